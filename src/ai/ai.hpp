@@ -41,6 +41,13 @@ public:
 	 */
 	static bool CanStartNew();
 
+	/**
+	 * Are the AI instances run by this game?
+	 * Network clients, and replays of a command log, only execute the commands of the AIs of the server.
+	 * @return True if the AI instances are run here.
+	 */
+	static bool IsRunningInstances();
+
 	/**
 	 * Start a new AI company.
 	 * @param company At which slot the AI company should start.
@@ -17,6 +17,7 @@
 #include "../framerate_type.h"
 #include "../scope_info.h"
 #include "../string_func.h"
+#include "../command_log_replay.h"
 #include "ai_scanner.hpp"
 #include "ai_instance.hpp"
 #include "ai_config.hpp"
@@ -35,12 +36,17 @@
 	return !_networking || (_network_server && _settings_game.ai.ai_in_multiplayer);
 }
 
+/* static */ bool AI::IsRunningInstances()
+{
+	return (!_networking || _network_server) && !IsReplayingCommandLog();
+}
+
 /* static */ void AI::StartNew(CompanyID company, bool rerandomise_ai)
 {
 	assert(Company::IsValidID(company));
 
 	/* Clients shouldn't start AIs */
-	if (_networking && !_network_server) return;
+	if (!AI::IsRunningInstances()) return;
 
 	AIConfig *config = AIConfig::GetConfig(company, AIConfig::SSS_FORCE_GAME);
 	AIInfo *info = config->GetInfo();
@@ -104,7 +110,7 @@
 
 /* static */ void AI::Stop(CompanyID company)
 {
-	if (_networking && !_network_server) return;
+	if (!AI::IsRunningInstances()) return;
 	PerformanceMeasurer::SetInactive((PerformanceElement)(PFE_AI0 + company));
 
 	Backup<CompanyID> cur_company(_current_company, company, FILE_LINE);
@@ -235,7 +241,7 @@
 	event->AddRef();
 
 	/* Clients should ignore events */
-	if (_networking && !_network_server) {
+	if (!AI::IsRunningInstances()) {
 		event->Release();
 		return;
 	}
@@ -260,7 +266,7 @@
 	event->AddRef();
 
 	/* Clients should ignore events */
-	if (_networking && !_network_server) {
+	if (!AI::IsRunningInstances()) {
 		event->Release();
 		return;
 	}
@@ -275,7 +281,7 @@
 
 /* static */ void AI::Save(CompanyID company)
 {
-	if (!_networking || _network_server) {
+	if (AI::IsRunningInstances()) {
 		Company *c = Company::GetIfValid(company);
 		assert(c != nullptr && c->ai_instance != nullptr);
 
@@ -289,7 +295,7 @@
 
 /* static */ void AI::Load(CompanyID company, int version)
 {
-	if (!_networking || _network_server) {
+	if (AI::IsRunningInstances()) {
 		Company *c = Company::GetIfValid(company);
 		assert(c != nullptr && c->ai_instance != nullptr);
 
@@ -181,6 +181,7 @@ struct BaseStation : StationPool::PoolItem<&_station_pool> {
 	}
 
 	static void PostDestructor(size_t index);
+	static void PreCleanPool();
 
 private:
 	void FillCachedName() const;
@@ -15,6 +15,8 @@
 
 #include "../table/sprites.h"
 
+#include <chrono>
+
 #include "../safeguards.h"
 
 /** Instantiation of the 32bpp with animation blitter factory. */
@@ -25,6 +27,32 @@ Blitter_32bppAnim::~Blitter_32bppAnim()
 	free(this->anim_alloc);
 }
 
+/**
+ * Note that an area of the animation buffer may contain animated colours.
+ * @param anim_offset Offset of the top left pixel of the area in the animation buffer.
+ * @param width Width of the area.
+ * @param height Height of the area.
+ */
+void Blitter_32bppAnim::MarkAnimated(int anim_offset, int width, int height)
+{
+	if (width <= 0 || height <= 0) return;
+
+	const int top = anim_offset / this->anim_buf_pitch;
+	const int left = anim_offset % this->anim_buf_pitch;
+	const int right = min(left + width, this->anim_buf_width);
+	const int bottom = min(top + height, this->anim_buf_height);
+	for (int y = top; y < bottom; y++) {
+		AnimatedSpan &span = this->anim_spans[y];
+		if (span.left >= span.right) {
+			span.left = left;
+			span.right = right;
+		} else {
+			span.left = min<int>(span.left, left);
+			span.right = max<int>(span.right, right);
+		}
+	}
+}
+
 template <BlitterMode mode, bool fast_path>
 inline void Blitter_32bppAnim::Draw(const Blitter::BlitterParams *bp, ZoomLevel zoom)
 {
@@ -282,6 +310,7 @@ void Blitter_32bppAnim::Draw(Blitter::BlitterParams *bp, BlitterMode mode, ZoomL
 	}
 
 	const BlitterSpriteFlags sprite_flags = ((const SpriteData *) bp->sprite)->flags;
+	this->MarkAnimatedSprite(bp, mode, sprite_flags);
 
 	switch (mode) {
 		default: NOT_REACHED();
@@ -356,6 +385,7 @@ void Blitter_32bppAnim::SetPixel(void *video, int x, int y, uint8 colour)
 	/* Set the colour in the anim-buffer too, if we are rendering to the screen */
 	if (_screen_disable_anim) return;
 	this->anim_buf[this->ScreenToAnimOffset((uint32 *)video) + x + y * this->anim_buf_pitch] = colour | (DEFAULT_BRIGHTNESS << 8);
+	if (colour >= PALETTE_ANIM_START) this->MarkAnimated(this->ScreenToAnimOffset((uint32 *)video) + x + y * this->anim_buf_pitch, 1, 1);
 }
 
 void Blitter_32bppAnim::DrawLine(void *video, int x, int y, int x2, int y2, int screen_width, int screen_height, uint8 colour, int width, int dash)
@@ -367,11 +397,14 @@ void Blitter_32bppAnim::DrawLine(void *video, int x, int y, int x2, int y2, int
 			*((Colour *)video + x + y * _screen.pitch) = c;
 		});
 	} else {
-		uint16 * const offset_anim_buf = this->anim_buf + this->ScreenToAnimOffset((uint32 *)video);
+		const int anim_offset = this->ScreenToAnimOffset((uint32 *)video);
+		uint16 * const offset_anim_buf = this->anim_buf + anim_offset;
 		const uint16 anim_colour = colour | (DEFAULT_BRIGHTNESS << 8);
+		const bool animated = colour >= PALETTE_ANIM_START;
 		this->DrawLineGeneric(x, y, x2, y2, screen_width, screen_height, width, dash, [&](int x, int y) {
 			*((Colour *)video + x + y * _screen.pitch) = c;
 			offset_anim_buf[x + y * this->anim_buf_pitch] = anim_colour;
+			if (animated) this->MarkAnimated(anim_offset + x + y * this->anim_buf_pitch, 1, 1);
 		});
 	}
 }
@@ -387,14 +420,17 @@ void Blitter_32bppAnim::SetLine(void *video, int x, int y, uint8 *colours, uint
 			colours++;
 		} while (--width);
 	} else {
-		uint16 *dstanim = (uint16 *)(&this->anim_buf[this->ScreenToAnimOffset((uint32 *)video) + x + y * this->anim_buf_pitch]);
-		do {
-			*dstanim = *colours | (DEFAULT_BRIGHTNESS << 8);
-			*dst = LookupColourInPalette(*colours);
+		const int anim_offset = this->ScreenToAnimOffset((uint32 *)video) + x + y * this->anim_buf_pitch;
+		uint16 *dstanim = (uint16 *)(&this->anim_buf[anim_offset]);
+		bool animated = false;
+		for (uint i = 0; i < width; i++) {
+			if (colours[i] >= PALETTE_ANIM_START) animated = true;
+			*dstanim = colours[i] | (DEFAULT_BRIGHTNESS << 8);
+			*dst = LookupColourInPalette(colours[i]);
 			dst++;
 			dstanim++;
-			colours++;
-		} while (--width);
+		}
+		if (animated) this->MarkAnimated(anim_offset, width, 1);
 	}
 }
 
@@ -430,6 +466,7 @@ void Blitter_32bppAnim::DrawRect(void *video, int width, int height, uint8 colou
 
 	Colour colour32 = LookupColourInPalette(colour);
 	uint16 *anim_line = this->ScreenToAnimOffset((uint32 *)video) + this->anim_buf;
+	if (colour >= PALETTE_ANIM_START) this->MarkAnimated(this->ScreenToAnimOffset((uint32 *)video), width, height);
 
 	do {
 		Colour *dst = (Colour *)video;
@@ -454,6 +491,7 @@ void Blitter_32bppAnim::CopyFromBuffer(void *video, const void *src, int width,
 	Colour *dst = (Colour *)video;
 	const uint32 *usrc = (const uint32 *)src;
 	uint16 *anim_line = this->ScreenToAnimOffset((uint32 *)video) + this->anim_buf;
+	this->MarkAnimated(this->ScreenToAnimOffset((uint32 *)video), width, height);
 
 	for (; height > 0; height--) {
 		/* We need to keep those for palette animation. */
@@ -557,6 +595,16 @@ void Blitter_32bppAnim::ScrollBuffer(void *video, int left, int top, int width,
 		}
 	}
 
+	/* Move the animated spans along with the animation buffer; keeping the old spans of the rows as well is harmless. */
+	const std::vector<AnimatedSpan> old_spans(this->anim_spans.begin() + top, this->anim_spans.begin() + top + height);
+	for (int y = max(top, top + scroll_y); y < min(top + height, top + height + scroll_y); y++) {
+		const AnimatedSpan &span = old_spans[y - scroll_y - top];
+		if (span.left >= span.right) continue;
+		const int span_left = max(span.left + scroll_x, left);
+		const int span_right = min(span.right + scroll_x, left + width);
+		this->MarkAnimated(y * this->anim_buf_pitch + span_left, span_right - span_left, 1);
+	}
+
 	Blitter_32bppBase::ScrollBuffer(video, left, top, width, height, scroll_x, scroll_y);
 }
 
@@ -575,30 +623,101 @@ void Blitter_32bppAnim::PaletteAnimate(const Palette &palette)
 	 *  Especially when going between toyland and non-toyland. */
 	assert(this->palette.first_dirty == PALETTE_ANIM_START || this->palette.first_dirty == 0);
 
-	const uint16 *anim = this->anim_buf;
-	Colour *dst = (Colour *)_screen.dst_ptr;
-
-	/* Let's walk the anim buffer and try to find the pixels */
-	const int width = this->anim_buf_width;
-	const int pitch_offset = _screen.pitch - width;
-	const int anim_pitch_offset = this->anim_buf_pitch - width;
-	for (int y = this->anim_buf_height; y != 0 ; y--) {
-		for (int x = width; x != 0 ; x--) {
+	/* Let's walk the rows of the anim buffer with animated spans and try to find the pixels */
+	int dirty_left = this->anim_buf_width;
+	int dirty_right = 0;
+	int dirty_top = this->anim_buf_height;
+	int dirty_bottom = 0;
+	for (int y = 0; y < this->anim_buf_height; y++) {
+		AnimatedSpan &span = this->anim_spans[y];
+		if (span.left >= span.right) continue;
+
+		const uint16 *anim = this->anim_buf + y * this->anim_buf_pitch + span.left;
+		Colour *dst = (Colour *)_screen.dst_ptr + y * _screen.pitch + span.left;
+		int animated_left = span.right;
+		int animated_right = span.left;
+		for (int x = span.left; x < span.right; x++) {
 			uint16 value = *anim;
 			uint8 colour = GB(value, 0, 8);
 			if (colour >= PALETTE_ANIM_START) {
 				/* Update this pixel */
 				*dst = this->AdjustBrightness(LookupColourInPalette(colour), GB(value, 8, 8));
+				animated_left = min(animated_left, x);
+				animated_right = x + 1;
 			}
 			dst++;
 			anim++;
 		}
-		dst += pitch_offset;
-		anim += anim_pitch_offset;
+
+		/* Shrink the span to the pixels which are actually animated. */
+		if (animated_left < animated_right) {
+			span.left = animated_left;
+			span.right = animated_right;
+			dirty_left = min(dirty_left, animated_left);
+			dirty_right = max(dirty_right, animated_right);
+			dirty_top = min(dirty_top, y);
+			dirty_bottom = y + 1;
+		} else {
+			span.left = span.right = 0;
+		}
 	}
 
-	/* Make sure the backend redraws the whole screen */
-	VideoDriver::GetInstance()->MakeDirty(0, 0, _screen.width, _screen.height);
+	if (dirty_left < dirty_right) {
+		/* Make sure the backend redraws the animated area */
+		VideoDriver::GetInstance()->MakeDirty(dirty_left, dirty_top, dirty_right - dirty_left, dirty_bottom - dirty_top);
+	}
+}
+
+/**
+ * Time palette animation of the current screen, when scanning all of the screen and when only scanning the animated spans.
+ * @param b Buffer to write the results to.
+ * @param last Last character of the buffer.
+ * @param iterations Number of palette animations to time.
+ */
+void Blitter_32bppAnim::BenchmarkPaletteAnimation(char *b, const char *last, uint iterations)
+{
+	Palette palette = this->palette;
+	palette.first_dirty = PALETTE_ANIM_START;
+	palette.count_dirty = 256 - PALETTE_ANIM_START;
+
+	for (bool full_scan : { true, false }) {
+		auto start = std::chrono::steady_clock::now();
+		for (uint i = 0; i < iterations; i++) {
+			if (full_scan) this->MarkAnimated(0, this->anim_buf_width, this->anim_buf_height);
+			this->PaletteAnimate(palette);
+		}
+		uint64 us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+		b += seprintf(b, last, "  %s: " OTTD_PRINTF64U " us\n", full_scan ? "full screen   " : "animated spans", us);
+	}
+
+	uint rows = 0;
+	uint64 pixels = 0;
+	for (const AnimatedSpan &span : this->anim_spans) {
+		if (span.left >= span.right) continue;
+		rows++;
+		pixels += span.right - span.left;
+	}
+	b += seprintf(b, last, "  %d x %d screen, %u rows with animated spans, " OTTD_PRINTF64U " pixels in spans\n",
+			this->anim_buf_width, this->anim_buf_height, rows, pixels);
+}
+
+/**
+ * Time palette animation of the current screen with the current blitter.
+ * @param b Buffer to write the results to.
+ * @param last Last character of the buffer.
+ * @param iterations Number of palette animations to time.
+ */
+void BenchmarkPaletteAnimation(char *b, const char *last, uint iterations)
+{
+	Blitter_32bppAnim *blitter = dynamic_cast<Blitter_32bppAnim *>(BlitterFactory::GetCurrentBlitter());
+	if (blitter == nullptr || _screen_disable_anim || _screen.dst_ptr == nullptr) {
+		seprintf(b, last, "Palette animation benchmark needs a 32bpp blitter with palette animation\n");
+		return;
+	}
+
+	b += seprintf(b, last, "Palette animation with %s: %u iterations\n", blitter->GetName(), iterations);
+	blitter->BenchmarkPaletteAnimation(b, last, iterations);
 }
 
 Blitter::PaletteAnimation Blitter_32bppAnim::UsePaletteAnimation()
@@ -618,5 +737,8 @@ void Blitter_32bppAnim::PostResize()
 
 		/* align buffer to next 16 byte boundary */
 		this->anim_buf = reinterpret_cast<uint16 *>((reinterpret_cast<uintptr_t>(this->anim_alloc) + 0xF) & (~0xF));
+
+		/* The buffer is cleared, so nothing is animated */
+		this->anim_spans.assign(this->anim_buf_height, AnimatedSpan{ 0, 0 });
 	}
 }
@@ -12,6 +12,8 @@
 
 #include "32bpp_optimized.hpp"
 
+#include <vector>
+
 /** The optimised 32 bpp blitter with palette animation. */
 class Blitter_32bppAnim : public Blitter_32bppOptimized {
 protected:
@@ -22,6 +24,31 @@ protected:
 	int anim_buf_height; ///< The height of the animation buffer.
 	Palette palette;     ///< The current palette.
 
+	/**
+	 * Span of a row of the animation buffer which may contain animated colours.
+	 * The pixels of the row outside of the span are never animated.
+	 */
+	struct AnimatedSpan {
+		uint16 left;  ///< First pixel of the span.
+		uint16 right; ///< One past the last pixel of the span; the span is empty when this is not more than #left.
+	};
+	std::vector<AnimatedSpan> anim_spans; ///< Per row of the animation buffer, the span which may contain animated colours.
+
+	void MarkAnimated(int anim_offset, int width, int height);
+
+	/**
+	 * Note the area a sprite is drawn to, when drawing it may store animated colours in the animation buffer.
+	 * @param bp The parameters of the draw.
+	 * @param mode The blitter mode of the draw.
+	 * @param sprite_flags The flags of the sprite.
+	 */
+	inline void MarkAnimatedSprite(const Blitter::BlitterParams *bp, BlitterMode mode, BlitterSpriteFlags sprite_flags)
+	{
+		if (mode == BM_TRANSPARENT || mode == BM_BLACK_REMAP) return;
+		if (mode == BM_NORMAL && (sprite_flags & SF_NO_ANIM)) return;
+		this->MarkAnimated(this->ScreenToAnimOffset((uint32 *)bp->dst) + bp->top * this->anim_buf_pitch + bp->left, bp->width, bp->height);
+	}
+
 public:
 	Blitter_32bppAnim() :
 		anim_buf(nullptr),
@@ -71,6 +98,8 @@ public:
 	}
 
 	template <BlitterMode mode, bool no_anim_translucent> void Draw(const Blitter::BlitterParams *bp, ZoomLevel zoom);
+
+	void BenchmarkPaletteAnimation(char *b, const char *last, uint iterations);
 };
 
 /** Factory for the 32bpp blitter with animation. */
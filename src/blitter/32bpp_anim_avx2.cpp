@@ -0,0 +1,200 @@
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file 32bpp_anim_avx2.cpp Implementation of the AVX2 32 bpp blitter with animation support. */
+
+#ifdef WITH_AVX2
+
+#include "../stdafx.h"
+#include "../video/video_driver.hpp"
+#include "../table/sprites.h"
+#include "32bpp_anim_avx2.hpp"
+#include "32bpp_sse_func.hpp"
+#include "32bpp_avx2_func.hpp"
+
+#include "../safeguards.h"
+
+/** Instantiation of the AVX2 32bpp blitter factory. */
+static FBlitter_32bppAVX2_Anim iFBlitter_32bppAVX2_Anim;
+
+/**
+ * Draws a sprite to a (screen) buffer. It is templated to allow faster operation.
+ *
+ * @tparam mode blitter mode
+ * @tparam read_mode how to skip the transparent pixels at the start of the lines
+ * @tparam translucent whether the sprite has translucent pixels
+ * @tparam animated whether the sprite has pixels that are drawn with the animated colours; only used by BM_NORMAL
+ * @param bp further blitting parameters
+ * @param zoom zoom level at which we are drawing
+ */
+template <BlitterMode mode, Blitter_32bppSSE_Base::ReadMode read_mode, bool translucent, bool animated>
+inline void Blitter_32bppAVX2_Anim::Draw(const Blitter::BlitterParams *bp, ZoomLevel zoom)
+{
+	const byte * const remap = bp->remap;
+	Colour *dst_line = (Colour *) bp->dst + bp->top * bp->pitch + bp->left;
+	uint16 *anim_line = this->anim_buf + this->ScreenToAnimOffset((uint32 *)bp->dst) + bp->top * this->anim_buf_pitch + bp->left;
+	int effective_width = bp->width;
+
+	/* Find where to start reading in the source sprite. */
+	const Blitter_32bppSSE_Base::SpriteData * const sd = (const Blitter_32bppSSE_Base::SpriteData *) bp->sprite;
+	const SpriteInfo * const si = &sd->infos[zoom];
+	const MapValue *src_mv_line = (const MapValue *) &sd->data[si->mv_offset] + bp->skip_top * si->sprite_width;
+	const Colour *src_rgba_line = (const Colour *) ((const byte *) &sd->data[si->sprite_offset] + bp->skip_top * si->sprite_line_size);
+
+	if (read_mode != RM_WITH_MARGIN) {
+		src_rgba_line += bp->skip_left;
+		src_mv_line += bp->skip_left;
+	}
+
+	/* Load these variables into register before loop. */
+	const __m256i a_cm        = BroadcastLanes(ALPHA_CONTROL_MASK);
+	const __m256i pack_low_cm = PACK_LOW_AVX2_MASK;
+	const __m256i tr_nom_base = _mm256_set1_epi16(256);
+
+	for (int y = bp->height; y != 0; y--) {
+		Colour *dst = dst_line;
+		const Colour *src = src_rgba_line + META_LENGTH;
+		const MapValue *src_mv = src_mv_line;
+		uint16 *anim = anim_line;
+
+		if (read_mode == RM_WITH_MARGIN) {
+			anim += src_rgba_line[0].data;
+			src += src_rgba_line[0].data;
+			dst += src_rgba_line[0].data;
+			src_mv += src_rgba_line[0].data;
+			const int width_diff = si->sprite_width - bp->width;
+			effective_width = bp->width - (int) src_rgba_line[0].data;
+			const int delta_diff = (int) src_rgba_line[1].data - width_diff;
+			const int new_width = effective_width - delta_diff;
+			effective_width = delta_diff > 0 ? new_width : effective_width;
+		}
+
+		for (int x = effective_width; x > 0; x -= 8) {
+			__m256i srcABCD = LoadEightPixels(src, x);
+			const __m256i dstABCD = LoadEightPixels(dst, x);
+			const __m128i alphaABCD = AlphaOfEightPixels(srcABCD);
+			const __m128i drawn = _mm_xor_si128(_mm_cmpeq_epi16(alphaABCD, _mm_setzero_si128()), _mm_set1_epi16(-1));
+			__m128i animABCD = LoadEightUint16(anim, x);
+
+			switch (mode) {
+				default:
+					if (animated) {
+						const __m128i mvABCD = LoadEightUint16(src_mv, x);
+
+						/* Pixels with an animated colour get the current colour from the palette. */
+						const __m128i mABCD = _mm_and_si128(mvABCD, _mm_set1_epi16(0xFF));
+						if (!_mm_testz_si128(_mm_cmpgt_epi16(mABCD, _mm_set1_epi16(PALETTE_ANIM_START - 1)), _mm_set1_epi16(-1))) {
+							ALIGN(32) Colour colours[8];
+							_mm256_store_si256((__m256i *) colours, srcABCD);
+							um128i mvs;
+							mvs.m128i = mvABCD;
+							for (uint i = 0; i < 8; i++) {
+								const uint8 m = mvs.m128i_u8[i * 2];
+								if (m < PALETTE_ANIM_START) continue;
+								const Colour c = (this->LookupColourInPalette(m).data & 0x00FFFFFF) | (colours[i].data & 0xFF000000);
+								colours[i] = AdjustBrightneSSE(c, mvs.m128i_u8[i * 2 + 1]);
+							}
+							srcABCD = _mm256_load_si256((const __m256i *) colours);
+						}
+
+						/* Fully opaque pixels take over the map value, translucent ones reset it. */
+						const __m128i opaque = _mm_cmpeq_epi16(alphaABCD, _mm_set1_epi16(255));
+						animABCD = _mm_blendv_epi8(animABCD, _mm_and_si128(mvABCD, opaque), drawn);
+					} else {
+						animABCD = _mm_andnot_si128(drawn, animABCD);
+					}
+					srcABCD = translucent ? AlphaBlendEightPixels(srcABCD, dstABCD, a_cm, pack_low_cm) : CopyEightPixels(srcABCD, dstABCD);
+					break;
+
+				case BM_COLOUR_REMAP: {
+					const __m128i mvABCD = LoadEightUint16(src_mv, x);
+					if (!_mm_testz_si128(mvABCD, _mm_set1_epi16(0xFF))) {
+						srcABCD = RemapEightPixels(srcABCD, mvABCD, remap, this->palette.palette, _mm256_setzero_si256());
+						if (NeedsBrightnessAdjustment(mvABCD)) srcABCD = AdjustBrightnessOfEightPixels(srcABCD, mvABCD);
+					}
+
+					/* Fully opaque remapped pixels get the remapped colour with their brightness, other pixels reset it. */
+					um128i mvs, remapped;
+					mvs.m128i = mvABCD;
+					for (uint i = 0; i < 8; i++) remapped.m128i_u16[i] = remap[mvs.m128i_u8[i * 2]];
+					const __m128i mapped = _mm_andnot_si128(_mm_cmpeq_epi16(_mm_and_si128(mvABCD, _mm_set1_epi16(0xFF)), _mm_setzero_si128()), _mm_cmpeq_epi16(alphaABCD, _mm_set1_epi16(255)));
+					const __m128i remapped_anim = _mm_or_si128(_mm_and_si128(mvABCD, _mm_set1_epi16((short)0xFF00)), remapped.m128i);
+					animABCD = _mm_blendv_epi8(animABCD, _mm_and_si128(remapped_anim, mapped), drawn);
+					srcABCD = AlphaBlendEightPixels(srcABCD, dstABCD, a_cm, pack_low_cm);
+					break;
+				}
+
+				case BM_TRANSPARENT:
+					/* Make the current colour a bit more black, so it looks like this image is transparent. */
+					animABCD = _mm_andnot_si128(drawn, animABCD);
+					srcABCD = DarkenEightPixels(srcABCD, dstABCD, a_cm, tr_nom_base);
+					break;
+			}
+
+			StoreEightPixels(dst, x, srcABCD);
+			StoreEightUint16(anim, x, animABCD);
+			src_mv += 8;
+			src += 8;
+			dst += 8;
+			anim += 8;
+		}
+
+		src_mv_line += si->sprite_width;
+		src_rgba_line = (const Colour*) ((const byte*) src_rgba_line + si->sprite_line_size);
+		dst_line += bp->pitch;
+		anim_line += this->anim_buf_pitch;
+	}
+}
+
+/**
+ * Draws a sprite to a (screen) buffer. Calls adequate templated function.
+ *
+ * @param bp further blitting parameters
+ * @param mode blitter mode
+ * @param zoom zoom level at which we are drawing
+ */
+void Blitter_32bppAVX2_Anim::Draw(Blitter::BlitterParams *bp, BlitterMode mode, ZoomLevel zoom)
+{
+	const BlitterSpriteFlags sprite_flags = ((const Blitter_32bppSSE_Base::SpriteData *) bp->sprite)->flags;
+	switch (mode) {
+		case BM_CRASH_REMAP:
+		case BM_BLACK_REMAP:
+			Blitter_32bppSSE4_Anim::Draw(bp, mode, zoom);
+			return;
+
+		default: break;
+	}
+
+	if (!_screen_disable_anim) this->MarkAnimatedSprite(bp, mode, sprite_flags);
+	switch (mode) {
+		default: {
+bm_normal:
+			if (bp->skip_left != 0 || bp->width <= MARGIN_NORMAL_THRESHOLD) {
+				if (sprite_flags & SF_NO_ANIM) Draw<BM_NORMAL, RM_WITH_SKIP, true, false>(bp, zoom);
+				else                           Draw<BM_NORMAL, RM_WITH_SKIP, true, true>(bp, zoom);
+			} else if (sprite_flags & SF_TRANSLUCENT) {
+				if (sprite_flags & SF_NO_ANIM) Draw<BM_NORMAL, RM_WITH_MARGIN, true, false>(bp, zoom);
+				else                           Draw<BM_NORMAL, RM_WITH_MARGIN, true, true>(bp, zoom);
+			} else {
+				if (sprite_flags & SF_NO_ANIM) Draw<BM_NORMAL, RM_WITH_MARGIN, false, false>(bp, zoom);
+				else                           Draw<BM_NORMAL, RM_WITH_MARGIN, false, true>(bp, zoom);
+			}
+			break;
+		}
+		case BM_COLOUR_REMAP:
+			if (sprite_flags & SF_NO_REMAP) goto bm_normal;
+			if (bp->skip_left != 0 || bp->width <= MARGIN_REMAP_THRESHOLD) {
+				Draw<BM_COLOUR_REMAP, RM_WITH_SKIP, true, true>(bp, zoom);
+			} else {
+				Draw<BM_COLOUR_REMAP, RM_WITH_MARGIN, true, true>(bp, zoom);
+			}
+			break;
+		case BM_TRANSPARENT: Draw<BM_TRANSPARENT, RM_NONE, true, true>(bp, zoom); break;
+	}
+}
+
+#endif /* WITH_AVX2 */
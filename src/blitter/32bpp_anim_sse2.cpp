@@ -29,22 +29,27 @@ void Blitter_32bppSSE2_Anim::PaletteAnimate(const Palette &palette)
 	 *  Especially when going between toyland and non-toyland. */
 	assert(this->palette.first_dirty == PALETTE_ANIM_START || this->palette.first_dirty == 0);
 
-	const uint16 *anim = this->anim_buf;
-	Colour *dst = (Colour *)_screen.dst_ptr;
-
-	bool screen_dirty = false;
-
-	/* Let's walk the anim buffer and try to find the pixels */
-	const int width = this->anim_buf_width;
+	/* Let's walk the rows of the anim buffer with animated spans and try to find the pixels */
 	const int screen_pitch = _screen.pitch;
 	const int anim_pitch = this->anim_buf_pitch;
 	__m128i anim_cmp = _mm_set1_epi16(PALETTE_ANIM_START - 1);
 	__m128i brightness_cmp = _mm_set1_epi16(Blitter_32bppBase::DEFAULT_BRIGHTNESS);
 	__m128i colour_mask = _mm_set1_epi16(0xFF);
-	for (int y = this->anim_buf_height; y != 0 ; y--) {
-		Colour *next_dst_ln = dst + screen_pitch;
-		const uint16 *next_anim_ln = anim + anim_pitch;
-		int x = width;
+	int dirty_left = this->anim_buf_width;
+	int dirty_right = 0;
+	int dirty_top = this->anim_buf_height;
+	int dirty_bottom = 0;
+	for (int y = 0; y < this->anim_buf_height; y++) {
+		AnimatedSpan &span = this->anim_spans[y];
+		if (span.left >= span.right) continue;
+
+		/* Rows of the anim buffer are 16 byte aligned, so start at the 8 pixel block containing the span. */
+		const int first = span.left & ~7;
+		const uint16 *anim = this->anim_buf + y * anim_pitch + first;
+		Colour *dst = (Colour *)_screen.dst_ptr + y * screen_pitch + first;
+		int animated_left = span.right;
+		int animated_right = span.left;
+		int x = span.right - first;
 		while (x > 0) {
 			__m128i data = _mm_load_si128((const __m128i *) anim);
 
@@ -54,6 +59,11 @@ void Blitter_32bppSSE2_Anim::PaletteAnimate(const Palette &palette)
 			/* test if any colour >= PALETTE_ANIM_START */
 			int colour_cmp_result = _mm_movemask_epi8(_mm_cmpgt_epi16(colour_data, anim_cmp));
 			if (unlikely(colour_cmp_result)) {
+				/* Each pixel has two bits in the result. */
+				const int block_left = span.right - x;
+				animated_left = min(animated_left, block_left + (int)FindFirstBit(colour_cmp_result) / 2);
+				animated_right = max(animated_right, min<int>(span.right, block_left + (int)FindLastBit(colour_cmp_result) / 2 + 1));
+
 				/* test if any brightness is unexpected */
 				if (unlikely(x < 8 || colour_cmp_result != 0xFFFF ||
 						_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_srli_epi16(data, 8), brightness_cmp)) != 0xFFFF)) {
@@ -64,7 +74,6 @@ void Blitter_32bppSSE2_Anim::PaletteAnimate(const Palette &palette)
 						if (colour >= PALETTE_ANIM_START) {
 							/* Update this pixel */
 							*dst = AdjustBrightneSSE(LookupColourInPalette(colour), GB(value, 8, 8));
-							screen_dirty = true;
 						}
 						data = _mm_srli_si128(data, 2);
 						dst++;
@@ -76,7 +85,6 @@ void Blitter_32bppSSE2_Anim::PaletteAnimate(const Palette &palette)
 						colour_data = _mm_srli_si128(colour_data, 2);
 						dst++;
 					}
-					screen_dirty = true;
 				}
 			} else {
 				/* fast path, no animation */
@@ -85,13 +93,23 @@ void Blitter_32bppSSE2_Anim::PaletteAnimate(const Palette &palette)
 			anim += 8;
 			x -= 8;
 		}
-		dst = next_dst_ln;
-		anim = next_anim_ln;
+
+		/* Shrink the span to the pixels which are actually animated. */
+		if (animated_left < animated_right) {
+			span.left = animated_left;
+			span.right = animated_right;
+			dirty_left = min(dirty_left, animated_left);
+			dirty_right = max(dirty_right, animated_right);
+			dirty_top = min(dirty_top, y);
+			dirty_bottom = y + 1;
+		} else {
+			span.left = span.right = 0;
+		}
 	}
 
-	if (screen_dirty) {
-		/* Make sure the backend redraws the whole screen */
-		VideoDriver::GetInstance()->MakeDirty(0, 0, _screen.width, _screen.height);
+	if (dirty_left < dirty_right) {
+		/* Make sure the backend redraws the animated area */
+		VideoDriver::GetInstance()->MakeDirty(dirty_left, dirty_top, dirty_right - dirty_left, dirty_bottom - dirty_top);
 	}
 }
 
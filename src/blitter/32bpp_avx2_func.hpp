@@ -0,0 +1,214 @@
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file 32bpp_avx2_func.hpp Functions related to AVX2 32 bpp blitters. */
+
+#ifndef BLITTER_32BPP_AVX2_FUNC_HPP
+#define BLITTER_32BPP_AVX2_FUNC_HPP
+
+#ifdef WITH_AVX2
+
+#include <immintrin.h>
+
+/* The 256 bits registers are handled as two 128 bits lanes, each lane holding four pixels.
+ * Unpacking the pixels to 16 bits puts pixels 0, 1, 4 and 5 in the low half and pixels 2, 3,
+ * 6 and 7 in the high half; packing them again restores the original order. As such, the
+ * control masks of the SSE blitters can be used for each lane. */
+
+/** Put the same 128 bits in both lanes of a 256 bits register. */
+static inline __m256i BroadcastLanes(const __m128i from)
+{
+	return _mm256_inserti128_si256(_mm256_castsi128_si256(from), from, 1);
+}
+
+/** Keep the low bytes of the colour channels and clear the alpha channel, like PACK_LOW_CONTROL_MASK. */
+#define PACK_LOW_AVX2_MASK _mm256_set1_epi64x(0x000000FF00FF00FFLL)
+
+/**
+ * Get the mask to load or store the first pixels of a block of eight.
+ * @param count The number of pixels, less than eight.
+ * @return The mask.
+ */
+static inline __m256i TailMask(int count)
+{
+	return _mm256_cmpgt_epi32(_mm256_set1_epi32(count), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+}
+
+/** Load eight pixels, or only the first \a count of them when there are less. */
+static inline __m256i LoadEightPixels(const Colour *from, int count)
+{
+	if (likely(count >= 8)) return _mm256_loadu_si256((const __m256i *) from);
+	return _mm256_maskload_epi32((const int *) from, TailMask(count));
+}
+
+/** Store eight pixels, or only the first \a count of them when there are less. */
+static inline void StoreEightPixels(Colour *to, int count, __m256i pixels)
+{
+	if (likely(count >= 8)) {
+		_mm256_storeu_si256((__m256i *) to, pixels);
+	} else {
+		_mm256_maskstore_epi32((int *) to, TailMask(count), pixels);
+	}
+}
+
+/** Load eight uint16 values (map values or animation buffer entries), or only the first \a count of them. */
+static inline __m128i LoadEightUint16(const void *from, int count)
+{
+	if (likely(count >= 8)) return _mm_loadu_si128((const __m128i *) from);
+	um128i tmp;
+	tmp.m128i = _mm_setzero_si128();
+	memcpy(tmp.m128i_u16, from, count * sizeof(uint16));
+	return tmp.m128i;
+}
+
+/** Store eight uint16 values, or only the first \a count of them. */
+static inline void StoreEightUint16(void *to, int count, __m128i values)
+{
+	if (likely(count >= 8)) {
+		_mm_storeu_si128((__m128i *) to, values);
+	} else {
+		um128i tmp;
+		tmp.m128i = values;
+		memcpy(to, tmp.m128i_u16, count * sizeof(uint16));
+	}
+}
+
+/** Get the alpha channel of eight pixels as uint16, in pixel order. */
+static inline __m128i AlphaOfEightPixels(__m256i from)
+{
+	__m256i alpha = _mm256_srli_epi32(from, 24);
+	alpha = _mm256_packus_epi32(alpha, alpha);              // Per lane: a0 a1 a2 a3 a0 a1 a2 a3
+	alpha = _mm256_permute4x64_epi64(alpha, 0x08);          // Low 128 bits: a0 .. a7
+	return _mm256_castsi256_si128(alpha);
+}
+
+/** Copy the pixels of \a src that are not fully transparent over \a dst. */
+static inline __m256i CopyEightPixels(__m256i src, __m256i dst)
+{
+	const __m256i transparent = _mm256_cmpeq_epi32(_mm256_and_si256(src, _mm256_set1_epi32(0xFF000000)), _mm256_setzero_si256());
+	return _mm256_blendv_epi8(src, dst, transparent);
+}
+
+/** Alpha blend eight pixels; equal to AlphaBlendTwoPixels() for each pair of pixels. */
+static inline __m256i AlphaBlendEightPixels(__m256i src, __m256i dst, const __m256i &distribution_mask, const __m256i &pack_mask)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i srcLo = _mm256_unpacklo_epi8(src, zero);
+	__m256i srcHi = _mm256_unpackhi_epi8(src, zero);
+	const __m256i dstLo = _mm256_unpacklo_epi8(dst, zero);
+	const __m256i dstHi = _mm256_unpackhi_epi8(dst, zero);
+
+	__m256i alphaLo = _mm256_add_epi16(_mm256_srli_epi16(_mm256_cmpgt_epi16(srcLo, zero), 15), srcLo); // if (alpha > 0) a++;
+	__m256i alphaHi = _mm256_add_epi16(_mm256_srli_epi16(_mm256_cmpgt_epi16(srcHi, zero), 15), srcHi);
+	alphaLo = _mm256_shuffle_epi8(alphaLo, distribution_mask);
+	alphaHi = _mm256_shuffle_epi8(alphaHi, distribution_mask);
+
+	srcLo = _mm256_add_epi16(_mm256_srli_epi16(_mm256_mullo_epi16(_mm256_sub_epi16(srcLo, dstLo), alphaLo), 8), dstLo); // a*(r - Cr)/256 + Cr
+	srcHi = _mm256_add_epi16(_mm256_srli_epi16(_mm256_mullo_epi16(_mm256_sub_epi16(srcHi, dstHi), alphaHi), 8), dstHi);
+	return _mm256_packus_epi16(_mm256_and_si256(srcLo, pack_mask), _mm256_and_si256(srcHi, pack_mask));
+}
+
+/** Darken eight pixels; equal to DarkenTwoPixels() for each pair of pixels. */
+static inline __m256i DarkenEightPixels(__m256i src, __m256i dst, const __m256i &distribution_mask, const __m256i &tr_nom_base)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i alphaLo = _mm256_shuffle_epi8(_mm256_unpacklo_epi8(src, zero), distribution_mask);
+	__m256i alphaHi = _mm256_shuffle_epi8(_mm256_unpackhi_epi8(src, zero), distribution_mask);
+	const __m256i nomLo = _mm256_sub_epi16(tr_nom_base, _mm256_srli_epi16(alphaLo, 2));
+	const __m256i nomHi = _mm256_sub_epi16(tr_nom_base, _mm256_srli_epi16(alphaHi, 2));
+	const __m256i dstLo = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(dst, zero), nomLo), 8);
+	const __m256i dstHi = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(dst, zero), nomHi), 8);
+	return _mm256_packus_epi16(dstLo, dstHi);
+}
+
+/** Adjust the brightness of four unpacked pixels; the dataflow of AdjustBrightnessOfTwoPixels() for each lane. */
+static inline __m256i AdjustBrightnessOfFourPixels(__m256i colAB, __m256i briAB)
+{
+	const __m256i ob_value = BroadcastLanes(OVERBRIGHT_VALUE_MASK);
+	colAB = _mm256_mullo_epi16(colAB, briAB);
+	__m256i colAB_ob = _mm256_srli_epi16(colAB, 8 + 7);
+	colAB = _mm256_srli_epi16(colAB, 7);
+
+	/* Sum overbright, see AdjustBrightnessOfTwoPixels(). */
+	colAB = _mm256_and_si256(colAB, BroadcastLanes(BRIGHTNESS_DIV_CLEANER));
+	colAB_ob = _mm256_and_si256(colAB_ob, BroadcastLanes(OVERBRIGHT_PRESENCE_MASK));
+	colAB_ob = _mm256_mullo_epi16(colAB_ob, ob_value);
+	colAB_ob = _mm256_and_si256(colAB_ob, colAB);
+	__m256i obAB = _mm256_hadd_epi16(_mm256_hadd_epi16(colAB_ob, _mm256_setzero_si256()), _mm256_setzero_si256());
+
+	obAB = _mm256_srli_epi16(obAB, 1);
+	obAB = _mm256_shuffle_epi8(obAB, BroadcastLanes(OVERBRIGHT_CONTROL_MASK));
+	__m256i retAB = _mm256_subs_epu16(ob_value, colAB);
+	retAB = _mm256_mullo_epi16(retAB, obAB);
+	retAB = _mm256_srli_epi16(retAB, 8);
+	return _mm256_add_epi16(retAB, colAB);
+}
+
+/**
+ * Adjust the brightness of eight pixels.
+ * @param from The pixels.
+ * @param mv The map values of the pixels.
+ * @return The pixels with adjusted brightness.
+ */
+static inline __m256i AdjustBrightnessOfEightPixels(__m256i from, __m128i mv)
+{
+	/* Like AdjustBrightnessOfTwoPixels(), keep alpha by using DEFAULT_BRIGHTNESS in the unused byte. */
+	__m128i brightness = _mm_and_si128(mv, _mm_set1_epi32(0xFF00FF00));
+	brightness = _mm_add_epi32(brightness, _mm_set1_epi32(Blitter_32bppBase::DEFAULT_BRIGHTNESS));
+
+	/* Give each lane the brightness of its pixels: pixels 0 and 1 / 4 and 5 for the low half. */
+	const __m256i bri = _mm256_castsi128_si256(brightness);
+	const __m256i bri_control = BroadcastLanes(BRIGHTNESS_LOW_CONTROL_MASK);
+	const __m256i briLo = _mm256_shuffle_epi8(_mm256_permutevar8x32_epi32(bri, _mm256_setr_epi32(0, 0, 0, 0, 2, 2, 2, 2)), bri_control);
+	const __m256i briHi = _mm256_shuffle_epi8(_mm256_permutevar8x32_epi32(bri, _mm256_setr_epi32(1, 1, 1, 1, 3, 3, 3, 3)), bri_control);
+
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i retLo = AdjustBrightnessOfFourPixels(_mm256_unpacklo_epi8(from, zero), briLo);
+	const __m256i retHi = AdjustBrightnessOfFourPixels(_mm256_unpackhi_epi8(from, zero), briHi);
+	return _mm256_packus_epi16(retLo, retHi);
+}
+
+/**
+ * Remap eight pixels with a colour remap; pixels without a remap channel are kept.
+ * @param src The pixels.
+ * @param mv The map values of the pixels.
+ * @param remap The colour remap.
+ * @param palette The palette to get the remapped colours from.
+ * @param unmapped The colours for the pixels that are remapped to colour 0.
+ * @return The remapped pixels.
+ */
+static inline __m256i RemapEightPixels(__m256i src, __m128i mv, const byte *remap, const Colour *palette, __m256i unmapped)
+{
+	um128i mvs;
+	mvs.m128i = mv;
+	ALIGN(32) int32 r[8];
+	for (uint i = 0; i < 8; i++) r[i] = remap[mvs.m128i_u8[i * 2]];
+
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i rABCD = _mm256_load_si256((const __m256i *) r);
+	const __m256i mABCD = _mm256_and_si256(_mm256_cvtepu16_epi32(mv), _mm256_set1_epi32(0xFF));
+	__m256i cmap = _mm256_i32gather_epi32((const int *) palette, rABCD, 4);
+	cmap = _mm256_blendv_epi8(cmap, src, _mm256_set1_epi32(0xFF000000)); // Colour of the palette, alpha of the sprite.
+	cmap = _mm256_blendv_epi8(cmap, unmapped, _mm256_cmpeq_epi32(rABCD, zero));
+	return _mm256_blendv_epi8(cmap, src, _mm256_cmpeq_epi32(mABCD, zero));
+}
+
+/**
+ * Check whether any of eight pixels needs its brightness adjusted after remapping.
+ * Pixels without a remap channel have either the default brightness or are transparent.
+ * @param mv The map values of the pixels.
+ * @return True iff a remapped pixel has a non default brightness.
+ */
+static inline bool NeedsBrightnessAdjustment(__m128i mv)
+{
+	const __m128i unmapped = _mm_cmpeq_epi16(_mm_and_si128(mv, _mm_set1_epi16(0xFF)), _mm_setzero_si128());
+	const __m128i default_brightness = _mm_cmpeq_epi16(_mm_srli_epi16(mv, 8), _mm_set1_epi16(Blitter_32bppBase::DEFAULT_BRIGHTNESS));
+	return _mm_movemask_epi8(_mm_or_si128(unmapped, default_brightness)) != 0xFFFF;
+}
+
+#endif /* WITH_AVX2 */
+#endif /* BLITTER_32BPP_AVX2_FUNC_HPP */
@@ -12,9 +12,15 @@
 #include "../stdafx.h"
 #include "../zoom_func.h"
 #include "../settings_type.h"
+#include "../spritecache.h"
+#include "../table/sprites.h"
+#include "factory.hpp"
 #include "32bpp_sse2.hpp"
 #include "32bpp_sse_func.hpp"
 
+#include <chrono>
+#include <vector>
+
 #include "../safeguards.h"
 
 /** Instantiation of the SSE2 32bpp blitter factory. */
@@ -138,4 +144,103 @@ Sprite *Blitter_32bppSSE_Base::Encode(const SpriteLoader::Sprite *sprite, Alloca
 	return dst_sprite;
 }
 
+#ifdef WITH_AVX2
+/**
+ * Time drawing the sprites of the sprite cache with the SSE4 and the AVX2 blitter, and
+ * check both draw the same. The sprites are encoded by the current blitter, which thus
+ * has to be one of the SSE or AVX2 blitters.
+ * @param b Buffer to write the results to.
+ * @param last Last character of the buffer.
+ * @param iterations Number of times to draw all sprites for each blitter mode.
+ */
+void BenchmarkSpriteBlitters(char *b, const char *last, uint iterations)
+{
+	if (dynamic_cast<Blitter_32bppSSE_Base *>(BlitterFactory::GetCurrentBlitter()) == nullptr) {
+		seprintf(b, last, "Sprite blitter benchmark needs one of the 32bpp SSE or AVX2 blitters\n");
+		return;
+	}
+
+	static const char * const names[] = { "32bpp-sse4", "32bpp-avx2" };
+	std::unique_ptr<Blitter> blitters[lengthof(names)];
+	for (uint i = 0; i < lengthof(names); i++) {
+		BlitterFactory *factory = BlitterFactory::GetBlitterFactory(names[i]);
+		if (factory == nullptr) {
+			seprintf(b, last, "Blitter %s is not supported by this CPU\n", names[i]);
+			return;
+		}
+		blitters[i].reset(factory->CreateInstance());
+	}
+
+	static const int BUFFER_WIDTH = 512;
+	static const int BUFFER_HEIGHT = 256;
+	const ZoomLevel zoom = _settings_client.gui.zoom_min;
+
+	std::vector<SpriteID> sprites;
+	for (SpriteID s = 0; s < GetMaxSpriteID() && sprites.size() < 2000; s++) {
+		if (GetSpriteType(s) != ST_NORMAL) continue;
+		const Sprite *sprite = GetSprite(s, ST_NORMAL);
+		const int width = UnScaleByZoom(sprite->width, zoom);
+		const int height = UnScaleByZoom(sprite->height, zoom);
+		if (width <= 0 || height <= 0 || width > BUFFER_WIDTH - 8 || height > BUFFER_HEIGHT) continue;
+		sprites.push_back(s);
+	}
+
+	b += seprintf(b, last, "Drawing %u sprites %u times at zoom level %d\n", (uint)sprites.size(), iterations, zoom);
+
+	static const struct {
+		BlitterMode mode;
+		const char *name;
+	} modes[] = {
+		{ BM_NORMAL,       "normal      " },
+		{ BM_COLOUR_REMAP, "colour remap" },
+		{ BM_TRANSPARENT,  "transparent " },
+	};
+
+	std::vector<uint32> buffers[lengthof(names)];
+	for (const auto &mode : modes) {
+		uint64 us[lengthof(names)];
+		for (uint i = 0; i < lengthof(names); i++) {
+			std::vector<uint32> &buffer = buffers[i];
+			buffer.resize(BUFFER_WIDTH * BUFFER_HEIGHT);
+			for (uint p = 0; p < buffer.size(); p++) buffer[p] = 0xFF000000 | (p * 0x9E3779B9);
+
+			auto start = std::chrono::steady_clock::now();
+			for (uint j = 0; j < iterations; j++) {
+				for (uint k = 0; k < sprites.size(); k++) {
+					const Sprite *sprite = GetSprite(sprites[k], ST_NORMAL);
+					Blitter::BlitterParams bp;
+					bp.sprite = sprite->data;
+					bp.remap = GetNonSprite(PALETTE_TO_RED, ST_RECOLOUR) + 1;
+					bp.skip_left = 0;
+					bp.skip_top = 0;
+					bp.width = UnScaleByZoom(sprite->width, zoom);
+					bp.height = UnScaleByZoom(sprite->height, zoom);
+					bp.sprite_width = sprite->width;
+					bp.sprite_height = sprite->height;
+					bp.left = k % 8; // Vary the alignment of the destination.
+					bp.top = 0;
+					bp.dst = buffer.data();
+					bp.pitch = BUFFER_WIDTH;
+					blitters[i]->Draw(&bp, mode.mode, zoom);
+				}
+			}
+			us[i] = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+		}
+
+		/* The alpha channel of the destination is not used, and not always written the same. */
+		uint differ = 0;
+		for (uint p = 0; p < buffers[0].size(); p++) {
+			if (((buffers[0][p] ^ buffers[1][p]) & 0x00FFFFFF) != 0) differ++;
+		}
+
+		b += seprintf(b, last, "  %s: %s " OTTD_PRINTF64U " us, %s " OTTD_PRINTF64U " us, ", mode.name, names[0], us[0], names[1], us[1]);
+		if (differ == 0) {
+			b += seprintf(b, last, "identical output\n");
+		} else {
+			b += seprintf(b, last, "%u pixels differ\n", differ);
+		}
+	}
+}
+#endif /* WITH_AVX2 */
+
 #endif /* WITH_SSE */
@@ -409,6 +409,7 @@ void VehicleCargoList::Append(CargoPacket *cp, MoveToAction action)
 	assert(cp != nullptr);
 	assert(action == MTA_LOAD ||
 			(action == MTA_KEEP && this->action_counts[MTA_LOAD] == 0));
+	this->ApplyPendingAging();
 	this->AddToMeta(cp, action);
 
 	if (this->count == cp->count) {
@@ -558,17 +559,49 @@ void VehicleCargoList::AddToMeta(const CargoPacket *cp, MoveToAction action)
 
 /**
  * Ages the all cargo in this list.
+ * The packets themselves are only updated when one of them reaches the
+ * maximum days in transit, or when the list is about to change; until then
+ * the aging is only counted in aging_pending. The cached days in transit of
+ * the list are always kept up to date.
  */
 void VehicleCargoList::AgeCargo()
 {
-	for (ConstIterator it(this->packets.begin()); it != this->packets.end(); it++) {
-		CargoPacket *cp = *it;
-		/* If we're at the maximum, then we can't increase no more. */
+	if (this->aging_pending == 0 || this->aging_pending == this->aging_headroom) {
+		/* The packets may have changed since they were last aged, or one of
+		 * them is at the maximum now. Bring them up to date and take stock. */
+		this->ApplyPendingAging();
+
+		this->aging_headroom = 0xFF;
+		this->aging_count = 0;
+		for (const CargoPacket *cp : this->packets) {
+			/* If we're at the maximum, then we can't increase no more. */
+			if (cp->days_in_transit == 0xFF) continue;
+
+			this->aging_headroom = min<uint16>(this->aging_headroom, 0xFF - cp->days_in_transit);
+			this->aging_count += cp->count;
+		}
+		if (this->aging_count == 0) return;
+	}
+
+	this->aging_pending++;
+	this->cargo_days_in_transit += this->aging_count;
+}
+
+/**
+ * Apply the aging counted by AgeCargo() to the packets. This has to be done
+ * before any packets are added, removed or inspected for their days in transit.
+ */
+void VehicleCargoList::ApplyPendingAging()
+{
+	if (this->aging_pending == 0) return;
+
+	for (CargoPacket *cp : this->packets) {
 		if (cp->days_in_transit == 0xFF) continue;
 
-		cp->days_in_transit++;
-		this->cargo_days_in_transit += cp->count;
+		assert(cp->days_in_transit + this->aging_pending <= 0xFF);
+		cp->days_in_transit += this->aging_pending;
 	}
+	this->aging_pending = 0;
 }
 
 /**
@@ -628,6 +661,7 @@ bool VehicleCargoList::Stage(bool accepted, StationID current_station, StationID
 {
 	this->AssertCountConsistency();
 	assert(this->action_counts[MTA_LOAD] == 0);
+	this->ApplyPendingAging();
 	this->action_counts[MTA_TRANSFER] = this->action_counts[MTA_DELIVER] = this->action_counts[MTA_KEEP] = 0;
 	Iterator it = this->packets.begin();
 	uint sum = 0;
@@ -721,6 +755,7 @@ bool VehicleCargoList::Stage(bool accepted, StationID current_station, StationID
 /** Invalidates the cached data and rebuild it. */
 void VehicleCargoList::InvalidateCache()
 {
+	this->ApplyPendingAging();
 	this->feeder_share = 0;
 	this->Parent::InvalidateCache();
 }
@@ -792,6 +827,7 @@ uint VehicleCargoList::Reassign<VehicleCargoList::MTA_DELIVER, VehicleCargoList:
 uint VehicleCargoList::Return(uint max_move, StationCargoList *dest, StationID next)
 {
 	max_move = min(this->action_counts[MTA_LOAD], max_move);
+	this->ApplyPendingAging();
 	this->PopCargo(CargoReturn(this, dest, max_move, next));
 	return max_move;
 }
@@ -805,6 +841,8 @@ uint VehicleCargoList::Return(uint max_move, StationCargoList *dest, StationID n
 uint VehicleCargoList::Shift(uint max_move, VehicleCargoList *dest)
 {
 	max_move = min(this->count, max_move);
+	this->ApplyPendingAging();
+	dest->ApplyPendingAging();
 	this->PopCargo(CargoShift(this, dest, max_move));
 	return max_move;
 }
@@ -819,6 +857,7 @@ uint VehicleCargoList::Shift(uint max_move, VehicleCargoList *dest)
  */
 uint VehicleCargoList::Unload(uint max_move, StationCargoList *dest, CargoPayment *payment)
 {
+	this->ApplyPendingAging();
 	uint moved = 0;
 	if (this->action_counts[MTA_TRANSFER] > 0) {
 		uint move = min(this->action_counts[MTA_TRANSFER], max_move);
@@ -842,6 +881,7 @@ uint VehicleCargoList::Unload(uint max_move, StationCargoList *dest, CargoPaymen
 uint VehicleCargoList::Truncate(uint max_move)
 {
 	max_move = min(this->count, max_move);
+	this->ApplyPendingAging();
 	if (max_move > this->ActionCount(MTA_KEEP)) this->KeepAll();
 	this->PopCargo(CargoRemoval<VehicleCargoList>(this, max_move));
 	return max_move;
@@ -858,6 +898,8 @@ uint VehicleCargoList::Truncate(uint max_move)
 uint VehicleCargoList::Reroute(uint max_move, VehicleCargoList *dest, StationID avoid, StationID avoid2, const GoodsEntry *ge)
 {
 	max_move = min(this->action_counts[MTA_TRANSFER], max_move);
+	this->ApplyPendingAging();
+	dest->ApplyPendingAging();
 	this->ShiftCargoWithFrontInsert(VehicleCargoReroute(this, dest, max_move, avoid, avoid2, ge));
 	return max_move;
 }
@@ -25,7 +25,7 @@ typedef uint32 CargoPacketID;
 struct CargoPacket;
 
 /** Type of the pool for cargo packets for a little over 16 million packets. */
-typedef Pool<CargoPacket, CargoPacketID, 1024, 0xFFF000, PT_NORMAL, true, false> CargoPacketPool;
+typedef Pool<CargoPacket, CargoPacketID, 1024, 0xFFF000, PT_NORMAL, false, false, true> CargoPacketPool;
 /** The actual pool with cargo packets. */
 extern CargoPacketPool _cargopacket_pool;
 
@@ -287,6 +287,10 @@ protected:
 	Money feeder_share;                     ///< Cache for the feeder share.
 	uint action_counts[NUM_MOVE_TO_ACTION]; ///< Counts of cargo to be transferred, delivered, kept and loaded.
 
+	uint16 aging_pending = 0;               ///< Number of times the cargo was aged without updating the packets, see AgeCargo().
+	uint16 aging_headroom = 0;              ///< Number of times the cargo can be aged before a packet reaches the maximum days in transit.
+	uint aging_count = 0;                   ///< Amount of cargo in packets which have not reached the maximum days in transit.
+
 	template<class Taction>
 	void ShiftCargo(Taction action);
 
@@ -430,6 +434,8 @@ public:
 
 	void AgeCargo();
 
+	void ApplyPendingAging();
+
 	void InvalidateCache();
 
 	void SetTransferLoadPlace(TileIndex xy);
@@ -637,6 +637,15 @@ bool IsCommandAllowedWhilePaused(uint32 cmd)
 
 static int _docommand_recursive = 0;
 
+/**
+ * Whether a command is being tested or executed, so the map may be halfway through being changed.
+ * @return true if inside a command
+ */
+bool IsCommandRunning()
+{
+	return _docommand_recursive != 0;
+}
+
 /**
  * Shorthand for calling the long DoCommand with a container.
  *
@@ -50,6 +50,7 @@ CommandFlags GetCommandFlags(uint32 cmd);
 const char *GetCommandName(uint32 cmd);
 Money GetAvailableMoneyForCommand();
 bool IsCommandAllowedWhilePaused(uint32 cmd);
+bool IsCommandRunning();
 
 /**
  * Extracts the DC flags needed for DoCommand from the flags returned by GetCommandFlags
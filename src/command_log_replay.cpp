@@ -0,0 +1,334 @@
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file command_log_replay.cpp Replaying of the command log written by '-d desync=1' against a savegame.
+ *
+ * The commands of the log are executed at the date they were executed at by the server,
+ * just before the game tick of that date, like the network does. The sync lines written
+ * by '-d desync=2' are compared with the random state of the replay. For every game tick
+ * the time it took and the state checksums are written to a report, so the replay doubles
+ * as a benchmark of a real multiplayer session.
+ */
+
+#include "stdafx.h"
+#include "command_log_replay.h"
+#include "command_func.h"
+#include "company_func.h"
+#include "date_func.h"
+#include "debug.h"
+#include "fileio_func.h"
+#include "openttd.h"
+#include "string_func.h"
+#include "core/random_func.hpp"
+#include "core/checksum_func.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "safeguards.h"
+
+extern void StateGameLoop();
+
+/** An entry of the command log to replay. */
+struct CommandLogReplayEntry {
+	uint64 when;              ///< Date, date fraction and tick skip counter the entry was logged at, see #GetReplayDate.
+	bool sync;                ///< Whether this entry is a check of the random state instead of a command.
+	CompanyID company;        ///< Company that executed the command.
+	CommandContainer command; ///< The command to execute.
+	uint32 sync_state[2];     ///< Random state the server had at the start of the tick.
+};
+
+/** State of the replay. */
+struct CommandLogReplay {
+	std::vector<CommandLogReplayEntry> entries; ///< Entries of the command log, in the order of the log.
+	size_t next = 0;                            ///< Next entry to handle.
+	bool started = false;                       ///< Whether the replay started, i.e. the savegame has been loaded.
+	FILE *report = nullptr;                     ///< Per tick report, or \c nullptr if it could not be opened.
+
+	uint commands = 0;                          ///< Number of executed commands.
+	uint failed_commands = 0;                   ///< Number of executed commands that failed.
+	uint skipped_commands = 0;                  ///< Number of commands that were not executed.
+	uint sync_matches = 0;                      ///< Number of sync checks that matched.
+	uint sync_mismatches = 0;                   ///< Number of sync checks that did not match.
+	uint paused_ticks = 0;                      ///< Number of game loops spent paused.
+	std::vector<uint32> tick_durations;         ///< Time spent in each game tick, in microseconds.
+};
+
+static CommandLogReplay *_command_log_replay = nullptr; ///< The replay in progress, if any.
+
+/**
+ * Combine a date, date fraction and tick skip counter into a value that sorts in time.
+ * @param date The date.
+ * @param date_fract The fraction of the date.
+ * @param tick_skip_counter The tick skip counter.
+ * @return The combined value.
+ */
+static inline uint64 GetReplayDate(uint32 date, uint32 date_fract, uint32 tick_skip_counter)
+{
+	return ((uint64)date << 24) | ((uint64)GB(date_fract, 0, 16) << 8) | GB(tick_skip_counter, 0, 8);
+}
+
+/**
+ * Parse the arguments of a "cmd:" line of the command log.
+ * @param p The line, after the "cmd: ".
+ * @param[out] entry The entry to fill.
+ * @return True if the line could be parsed.
+ */
+static bool ParseCommandLogCommand(const char *p, CommandLogReplayEntry &entry)
+{
+	uint date, date_fract, tick_skip_counter, company;
+	int consumed = 0;
+	CommandContainer &cmd = entry.command;
+	if (sscanf(p, "date{%x; %x; %x}; company: %x; tile: %x (%*u x %*u); p1: %x; p2: %x; cmd: %x; %n",
+			&date, &date_fract, &tick_skip_counter, &company, &cmd.tile, &cmd.p1, &cmd.p2, &cmd.cmd, &consumed) != 8 || consumed == 0) {
+		return false;
+	}
+
+	/* The text is followed by the length of the binary data and the name of the command, which has no parentheses. */
+	const char *text = p + consumed;
+	const char *name = strrchr(text, '(');
+	if (*text != '"' || name == nullptr) return false;
+	const char *text_end = name;
+	while (text_end > text && *text_end != '"') text_end--;
+	if (text_end == text) return false;
+
+	entry.when = GetReplayDate(date, date_fract, tick_skip_counter);
+	entry.sync = false;
+	entry.company = (CompanyID)company;
+	cmd.callback = nullptr;
+	cmd.text.assign(text + 1, text_end - text - 1);
+	cmd.binary_length = strtoul(text_end + 1, nullptr, 16);
+	return true;
+}
+
+/**
+ * Load the command log to replay once the savegame has been loaded.
+ * Lines that are not relevant to the replay are ignored.
+ * @param filename The command log; when not found as is, it is searched for in the autosave folder.
+ * @return True if the command log could be read.
+ */
+bool LoadCommandLogReplay(const char *filename)
+{
+	FILE *f = FioFOpenFile(filename, "rb", NO_DIRECTORY);
+	if (f == nullptr) f = FioFOpenFile(filename, "rb", AUTOSAVE_DIR);
+	if (f == nullptr) return false;
+	FileCloser fcloser(f);
+
+	std::unique_ptr<CommandLogReplay> replay(new CommandLogReplay());
+	std::vector<char> buffer(MAX_CMD_TEXT_LENGTH + 512);
+	uint line_number = 0;
+	uint ignored = 0;
+	while (fgets(buffer.data(), (int)buffer.size(), f) != nullptr) {
+		line_number++;
+
+		const char *p = buffer.data();
+		/* Ignore the "[date time] " part of the message */
+		if (*p == '[') {
+			p = strchr(p, ']');
+			if (p == nullptr) continue;
+			p += 2;
+		}
+
+		CommandLogReplayEntry entry;
+		if (strncmp(p, "cmd: ", 5) == 0) {
+			if (!ParseCommandLogCommand(p + 5, entry)) {
+				DEBUG(misc, 0, "Command log line %u: cannot parse command", line_number);
+				return false;
+			}
+		} else if (strncmp(p, "sync: ", 6) == 0) {
+			uint date, date_fract, tick_skip_counter;
+			if (sscanf(p + 6, "date{%x; %x; %x}; %x; %x", &date, &date_fract, &tick_skip_counter, &entry.sync_state[0], &entry.sync_state[1]) != 5) {
+				DEBUG(misc, 0, "Command log line %u: cannot parse sync state", line_number);
+				return false;
+			}
+			entry.when = GetReplayDate(date, date_fract, tick_skip_counter);
+			entry.sync = true;
+		} else {
+			/* Messages, failed commands, joins and the like do not change the game state. */
+			ignored++;
+			continue;
+		}
+
+		if (!replay->entries.empty() && entry.when < replay->entries.back().when) {
+			DEBUG(misc, 0, "Command log line %u: entry is older than the previous entry; was the server restarted?", line_number);
+			return false;
+		}
+		replay->entries.push_back(std::move(entry));
+	}
+
+	DEBUG(misc, 0, "Replaying " PRINTF_SIZE " entries of command log '%s', ignored %u lines", replay->entries.size(), filename, ignored);
+	_command_log_replay = replay.release();
+	return true;
+}
+
+/**
+ * Whether a command log is being replayed.
+ * When replaying, the AIs and game script do not run, as their commands are part of the log.
+ * @return True if a command log is being replayed.
+ */
+bool IsReplayingCommandLog()
+{
+	return _command_log_replay != nullptr;
+}
+
+/**
+ * Get the value at a fraction of the sorted tick durations.
+ * @param sorted The sorted tick durations.
+ * @param percentile The percentile to get.
+ * @return The duration in microseconds.
+ */
+static uint32 GetTickDurationPercentile(const std::vector<uint32> &sorted, uint percentile)
+{
+	if (sorted.empty()) return 0;
+	return sorted[min<size_t>(sorted.size() * percentile / 100, sorted.size() - 1)];
+}
+
+/** Write the summary of the replay, end it and quit the game. */
+static void FinishCommandLogReplay()
+{
+	CommandLogReplay *replay = _command_log_replay;
+	if (replay->report != nullptr) fclose(replay->report);
+
+	std::vector<uint32> sorted = replay->tick_durations;
+	std::sort(sorted.begin(), sorted.end());
+	uint64 total = 0;
+	for (uint32 duration : sorted) total += duration;
+
+	DEBUG(misc, 0, "Replay finished at date{%08x; %02x; %02x}; random state {%08x, %08x}; state checksum " OTTD_PRINTFHEX64,
+			_date, _date_fract, _tick_skip_counter, _random.state[0], _random.state[1], _state_checksum.state);
+	DEBUG(misc, 0, "  commands: %u executed, %u failed, %u skipped", replay->commands, replay->failed_commands, replay->skipped_commands);
+	DEBUG(misc, 0, "  sync checks: %u matched, %u mismatched", replay->sync_matches, replay->sync_mismatches);
+	DEBUG(misc, 0, "  game ticks: " PRINTF_SIZE " run, %u paused; " OTTD_PRINTF64U " ms in total",
+			sorted.size(), replay->paused_ticks, total / 1000);
+	if (!sorted.empty()) {
+		DEBUG(misc, 0, "  tick time (us): average " OTTD_PRINTF64U ", median %u, 99th percentile %u, maximum %u",
+				total / sorted.size(), GetTickDurationPercentile(sorted, 50), GetTickDurationPercentile(sorted, 99), sorted.back());
+	}
+
+	delete replay;
+	_command_log_replay = nullptr;
+	_exit_game = true;
+}
+
+/**
+ * Start replaying once the savegame has been loaded.
+ * @param replay The replay.
+ */
+static void StartCommandLogReplay(CommandLogReplay *replay)
+{
+	/* The savegame may have been made after the start of the log. */
+	const uint64 now = GetReplayDate(_date, _date_fract, _tick_skip_counter);
+	size_t skip = 0;
+	while (skip < replay->entries.size() && replay->entries[skip].when < now) skip++;
+	if (skip > 0) DEBUG(misc, 0, "Skipping " PRINTF_SIZE " entries of the command log from before the savegame's date", skip);
+	replay->skipped_commands += (uint)std::count_if(replay->entries.begin(), replay->entries.begin() + skip, [](const CommandLogReplayEntry &e) { return !e.sync; });
+	replay->next = skip;
+	replay->started = true;
+
+	replay->report = FioFOpenFile("commands-replay.csv", "w", AUTOSAVE_DIR);
+	if (replay->report != nullptr) {
+		fputs("tick,date,date_fract,tick_skip_counter,commands,duration_us,random_state_0,random_state_1,state_checksum\n", replay->report);
+	} else {
+		DEBUG(misc, 0, "Cannot open commands-replay.csv in the autosave folder; not writing the per tick report");
+	}
+}
+
+/**
+ * Handle the entries of the command log that are due before the current game tick.
+ * @param replay The replay.
+ * @return Number of executed commands.
+ */
+static uint HandleDueCommandLogEntries(CommandLogReplay *replay)
+{
+	const uint64 now = GetReplayDate(_date, _date_fract, _tick_skip_counter);
+
+	uint executed = 0;
+	for (; replay->next < replay->entries.size() && replay->entries[replay->next].when <= now; replay->next++) {
+		CommandLogReplayEntry &entry = replay->entries[replay->next];
+		if (entry.when < now) {
+			/* Only possible when the replay skipped a tick the server ran. */
+			if (!entry.sync) replay->skipped_commands++;
+			continue;
+		}
+
+		if (entry.sync) {
+			if (entry.sync_state[0] == _random.state[0] && entry.sync_state[1] == _random.state[1]) {
+				replay->sync_matches++;
+			} else {
+				replay->sync_mismatches++;
+				DEBUG(misc, 0, "Sync check: date{%08x; %02x; %02x}; mismatch expected {%08x, %08x}, got {%08x, %08x}",
+						_date, _date_fract, _tick_skip_counter, entry.sync_state[0], entry.sync_state[1], _random.state[0], _random.state[1]);
+			}
+			continue;
+		}
+
+		CommandContainer &cmd = entry.command;
+		if (cmd.binary_length > 0) {
+			/* The log does not contain the binary data of commands. */
+			DEBUG(misc, 1, "Skipping replay of command with binary data: %s", GetCommandName(cmd.cmd));
+			replay->skipped_commands++;
+			continue;
+		}
+
+		_current_company = entry.company;
+		cmd.cmd |= CMD_NETWORK_COMMAND;
+		if (!DoCommandP(&cmd, false)) replay->failed_commands++;
+		replay->commands++;
+		executed++;
+	}
+	_current_company = _local_company;
+
+	return executed;
+}
+
+/**
+ * Run the game loop of a replay: execute the commands of the command log
+ * that are due, run the game tick and measure how long that took.
+ * The game quits when the end of the command log has been reached.
+ */
+void CommandLogReplayGameLoop()
+{
+	CommandLogReplay *replay = _command_log_replay;
+	if (_game_mode != GM_NORMAL) {
+		DEBUG(misc, 0, "Replaying a command log requires a savegame to be loaded");
+		FinishCommandLogReplay();
+		return;
+	}
+
+	if (!replay->started) StartCommandLogReplay(replay);
+
+	const uint commands = HandleDueCommandLogEntries(replay);
+	const Date date = _date;
+	const DateFract date_fract = _date_fract;
+	const uint8 tick_skip_counter = _tick_skip_counter;
+
+	if (_pause_mode != PM_UNPAUSED) {
+		StateGameLoop();
+		replay->paused_ticks++;
+		if (replay->next < replay->entries.size() && replay->entries[replay->next].when > GetReplayDate(_date, _date_fract, _tick_skip_counter)) {
+			/* Nothing in the log can unpause the game anymore. */
+			DEBUG(misc, 0, "Game is paused, but the remainder of the command log is for later dates");
+			FinishCommandLogReplay();
+		}
+	} else {
+		using namespace std::chrono;
+		const auto start = steady_clock::now();
+		StateGameLoop();
+		const uint32 duration = (uint32)duration_cast<microseconds>(steady_clock::now() - start).count();
+
+		if (replay->report != nullptr) {
+			fprintf(replay->report, PRINTF_SIZE ",%u,%u,%u,%u,%u,%08x,%08x," OTTD_PRINTFHEX64 "\n", replay->tick_durations.size(),
+					date, date_fract, tick_skip_counter, commands, duration, _random.state[0], _random.state[1], _state_checksum.state);
+		}
+		replay->tick_durations.push_back(duration);
+	}
+
+	if (_command_log_replay != nullptr && replay->next >= replay->entries.size()) FinishCommandLogReplay();
+}
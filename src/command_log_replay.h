@@ -0,0 +1,17 @@
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file command_log_replay.h Replaying of the command log written by '-d desync=1' against a savegame. */
+
+#ifndef COMMAND_LOG_REPLAY_H
+#define COMMAND_LOG_REPLAY_H
+
+bool LoadCommandLogReplay(const char *filename);
+bool IsReplayingCommandLog();
+void CommandLogReplayGameLoop();
+
+#endif /* COMMAND_LOG_REPLAY_H */
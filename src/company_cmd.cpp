@@ -35,6 +35,7 @@
 #include "goal_base.h"
 #include "story_base.h"
 #include "zoning.h"
+#include "command_log_replay.h"
 
 #include "table/strings.h"
 
@@ -599,6 +600,9 @@ void StartupCompanies()
 /** Start a new competitor company if possible. */
 static bool MaybeStartNewCompany()
 {
+	/* When replaying, the starts of the AIs are part of the command log. */
+	if (IsReplayingCommandLog()) return false;
+
 	if (_networking && Company::GetNumItems() >= _settings_client.network.max_companies) return false;
 
 	/* count number of competitors */
@@ -820,8 +824,8 @@ CommandCost CmdCompanyCtrl(TileIndex tile, DoCommandFlag flags, uint32 p1, uint3
 
 	switch ((CompanyCtrlAction)GB(p1, 0, 16)) {
 		case CCA_NEW: { // Create a new company
-			/* This command is only executed in a multiplayer game */
-			if (!_networking) return CMD_ERROR;
+			/* This command is only executed in a multiplayer game, or when replaying one */
+			if (!_networking && !IsReplayingCommandLog()) return CMD_ERROR;
 
 			/* Has the network client a correct ClientIndex? */
 			if (!(flags & DC_EXEC)) return CommandCost();
@@ -833,7 +837,7 @@ CommandCost CmdCompanyCtrl(TileIndex tile, DoCommandFlag flags, uint32 p1, uint3
 			 * are actually no clients at all. However, the company has to
 			 * be created, otherwise we cannot rerun the game properly.
 			 * So only allow a nullptr client info in that case. */
-			if (ci == nullptr) return CommandCost();
+			if (ci == nullptr && !IsReplayingCommandLog()) return CommandCost();
 #endif /* NOT DEBUG_DUMP_COMMANDS */
 
 			/* Delete multiplayer progress bar */
@@ -47,6 +47,7 @@
 #include "town.h"
 #include "industry.h"
 #include "string_func_extra.h"
+#include "tracing.h"
 #include <time.h>
 
 #include "safeguards.h"
@@ -2078,6 +2079,103 @@ DEF_CONSOLE_CMD(ConVehicleStats)
 	return true;
 }
 
+DEF_CONSOLE_CMD(ConBenchmarkRoadPathfinder)
+{
+	if (argc == 0 || argc > 2) {
+		IConsoleHelp("Debug: Time road vehicle path searches with and without the road region graph. Usage: 'benchmark_road_pathfinder [<iterations>]'");
+		return true;
+	}
+
+	uint32 iterations = 1;
+	if (argc == 2 && (!GetArgumentInteger(&iterations, argv[1]) || iterations == 0)) return false;
+
+	extern void BenchmarkRoadVehiclePathfinder(char *buffer, const char *last, uint iterations);
+	char buffer[32768];
+	BenchmarkRoadVehiclePathfinder(buffer, lastof(buffer), iterations);
+	PrintLineByLine(buffer);
+	return true;
+}
+
+DEF_CONSOLE_CMD(ConBenchmarkSpriteGroups)
+{
+	if (argc == 0 || argc > 2) {
+		IConsoleHelp("Debug: Check that the compiled NewGRF sprite groups resolve the same as the interpreted ones, and time both. Usage: 'benchmark_sprite_groups [<iterations>]'");
+		return true;
+	}
+
+	uint32 iterations = 100;
+	if (argc == 2 && (!GetArgumentInteger(&iterations, argv[1]) || iterations == 0)) return false;
+
+	extern void BenchmarkSpriteGroups(char *buffer, const char *last, uint iterations);
+	char buffer[4096];
+	BenchmarkSpriteGroups(buffer, lastof(buffer), iterations);
+	PrintLineByLine(buffer);
+	return true;
+}
+
+DEF_CONSOLE_CMD(ConCheckShoreTrees)
+{
+	if (argc == 0) {
+		IConsoleHelp("Debug: Check that the water region cache is updated when trees grow on or die on coast tiles. Usage: 'check_shore_trees'");
+		return true;
+	}
+
+	if (_networking) {
+		IConsoleError("This command changes the map, so it is not available in a network game.");
+		return true;
+	}
+
+	extern void CheckShoreTreeWaterRegions(char *buffer, const char *last);
+	char buffer[1024];
+	CheckShoreTreeWaterRegions(buffer, lastof(buffer));
+	PrintLineByLine(buffer);
+	return true;
+}
+
+DEF_CONSOLE_CMD(ConBenchmarkPaletteAnimation)
+{
+	if (argc == 0 || argc > 2) {
+		IConsoleHelp("Debug: Time palette animation of the screen with and without the animated spans. Usage: 'benchmark_palette_animation [<iterations>]'");
+		return true;
+	}
+
+	uint32 iterations = 100;
+	if (argc == 2 && (!GetArgumentInteger(&iterations, argv[1]) || iterations == 0)) return false;
+
+#ifdef DEDICATED
+	IConsoleError("Palette animation is not available in a dedicated server.");
+#else
+	extern void BenchmarkPaletteAnimation(char *buffer, const char *last, uint iterations);
+	char buffer[1024];
+	BenchmarkPaletteAnimation(buffer, lastof(buffer), iterations);
+	PrintLineByLine(buffer);
+#endif
+	return true;
+}
+
+DEF_CONSOLE_CMD(ConBenchmarkBlitters)
+{
+	if (argc == 0 || argc > 2) {
+		IConsoleHelp("Debug: Time drawing the cached sprites with the SSE4 and AVX2 blitters. Usage: 'benchmark_blitters [<iterations>]'");
+		return true;
+	}
+
+	uint32 iterations = 10;
+	if (argc == 2 && (!GetArgumentInteger(&iterations, argv[1]) || iterations == 0)) return false;
+
+#if defined(DEDICATED)
+	IConsoleError("Blitters are not available in a dedicated server.");
+#elif !defined(WITH_AVX2)
+	IConsoleError("The AVX2 blitters are not part of this build.");
+#else
+	extern void BenchmarkSpriteBlitters(char *buffer, const char *last, uint iterations);
+	char buffer[1024];
+	BenchmarkSpriteBlitters(buffer, lastof(buffer), iterations);
+	PrintLineByLine(buffer);
+#endif
+	return true;
+}
+
 DEF_CONSOLE_CMD(ConMapStats)
 {
 	if (argc == 0) {
@@ -2106,6 +2204,29 @@ DEF_CONSOLE_CMD(ConStFlowStats)
 	return true;
 }
 
+DEF_CONSOLE_CMD(ConDumpPoolStats)
+{
+	if (argc == 0) {
+		IConsoleHelp("Dump pool memory use, fragmentation and iteration cost.");
+		return true;
+	}
+
+	for (PoolBase *pool : *PoolBase::GetPools()) {
+		PoolStats stats;
+		pool->GetStats(stats);
+		uint fragmentation = stats.first_unused > 0 ? (uint)(100 * (stats.first_unused - stats.items) / stats.first_unused) : 0;
+		IConsolePrintF(CC_DEFAULT, "%s: items: " PRINTF_SIZE ", first unused: " PRINTF_SIZE ", size: " PRINTF_SIZE ", holes: %u%%, item size: " PRINTF_SIZE ", memory: " PRINTF_SIZE " bytes",
+				stats.name, stats.items, stats.first_unused, stats.size, fragmentation, stats.item_size, stats.memory);
+		if (stats.slab_items > 0) {
+			IConsolePrintF(CC_DEFAULT, "  slabs: " PRINTF_SIZE " of " PRINTF_SIZE " items, " PRINTF_SIZE " unused slots",
+					stats.slabs, stats.slab_items, stats.slabs * stats.slab_items - stats.items);
+		}
+		IConsolePrintF(CC_DEFAULT, "  iteration: " PRINTF_SIZE " items in " OTTD_PRINTF64U " ns",
+				stats.iterated, stats.iterate_ns);
+	}
+	return true;
+}
+
 DEF_CONSOLE_CMD(ConDumpGameEvents)
 {
 	if (argc == 0) {
@@ -2343,6 +2464,8 @@ DEF_CONSOLE_CMD(ConNewGRFProfile)
 		IConsoleHelp("  End profiling and write the collected data to CSV files.");
 		IConsoleHelp("Usage: newgrf_profile abort");
 		IConsoleHelp("  End profiling and discard all collected data.");
+		IConsoleHelp("Usage: newgrf_profile cache [reset]");
+		IConsoleHelp("  Show or reset the statistics of the callback result cache.");
 		return true;
 	}
 
@@ -2453,9 +2576,74 @@ DEF_CONSOLE_CMD(ConNewGRFProfile)
 		return true;
 	}
 
+	/* "cache" sub-command */
+	if (strncasecmp(argv[1], "cac", 3) == 0) {
+		if (argc >= 3 && strncasecmp(argv[2], "res", 3) == 0) {
+			_callback_cache_stats = {};
+			IConsolePrint(CC_INFO, "Callback result cache statistics reset.");
+			return true;
+		}
+
+		const CallbackCacheStats &stats = _callback_cache_stats;
+		IConsolePrintF(CC_INFO, "Callback result cache:");
+		IConsolePrintF(CC_INFO, "  Lookups:     " OTTD_PRINTF64U, stats.lookups);
+		IConsolePrintF(CC_INFO, "  Hits:        " OTTD_PRINTF64U " (%u%%)", stats.hits, stats.lookups > 0 ? (uint)(stats.hits * 100 / stats.lookups) : 0);
+		IConsolePrintF(CC_INFO, "  Misses:      " OTTD_PRINTF64U ", of which uncacheable: " OTTD_PRINTF64U, stats.misses, stats.uncacheable);
+		IConsolePrintF(CC_INFO, "  Bypassed:    " OTTD_PRINTF64U, stats.bypassed);
+		return true;
+	}
+
 	return false;
 }
 
+#ifdef USE_TRACE_ZONES
+DEF_CONSOLE_CMD(ConTrace)
+{
+	if (argc == 0) {
+		IConsoleHelp("Trace the time spent in zones of the game loop and of other threads, to find which vehicles, stations or towns make ticks slow.");
+		IConsoleHelp("Usage: trace [status]");
+		IConsoleHelp("  Show whether tracing is active and how much it recorded.");
+		IConsoleHelp("Usage: trace start");
+		IConsoleHelp("  Begin recording zones. Each thread keeps its most recent zones.");
+		IConsoleHelp("Usage: trace stop");
+		IConsoleHelp("  End recording zones. The recorded zones can still be dumped.");
+		IConsoleHelp("Usage: trace dump [<num-ticks>]");
+		IConsoleHelp("  Write the zones of the last <num-ticks> game ticks (default 100) to a Chrome trace JSON file in the screenshot directory.");
+		return true;
+	}
+
+	if (argc == 1 || strcasecmp(argv[1], "status") == 0) {
+		PrintTraceStatus();
+		return true;
+	}
+
+	if (strcasecmp(argv[1], "start") == 0) {
+		if (IsTracing()) {
+			IConsolePrint(CC_WARNING, "Tracing is already active.");
+		} else {
+			StartTracing();
+			IConsolePrint(CC_INFO, "Tracing started.");
+		}
+		return true;
+	}
+
+	if (strcasecmp(argv[1], "stop") == 0) {
+		StopTracing();
+		IConsolePrint(CC_INFO, "Tracing stopped.");
+		return true;
+	}
+
+	if (strcasecmp(argv[1], "dump") == 0) {
+		uint ticks = 100;
+		if (argc >= 3 && !GetArgumentInteger(&ticks, argv[2])) return false;
+		DumpTrace(ticks);
+		return true;
+	}
+
+	return false;
+}
+#endif /* USE_TRACE_ZONES */
+
 #ifdef _DEBUG
 /******************
  *  debug commands
@@ -2638,16 +2826,25 @@ void IConsoleStdLibRegister()
 #endif
 	IConsoleCmdRegister("fps",     ConFramerate);
 	IConsoleCmdRegister("fps_wnd", ConFramerateWindow);
+#ifdef USE_TRACE_ZONES
+	IConsoleCmdRegister("trace",   ConTrace);
+#endif
 
 	IConsoleCmdRegister("dump_command_log", ConDumpCommandLog, nullptr, true);
 	IConsoleCmdRegister("dump_inflation", ConDumpInflation, nullptr, true);
 	IConsoleCmdRegister("dump_cpdp_stats", ConDumpCpdpStats, nullptr, true);
 	IConsoleCmdRegister("dump_veh_stats", ConVehicleStats, nullptr, true);
+	IConsoleCmdRegister("benchmark_road_pathfinder", ConBenchmarkRoadPathfinder, nullptr, true);
+	IConsoleCmdRegister("benchmark_sprite_groups", ConBenchmarkSpriteGroups, nullptr, true);
+	IConsoleCmdRegister("benchmark_palette_animation", ConBenchmarkPaletteAnimation, nullptr, true);
+	IConsoleCmdRegister("benchmark_blitters", ConBenchmarkBlitters, nullptr, true);
 	IConsoleCmdRegister("dump_map_stats", ConMapStats, nullptr, true);
 	IConsoleCmdRegister("dump_st_flow_stats", ConStFlowStats, nullptr, true);
+	IConsoleCmdRegister("dump_pool_stats", ConDumpPoolStats, nullptr, true);
 	IConsoleCmdRegister("dump_game_events", ConDumpGameEvents, nullptr, true);
 	IConsoleCmdRegister("dump_load_debug_log", ConDumpLoadDebugLog, nullptr, true);
 	IConsoleCmdRegister("check_caches", ConCheckCaches, nullptr, true);
+	IConsoleCmdRegister("check_shore_trees", ConCheckShoreTrees, nullptr, true);
 	IConsoleCmdRegister("show_town_window", ConShowTownWindow, nullptr, true);
 	IConsoleCmdRegister("show_station_window", ConShowStationWindow, nullptr, true);
 	IConsoleCmdRegister("show_industry_window", ConShowIndustryWindow, nullptr, true);
@@ -16,13 +16,15 @@
 #include "math_func.hpp"
 #include "bitmath_func.hpp"
 
+#include <chrono>
+
 /**
  * Helper for defining the method's signature.
  * @param type The return type of the method.
  */
 #define DEFINE_POOL_METHOD(type) \
-	template <class Titem, typename Tindex, size_t Tgrowth_step, size_t Tmax_size, PoolType Tpool_type, bool Tcache, bool Tzero> \
-	type Pool<Titem, Tindex, Tgrowth_step, Tmax_size, Tpool_type, Tcache, Tzero>
+	template <class Titem, typename Tindex, size_t Tgrowth_step, size_t Tmax_size, PoolType Tpool_type, bool Tcache, bool Tzero, bool Tslab> \
+	type Pool<Titem, Tindex, Tgrowth_step, Tmax_size, Tpool_type, Tcache, Tzero, Tslab>
 
 /**
  * Create a clean pool.
@@ -41,6 +43,7 @@ DEFINE_POOL_METHOD(inline)::Pool(const char *name) :
 		cleaning(false),
 		data(nullptr),
 		free_bitmap(nullptr),
+		slabs(nullptr),
 		alloc_cache(nullptr)
 { }
 
@@ -55,7 +58,7 @@ DEFINE_POOL_METHOD(inline void)::ResizeFor(size_t index)
 	assert(index >= this->size);
 	assert(index < Tmax_size);
 
-	size_t new_size = min(Tmax_size, Align(index + 1, max<uint>(64, Tgrowth_step)));
+	size_t new_size = min(Tmax_size, Align(index + 1, SLAB_ITEMS));
 
 	this->data = ReallocT(this->data, new_size);
 	MemSetT(this->data + this->size, 0, new_size - this->size);
@@ -66,6 +69,11 @@ DEFINE_POOL_METHOD(inline void)::ResizeFor(size_t index)
 		this->free_bitmap[new_size / 64] |= (~((uint64) 0)) << (new_size % 64);
 	}
 
+	if (Tslab) {
+		this->slabs = ReallocT(this->slabs, CeilDiv(new_size, SLAB_ITEMS));
+		MemSetT(this->slabs + CeilDiv(this->size, SLAB_ITEMS), 0, CeilDiv(new_size, SLAB_ITEMS) - CeilDiv(this->size, SLAB_ITEMS));
+	}
+
 	this->size = new_size;
 }
 
@@ -100,6 +108,38 @@ DEFINE_POOL_METHOD(inline size_t)::FindFirstFree()
 	return NO_FREE_ITEM;
 }
 
+/**
+ * Searches for a free index close to the given one, preferring higher indexes.
+ * Only the slab of the given index is searched, as other indexes are not close in memory.
+ * @param index index to search around
+ * @return free index in the same slab, NO_FREE_ITEM if there is none
+ */
+DEFINE_POOL_METHOD(inline size_t)::FindFreeNear(size_t index)
+{
+	if (index >= this->size) return NO_FREE_ITEM;
+
+	const size_t begin = index - (index % SLAB_ITEMS);
+	const size_t end = min(begin + SLAB_ITEMS, this->size);
+
+	/* Items are usually added after their neighbour, so search upwards first. */
+	for (size_t i = index + 1; i < end; i = Align(i + 1, 64)) {
+		uint64 available = ~this->free_bitmap[i / 64] & ((~(uint64) 0) << (i % 64));
+		if (available == 0) continue;
+		size_t found = (i / 64) * 64 + FindFirstBit64(available);
+		if (found < end) return found;
+		break;
+	}
+
+	for (size_t i = index; i > begin; i -= (i - 1) % 64 + 1) {
+		uint64 available = ~this->free_bitmap[(i - 1) / 64] & ((~(uint64) 0) >> (63 - (i - 1) % 64));
+		if (available == 0) continue;
+		size_t found = ((i - 1) / 64) * 64 + FindLastBit(available);
+		return found >= begin ? found : NO_FREE_ITEM;
+	}
+
+	return NO_FREE_ITEM;
+}
+
 /**
  * Makes given index valid
  * @param size size of item
@@ -115,7 +155,18 @@ DEFINE_POOL_METHOD(inline void *)::AllocateItem(size_t size, size_t index)
 	this->items++;
 
 	Titem *item;
-	if (Tcache && this->alloc_cache != nullptr) {
+	if (Tslab) {
+		/* The memory of an item only depends on its index, so items with neighbouring indexes are neighbours in memory too. */
+		assert(sizeof(Titem) == size);
+		byte *&slab = this->slabs[index / SLAB_ITEMS];
+		if (slab == nullptr) slab = MallocT<byte>(SLAB_ITEMS * sizeof(Titem));
+		item = (Titem *)(slab + (index % SLAB_ITEMS) * sizeof(Titem));
+		if (Tzero) {
+			/* Explicitly casting to (void *) prevents a clang warning -
+			 * we are actually memsetting a (not-yet-constructed) object */
+			memset((void *)item, 0, sizeof(Titem));
+		}
+	} else if (Tcache && this->alloc_cache != nullptr) {
 		assert(sizeof(Titem) == size);
 		item = (Titem *)this->alloc_cache;
 		this->alloc_cache = this->alloc_cache->next;
@@ -181,6 +232,25 @@ DEFINE_POOL_METHOD(void *)::GetNew(size_t size, size_t index)
 	return this->AllocateItem(size, index);
 }
 
+/**
+ * Allocates new item, preferably close to the given one
+ * @param size size of item
+ * @param neighbour index of the item to allocate the new item close to
+ * @return pointer to allocated item
+ * @note error() on failure! (no free item)
+ */
+DEFINE_POOL_METHOD(void *)::GetNewNear(size_t size, size_t neighbour)
+{
+	size_t index = this->FindFreeNear(neighbour);
+	if (index == NO_FREE_ITEM) return this->GetNew(size);
+
+#ifdef OTTD_ASSERT
+	assert(this->checked != 0);
+	this->checked--;
+#endif /* OTTD_ASSERT */
+	return this->AllocateItem(size, index);
+}
+
 /**
  * Deallocates memory used by this index and marks item as free
  * @param index item to deallocate
@@ -191,7 +261,9 @@ DEFINE_POOL_METHOD(void)::FreeItem(size_t index)
 {
 	assert(index < this->size);
 	assert(this->data[index] != nullptr);
-	if (Tcache) {
+	if (Tslab) {
+		/* The memory stays part of the slab, until the pool is cleaned. */
+	} else if (Tcache) {
 		AllocCache *ac = (AllocCache *)this->data[index];
 		ac->next = this->alloc_cache;
 		this->alloc_cache = ac;
@@ -214,11 +286,16 @@ DEFINE_POOL_METHOD(void)::CleanPool()
 		delete this->Get(i); // 'delete nullptr;' is very valid
 	}
 	assert(this->items == 0);
+	if (Tslab) {
+		for (size_t i = 0; i < CeilDiv(this->size, SLAB_ITEMS); i++) free(this->slabs[i]);
+	}
 	free(this->data);
 	free(this->free_bitmap);
+	free(this->slabs);
 	this->first_unused = this->first_free = this->size = 0;
 	this->data = nullptr;
 	this->free_bitmap = nullptr;
+	this->slabs = nullptr;
 	this->cleaning = false;
 
 	if (Tcache) {
@@ -230,6 +307,39 @@ DEFINE_POOL_METHOD(void)::CleanPool()
 	}
 }
 
+/**
+ * Determines the memory use of the pool, and times iterating all its items.
+ * @param stats Stats to fill.
+ */
+DEFINE_POOL_METHOD(void)::GetStats(PoolStats &stats)
+{
+	stats.name = this->name;
+	stats.items = this->items;
+	stats.first_unused = this->first_unused;
+	stats.size = this->size;
+	stats.item_size = sizeof(Titem);
+	stats.slabs = 0;
+	stats.slab_items = Tslab ? SLAB_ITEMS : 0;
+	stats.memory = this->size * sizeof(Titem *) + CeilDiv(this->size, 64) * sizeof(uint64);
+	if (Tslab) {
+		for (size_t i = 0; i < CeilDiv(this->size, SLAB_ITEMS); i++) {
+			if (this->slabs[i] != nullptr) stats.slabs++;
+		}
+		stats.memory += CeilDiv(this->size, SLAB_ITEMS) * sizeof(byte *) + stats.slabs * SLAB_ITEMS * sizeof(Titem);
+	} else {
+		size_t cached = 0;
+		for (const AllocCache *ac = this->alloc_cache; ac != nullptr; ac = ac->next) cached++;
+		stats.memory += (this->items + cached) * sizeof(Titem);
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	stats.iterated = 0;
+	for (size_t i = this->FindNextUsed(0); i < this->first_unused; i = this->FindNextUsed(i + 1)) {
+		if (this->Get(i)->index == i) stats.iterated++;
+	}
+	stats.iterate_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
 #undef DEFINE_POOL_METHOD
 
 /**
@@ -240,7 +350,9 @@ DEFINE_POOL_METHOD(void)::CleanPool()
 #define INSTANTIATE_POOL_METHODS(name) \
 	template void * name ## Pool::GetNew(size_t size); \
 	template void * name ## Pool::GetNew(size_t size, size_t index); \
+	template void * name ## Pool::GetNewNear(size_t size, size_t neighbour); \
 	template void name ## Pool::FreeItem(size_t index); \
-	template void name ## Pool::CleanPool();
+	template void name ## Pool::CleanPool(); \
+	template void name ## Pool::GetStats(PoolStats &stats);
 
 #endif /* POOL_FUNC_HPP */
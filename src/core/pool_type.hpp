@@ -12,6 +12,8 @@
 
 #include "smallvec_type.hpp"
 #include "enum_type.hpp"
+#include "math_func.hpp"
+#include "bitmath_func.hpp"
 
 /** Various types of a pool. */
 enum PoolType {
@@ -26,6 +28,25 @@ DECLARE_ENUM_AS_BIT_SET(PoolType)
 
 typedef std::vector<struct PoolBase *> PoolVector; ///< Vector of pointers to PoolBase
 
+/** Existing pool item to allocate a new item close to, see PoolItem's operator new(size_t, PoolNeighbour). */
+struct PoolNeighbour {
+	size_t index; ///< Index of the existing item.
+};
+
+/** Memory use and iteration cost of a pool, see #PoolBase::GetStats. */
+struct PoolStats {
+	const char *name;    ///< Name of the pool.
+	size_t items;        ///< Number of used indexes.
+	size_t first_unused; ///< This and all higher indexes are free.
+	size_t size;         ///< Number of addressable indexes.
+	size_t item_size;    ///< Size of the base item type.
+	size_t slabs;        ///< Number of allocated slabs, 0 when the pool doesn't use slabs.
+	size_t slab_items;   ///< Number of items per slab, 0 when the pool doesn't use slabs.
+	size_t memory;       ///< Number of bytes of the index, the bitmap and the (base part of the) items.
+	size_t iterated;     ///< Number of items found by iterating the pool.
+	uint64 iterate_ns;   ///< Time taken to iterate all items of the pool, in nanoseconds.
+};
+
 /** Base class for base of all pools. */
 struct PoolBase {
 	const PoolType type; ///< Type of this pool.
@@ -58,6 +79,12 @@ struct PoolBase {
 	 */
 	virtual void CleanPool() = 0;
 
+	/**
+	 * Virtual method that determines the memory use and iteration cost of the pool.
+	 * @param stats Stats to fill.
+	 */
+	virtual void GetStats(PoolStats &stats) = 0;
+
 private:
 	/**
 	 * Dummy private copy constructor to prevent compilers from
@@ -75,14 +102,18 @@ private:
  * @tparam Tpool_type   Type of this pool
  * @tparam Tcache       Whether to perform 'alloc' caching, i.e. don't actually free/malloc just reuse the memory
  * @tparam Tzero        Whether to zero the memory
- * @warning when Tcache is enabled *all* instances of this pool's item must be of the same size.
+ * @tparam Tslab        Whether to allocate the items from slabs of consecutive indexes, instead of one by one
+ * @warning when Tcache or Tslab is enabled *all* instances of this pool's item must be of the same size.
  */
-template <class Titem, typename Tindex, size_t Tgrowth_step, size_t Tmax_size, PoolType Tpool_type = PT_NORMAL, bool Tcache = false, bool Tzero = true>
+template <class Titem, typename Tindex, size_t Tgrowth_step, size_t Tmax_size, PoolType Tpool_type = PT_NORMAL, bool Tcache = false, bool Tzero = true, bool Tslab = false>
 struct Pool : PoolBase {
 	/* Ensure Tmax_size is within the bounds of Tindex. */
 	assert_compile((uint64)(Tmax_size - 1) >> 8 * sizeof(Tindex) == 0);
+	/* Slabs keep the memory of freed items already, so there is nothing to cache. */
+	assert_compile(!(Tcache && Tslab));
 
 	static const size_t MAX_SIZE = Tmax_size; ///< Make template parameter accessible from outside
+	static const size_t SLAB_ITEMS = Tgrowth_step > 64 ? Tgrowth_step : 64; ///< Number of items per slab; the pool always grows by whole slabs
 
 	const char * const name; ///< Name of this pool
 
@@ -97,9 +128,11 @@ struct Pool : PoolBase {
 
 	Titem **data;        ///< Pointer to array of pointers to Titem
 	uint64 *free_bitmap; ///< Pointer to free bitmap
+	byte **slabs;        ///< Pointer to array of slabs of #SLAB_ITEMS items, nullptr for slabs without items so far; only used with Tslab
 
 	Pool(const char *name);
 	virtual void CleanPool();
+	virtual void GetStats(PoolStats &stats);
 
 	/**
 	 * Returns Titem with given index
@@ -123,6 +156,24 @@ struct Pool : PoolBase {
 		return index < this->first_unused && this->Get(index) != nullptr;
 	}
 
+	/**
+	 * Finds the first used index at or after the given one, skipping unused ranges with the free bitmap.
+	 * @param index index to start searching at
+	 * @return first used index not lower than \a index, or first_unused if there is none
+	 */
+	inline size_t FindNextUsed(size_t index) const
+	{
+		if (index >= this->first_unused) return this->first_unused;
+		size_t bitmap_index = index / 64;
+		const size_t bitmap_end = CeilDiv(this->first_unused, 64);
+		uint64 used = this->free_bitmap[bitmap_index] & ((~(uint64) 0) << (index % 64));
+		while (used == 0) {
+			if (++bitmap_index == bitmap_end) return this->first_unused;
+			used = this->free_bitmap[bitmap_index];
+		}
+		return min(this->first_unused, (bitmap_index * 64) + FindFirstBit64(used));
+	}
+
 	/**
 	 * Tests whether we can allocate 'n' items
 	 * @param n number of items we want to allocate
@@ -161,7 +212,7 @@ struct Pool : PoolBase {
 
 	private:
 		size_t index;
-		void ValidateIndex() { while (this->index < T::GetPoolSize() && !(T::IsValidID(this->index))) this->index++; }
+		void ValidateIndex() { while ((this->index = T::GetNextUsedIndex(this->index)) < T::GetPoolSize() && !(T::IsValidID(this->index))) this->index++; }
 	};
 
 	/*
@@ -202,7 +253,7 @@ struct Pool : PoolBase {
 	private:
 		size_t index;
 		F filter;
-		void ValidateIndex() { while (this->index < T::GetPoolSize() && !(T::IsValidID(this->index) && this->filter(this->index))) this->index++; }
+		void ValidateIndex() { while ((this->index = T::GetNextUsedIndex(this->index)) < T::GetPoolSize() && !(T::IsValidID(this->index) && this->filter(this->index))) this->index++; }
 	};
 
 	/*
@@ -223,12 +274,12 @@ struct Pool : PoolBase {
 	 * Base class for all PoolItems
 	 * @tparam Tpool The pool this item is going to be part of
 	 */
-	template <struct Pool<Titem, Tindex, Tgrowth_step, Tmax_size, Tpool_type, Tcache, Tzero> *Tpool>
+	template <struct Pool<Titem, Tindex, Tgrowth_step, Tmax_size, Tpool_type, Tcache, Tzero, Tslab> *Tpool>
 	struct PoolItem {
 		Tindex index; ///< Index of this pool item
 
 		/** Type of the pool this item is going to be part of */
-		typedef struct Pool<Titem, Tindex, Tgrowth_step, Tmax_size, Tpool_type, Tcache, Tzero> Pool;
+		typedef struct Pool<Titem, Tindex, Tgrowth_step, Tmax_size, Tpool_type, Tcache, Tzero, Tslab> Pool;
 
 		/**
 		 * Allocates space for new Titem
@@ -267,6 +318,19 @@ struct Pool : PoolBase {
 			return Tpool->GetNew(size, index);
 		}
 
+		/**
+		 * Allocates space for new Titem, preferably close to an existing item.
+		 * With slabs, the new item is then close in memory to its neighbour too.
+		 * @param size size of Titem
+		 * @param neighbour item to allocate the new item close to
+		 * @return pointer to allocated memory
+		 * @note can never fail (return nullptr), use CanAllocate() to check first!
+		 */
+		inline void *operator new(size_t size, PoolNeighbour neighbour)
+		{
+			return Tpool->GetNewNear(size, neighbour.index);
+		}
+
 		/**
 		 * Allocates space for new Titem at given memory address
 		 * @param size size of Titem
@@ -353,6 +417,17 @@ struct Pool : PoolBase {
 			return Tpool->first_unused;
 		}
 
+		/**
+		 * Returns the first used index at or after the given one.
+		 * Useful for skipping unused ranges when iterating over all pool items.
+		 * @param index index to start searching at
+		 * @return first used index not lower than \a index, or GetPoolSize() if there is none
+		 */
+		static inline size_t GetNextUsedIndex(size_t index)
+		{
+			return Tpool->FindNextUsed(index);
+		}
+
 		/**
 		 * Returns number of valid items in the pool
 		 * @return number of valid items in the pool
@@ -404,9 +479,11 @@ private:
 	void *AllocateItem(size_t size, size_t index);
 	void ResizeFor(size_t index);
 	size_t FindFirstFree();
+	size_t FindFreeNear(size_t index);
 
 	void *GetNew(size_t size);
 	void *GetNew(size_t size, size_t index);
+	void *GetNewNear(size_t size, size_t neighbour);
 
 	void FreeItem(size_t index);
 };
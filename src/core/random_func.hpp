@@ -74,6 +74,25 @@ public:
 };
 
 void SetRandomSeed(uint32 seed);
+
+/**
+ * Derive the seed of an independent random sequence, such as one per map region,
+ * from a base seed and two values identifying the sequence.
+ * @param seed Base seed
+ * @param a First value identifying the sequence
+ * @param b Second value identifying the sequence
+ * @return Well mixed seed for a Randomizer
+ */
+static inline uint32 DeriveRandomSeed(uint32 seed, uint32 a, uint32 b)
+{
+	uint32 h = seed ^ (a * 0x9E3779B9) ^ (b * 0x85EBCA6B);
+	h ^= h >> 16;
+	h *= 0x7FEB352D;
+	h ^= h >> 15;
+	h *= 0x846CA68B;
+	h ^= h >> 16;
+	return h;
+}
 #ifdef RANDOM_DEBUG
 	#ifdef __APPLE__
 		#define OTTD_Random() DoRandom(__LINE__, __FILE__)
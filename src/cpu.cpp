@@ -88,7 +88,13 @@ uint64 ottd_rdtsc() {return 0;}
 #if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
 void ottd_cpuid(int info[4], int type)
 {
-	__cpuid(info, type);
+	__cpuidex(info, type, 0);
+}
+
+/** Read the extended control register 0 (XCR0), i.e. the register states saved by the OS. */
+static uint64 ottd_xgetbv()
+{
+	return _xgetbv(0);
 }
 #elif defined(__x86_64__) || defined(__i386)
 void ottd_cpuid(int info[4], int type)
@@ -108,21 +114,35 @@ void ottd_cpuid(int info[4], int type)
 			/* It is safe to write "=r" for (info[1]) as in case that PIC is enabled for i386,
 			 * the compiler will not choose EBX as target register (but something else).
 			 */
-			: "a" (type)
+			: "a" (type), "c" (0)
 	);
 #else
 	__asm__ __volatile__ (
 			"cpuid           \n\t"
 			: "=a" (info[0]), "=b" (info[1]), "=c" (info[2]), "=d" (info[3])
-			: "a" (type)
+			: "a" (type), "c" (0)
 	);
 #endif /* i386 PIC */
 }
+
+/** Read the extended control register 0 (XCR0), i.e. the register states saved by the OS. */
+static uint64 ottd_xgetbv()
+{
+	uint32 high, low;
+	/* Encoded as bytes as older assemblers do not know the xgetbv mnemonic. */
+	__asm__ __volatile__ (".byte 0x0f, 0x01, 0xd0" : "=a" (low), "=d" (high) : "c" (0));
+	return ((uint64)high << 32) | low;
+}
 #else
 void ottd_cpuid(int info[4], int type)
 {
 	info[0] = info[1] = info[2] = info[3] = 0;
 }
+
+static uint64 ottd_xgetbv()
+{
+	return 0;
+}
 #endif
 
 bool HasCPUIDFlag(uint type, uint index, uint bit)
@@ -135,3 +155,18 @@ bool HasCPUIDFlag(uint type, uint index, uint bit)
 	ottd_cpuid(cpu_info, type);
 	return HasBit(cpu_info[index], bit);
 }
+
+/**
+ * Check whether AVX2 instructions can be used.
+ * Next to the CPU supporting them, the OS must save the YMM registers on a context switch.
+ * @return True iff AVX2 is supported by both the CPU and the OS.
+ */
+bool HasAVX2Support()
+{
+	/* AVX and OSXSAVE; the latter is required before XGETBV may be executed. */
+	if (!HasCPUIDFlag(1, 2, 28) || !HasCPUIDFlag(1, 2, 27)) return false;
+	if (!HasCPUIDFlag(7, 1, 5)) return false;
+
+	/* The OS must have enabled saving of both the XMM and YMM state. */
+	return (ottd_xgetbv() & 0x6) == 0x6;
+}
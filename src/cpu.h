@@ -32,4 +32,6 @@ void ottd_cpuid(int info[4], int type);
  */
 bool HasCPUIDFlag(uint type, uint index, uint bit);
 
+bool HasAVX2Support();
+
 #endif /* CPU_H */
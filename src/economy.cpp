@@ -53,6 +53,8 @@
 #include "tbtr_template_vehicle.h"
 #include "scope_info.h"
 #include "pathfinder/yapf/yapf_cache.h"
+#include "tracing.h"
+#include "command_log_replay.h"
 
 #include "table/strings.h"
 #include "table/pricebase.h"
@@ -514,6 +516,9 @@ void ChangeOwnershipOfCompanyItems(Owner old_owner, Owner new_owner)
 			ChangeTileOwner(tile, old_owner, new_owner);
 		} while (++tile != MapSize());
 
+		/* The owners of track changed, outside of a command. */
+		ClearSignalBlockCache();
+
 		if (new_owner != INVALID_OWNER) {
 			/* Update all signals because there can be new segment that was owned by two companies
 			 * and signals were not propagated
@@ -663,8 +668,9 @@ static void CompanyCheckBankrupt(Company *c)
 			 * case of a network game the command will be processed at a time
 			 * that changing the current company is okay. In case of single
 			 * player we are sure (the above check) that we are not the local
-			 * company and thus we won't be moved. */
-			if (!_networking || _network_server) {
+			 * company and thus we won't be moved. When replaying a command
+			 * log, the command of the server is part of the log. */
+			if ((!_networking && !IsReplayingCommandLog()) || _network_server) {
 				DoCommandP(0, CCA_DELETE | (c->index << 16) | (CRR_BANKRUPT << 24), 0, CMD_COMPANY_CTRL);
 				return;
 			}
@@ -2147,6 +2153,8 @@ void LoadUnloadStation(Station *st)
 	/* No vehicle is here... */
 	if (st->loading_vehicles.empty()) return;
 
+	TRACE_ZONE_ID("LoadUnloadStation", st->index);
+
 	Vehicle *last_loading = nullptr;
 
 	/* Check if anything will be loaded at all. Otherwise we don't need to reserve either. */
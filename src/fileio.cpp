@@ -13,16 +13,24 @@
 #include "fios.h"
 #include "string_func.h"
 #include "tar_type.h"
+#include "core/mem_func.hpp"
 #ifdef _WIN32
 #include <windows.h>
+#include <io.h>
+#include "os/windows/win32.h"
 # define access _taccess
 #elif defined(__HAIKU__)
 #include <Path.h>
 #include <storage/FindDirectory.h>
+#include <unistd.h>
 #else
 #include <unistd.h>
 #include <pwd.h>
 #endif
+#if defined(UNIX) || defined(__HAIKU__)
+#include <sys/mman.h>
+#define WITH_FIO_MMAP
+#endif
 #include <sys/stat.h>
 #include <algorithm>
 
@@ -41,8 +49,10 @@ struct Fio {
 	byte *buffer, *buffer_end;             ///< position pointer in local buffer and last valid byte of buffer
 	size_t pos;                            ///< current (system) position in file
 	FILE *cur_fh;                          ///< current file handle
+	const FioFileMapping *cur_mapping;     ///< memory image of the current file, or nullptr if it is read through \c cur_fh
 	const char *filename;                  ///< current filename
 	FILE *handles[MAX_FILE_SLOTS];         ///< array of file handles we can have open
+	std::shared_ptr<const FioFileMapping> mappings[MAX_FILE_SLOTS]; ///< memory images of the files we have open, if they could be mapped
 	const char *filenames[MAX_FILE_SLOTS]; ///< array of filenames we (should) have open
 	char *shortnames[MAX_FILE_SLOTS];      ///< array of short names for spriteloader's use
 #if defined(LIMITED_FDS)
@@ -58,6 +68,7 @@ static bool _do_scan_working_directory = true;
 
 extern char *_config_file;
 extern char *_highscore_file;
+extern char *_grf_scan_cache_file;
 
 /**
  * Get position in the current file.
@@ -86,6 +97,15 @@ const char *FioGetFilename(uint slot)
 void FioSeekTo(size_t pos, int mode)
 {
 	if (mode == SEEK_CUR) pos += FioGetPos();
+	if (_fio.cur_mapping != nullptr) {
+		/* The whole file is in memory; let the read buffer span the mapping so that no refill is ever needed. */
+		const FioFileMapping *m = _fio.cur_mapping;
+		_fio.buffer_end = const_cast<byte *>(m->data + m->end);
+		_fio.buffer = const_cast<byte *>(m->data + min(pos, m->end));
+		_fio.pos = m->end;
+		if (pos > m->end) DEBUG(misc, 0, "Seeking in %s failed", _fio.filename);
+		return;
+	}
 	_fio.buffer = _fio.buffer_end = _fio.buffer_start + FIO_BUFFER_SIZE;
 	_fio.pos = pos;
 	if (fseek(_fio.cur_fh, _fio.pos, SEEK_SET) < 0) {
@@ -120,6 +140,7 @@ void FioSeekToFile(uint slot, size_t pos)
 	f = _fio.handles[slot];
 	assert(f != nullptr);
 	_fio.cur_fh = f;
+	_fio.cur_mapping = _fio.mappings[slot].get();
 	_fio.filename = _fio.filenames[slot];
 	FioSeekTo(pos, SEEK_SET);
 }
@@ -131,6 +152,7 @@ void FioSeekToFile(uint slot, size_t pos)
 byte FioReadByte()
 {
 	if (_fio.buffer == _fio.buffer_end) {
+		if (_fio.cur_mapping != nullptr) return 0;
 		_fio.buffer = _fio.buffer_start;
 		size_t size = fread(_fio.buffer, 1, FIO_BUFFER_SIZE, _fio.cur_fh);
 		_fio.pos += size;
@@ -184,6 +206,12 @@ uint32 FioReadDword()
  */
 void FioReadBlock(void *ptr, size_t size)
 {
+	if (_fio.cur_mapping != nullptr) {
+		size_t avail = min<size_t>(_fio.buffer_end - _fio.buffer, size);
+		MemCpyT(static_cast<byte *>(ptr), _fio.buffer, avail);
+		_fio.buffer += avail;
+		return;
+	}
 	FioSeekTo(FioGetPos(), SEEK_SET);
 	_fio.pos += fread(ptr, 1, size, _fio.cur_fh);
 }
@@ -195,6 +223,8 @@ void FioReadBlock(void *ptr, size_t size)
 static inline void FioCloseFile(int slot)
 {
 	if (_fio.handles[slot] != nullptr) {
+		if (_fio.cur_mapping == _fio.mappings[slot].get()) _fio.cur_mapping = nullptr;
+		_fio.mappings[slot].reset();
 		fclose(_fio.handles[slot]);
 
 		free(_fio.shortnames[slot]);
@@ -239,6 +269,92 @@ static void FioFreeHandle()
 }
 #endif /* LIMITED_FDS */
 
+/**
+ * Map a file into memory, read-only.
+ * The mapping always starts at the beginning of the underlying file, so that
+ * positions within a file in a tar keep using the same offsets as \c FILE based reading.
+ * @param f     The opened file, positioned at the start of the (possibly tarred) file.
+ * @param begin Offset of the start of the file in \a f.
+ * @param size  Size of the file, starting from \a begin.
+ * @return The mapping, or \c nullptr when the file could not be mapped. Callers must then fall back to reading \a f.
+ */
+static std::shared_ptr<const FioFileMapping> FioMapFile(FILE *f, size_t begin, size_t size)
+{
+	size_t end = begin + size;
+	if (size == 0 || end < begin) return nullptr;
+	/* Do not exhaust the address space of 32 bit builds with huge NewGRFs. */
+	if (sizeof(size_t) < 8 && end > (64 << 20)) return nullptr;
+
+#if defined(WITH_FIO_MMAP)
+	void *addr = mmap(nullptr, end, PROT_READ, MAP_SHARED, fileno(f), 0);
+	if (addr == MAP_FAILED) return nullptr;
+	return std::make_shared<FioFileMapping>(static_cast<const byte *>(addr), begin, end);
+#elif defined(_WIN32)
+	HANDLE mapping = CreateFileMapping((HANDLE)_get_osfhandle(_fileno(f)), nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping == nullptr) return nullptr;
+	void *addr = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, end);
+	/* The view keeps a reference to the mapping object. */
+	CloseHandle(mapping);
+	if (addr == nullptr) return nullptr;
+	return std::make_shared<FioFileMapping>(static_cast<const byte *>(addr), begin, end);
+#else
+	return nullptr;
+#endif
+}
+
+FioFileMapping::~FioFileMapping()
+{
+#if defined(WITH_FIO_MMAP)
+	munmap(const_cast<byte *>(this->data), this->end);
+#elif defined(_WIN32)
+	UnmapViewOfFile(this->data);
+#endif
+}
+
+/**
+ * Get the memory image of a slotted file.
+ * The returned mapping stays valid for as long as the caller holds on to it, even when the slot is closed or reused.
+ * @param slot Index of the file.
+ * @return The mapping, or \c nullptr if the file in \a slot is not memory mapped.
+ */
+std::shared_ptr<const FioFileMapping> FioGetFileMapping(uint slot)
+{
+	return _fio.mappings[slot];
+}
+
+/**
+ * Get the size and modification time of a slotted file.
+ * For a file within a tar these are the size and modification time of the tar itself.
+ * @param slot Index of the file.
+ * @param[out] size Size of the file in bytes.
+ * @param[out] mtime Time of the last modification of the file.
+ * @return True if the information could be determined.
+ */
+bool FioGetFileStat(uint slot, uint64 *size, int64 *mtime)
+{
+	if (_fio.handles[slot] == nullptr) return false;
+
+	return FioGetFileStat(_fio.handles[slot], size, mtime);
+}
+
+/**
+ * Get the size and modification time of an opened file.
+ * For a file within a tar these are the size and modification time of the tar itself.
+ * @param f The file.
+ * @param[out] size Size of the file in bytes.
+ * @param[out] mtime Time of the last modification of the file.
+ * @return True if the information could be determined.
+ */
+bool FioGetFileStat(FILE *f, uint64 *size, int64 *mtime)
+{
+	struct stat sb;
+	if (fstat(fileno(f), &sb) != 0) return false;
+
+	*size = sb.st_size;
+	*mtime = sb.st_mtime;
+	return true;
+}
+
 /**
  * Open a slotted file.
  * @param slot Index to assign.
@@ -252,7 +368,8 @@ void FioOpenFile(uint slot, const char *filename, Subdirectory subdir, char **ou
 #if defined(LIMITED_FDS)
 	FioFreeHandle();
 #endif /* LIMITED_FDS */
-	f = FioFOpenFile(filename, "rb", subdir, nullptr, output_filename);
+	size_t filesize;
+	f = FioFOpenFile(filename, "rb", subdir, &filesize, output_filename);
 	if (f == nullptr) usererror("Cannot open file '%s'", filename);
 	long pos = ftell(f);
 	if (pos < 0) usererror("Cannot read file '%s'", filename);
@@ -260,6 +377,7 @@ void FioOpenFile(uint slot, const char *filename, Subdirectory subdir, char **ou
 	FioCloseFile(slot); // if file was opened before, close it
 	_fio.handles[slot] = f;
 	_fio.filenames[slot] = filename;
+	_fio.mappings[slot] = FioMapFile(f, pos, filesize);
 
 	/* Store the filename without path and extension */
 	const char *t = strrchr(filename, PATHSEPCHAR);
@@ -1204,6 +1322,7 @@ void DeterminePaths(const char *exe)
 	DEBUG(misc, 3, "%s found as config directory", config_dir);
 
 	_highscore_file = str_fmt("%shs.dat", config_dir);
+	_grf_scan_cache_file = str_fmt("%snewgrf_scan.dat", config_dir);
 	extern char *_hotkeys_file;
 	_hotkeys_file = str_fmt("%shotkeys.cfg", config_dir);
 	extern char *_windows_file;
@@ -1273,6 +1392,46 @@ void SanitizeFilename(char *filename)
 	}
 }
 
+/**
+ * Open a temporary file to write a new version of a file to, which replaces the file once complete.
+ * The name of the temporary file is unique for this process, so concurrent instances do not write to the same file.
+ * @param filename The file to write a new version of.
+ * @param[out] tmp_filename Buffer for the name of the temporary file, to pass to #FioReplaceFile.
+ * @param last The last element of \a tmp_filename.
+ * @return The opened temporary file, or \c nullptr if it could not be opened.
+ */
+FILE *FioFOpenReplacementFile(const char *filename, char *tmp_filename, const char *last)
+{
+#if defined(_WIN32)
+	const uint pid = (uint)GetCurrentProcessId();
+#else
+	const uint pid = (uint)getpid();
+#endif
+	seprintf(tmp_filename, last, "%s.%u.tmp", filename, pid);
+	return fopen(tmp_filename, "w");
+}
+
+/**
+ * Replace a file by a new version written with #FioFOpenReplacementFile.
+ * Readers either see the old or the new version, never a partially written file.
+ * @param tmp_filename The temporary file with the new version; it is removed.
+ * @param filename The file to replace.
+ * @return True if the file was replaced.
+ */
+bool FioReplaceFile(const char *tmp_filename, const char *filename)
+{
+#if defined(_WIN32)
+	TCHAR tfilename[MAX_PATH], tfile_new[MAX_PATH];
+	convert_to_fs(filename, tfilename, lengthof(tfilename));
+	convert_to_fs(tmp_filename, tfile_new, lengthof(tfile_new));
+	if (MoveFileEx(tfile_new, tfilename, MOVEFILE_REPLACE_EXISTING) != 0) return true;
+#else
+	if (rename(tmp_filename, filename) == 0) return true;
+#endif
+	unlink(tmp_filename);
+	return false;
+}
+
 /**
  * Load a file into memory.
  * @param filename Name of the file to load.
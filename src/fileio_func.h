@@ -12,6 +12,20 @@
 
 #include "core/enum_type.hpp"
 #include "fileio_type.h"
+#include <memory>
+
+/** Read-only memory image of a (possibly tarred) file. */
+struct FioFileMapping {
+	const byte *data; ///< Start of the underlying file in memory.
+	size_t begin;     ///< Offset of the first byte of the file within \c data.
+	size_t end;       ///< Offset just past the last byte of the file within \c data.
+
+	FioFileMapping(const byte *data, size_t begin, size_t end) : data(data), begin(begin), end(end) {}
+	~FioFileMapping();
+
+	FioFileMapping(const FioFileMapping &) = delete;
+	FioFileMapping &operator=(const FioFileMapping &) = delete;
+};
 
 void FioSeekTo(size_t pos, int mode);
 void FioSeekToFile(uint slot, size_t pos);
@@ -24,6 +38,9 @@ void FioCloseAll();
 void FioOpenFile(uint slot, const char *filename, Subdirectory subdir, char **output_filename = nullptr);
 void FioReadBlock(void *ptr, size_t size);
 void FioSkipBytes(int n);
+std::shared_ptr<const FioFileMapping> FioGetFileMapping(uint slot);
+bool FioGetFileStat(uint slot, uint64 *size, int64 *mtime);
+bool FioGetFileStat(FILE *f, uint64 *size, int64 *mtime);
 
 /**
  * The search paths OpenTTD could search through.
@@ -61,6 +78,8 @@ void SanitizeFilename(char *filename);
 bool AppendPathSeparator(char *buf, const char *last);
 void DeterminePaths(const char *exe);
 void *ReadFileToMem(const char *filename, size_t *lenp, size_t maxsize);
+FILE *FioFOpenReplacementFile(const char *filename, char *tmp_filename, const char *last);
+bool FioReplaceFile(const char *tmp_filename, const char *filename);
 bool FileExists(const char *filename);
 bool ExtractTar(const char *tar_filename, Subdirectory subdir);
 
@@ -136,6 +136,33 @@ namespace {
 			return sumtime * 1000 / count / TIMESTAMP_PRECISION;
 		}
 
+		/**
+		 * Summarise the cycles of a performance element that started after a point in time.
+		 * @param since Timestamp to summarise the later cycles of.
+		 * @return The number, average and peak duration of the cycles.
+		 */
+		PerformanceSummary GetSummary(TimingMeasurement since)
+		{
+			PerformanceSummary summary = { 0, 0, 0 };
+			TimingMeasurement sumtime = 0;
+
+			/* Walk back from the last recorded point, at most over the whole buffer */
+			int point = this->prev_index;
+			for (int count = min(this->num_valid, NUM_FRAMERATE_POINTS); count > 0 && this->timestamps[point] > since; count--) {
+				auto d = this->durations[point];
+				if (d != INVALID_DURATION) {
+					sumtime += d;
+					summary.samples++;
+					summary.peak = max(summary.peak, d);
+				}
+				point--;
+				if (point < 0) point = NUM_FRAMERATE_POINTS - 1;
+			}
+
+			if (summary.samples != 0) summary.average = sumtime / summary.samples;
+			return summary;
+		}
+
 		/** Get current rate of a performance element, based on approximately the past one second of data */
 		double GetRate()
 		{
@@ -223,6 +250,39 @@ static TimingMeasurement GetPerformanceTimer()
 }
 
 
+/**
+ * Get the current time in the timebase of the performance measurements.
+ * @return Timestamp with microsecond precision.
+ */
+TimingMeasurement GetPerformanceTimestamp()
+{
+	return GetPerformanceTimer();
+}
+
+/**
+ * Summarise the measurements of a performance element after a point in time.
+ * Only the measurements still in the buffer of the element are included.
+ * @param elem The element to summarise.
+ * @param since Timestamp, from #GetPerformanceTimestamp, to summarise the later measurements of.
+ * @return The number, average and peak duration of the measurements.
+ */
+PerformanceSummary GetPerformanceSummary(PerformanceElement elem, TimingMeasurement since)
+{
+	assert(elem < PFE_MAX);
+	return _pf_data[elem].GetSummary(since);
+}
+
+/**
+ * Get the current rate of a performance element.
+ * @param elem The element to get the rate of.
+ * @return Number of cycles per second over approximately the past second.
+ */
+double GetPerformanceRate(PerformanceElement elem)
+{
+	assert(elem < PFE_MAX);
+	return _pf_data[elem].GetRate();
+}
+
 /**
  * Begin a cycle of a measured element.
  * @param elem The element to be measured
@@ -120,6 +120,17 @@ public:
 	static void Reset(PerformanceElement elem);
 };
 
+/** Summary of the measurements of a performance element over a period of time. */
+struct PerformanceSummary {
+	uint samples;              ///< Number of measurements in the period.
+	TimingMeasurement average; ///< Average duration of the measurements, in microseconds.
+	TimingMeasurement peak;    ///< Longest duration of the measurements, in microseconds.
+};
+
+TimingMeasurement GetPerformanceTimestamp();
+PerformanceSummary GetPerformanceSummary(PerformanceElement elem, TimingMeasurement since);
+double GetPerformanceRate(PerformanceElement elem);
+
 void ShowFramerateWindow();
 
 #endif /* FRAMERATE_TYPE_H */
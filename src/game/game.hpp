@@ -34,6 +34,13 @@ public:
 	 */
 	static void Initialize();
 
+	/**
+	 * Is the GameScript run by this game?
+	 * Network clients, and replays of a command log, only execute the commands of the GameScript of the server.
+	 * @return True if the GameScript is run here.
+	 */
+	static bool IsRunningInstance();
+
 	/**
 	 * Start up a new GameScript.
 	 */
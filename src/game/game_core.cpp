@@ -14,6 +14,7 @@
 #include "../network/network.h"
 #include "../window_func.h"
 #include "../framerate_type.h"
+#include "../command_log_replay.h"
 #include "game.hpp"
 #include "game_scanner.hpp"
 #include "game_config.hpp"
@@ -30,7 +31,7 @@
 
 /* static */ void Game::GameLoop()
 {
-	if (_networking && !_network_server) {
+	if (!Game::IsRunningInstance()) {
 		PerformanceMeasurer::SetInactive(PFE_GAMESCRIPT);
 		return;
 	}
@@ -69,12 +70,17 @@
 	}
 }
 
+/* static */ bool Game::IsRunningInstance()
+{
+	return (!_networking || _network_server) && !IsReplayingCommandLog();
+}
+
 /* static */ void Game::StartNew()
 {
 	if (Game::instance != nullptr) return;
 
 	/* Clients shouldn't start GameScripts */
-	if (_networking && !_network_server) return;
+	if (!Game::IsRunningInstance()) return;
 
 	GameConfig *config = GameConfig::GetConfig(GameConfig::SSS_FORCE_GAME);
 	GameInfo *info = config->GetInfo();
@@ -141,7 +147,7 @@
 	event->AddRef();
 
 	/* Clients should ignore events */
-	if (_networking && !_network_server) {
+	if (!Game::IsRunningInstance()) {
 		event->Release();
 		return;
 	}
@@ -201,7 +207,7 @@
 
 /* static */ void Game::Save()
 {
-	if (Game::instance != nullptr && (!_networking || _network_server)) {
+	if (Game::instance != nullptr && Game::IsRunningInstance()) {
 		Backup<CompanyID> cur_company(_current_company, OWNER_DEITY, FILE_LINE);
 		Game::instance->Save();
 		cur_company.Restore();
@@ -212,7 +218,7 @@
 
 /* static */ void Game::Load(int version)
 {
-	if (Game::instance != nullptr && (!_networking || _network_server)) {
+	if (Game::instance != nullptr && Game::IsRunningInstance()) {
 		Backup<CompanyID> cur_company(_current_company, OWNER_DEITY, FILE_LINE);
 		Game::instance->Load(version);
 		cur_company.Restore();
@@ -204,6 +204,7 @@ static void _GenerateWorld()
 		/* Call any callback */
 		if (_gw.proc != nullptr) _gw.proc();
 		IncreaseGeneratingWorldProgress(GWP_GAME_START);
+		FinishGeneratingWorldProgress();
 
 		CleanupGeneration();
 		lock.unlock();
@@ -219,6 +220,7 @@ static void _GenerateWorld()
 			SaveOrLoad(name, SLO_SAVE, DFT_GAME_FILE, AUTOSAVE_DIR, false);
 		}
 	} catch (...) {
+		FinishGeneratingWorldProgress();
 		BasePersistentStorageArray::SwitchMode(PSM_LEAVE_GAMELOOP, true);
 		if (_cur_company.IsValid()) _cur_company.Restore();
 		_generating_world = false;
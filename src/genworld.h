@@ -96,7 +96,8 @@ void HandleGeneratingWorldAbortion();
 /* genworld_gui.cpp */
 void SetNewLandscapeType(byte landscape);
 void SetGeneratingWorldProgress(GenWorldProgress cls, uint total);
-void IncreaseGeneratingWorldProgress(GenWorldProgress cls);
+void IncreaseGeneratingWorldProgress(GenWorldProgress cls, uint count = 1);
+void FinishGeneratingWorldProgress();
 void PrepareGenerateWorldProgress();
 void ShowGenerateWorldProgress();
 void StartNewGameWithoutGUI(uint32 seed);
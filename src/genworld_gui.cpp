@@ -31,6 +31,8 @@
 
 #include "widgets/genworld_widget.h"
 
+#include <chrono>
+
 #include "safeguards.h"
 
 
@@ -1224,6 +1226,43 @@ static const StringID _generation_class_table[]  = {
 };
 assert_compile(lengthof(_generation_class_table) == GWP_CLASS_COUNT);
 
+/** Names of the world generation stages, for the debug output of their timings. */
+static const char * const _generation_class_names[] = {
+	"map init",
+	"landscape",
+	"rivers",
+	"rough/rocky",
+	"towns",
+	"industries",
+	"objects",
+	"trees",
+	"game init",
+	"tile loop",
+	"game script",
+	"game start",
+};
+assert_compile(lengthof(_generation_class_names) == GWP_CLASS_COUNT);
+
+static GenWorldProgress _gws_timing_cls = GWP_CLASS_COUNT;      ///< Stage of the world generation which is being timed.
+static std::chrono::steady_clock::time_point _gws_timing_start; ///< Start time of the timed stage.
+
+/**
+ * Record the start of a stage of the world generation, and log the time taken by the previous stage.
+ * @param cls the stage which starts now, or GWP_CLASS_COUNT when world generation has finished.
+ */
+static void RecordGeneratingWorldStage(GenWorldProgress cls)
+{
+	if (cls == _gws_timing_cls) return;
+
+	auto now = std::chrono::steady_clock::now();
+	if (_gws_timing_cls != GWP_CLASS_COUNT && cls != GWP_MAP_INIT) {
+		uint ms = (uint)std::chrono::duration_cast<std::chrono::milliseconds>(now - _gws_timing_start).count();
+		DEBUG(misc, 1, "World generation: %s took %u ms", _generation_class_names[_gws_timing_cls], ms);
+	}
+	_gws_timing_cls = cls;
+	_gws_timing_start = now;
+}
+
 
 static void AbortGeneratingWorldCallback(Window *w, bool confirmed)
 {
@@ -1393,20 +1432,31 @@ static void _SetGeneratingWorldProgress(GenWorldProgress cls, uint progress, uin
  */
 void SetGeneratingWorldProgress(GenWorldProgress cls, uint total)
 {
+	RecordGeneratingWorldStage(cls);
+
 	if (total == 0) return;
 
 	_SetGeneratingWorldProgress(cls, 0, total);
 }
 
 /**
- * Increases the current stage of the world generation with one.
+ * Increases the current stage of the world generation.
  * @param cls the current class we are in.
+ * @param count the number of completed items.
  *
  * Warning: this function isn't clever. Don't go from class 4 to 3. Go upwards, always.
  *  Also, progress works if total is zero, total works if progress is zero.
  */
-void IncreaseGeneratingWorldProgress(GenWorldProgress cls)
+void IncreaseGeneratingWorldProgress(GenWorldProgress cls, uint count)
 {
 	/* In fact the param 'class' isn't needed.. but for some security reasons, we want it around */
-	_SetGeneratingWorldProgress(cls, 1, 0);
+	_SetGeneratingWorldProgress(cls, count, 0);
+}
+
+/**
+ * Mark the world generation as finished or aborted, which logs the time taken by its last stage.
+ */
+void FinishGeneratingWorldProgress()
+{
+	RecordGeneratingWorldStage(GWP_CLASS_COUNT);
 }
@@ -29,7 +29,10 @@
 #include "object_base.h"
 #include "company_func.h"
 #include "tunnelbridge_map.h"
+#include "road_map.h"
 #include "pathfinder/npf/aystar.h"
+#include "pathfinder/road_regions.h"
+#include "pathfinder/water_regions.h"
 #include "saveload/saveload.h"
 #include "framerate_type.h"
 #include "3rdparty/cpp-btree/btree_set.h"
@@ -579,6 +582,8 @@ void DoClearSquare(TileIndex tile)
 {
 	/* If the tile can have animation and we clear it, delete it from the animated tile list. */
 	if (_tile_type_procs[GetTileType(tile)]->animate_tile_proc != nullptr) DeleteAnimatedTile(tile);
+	if (MayHaveRoad(tile)) InvalidateRoadRegion(tile);
+	if (IsTileType(tile, MP_WATER) || IsTileType(tile, MP_STATION) || IsTileType(tile, MP_TUNNELBRIDGE)) InvalidateWaterRegion(tile);
 
 	MakeClear(tile, CLEAR_GRASS, _generating_world ? 3 : 0);
 	MarkTileDirtyByTile(tile);
@@ -16,6 +16,7 @@
 #include "../framerate_type.h"
 #include "../command_func.h"
 #include "../network/network.h"
+#include "../tracing.h"
 #include <algorithm>
 
 #include "../safeguards.h"
@@ -146,6 +147,8 @@ void LinkGraphSchedule::JoinNext()
  */
 /* static */ void LinkGraphSchedule::Run(LinkGraphJob *job)
 {
+	TRACE_ZONE_ID("Link graph job", job->index);
+
 	for (uint i = 0; i < lengthof(instance.handlers); ++i) {
 		if (job->IsJobAborted()) return;
 		instance.handlers[i]->Run(*job);
@@ -14,9 +14,39 @@
 #include "../vehicle_func.h"
 #include "refresh.h"
 #include "linkgraph.h"
+#include "../3rdparty/cpp-btree/btree_map.h"
 
 #include "../safeguards.h"
 
+/** Maximum number of cached runs per order list, see #LinkRefresher::CachedRefresh. */
+static const size_t MAX_CACHED_REFRESHES_PER_ORDER_LIST = 16;
+
+/** Cached runs of the refresh algorithm, by order list. */
+static btree::btree_map<OrderListID, std::vector<LinkRefresher::CachedRefresh>> _cached_refreshes;
+
+/**
+ * Forget the cached runs of the refresh algorithm for an order list.
+ * Call whenever the orders of the list are changed.
+ * @param list Order list to forget the runs of.
+ */
+/* static */ void LinkRefresher::InvalidateOrderList(OrderListID list)
+{
+	_cached_refreshes.erase(list);
+}
+
+/**
+ * Check whether an order list has orders which refit the vehicle.
+ * @param list Order list to check.
+ * @return True if the list has refit orders.
+ */
+static bool HasRefitOrders(const OrderList *list)
+{
+	for (const Order *o = list->GetFirstOrder(); o != nullptr; o = o->next) {
+		if ((o->IsType(OT_GOTO_DEPOT) || o->IsType(OT_GOTO_STATION)) && o->IsRefit()) return true;
+	}
+	return false;
+}
+
 /**
  * Refresh all links the given vehicle will visit.
  * @param v Vehicle to refresh links for.
@@ -30,6 +60,7 @@
 	if (v->orders.list == nullptr) return;
 
 	CargoTypes have_cargo_mask = v->GetLastLoadingStationValidCargoMask();
+	const bool cacheable = !HasRefitOrders(v->orders.list);
 
 	/* Scan orders for cargo-specific load/unload, and run LinkRefresher separately for each set of cargoes where they differ. */
 	while (cargo_mask != 0) {
@@ -52,16 +83,72 @@
 		/* Make sure the first order is a useful order. */
 		const Order *first = v->orders.list->GetNextDecisionNode(v->GetOrder(v->cur_implicit_order_index), 0, iter_cargo_mask);
 		if (first != nullptr) {
-			HopSet seen_hops;
-			LinkRefresher refresher(v, &seen_hops, allow_merge, is_full_loading, iter_cargo_mask);
+			const uint8 flags = (iter_cargo_mask & have_cargo_mask) ? 1 << HAS_CARGO : 0;
+
+			std::vector<CachedRefresh> *cached = cacheable ? &_cached_refreshes[v->orders.list->index] : nullptr;
+			const CachedRefresh *hit = nullptr;
+			if (cached != nullptr) {
+				for (const CachedRefresh &refresh : *cached) {
+					if (refresh.first == first && refresh.cargo_mask == iter_cargo_mask && refresh.flags == flags) {
+						hit = &refresh;
+						break;
+					}
+				}
+			}
+
+			if (hit != nullptr) {
+				/* Same orders and no refits: the same links are refreshed, only with the capacities of this vehicle. */
+				LinkRefresher refresher(v, nullptr, allow_merge, is_full_loading, iter_cargo_mask);
+				for (const RefreshStep &step : hit->steps) refresher.RefreshStats(step.first, step.second);
+			} else {
+				HopSet seen_hops;
+				std::vector<RefreshStep> steps;
+				LinkRefresher refresher(v, &seen_hops, allow_merge, is_full_loading, iter_cargo_mask);
+				if (cached != nullptr) refresher.recorded_steps = &steps;
+
+				refresher.RefreshLinks(first, first, flags);
 
-			refresher.RefreshLinks(first, first, (iter_cargo_mask & have_cargo_mask) ? 1 << HAS_CARGO : 0);
+				if (cached != nullptr) {
+					if (cached->size() >= MAX_CACHED_REFRESHES_PER_ORDER_LIST) cached->clear();
+					cached->push_back({ first, iter_cargo_mask, flags, std::move(steps) });
+				}
+			}
 		}
 
 		cargo_mask &= ~iter_cargo_mask;
 	}
 }
 
+/**
+ * Run the refresh algorithm again for all cached runs, without refreshing any links, and compare the results.
+ * @return The order lists whose cached runs don't match their orders any more.
+ */
+/* static */ std::vector<OrderListID> LinkRefresher::GetStaleCachedRefreshes()
+{
+	std::vector<OrderListID> stale;
+	for (const auto &it : _cached_refreshes) {
+		const OrderList *list = OrderList::GetIfValid(it.first);
+		bool ok = list != nullptr && list->GetFirstSharedVehicle() != nullptr && !HasRefitOrders(list);
+		for (const CachedRefresh &refresh : it.second) {
+			if (!ok) break;
+			ok = false;
+			for (const Order *o = list->GetFirstOrder(); o != nullptr; o = o->next) {
+				if (o == refresh.first) ok = true;
+			}
+			if (!ok) break;
+			HopSet seen_hops;
+			std::vector<RefreshStep> steps;
+			LinkRefresher refresher(list->GetFirstSharedVehicle(), &seen_hops, false, false, refresh.cargo_mask);
+			refresher.recorded_steps = &steps;
+			refresher.record_only = true;
+			refresher.RefreshLinks(refresh.first, refresh.first, refresh.flags);
+			ok = (steps == refresh.steps);
+		}
+		if (!ok) stale.push_back(it.first);
+	}
+	return stale;
+}
+
 /**
  * Comparison operator to allow hops to be used in a std::set.
  * @param other Other hop to be compared with.
@@ -92,7 +179,7 @@ bool LinkRefresher::Hop::operator<(const Hop &other) const
  */
 LinkRefresher::LinkRefresher(Vehicle *vehicle, HopSet *seen_hops, bool allow_merge, bool is_full_loading, CargoTypes cargo_mask) :
 	vehicle(vehicle), seen_hops(seen_hops), cargo(CT_INVALID), allow_merge(allow_merge),
-	is_full_loading(is_full_loading), cargo_mask(cargo_mask)
+	is_full_loading(is_full_loading), cargo_mask(cargo_mask), recorded_steps(nullptr), record_only(false)
 {
 	memset(this->capacities, 0, sizeof(this->capacities));
 
@@ -339,7 +426,8 @@ void LinkRefresher::RefreshLinks(const Order *cur, const Order *next, uint8 flag
 		if (cur->IsType(OT_GOTO_STATION) || cur->IsType(OT_IMPLICIT)) {
 			if (cur->CanLeaveWithCargo(HasBit(flags, HAS_CARGO), FindFirstBit(this->cargo_mask))) {
 				SetBit(flags, HAS_CARGO);
-				this->RefreshStats(cur, next);
+				if (this->recorded_steps != nullptr) this->recorded_steps->emplace_back(cur, next);
+				if (!this->record_only) this->RefreshStats(cur, next);
 			} else {
 				ClrBit(flags, HAS_CARGO);
 			}
@@ -23,6 +23,24 @@ class LinkRefresher {
 public:
 	static void Run(Vehicle *v, bool allow_merge = true, bool is_full_loading = false, CargoTypes cargo_mask = ALL_CARGOTYPES);
 
+	static void InvalidateOrderList(OrderListID list);
+	static std::vector<OrderListID> GetStaleCachedRefreshes();
+
+	/** Orders of a link to refresh the stats of, see #RefreshStats. */
+	typedef std::pair<const Order *, const Order *> RefreshStep;
+
+	/**
+	 * Links refreshed by a run of the refresh algorithm for an order list without refit orders.
+	 * Without refits the capacities of the consist don't change along the way, so which links are
+	 * refreshed only depends on the orders, and can be reused for all vehicles sharing the order list.
+	 */
+	struct CachedRefresh {
+		const Order *first;             ///< Order the run started at.
+		CargoTypes cargo_mask;          ///< Bit-mask of cargo IDs the run was for.
+		uint8 flags;                    ///< RefreshFlags the run started with.
+		std::vector<RefreshStep> steps; ///< Links refreshed by the run, in order.
+	};
+
 protected:
 	/**
 	 * Various flags about properties of the last examined link that might have
@@ -88,6 +106,8 @@ protected:
 	bool allow_merge;           ///< If the refresher is allowed to merge or extend link graphs.
 	bool is_full_loading;       ///< If the vehicle is full loading.
 	CargoTypes cargo_mask;      ///< Bit-mask of cargo IDs to refresh.
+	std::vector<RefreshStep> *recorded_steps; ///< Links refreshed so far, if they are to be cached. This is shared between all Refreshers of the same run.
+	bool record_only;           ///< Only record the links, don't refresh their stats.
 
 	LinkRefresher(Vehicle *v, HopSet *seen_hops, bool allow_merge, bool is_full_loading, CargoTypes cargo_mask);
 
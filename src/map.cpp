@@ -80,6 +80,9 @@ void AllocateMap(uint size_x, uint size_y)
 
 	_m = CallocT<Tile>(_map_size);
 	_me = CallocT<TileExtended>(_map_size);
+
+	extern void AllocateVehicleTileHash();
+	AllocateVehicleTileHash();
 }
 
 
@@ -37,6 +37,8 @@
 #include "command_func.h"
 #include "zoning.h"
 #include "cargopacket.h"
+#include "pathfinder/road_regions.h"
+#include "pathfinder/water_regions.h"
 
 #include "safeguards.h"
 
@@ -81,6 +83,8 @@ void InitializeGame(uint size_x, uint size_y, bool reset_date, bool reset_settin
 	_cur_tileloop_tile = 1;
 	_thd.redsq = INVALID_TILE;
 	_road_layout_change_counter = 0;
+	ClearRoadRegions();
+	ClearWaterRegions();
 	_game_events_since_load = (GameEventFlags) 0;
 	_game_events_overall = (GameEventFlags) 0;
 	_game_load_cur_date_ymd = { 0, 0, 0 };
@@ -113,6 +117,7 @@ void InitializeGame(uint size_x, uint size_y, bool reset_date, bool reset_settin
 
 	FreeSignalPrograms();
 	FreeSignalDependencies();
+	ClearSignalBlockCache();
 
 	ClearZoningCaches();
 	IntialiseOrderDestinationRefcountMap();
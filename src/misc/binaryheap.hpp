@@ -298,6 +298,20 @@ public:
 	{
 		this->items = 0;
 	}
+
+	/**
+	 * Free the memory above a capacity, if the heap grew beyond it.
+	 * @param max_capacity The capacity to shrink to.
+	 * @pre The heap holds no more than \a max_capacity items.
+	 */
+	inline void Shrink(uint max_capacity)
+	{
+		assert(this->items <= max_capacity);
+		if (this->capacity <= max_capacity) return;
+
+		this->capacity = max_capacity;
+		this->data = ReallocT<T*>(this->data, this->capacity + 1);
+	}
 };
 
 #endif /* BINARYHEAP_HPP */
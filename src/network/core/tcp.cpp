@@ -23,7 +23,7 @@
 NetworkTCPSocketHandler::NetworkTCPSocketHandler(SOCKET s) :
 		NetworkSocketHandler(),
 		packet_queue(nullptr), packet_recv(nullptr),
-		sock(s), writable(false)
+		sock(s), writable(false), traffic(nullptr)
 {
 }
 
@@ -123,6 +123,7 @@ SendPacketsState NetworkTCPSocketHandler::SendPackets(bool closing_down)
 		}
 
 		p->pos += res;
+		if (this->traffic != nullptr) this->traffic->bytes_sent += res;
 
 		/* Is this packet sent? */
 		if (p->pos == p->size) {
@@ -176,6 +177,7 @@ Packet *NetworkTCPSocketHandler::ReceivePacket()
 				return nullptr;
 			}
 			p->pos += res;
+			if (this->traffic != nullptr) this->traffic->bytes_received += res;
 		}
 
 		/* Read the packet size from the received packet */
@@ -203,6 +205,7 @@ Packet *NetworkTCPSocketHandler::ReceivePacket()
 		}
 
 		p->pos += res;
+		if (this->traffic != nullptr) this->traffic->bytes_received += res;
 	}
 
 	/* Prepare for receiving a new packet */
@@ -23,6 +23,12 @@ enum SendPacketsState {
 	SPS_ALL_SENT,    ///< All packets in the queue are sent.
 };
 
+/** Number of bytes sent and received over a group of TCP connections. */
+struct NetworkTraffic {
+	uint64 bytes_sent;     ///< Number of bytes sent.
+	uint64 bytes_received; ///< Number of bytes received.
+};
+
 /** Base socket handler for all TCP sockets */
 class NetworkTCPSocketHandler : public NetworkSocketHandler {
 private:
@@ -31,6 +37,7 @@ private:
 public:
 	SOCKET sock;              ///< The socket currently connected to
 	bool writable;            ///< Can we write to this socket?
+	NetworkTraffic *traffic;  ///< Counters to account the sent and received bytes to, or \c nullptr.
 
 	/**
 	 * Whether this socket is currently bound to a socket.
@@ -59,6 +59,7 @@ enum PacketAdminType {
 	ADMIN_PACKET_SERVER_GAMESCRIPT,      ///< The server gives the admin information from the GameScript in JSON.
 	ADMIN_PACKET_SERVER_RCON_END,        ///< The server indicates that the remote console command has completed.
 	ADMIN_PACKET_SERVER_PONG,            ///< The server replies to a ping request from the admin.
+	ADMIN_PACKET_SERVER_PERFORMANCE,     ///< The server gives the admin performance measurements of the game.
 
 	INVALID_ADMIN_PACKET = 0xFF,         ///< An invalid marker for admin packets.
 };
@@ -82,6 +83,7 @@ enum AdminUpdateType {
 	ADMIN_UPDATE_CMD_NAMES,       ///< The admin would like a list of all DoCommand names.
 	ADMIN_UPDATE_CMD_LOGGING,     ///< The admin would like to have DoCommand information.
 	ADMIN_UPDATE_GAMESCRIPT,      ///< The admin would like to have gamescript messages.
+	ADMIN_UPDATE_PERFORMANCE,     ///< The admin would like to have performance measurements.
 	ADMIN_UPDATE_END,             ///< Must ALWAYS be on the end of this list!! (period)
 };
 
@@ -477,6 +479,33 @@ protected:
 	 */
 	virtual NetworkRecvStatus Receive_SERVER_RCON_END(Packet *p);
 
+	/**
+	 * Send performance measurements of the game to the admin.
+	 *
+	 * NOTICE: The performance elements and pools are not stable. Do not rely
+	 *         on their IDs or names to be constant across different versions /
+	 *         revisions of OpenTTD.
+	 *
+	 * uint32  Game loop rate in hundredths of ticks per second.
+	 * uint8   Number of performance elements that follow.
+	 * For each performance element with measurements since the previous PERFORMANCE packet:
+	 *   uint8   ID of the performance element.
+	 *   uint16  Number of measurements since the previous PERFORMANCE packet.
+	 *   uint32  Average duration of these measurements in microseconds.
+	 *   uint32  Longest duration of these measurements in microseconds.
+	 * uint64  Number of bytes sent to clients since the server started.
+	 * uint64  Number of bytes received from clients since the server started.
+	 * uint8   Number of pools that follow.
+	 * For each pool:
+	 *   string  Name of the pool.
+	 *   uint32  Number of items in the pool.
+	 * uint64  Number of bytes used by the sprite cache.
+	 * uint64  Number of bytes the sprite cache is limited to.
+	 * @param p The packet that was just received.
+	 * @return The state the network should have.
+	 */
+	virtual NetworkRecvStatus Receive_SERVER_PERFORMANCE(Packet *p);
+
 	NetworkRecvStatus HandlePacket(Packet *p);
 public:
 	NetworkRecvStatus CloseConnection(bool error = true) override;
@@ -20,6 +20,16 @@
 #include "../map_func.h"
 #include "../rev.h"
 #include "../game/game.hpp"
+#include "../vehicle_base.h"
+#include "../station_base.h"
+#include "../roadstop_base.h"
+#include "../order_base.h"
+#include "../cargopacket.h"
+#include "../town.h"
+#include "../industry.h"
+#include "../linkgraph/linkgraph.h"
+#include "../linkgraph/linkgraphjob.h"
+#include "../spritecache.h"
 
 #include "../safeguards.h"
 
@@ -52,6 +62,7 @@ static const AdminUpdateFrequency _admin_update_type_frequencies[] = {
 	ADMIN_FREQUENCY_POLL,                                                                                                                                  ///< ADMIN_UPDATE_CMD_NAMES
 	                       ADMIN_FREQUENCY_AUTOMATIC,                                                                                                      ///< ADMIN_UPDATE_CMD_LOGGING
 	                       ADMIN_FREQUENCY_AUTOMATIC,                                                                                                      ///< ADMIN_UPDATE_GAMESCRIPT
+	ADMIN_FREQUENCY_POLL | ADMIN_FREQUENCY_DAILY | ADMIN_FREQUENCY_WEEKLY | ADMIN_FREQUENCY_MONTHLY | ADMIN_FREQUENCY_QUARTERLY | ADMIN_FREQUENCY_ANUALLY, ///< ADMIN_UPDATE_PERFORMANCE
 };
 /** Sanity check. */
 assert_compile(lengthof(_admin_update_type_frequencies) == ADMIN_UPDATE_END);
@@ -65,6 +76,7 @@ ServerNetworkAdminSocketHandler::ServerNetworkAdminSocketHandler(SOCKET s) : Net
 	_network_admins_connected++;
 	this->status = ADMIN_STATUS_INACTIVE;
 	this->realtime_connect = _realtime_tick;
+	this->last_performance_update = GetPerformanceTimestamp();
 }
 
 /**
@@ -655,6 +667,66 @@ NetworkRecvStatus ServerNetworkAdminSocketHandler::SendCmdLogging(ClientID clien
 	return NETWORK_RECV_STATUS_OKAY;
 }
 
+/**
+ * Send the performance measurements since the previous performance update of this admin.
+ */
+NetworkRecvStatus ServerNetworkAdminSocketHandler::SendPerformance()
+{
+	const TimingMeasurement now = GetPerformanceTimestamp();
+
+	PerformanceSummary summaries[PFE_MAX];
+	uint8 elements = 0;
+	for (PerformanceElement e = PFE_FIRST; e < PFE_MAX; e++) {
+		summaries[e] = GetPerformanceSummary(e, this->last_performance_update);
+		if (summaries[e].samples != 0) elements++;
+	}
+	this->last_performance_update = now;
+
+	Packet *p = new Packet(ADMIN_PACKET_SERVER_PERFORMANCE);
+
+	p->Send_uint32((uint32)(GetPerformanceRate(PFE_GAMELOOP) * 100));
+
+	p->Send_uint8(elements);
+	for (PerformanceElement e = PFE_FIRST; e < PFE_MAX; e++) {
+		const PerformanceSummary &summary = summaries[e];
+		if (summary.samples == 0) continue;
+
+		p->Send_uint8 (e);
+		p->Send_uint16(min<uint>(summary.samples, UINT16_MAX));
+		p->Send_uint32((uint32)min<TimingMeasurement>(summary.average, UINT32_MAX));
+		p->Send_uint32((uint32)min<TimingMeasurement>(summary.peak, UINT32_MAX));
+	}
+
+	p->Send_uint64(_network_server_traffic.bytes_sent);
+	p->Send_uint64(_network_server_traffic.bytes_received);
+
+	/* The pools that grow with the size of the game. */
+	const std::pair<const char *, size_t> pools[] = {
+		{ _vehicle_pool.name,        _vehicle_pool.items },
+		{ _station_pool.name,        _station_pool.items },
+		{ _roadstop_pool.name,       _roadstop_pool.items },
+		{ _order_pool.name,          _order_pool.items },
+		{ _orderlist_pool.name,      _orderlist_pool.items },
+		{ _cargopacket_pool.name,    _cargopacket_pool.items },
+		{ _town_pool.name,           _town_pool.items },
+		{ _industry_pool.name,       _industry_pool.items },
+		{ _link_graph_pool.name,     _link_graph_pool.items },
+		{ _link_graph_job_pool.name, _link_graph_job_pool.items },
+	};
+	p->Send_uint8(lengthof(pools));
+	for (const auto &pool : pools) {
+		p->Send_string(pool.first);
+		p->Send_uint32((uint32)pool.second);
+	}
+
+	p->Send_uint64(GetSpriteCacheUsage());
+	p->Send_uint64(GetSpriteCacheLimit());
+
+	this->SendPacket(p);
+
+	return NETWORK_RECV_STATUS_OKAY;
+}
+
 /***********
  * Receiving functions
  ************/
@@ -768,6 +840,11 @@ NetworkRecvStatus ServerNetworkAdminSocketHandler::Receive_ADMIN_POLL(Packet *p)
 			this->SendCmdNames();
 			break;
 
+		case ADMIN_UPDATE_PERFORMANCE:
+			/* The admin is requesting performance measurements. */
+			this->SendPerformance();
+			break;
+
 		default:
 			/* An unsupported "poll" update type. */
 			DEBUG(net, 3, "[admin] Not supported poll %d (%d) from '%s' (%s).", type, d1, this->admin_name, this->admin_version);
@@ -1016,6 +1093,10 @@ void NetworkAdminUpdate(AdminUpdateFrequency freq)
 						as->SendCompanyStats();
 						break;
 
+					case ADMIN_UPDATE_PERFORMANCE:
+						as->SendPerformance();
+						break;
+
 					default: NOT_REACHED();
 				}
 			}
@@ -13,6 +13,7 @@
 #include "network_internal.h"
 #include "core/tcp_listen.h"
 #include "core/tcp_admin.h"
+#include "../framerate_type.h"
 
 extern AdminIndex _redirect_console_to_admin;
 
@@ -39,6 +40,7 @@ public:
 	AdminUpdateFrequency update_frequency[ADMIN_UPDATE_END]; ///< Admin requested update intervals.
 	uint32 realtime_connect;                                 ///< Time of connection.
 	NetworkAddress address;                                  ///< Address of the admin.
+	TimingMeasurement last_performance_update;              ///< Time of the previous performance update.
 
 	ServerNetworkAdminSocketHandler(SOCKET s);
 	~ServerNetworkAdminSocketHandler();
@@ -68,6 +70,7 @@ public:
 	NetworkRecvStatus SendCmdNames();
 	NetworkRecvStatus SendCmdLogging(ClientID client_id, const CommandPacket *cp);
 	NetworkRecvStatus SendRconEnd(const char *command);
+	NetworkRecvStatus SendPerformance();
 
 	static void Send();
 	static void AcceptConnection(SOCKET s, const NetworkAddress &address);
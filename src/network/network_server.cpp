@@ -54,6 +54,9 @@ assert_compile(NetworkClientSocketPool::MAX_SIZE == MAX_CLIENT_SLOTS);
 NetworkClientSocketPool _networkclientsocket_pool("NetworkClientSocket");
 INSTANTIATE_POOL_METHODS(NetworkClientSocket)
 
+/** Bytes sent to and received from all clients of the server. */
+NetworkTraffic _network_server_traffic;
+
 /** Instantiate the listen sockets. */
 template SocketList TCPListenHandler<ServerNetworkGameSocketHandler, PACKET_SERVER_FULL, PACKET_SERVER_BANNED>::sockets;
 
@@ -217,6 +220,7 @@ ServerNetworkGameSocketHandler::ServerNetworkGameSocketHandler(SOCKET s) : Netwo
 	this->server_hash_bits = InteractiveRandom();
 	this->rcon_hash_bits = InteractiveRandom();
 	this->settings_hash_bits = InteractiveRandom();
+	this->traffic = &_network_server_traffic;
 
 	/* The Socket and Info pools need to be the same in size. After all,
 	 * each Socket will be associated with at most one Info object. As
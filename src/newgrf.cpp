@@ -430,6 +430,9 @@ static void ClearTemporaryNewGRFData(GRFFile *gf)
 		l = l2;
 	}
 	gf->label = nullptr;
+
+	gf->sprite_records.clear();
+	gf->sprite_records.shrink_to_fit();
 }
 
 /**
@@ -9204,6 +9207,7 @@ void ResetNewGRFData()
 	_grf_id_overrides.clear();
 
 	InitializeSoundPool();
+	ClearCallbackCache();
 	_spritegroup_pool.CleanPool();
 }
 
@@ -9791,6 +9795,53 @@ static void FinaliseAirportsArray()
 	}
 }
 
+/* XXX: There is a difference between staged loading in TTDPatch and
+ * here.  In TTDPatch, for some reason actions 1 and 2 are carried out
+ * during stage 1, whilst action 3 is carried out during stage 2 (to
+ * "resolve" cargo IDs... wtf). This is a little problem, because cargo
+ * IDs are valid only within a given set (action 1) block, and may be
+ * overwritten after action 3 associates them. But overwriting happens
+ * in an earlier stage than associating, so...  We just process actions
+ * 1 and 2 in stage 2 now, let's hope that won't get us into problems.
+ * --pasky
+ * We need a pre-stage to set up GOTO labels of Action 0x10 because the grf
+ * is not in memory and scanning the file every time would be too expensive.
+ * In other stages we skip action 0x10 since it's already dealt with. */
+static const SpecialSpriteHandler _special_sprite_handlers[][GLS_END] = {
+	/* 0x00 */ { nullptr,       SafeChangeInfo, nullptr,         nullptr,         ReserveChangeInfo, FeatureChangeInfo, },
+	/* 0x01 */ { SkipAct1,      SkipAct1,       SkipAct1,        SkipAct1,        SkipAct1,          NewSpriteSet, },
+	/* 0x02 */ { nullptr,       nullptr,        nullptr,         nullptr,         nullptr,           NewSpriteGroup, },
+	/* 0x03 */ { nullptr,       GRFUnsafe,      nullptr,         nullptr,         nullptr,           FeatureMapSpriteGroup, },
+	/* 0x04 */ { nullptr,       nullptr,        nullptr,         nullptr,         nullptr,           FeatureNewName, },
+	/* 0x05 */ { SkipAct5,      SkipAct5,       SkipAct5,        SkipAct5,        SkipAct5,          GraphicsNew, },
+	/* 0x06 */ { nullptr,       nullptr,        nullptr,         CfgApply,        CfgApply,          CfgApply, },
+	/* 0x07 */ { nullptr,       nullptr,        nullptr,         nullptr,         SkipIf,            SkipIf, },
+	/* 0x08 */ { ScanInfo,      nullptr,        nullptr,         GRFInfo,         GRFInfo,           GRFInfo, },
+	/* 0x09 */ { nullptr,       nullptr,        nullptr,         SkipIf,          SkipIf,            SkipIf, },
+	/* 0x0A */ { SkipActA,      SkipActA,       SkipActA,        SkipActA,        SkipActA,          SpriteReplace, },
+	/* 0x0B */ { nullptr,       nullptr,        nullptr,         GRFLoadError,    GRFLoadError,      GRFLoadError, },
+	/* 0x0C */ { nullptr,       nullptr,        nullptr,         GRFComment,      nullptr,           GRFComment, },
+	/* 0x0D */ { nullptr,       SafeParamSet,   nullptr,         ParamSet,        ParamSet,          ParamSet, },
+	/* 0x0E */ { nullptr,       SafeGRFInhibit, nullptr,         GRFInhibit,      GRFInhibit,        GRFInhibit, },
+	/* 0x0F */ { nullptr,       GRFUnsafe,      nullptr,         FeatureTownName, nullptr,           nullptr, },
+	/* 0x10 */ { nullptr,       nullptr,        DefineGotoLabel, nullptr,         nullptr,           nullptr, },
+	/* 0x11 */ { SkipAct11,     GRFUnsafe,      SkipAct11,       GRFSound,        SkipAct11,         GRFSound, },
+	/* 0x12 */ { SkipAct12,     SkipAct12,      SkipAct12,       SkipAct12,       SkipAct12,         LoadFontGlyph, },
+	/* 0x13 */ { nullptr,       nullptr,        nullptr,         nullptr,         nullptr,           TranslateGRFStrings, },
+	/* 0x14 */ { StaticGRFInfo, nullptr,        nullptr,         Act14FeatureTest,nullptr,           nullptr, },
+};
+
+/**
+ * Check whether a pseudo sprite action does anything in the given loading stage.
+ * @param action The action of the pseudo sprite.
+ * @param stage The loading stage.
+ * @return True if the action has a handler in \a stage.
+ */
+static bool IsSpecialSpriteHandled(byte action, GrfLoadingStage stage)
+{
+	return action < lengthof(_special_sprite_handlers) && _special_sprite_handlers[action][stage] != nullptr;
+}
+
 /* Here we perform initial decoding of some special sprites (as are they
  * described at http://www.ttdpatch.net/src/newgrf.txt, but this is only a very
  * partial implementation yet).
@@ -9799,42 +9850,6 @@ static void FinaliseAirportsArray()
  * better make this more robust in the future. */
 static void DecodeSpecialSprite(byte *buf, uint num, GrfLoadingStage stage)
 {
-	/* XXX: There is a difference between staged loading in TTDPatch and
-	 * here.  In TTDPatch, for some reason actions 1 and 2 are carried out
-	 * during stage 1, whilst action 3 is carried out during stage 2 (to
-	 * "resolve" cargo IDs... wtf). This is a little problem, because cargo
-	 * IDs are valid only within a given set (action 1) block, and may be
-	 * overwritten after action 3 associates them. But overwriting happens
-	 * in an earlier stage than associating, so...  We just process actions
-	 * 1 and 2 in stage 2 now, let's hope that won't get us into problems.
-	 * --pasky
-	 * We need a pre-stage to set up GOTO labels of Action 0x10 because the grf
-	 * is not in memory and scanning the file every time would be too expensive.
-	 * In other stages we skip action 0x10 since it's already dealt with. */
-	static const SpecialSpriteHandler handlers[][GLS_END] = {
-		/* 0x00 */ { nullptr,       SafeChangeInfo, nullptr,         nullptr,         ReserveChangeInfo, FeatureChangeInfo, },
-		/* 0x01 */ { SkipAct1,      SkipAct1,       SkipAct1,        SkipAct1,        SkipAct1,          NewSpriteSet, },
-		/* 0x02 */ { nullptr,       nullptr,        nullptr,         nullptr,         nullptr,           NewSpriteGroup, },
-		/* 0x03 */ { nullptr,       GRFUnsafe,      nullptr,         nullptr,         nullptr,           FeatureMapSpriteGroup, },
-		/* 0x04 */ { nullptr,       nullptr,        nullptr,         nullptr,         nullptr,           FeatureNewName, },
-		/* 0x05 */ { SkipAct5,      SkipAct5,       SkipAct5,        SkipAct5,        SkipAct5,          GraphicsNew, },
-		/* 0x06 */ { nullptr,       nullptr,        nullptr,         CfgApply,        CfgApply,          CfgApply, },
-		/* 0x07 */ { nullptr,       nullptr,        nullptr,         nullptr,         SkipIf,            SkipIf, },
-		/* 0x08 */ { ScanInfo,      nullptr,        nullptr,         GRFInfo,         GRFInfo,           GRFInfo, },
-		/* 0x09 */ { nullptr,       nullptr,        nullptr,         SkipIf,          SkipIf,            SkipIf, },
-		/* 0x0A */ { SkipActA,      SkipActA,       SkipActA,        SkipActA,        SkipActA,          SpriteReplace, },
-		/* 0x0B */ { nullptr,       nullptr,        nullptr,         GRFLoadError,    GRFLoadError,      GRFLoadError, },
-		/* 0x0C */ { nullptr,       nullptr,        nullptr,         GRFComment,      nullptr,           GRFComment, },
-		/* 0x0D */ { nullptr,       SafeParamSet,   nullptr,         ParamSet,        ParamSet,          ParamSet, },
-		/* 0x0E */ { nullptr,       SafeGRFInhibit, nullptr,         GRFInhibit,      GRFInhibit,        GRFInhibit, },
-		/* 0x0F */ { nullptr,       GRFUnsafe,      nullptr,         FeatureTownName, nullptr,           nullptr, },
-		/* 0x10 */ { nullptr,       nullptr,        DefineGotoLabel, nullptr,         nullptr,           nullptr, },
-		/* 0x11 */ { SkipAct11,     GRFUnsafe,      SkipAct11,       GRFSound,        SkipAct11,         GRFSound, },
-		/* 0x12 */ { SkipAct12,     SkipAct12,      SkipAct12,       SkipAct12,       SkipAct12,         LoadFontGlyph, },
-		/* 0x13 */ { nullptr,       nullptr,        nullptr,         nullptr,         nullptr,           TranslateGRFStrings, },
-		/* 0x14 */ { StaticGRFInfo, nullptr,        nullptr,         Act14FeatureTest,nullptr,           nullptr, },
-	};
-
 	GRFLocation location(_cur.grfconfig->ident.grfid, _cur.nfo_line);
 
 	GRFLineToSpriteOverride::iterator it = _grf_line_to_action6_sprite_override.find(location);
@@ -9861,13 +9876,13 @@ static void DecodeSpecialSprite(byte *buf, uint num, GrfLoadingStage stage)
 			grfmsg(2, "DecodeSpecialSprite: Unexpected data block, skipping");
 		} else if (action == 0xFE) {
 			grfmsg(2, "DecodeSpecialSprite: Unexpected import block, skipping");
-		} else if (action >= lengthof(handlers)) {
+		} else if (action >= lengthof(_special_sprite_handlers)) {
 			grfmsg(7, "DecodeSpecialSprite: Skipping unknown action 0x%02X", action);
-		} else if (handlers[action][stage] == nullptr) {
+		} else if (_special_sprite_handlers[action][stage] == nullptr) {
 			grfmsg(7, "DecodeSpecialSprite: Skipping action 0x%02X in stage %d", action, stage);
 		} else {
 			grfmsg(7, "DecodeSpecialSprite: Handling action 0x%02X in stage %d", action, stage);
-			handlers[action][stage](bufp);
+			_special_sprite_handlers[action][stage](bufp);
 		}
 	} catch (...) {
 		grfmsg(1, "DecodeSpecialSprite: Tried to read past end of pseudo-sprite data");
@@ -9985,18 +10000,55 @@ void LoadNewGRFFile(GRFConfig *config, uint file_index, GrfLoadingStage stage, S
 
 	ReusableBuffer<byte> buf;
 
-	while ((num = (_cur.grf_container_ver >= 2 ? FioReadDword() : FioReadWord())) != 0) {
+	/* The label scan is the first stage to walk the whole file; it builds the index of
+	 * sprite records, so later stages can skip records without decoding them. */
+	const bool build_index = (stage == GLS_LABELSCAN);
+	std::vector<GRFSpriteRecord> new_records;
+	const std::vector<GRFSpriteRecord> *records = nullptr;
+	if (stage != GLS_FILESCAN && stage != GLS_SAFETYSCAN && !build_index && !_cur.grffile->sprite_records.empty()) {
+		records = &_cur.grffile->sprite_records;
+	}
+	size_t next_record = 0;
+	if (build_index) _cur.grffile->sprite_records.clear();
+
+	for (;;) {
+		size_t pos = FioGetPos();
+		const GRFSpriteRecord *record = nullptr;
+		if (records != nullptr) {
+			/* Records are normally visited in order, but actions 1, 5, 7, 9, 0A and 11 may move the file position. */
+			if (next_record >= records->size() || (*records)[next_record].pos != pos) {
+				next_record = std::lower_bound(records->begin(), records->end(), pos,
+						[](const GRFSpriteRecord &r, size_t p) { return r.pos < p; }) - records->begin();
+			}
+			if (next_record < records->size() && (*records)[next_record].pos == pos) record = &(*records)[next_record++];
+		}
+
+		if ((num = (_cur.grf_container_ver >= 2 ? FioReadDword() : FioReadWord())) == 0) break;
 		byte type = FioReadByte();
 		_cur.nfo_line++;
 
 		if (type == 0xFF) {
 			if (_cur.skip_sprites == 0) {
-				DecodeSpecialSprite(buf.Allocate(num), num, stage);
+				GRFLocation location(_cur.grfconfig->ident.grfid, _cur.nfo_line);
+				bool overridden = _grf_line_to_action6_sprite_override.find(location) != _grf_line_to_action6_sprite_override.end();
+
+				if (record != nullptr && record->action != 0xFF && !overridden && !IsSpecialSpriteHandled(record->action, stage)) {
+					/* Nothing to do for this action in this stage, don't bother reading it. */
+					grfmsg(7, "LoadNewGRFFile: Skipping action 0x%02X in stage %d", record->action, stage);
+					FioSeekTo(record->next_pos, SEEK_SET);
+					continue;
+				}
+
+				byte *data = buf.Allocate(num);
+				DecodeSpecialSprite(data, num, stage);
+				if (build_index) new_records.push_back({ pos, pos + num + (_cur.grf_container_ver >= 2 ? 5 : 3), type, overridden ? (byte)0xFF : data[0] });
 
 				/* Stop all processing if we are to skip the remaining sprites */
 				if (_cur.skip_sprites == -1) break;
 
 				continue;
+			} else if (record != nullptr) {
+				FioSeekTo(record->next_pos, SEEK_SET);
 			} else {
 				FioSkipBytes(num);
 			}
@@ -10007,7 +10059,9 @@ void LoadNewGRFFile(GRFConfig *config, uint file_index, GrfLoadingStage stage, S
 				break;
 			}
 
-			if (_cur.grf_container_ver >= 2 && type == 0xFD) {
+			if (record != nullptr) {
+				FioSeekTo(record->next_pos, SEEK_SET);
+			} else if (_cur.grf_container_ver >= 2 && type == 0xFD) {
 				/* Reference to data section. Container version >= 2 only. */
 				FioSkipBytes(num);
 			} else {
@@ -10016,8 +10070,13 @@ void LoadNewGRFFile(GRFConfig *config, uint file_index, GrfLoadingStage stage, S
 			}
 		}
 
+		if (build_index) new_records.push_back({ pos, FioGetPos(), type, 0xFF });
+
 		if (_cur.skip_sprites > 0) _cur.skip_sprites--;
 	}
+
+	/* Only keep a complete index; an aborted scan leaves later stages to read the file the slow way. */
+	if (build_index && num == 0) _cur.grffile->sprite_records = std::move(new_records);
 }
 
 /**
@@ -10209,6 +10268,9 @@ static void AfterLoadGRFs()
 	}
 	_grf_line_to_action6_sprite_override.clear();
 
+	/* Prepare the sprite groups for faster resolving. */
+	CompileSpriteGroups();
+
 	/* Polish cargoes */
 	FinaliseCargoArray();
 
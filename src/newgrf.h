@@ -105,6 +105,14 @@ struct GRFLabel {
 	struct GRFLabel *next;
 };
 
+/** Location of a sprite record within a NewGRF file, indexed during the first loading stage. */
+struct GRFSpriteRecord {
+	size_t pos;      ///< Offset of the record header in the file.
+	size_t next_pos; ///< Offset of the header of the next record.
+	byte type;       ///< Type of the record, 0xFF for pseudo sprites.
+	byte action;     ///< Action of a pseudo sprite, 0xFF if not known.
+};
+
 enum Action0RemapPropertyIds {
 	A0RPI_CHECK_PROPERTY_LENGTH = 0x10000,
 	A0RPI_UNKNOWN_IGNORE = 0x200,
@@ -234,6 +242,7 @@ struct GRFFile : ZeroedMemoryAllocator {
 	uint param_end;  ///< one more than the highest set parameter
 
 	GRFLabel *label; ///< Pointer to the first label. This is a linked list, not an array.
+	std::vector<GRFSpriteRecord> sprite_records; ///< Index of all sprite records in the file, only available while loading.
 
 	std::vector<CargoLabel> cargo_list;             ///< Cargo translation table (local ID -> label)
 	uint8 cargo_map[NUM_CARGO];                     ///< Inverse cargo translation table (CargoID -> local ID)
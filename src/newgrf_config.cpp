@@ -26,6 +26,9 @@
 #include "fios.h"
 
 #include "thread.h"
+#include "string_func.h"
+#include <map>
+#include <memory>
 #include <mutex>
 #include <condition_variable>
 #if defined(__MINGW32__)
@@ -346,39 +349,52 @@ bool UpdateNewGRFConfigPalette(int32 p1)
 	return true;
 }
 
+/** Number of bytes at the start of a GRF needed to determine the size of its data section. */
+static const uint GRF_DATA_SECTION_HEADER_LEN = 14;
+
 /**
- * Get the data section size of a GRF.
- * @param f GRF.
+ * Get the data section size of a GRF from the start of the file.
+ * @param data The first #GRF_DATA_SECTION_HEADER_LEN bytes of the GRF.
  * @return Size of the data section or SIZE_MAX if the file has no separate data section.
  */
-size_t GRFGetSizeOfDataSection(FILE *f)
+static size_t GRFGetSizeOfDataSection(const byte *data)
 {
 	extern const byte _grf_cont_v2_sig[];
-	static const uint header_len = 14;
-
-	byte data[header_len];
-	if (fread(data, 1, header_len, f) == header_len) {
-		if (data[0] == 0 && data[1] == 0 && MemCmpT(data + 2, _grf_cont_v2_sig, 8) == 0) {
-			/* Valid container version 2, get data section size. */
-			size_t offset = ((size_t)data[13] << 24) | ((size_t)data[12] << 16) | ((size_t)data[11] << 8) | (size_t)data[10];
-			if (offset >= 1 * 1024 * 1024 * 1024) {
-				DEBUG(grf, 0, "Unexpectedly large offset for NewGRF");
-				/* Having more than 1 GiB of data is very implausible. Mostly because then
-				 * all pools in OpenTTD are flooded already. Or it's just Action C all over.
-				 * In any case, the offsets to graphics will likely not work either. */
-				return SIZE_MAX;
-			}
-			return header_len + offset;
+	static const uint header_len = GRF_DATA_SECTION_HEADER_LEN;
+
+	if (data[0] == 0 && data[1] == 0 && MemCmpT(data + 2, _grf_cont_v2_sig, 8) == 0) {
+		/* Valid container version 2, get data section size. */
+		size_t offset = ((size_t)data[13] << 24) | ((size_t)data[12] << 16) | ((size_t)data[11] << 8) | (size_t)data[10];
+		if (offset >= 1 * 1024 * 1024 * 1024) {
+			DEBUG(grf, 0, "Unexpectedly large offset for NewGRF");
+			/* Having more than 1 GiB of data is very implausible. Mostly because then
+			 * all pools in OpenTTD are flooded already. Or it's just Action C all over.
+			 * In any case, the offsets to graphics will likely not work either. */
+			return SIZE_MAX;
 		}
+		return header_len + offset;
 	}
 
 	return SIZE_MAX;
 }
 
+/**
+ * Get the data section size of a GRF.
+ * @param f GRF.
+ * @return Size of the data section or SIZE_MAX if the file has no separate data section.
+ */
+size_t GRFGetSizeOfDataSection(FILE *f)
+{
+	byte data[GRF_DATA_SECTION_HEADER_LEN];
+	if (fread(data, 1, GRF_DATA_SECTION_HEADER_LEN, f) != GRF_DATA_SECTION_HEADER_LEN) return SIZE_MAX;
+	return GRFGetSizeOfDataSection(data);
+}
+
 struct GRFMD5SumState {
 	GRFConfig *config;
 	size_t size;
-	FILE *f;
+	FILE *f;                                        ///< File to read from, if not hashing from \c mapping.
+	std::shared_ptr<const FioFileMapping> mapping; ///< Memory image of the file, shared with the NewGRF loader.
 };
 
 static uint _grf_md5_parallel = 0;
@@ -393,6 +409,12 @@ static const uint GRF_MD5_PENDING_MAX = 8;
 static void CalcGRFMD5SumFromState(const GRFMD5SumState &state)
 {
 	Md5 checksum;
+	if (state.mapping != nullptr) {
+		checksum.Append(state.mapping->data + state.mapping->begin, state.size);
+		checksum.Finish(state.config->ident.md5sum);
+		return;
+	}
+
 	uint8 buffer[1024];
 	size_t len;
 	size_t size = state.size;
@@ -443,6 +465,379 @@ void CalcGRFMD5ThreadingEnd()
 	}
 }
 
+char *_grf_scan_cache_file; ///< The file to store the NewGRF scan cache in.
+
+/** Cached scan result of a NewGRF, valid as long as the file keeps its size and modification time. */
+struct GRFScanCacheEntry {
+	uint64 size;                        ///< Size of the file (or of the tar containing it).
+	int64 mtime;                        ///< Modification time of the file (or of the tar containing it).
+	std::unique_ptr<GRFConfig> details; ///< What the scan found: GRF ID, checksum, flags, palette, versions, texts and parameter information.
+	bool used;                          ///< Whether the file was seen during the current scan.
+};
+
+/** A NewGRF whose checksum is being calculated during the current scan, and is to be added to the cache. */
+struct GRFScanCachePending {
+	const GRFConfig *config; ///< The NewGRF; its checksum is ready once the scan has finished.
+	std::string path;        ///< Full path of the file.
+	uint64 size;             ///< Size of the file (or of the tar containing it).
+	int64 mtime;             ///< Modification time of the file (or of the tar containing it).
+};
+
+static const char GRF_SCAN_CACHE_HEADER[] = "OpenTTD NewGRF scan cache v2";
+static const size_t GRF_SCAN_CACHE_MAX_SIZE = 64 * 1024 * 1024; ///< Size above which the scan cache file is not trusted.
+
+static bool _grf_scan_cache_active = false;                      ///< Whether the scan cache is used for the details of scanned NewGRFs.
+static bool _grf_scan_cache_loaded = false;                      ///< Whether the scan cache file has been read.
+static std::map<std::string, GRFScanCacheEntry> _grf_scan_cache; ///< Known scan results, indexed by full path.
+static std::vector<GRFScanCachePending> _grf_scan_cache_pending; ///< NewGRFs scanned and hashed during the current scan.
+
+/**
+ * Split the next space separated token off a line of the scan cache.
+ * @param[in,out] p Position in the line; moved to the start of the next token.
+ * @return The token, or \c nullptr at the end of the line.
+ */
+static const char *NextGRFScanCacheToken(char *&p)
+{
+	if (*p == '\0') return nullptr;
+	const char *token = p;
+	while (*p != '\0' && *p != ' ') p++;
+	if (*p == ' ') *p++ = '\0';
+	return token;
+}
+
+/**
+ * Parse a number of a line of the scan cache.
+ * @param[in,out] p Position in the line; moved to the start of the next token.
+ * @param base The base of the number.
+ * @param[out] value The number.
+ * @return True if the token was a number.
+ */
+static bool ParseGRFScanCacheNumber(char *&p, int base, uint64 &value)
+{
+	const char *token = NextGRFScanCacheToken(p);
+	if (token == nullptr) return false;
+	char *end;
+	value = strtoull(token, &end, base);
+	return *end == '\0' && end != token;
+}
+
+/**
+ * Parse the details of a NewGRF from a line of the scan cache.
+ * The line is "D <flags> <palette> <version> <min loadable version> <valid params> <has param defaults> <name> <info> <url>".
+ * @param p The line, after the "D ".
+ * @param[out] details The config to fill.
+ * @return True if the line was valid.
+ */
+static bool ParseGRFScanCacheDetails(char *p, GRFConfig *details)
+{
+	uint64 flags, palette, version, min_loadable_version, num_valid_params, has_param_defaults;
+	if (!ParseGRFScanCacheNumber(p, 16, flags) || !ParseGRFScanCacheNumber(p, 16, palette) ||
+			!ParseGRFScanCacheNumber(p, 10, version) || !ParseGRFScanCacheNumber(p, 10, min_loadable_version) ||
+			!ParseGRFScanCacheNumber(p, 10, num_valid_params) || !ParseGRFScanCacheNumber(p, 10, has_param_defaults)) {
+		return false;
+	}
+	if (num_valid_params > lengthof(details->param)) return false;
+	details->flags = (uint8)flags;
+	details->palette = (uint8)palette;
+	details->version = (uint32)version;
+	details->min_loadable_version = (uint32)min_loadable_version;
+	details->num_valid_params = (uint8)num_valid_params;
+	details->has_param_defaults = has_param_defaults != 0;
+
+	for (GRFTextWrapper *wrapper : { details->name, details->info, details->url }) {
+		const char *token = NextGRFScanCacheToken(p);
+		if (token == nullptr || !DeserialiseGRFTextList(&wrapper->text, token)) return false;
+	}
+	return true;
+}
+
+/**
+ * Parse the information about a parameter of a NewGRF from a line of the scan cache.
+ * The line is "P <index> <type> <min> <max> <default> <param> <first bit> <bits> <name> <description> <value names>".
+ * The value names are "-" or "<value>=<text list>" joined by '/'.
+ * @param p The line, after the "P ".
+ * @param[out] details The config to add the parameter information to.
+ * @return True if the line was valid.
+ */
+static bool ParseGRFScanCacheParameter(char *p, GRFConfig *details)
+{
+	uint64 index, type, min_value, max_value, def_value, param_nr, first_bit, num_bit;
+	if (!ParseGRFScanCacheNumber(p, 10, index) || !ParseGRFScanCacheNumber(p, 10, type) ||
+			!ParseGRFScanCacheNumber(p, 10, min_value) || !ParseGRFScanCacheNumber(p, 10, max_value) ||
+			!ParseGRFScanCacheNumber(p, 10, def_value) || !ParseGRFScanCacheNumber(p, 10, param_nr) ||
+			!ParseGRFScanCacheNumber(p, 10, first_bit) || !ParseGRFScanCacheNumber(p, 10, num_bit)) {
+		return false;
+	}
+	if (index >= lengthof(details->param) || type >= PTYPE_END || param_nr >= lengthof(details->param) || first_bit > 31 || num_bit > 32 - first_bit) return false;
+	if (index < details->param_info.size() && details->param_info[index] != nullptr) return false;
+
+	if (index >= details->param_info.size()) details->param_info.resize(index + 1);
+	GRFParameterInfo *info = new GRFParameterInfo((uint)index);
+	details->param_info[index] = info;
+	info->type = (GRFParameterType)type;
+	info->min_value = (uint32)min_value;
+	info->max_value = (uint32)max_value;
+	info->def_value = (uint32)def_value;
+	info->param_nr = (byte)param_nr;
+	info->first_bit = (byte)first_bit;
+	info->num_bit = (byte)num_bit;
+
+	const char *name = NextGRFScanCacheToken(p);
+	if (name == nullptr || !DeserialiseGRFTextList(&info->name, name)) return false;
+	const char *desc = NextGRFScanCacheToken(p);
+	if (desc == nullptr || !DeserialiseGRFTextList(&info->desc, desc)) return false;
+
+	char *values = const_cast<char *>(NextGRFScanCacheToken(p));
+	if (values == nullptr || NextGRFScanCacheToken(p) != nullptr) return false;
+	if (strcmp(values, "-") == 0) return true;
+	for (char *value = values; value != nullptr;) {
+		char *next = strchr(value, '/');
+		if (next != nullptr) *next++ = '\0';
+		char *end;
+		uint32 id = (uint32)strtoul(value, &end, 10);
+		if (end == value || *end != '=' || info->value_names.Contains(id)) return false;
+		GRFText *list = nullptr;
+		bool ok = DeserialiseGRFTextList(&list, end + 1);
+		info->value_names.Insert(id, list);
+		if (!ok) return false;
+		value = next;
+	}
+	return true;
+}
+
+/** Read the NewGRF scan cache from disk. */
+static void LoadGRFScanCache()
+{
+	_grf_scan_cache_loaded = true;
+	_grf_scan_cache.clear();
+	if (_grf_scan_cache_file == nullptr) return;
+
+	size_t len;
+	std::unique_ptr<char, FreeDeleter> data((char *)ReadFileToMem(_grf_scan_cache_file, &len, GRF_SCAN_CACHE_MAX_SIZE));
+	if (data == nullptr) return;
+
+	char *line = data.get();
+	if (strncmp(line, GRF_SCAN_CACHE_HEADER, strlen(GRF_SCAN_CACHE_HEADER)) != 0) {
+		DEBUG(grf, 1, "Ignoring NewGRF scan cache with unknown format");
+		return;
+	}
+
+	/* Every NewGRF starts with a line "G <size> <mtime> <grfid> <md5sum> <path>", followed by
+	 * a "D" line with its details and a "P" line for each parameter it describes. */
+	GRFScanCacheEntry entry;
+	std::string path;
+	bool valid = false; ///< Whether the lines of the current NewGRF were valid so far.
+	auto finish_entry = [&]() {
+		if (valid && entry.details->ident.grfid != 0 && !HasBit(entry.details->flags, GCF_SYSTEM)) {
+			_grf_scan_cache[path] = std::move(entry);
+		}
+		valid = false;
+	};
+
+	for (line = strchr(line, '\n'); line != nullptr;) {
+		line++;
+		char *end = strchr(line, '\n');
+		if (end != nullptr) *end = '\0';
+		if (end != nullptr && end > line && end[-1] == '\r') end[-1] = '\0';
+
+		char *p = line;
+		const char *type = NextGRFScanCacheToken(p);
+		if (type != nullptr && strcmp(type, "G") == 0) {
+			finish_entry();
+			entry.details.reset(new GRFConfig());
+			entry.used = false;
+			uint64 mtime, grfid;
+			valid = ParseGRFScanCacheNumber(p, 10, entry.size) && ParseGRFScanCacheNumber(p, 10, mtime) && ParseGRFScanCacheNumber(p, 16, grfid);
+			entry.mtime = (int64)mtime;
+			entry.details->ident.grfid = BSWAP32((uint32)grfid);
+
+			const char *md5 = NextGRFScanCacheToken(p);
+			valid = valid && md5 != nullptr && strlen(md5) == 2 * sizeof(entry.details->ident.md5sum);
+			for (uint i = 0; valid && i < lengthof(entry.details->ident.md5sum); i++) {
+				const char hex[3] = { md5[i * 2], md5[i * 2 + 1], '\0' };
+				char *hex_end;
+				entry.details->ident.md5sum[i] = (uint8)strtoul(hex, &hex_end, 16);
+				valid = (hex_end == hex + 2);
+			}
+
+			/* The path is the rest of the line, it may contain spaces. */
+			valid = valid && *p != '\0';
+			path = p;
+		} else if (type != nullptr && strcmp(type, "D") == 0) {
+			valid = valid && ParseGRFScanCacheDetails(p, entry.details.get());
+		} else if (type != nullptr && strcmp(type, "P") == 0) {
+			valid = valid && ParseGRFScanCacheParameter(p, entry.details.get());
+		} else if (type != nullptr) {
+			valid = false;
+		}
+
+		line = end;
+	}
+	finish_entry();
+}
+
+/** Write the entries of the NewGRF scan cache that were seen in the last scan to disk. */
+static void SaveGRFScanCache()
+{
+	if (_grf_scan_cache_file == nullptr) return;
+
+	/* Write to a temporary file first, so a crash or another instance scanning at the same time never leaves a truncated cache behind. */
+	char tmp_filename[MAX_PATH];
+	FILE *f = FioFOpenReplacementFile(_grf_scan_cache_file, tmp_filename, lastof(tmp_filename));
+	if (f == nullptr) {
+		DEBUG(grf, 1, "Could not save NewGRF scan cache to %s", _grf_scan_cache_file);
+		return;
+	}
+
+	std::string buffer;
+	fprintf(f, "%s\n", GRF_SCAN_CACHE_HEADER);
+	for (const auto &it : _grf_scan_cache) {
+		if (!it.second.used) continue;
+		const GRFConfig *details = it.second.details.get();
+
+		char md5[33];
+		md5sumToString(md5, lastof(md5), details->ident.md5sum);
+		fprintf(f, "G " OTTD_PRINTF64U " " OTTD_PRINTF64 " %08X %s %s\n", it.second.size, it.second.mtime, BSWAP32(details->ident.grfid), md5, it.first.c_str());
+
+		buffer.clear();
+		for (const GRFTextWrapper *wrapper : { details->name, details->info, details->url }) {
+			buffer += ' ';
+			SerialiseGRFTextList(wrapper->text, buffer);
+		}
+		fprintf(f, "D %X %X %u %u %u %u%s\n", (uint)details->flags, (uint)details->palette, details->version, details->min_loadable_version,
+				details->num_valid_params, details->has_param_defaults ? 1 : 0, buffer.c_str());
+
+		for (uint i = 0; i < details->param_info.size(); i++) {
+			const GRFParameterInfo *info = details->param_info[i];
+			if (info == nullptr) continue;
+
+			buffer.clear();
+			buffer += ' ';
+			SerialiseGRFTextList(info->name, buffer);
+			buffer += ' ';
+			SerialiseGRFTextList(info->desc, buffer);
+			buffer += ' ';
+			if (info->value_names.size() == 0) buffer += '-';
+			for (const auto &value : info->value_names) {
+				if (&value != &*info->value_names.begin()) buffer += '/';
+				buffer += std::to_string(value.first);
+				buffer += '=';
+				SerialiseGRFTextList(value.second, buffer);
+			}
+			fprintf(f, "P %u %u %u %u %u %u %u %u%s\n", i, (uint)info->type, info->min_value, info->max_value, info->def_value,
+					(uint)info->param_nr, (uint)info->first_bit, (uint)info->num_bit, buffer.c_str());
+		}
+	}
+
+	bool ok = ferror(f) == 0;
+	ok = (fclose(f) == 0) && ok;
+	if (!ok || !FioReplaceFile(tmp_filename, _grf_scan_cache_file)) {
+		if (!ok) unlink(tmp_filename);
+		DEBUG(grf, 1, "Could not save NewGRF scan cache to %s", _grf_scan_cache_file);
+	}
+}
+
+/**
+ * Start using the NewGRF scan cache for the NewGRFs found by the scan.
+ */
+static void GRFScanCacheStart()
+{
+	if (!_grf_scan_cache_loaded) LoadGRFScanCache();
+	for (auto &it : _grf_scan_cache) it.second.used = false;
+	_grf_scan_cache_pending.clear();
+	_grf_scan_cache_active = true;
+}
+
+/**
+ * Stop using the NewGRF scan cache, add the NewGRFs scanned during the scan and write the cache to disk.
+ * @pre All checksum calculations have finished.
+ */
+static void GRFScanCacheEnd()
+{
+	_grf_scan_cache_active = false;
+
+	for (const GRFScanCachePending &pending : _grf_scan_cache_pending) {
+		GRFScanCacheEntry &entry = _grf_scan_cache[pending.path];
+		entry.size = pending.size;
+		entry.mtime = pending.mtime;
+		entry.details.reset(new GRFConfig(*pending.config));
+		entry.used = true;
+	}
+	_grf_scan_cache_pending.clear();
+
+	SaveGRFScanCache();
+}
+
+/**
+ * Fill the details of a NewGRF from the scan cache, if the file did not change since it was cached.
+ * This skips opening the NewGRF in a file slot, its action 8 and 14 scan and its checksum calculation.
+ * @param config GRF to fill.
+ * @param subdir The subdirectory to look in.
+ * @return True if the details were found in the cache and stored in the config.
+ */
+static bool FillGRFDetailsFromScanCache(GRFConfig *config, Subdirectory subdir)
+{
+	if (!_grf_scan_cache_active) return false;
+
+	char *full_filename = nullptr;
+	FILE *f = FioFOpenFile(config->filename, "rb", subdir, nullptr, &full_filename);
+	if (f == nullptr) return false;
+
+	uint64 size;
+	int64 mtime;
+	bool stat_ok = FioGetFileStat(f, &size, &mtime);
+	FioFCloseFile(f);
+
+	auto it = full_filename == nullptr ? _grf_scan_cache.end() : _grf_scan_cache.find(full_filename);
+	if (!stat_ok || it == _grf_scan_cache.end() || it->second.size != size || it->second.mtime != mtime) {
+		free(full_filename);
+		return false;
+	}
+
+	const GRFConfig *details = it->second.details.get();
+	free(config->full_filename);
+	config->full_filename = full_filename;
+	config->ident = details->ident;
+	config->flags = details->flags;
+	config->palette = details->palette;
+	config->version = details->version;
+	config->min_loadable_version = details->min_loadable_version;
+	config->num_valid_params = details->num_valid_params;
+	config->has_param_defaults = details->has_param_defaults;
+	config->name->Release();
+	config->name = details->name;
+	config->name->AddRef();
+	config->info->Release();
+	config->info = details->info;
+	config->info->AddRef();
+	config->url->Release();
+	config->url = details->url;
+	config->url->AddRef();
+	for (GRFParameterInfo *info : details->param_info) {
+		config->param_info.push_back(info == nullptr ? nullptr : new GRFParameterInfo(*info));
+	}
+	config->SetSuitablePalette();
+	config->FinalizeParameterInfo();
+
+	it->second.used = true;
+	return true;
+}
+
+/**
+ * Register the NewGRF just opened in the config slot for adding to the scan cache once its checksum has been calculated.
+ * @param config GRF to compute.
+ */
+static void AddGRFToScanCache(const GRFConfig *config)
+{
+	if (!_grf_scan_cache_active || config->full_filename == nullptr) return;
+
+	uint64 size;
+	int64 mtime;
+	if (!FioGetFileStat(CONFIG_SLOT, &size, &mtime)) return;
+
+	_grf_scan_cache_pending.push_back({ config, config->full_filename, size, mtime });
+}
+
 /**
  * Calculate the MD5 sum for a GRF, and store it in the config.
  * @param config GRF to compute.
@@ -451,22 +846,30 @@ void CalcGRFMD5ThreadingEnd()
  */
 static bool CalcGRFMD5Sum(GRFConfig *config, Subdirectory subdir)
 {
-	size_t size;
+	GRFMD5SumState state { config, 0, nullptr, FioGetFileMapping(CONFIG_SLOT) };
 
-	/* open the file */
-	FILE *f = FioFOpenFile(config->filename, "rb", subdir, &size);
-	if (f == nullptr) return false;
+	if (state.mapping != nullptr) {
+		/* The scan has just mapped this file into the config slot; hash that image instead of reading the file again. */
+		state.size = state.mapping->end - state.mapping->begin;
+		if (state.size >= GRF_DATA_SECTION_HEADER_LEN) state.size = min(state.size, GRFGetSizeOfDataSection(state.mapping->data + state.mapping->begin));
+	} else {
+		/* open the file */
+		FILE *f = FioFOpenFile(config->filename, "rb", subdir, &state.size);
+		if (f == nullptr) return false;
 
-	long start = ftell(f);
-	size = min(size, GRFGetSizeOfDataSection(f));
+		long start = ftell(f);
+		state.size = min(state.size, GRFGetSizeOfDataSection(f));
 
-	if (start < 0 || fseek(f, start, SEEK_SET) < 0) {
-		FioFCloseFile(f);
-		return false;
+		if (start < 0 || fseek(f, start, SEEK_SET) < 0) {
+			FioFCloseFile(f);
+			return false;
+		}
+		state.f = f;
 	}
 
+	AddGRFToScanCache(config);
+
 	/* calculate md5sum */
-	GRFMD5SumState state { config, size, f };
 	if (_grf_md5_parallel == 0) {
 		CalcGRFMD5SumFromState(state);
 		return true;
@@ -502,6 +905,8 @@ static bool CalcGRFMD5Sum(GRFConfig *config, Subdirectory subdir)
  */
 bool FillGRFDetails(GRFConfig *config, bool is_static, Subdirectory subdir)
 {
+	if (!is_static && FillGRFDetailsFromScanCache(config, subdir)) return true;
+
 	if (!FioCheckFileExists(config->filename, subdir)) {
 		config->status = GCS_NOT_FOUND;
 		return false;
@@ -731,10 +1136,12 @@ public:
 	static uint DoScan()
 	{
 		CalcGRFMD5ThreadingStart();
+		GRFScanCacheStart();
 		GRFFileScanner fs;
 		fs.grfs.clear();
 		int ret = fs.Scan(".grf", NEWGRF_DIR);
 		CalcGRFMD5ThreadingEnd();
+		GRFScanCacheEnd();
 
 		for (GRFConfig *c : fs.grfs) {
 			bool added = true;
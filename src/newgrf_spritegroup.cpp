@@ -9,11 +9,20 @@
 
 #include "stdafx.h"
 #include <algorithm>
+#include <chrono>
+#include <memory>
 #include "debug.h"
 #include "newgrf_spritegroup.h"
 #include "newgrf_profiling.h"
+#include "newgrf_house.h"
+#include "newgrf_engine.h"
+#include "engine_base.h"
 #include "core/pool_func.hpp"
 #include "vehicle_type.h"
+#include "vehicle_base.h"
+#include "town.h"
+#include "string_func.h"
+#include "debug_settings.h"
 
 #include "safeguards.h"
 
@@ -22,6 +31,98 @@ INSTANTIATE_POOL_METHODS(SpriteGroup)
 
 TemporaryStorageArray<int32, 0x110> _temp_store;
 
+/** A variable read while resolving a callback. */
+struct CallbackCacheRead {
+	VarSpriteGroupScope scope; ///< Scope the variable was read from.
+	byte variable;             ///< Variable number.
+	bool available;            ///< Whether the variable was available.
+	uint32 parameter;          ///< Parameter of 60+x variables.
+	uint32 value;              ///< Value that was read.
+};
+
+/** A temporary storage register written while resolving a callback. */
+struct CallbackCacheStore {
+	uint reg;    ///< Register written to.
+	int32 value; ///< Value written.
+};
+
+/** Inputs and side effects of the callback resolution in progress. */
+struct CallbackCacheRecording {
+	bool cacheable;                         ///< Whether the result only depends on the recorded reads.
+	std::vector<CallbackCacheRead> reads;   ///< Variables read, without duplicates.
+	std::vector<CallbackCacheStore> stores; ///< Writes to the temporary storage, in order.
+
+	/**
+	 * Record a variable read.
+	 * Variables that are constant for the cache entry, or that only depend on earlier reads, are not recorded.
+	 */
+	void AddRead(VarSpriteGroupScope scope, byte variable, uint32 parameter, uint32 value, bool available)
+	{
+		switch (variable) {
+			case 0x0C: // Part of the key
+			case 0x10:
+			case 0x18:
+			case 0x1C: // Set by the sprite groups, or part of the key
+			case 0x7D: // Cleared at the start, then set by the sprite groups
+			case 0x7F: // Only changes on reload
+				return;
+		}
+		for (const CallbackCacheRead &read : this->reads) {
+			if (read.scope == scope && read.variable == variable && read.parameter == parameter && read.value == value && read.available == available) return;
+		}
+		if (this->reads.size() >= CALLBACK_CACHE_MAX_READS) {
+			this->cacheable = false;
+			return;
+		}
+		this->reads.push_back({ scope, variable, available, parameter, value });
+	}
+
+	static const uint CALLBACK_CACHE_MAX_READS = 64; ///< Maximum number of distinct reads of a cacheable callback.
+};
+
+/** Cached result of a callback. It is valid as long as all recorded variables still have the same value. */
+struct CallbackCacheEntry {
+	const SpriteGroup *root;                ///< Root sprite group of the callback, or \c nullptr for an unused entry.
+	CallbackID callback;                    ///< Callback being resolved.
+	uint32 param1;                          ///< First parameter (var 10) of the callback.
+	uint32 param2;                          ///< Second parameter (var 18) of the callback.
+	uint32 initial_last_value;              ///< Value of var 1C at the start of the resolution.
+	uint32 last_value;                      ///< Value of var 1C at the end of the resolution.
+	uint16 result;                          ///< Callback result.
+	bool valid;                             ///< Whether the result, reads and stores are valid.
+	uint8 failures;                         ///< Number of consecutive misses.
+	uint8 skip;                             ///< Number of lookups to bypass the cache for.
+	std::vector<CallbackCacheRead> reads;   ///< Variables the result depends on.
+	std::vector<CallbackCacheStore> stores; ///< Writes to the temporary storage to repeat on a hit.
+};
+
+static const uint CALLBACK_CACHE_BITS = 12;        ///< Number of bits of the callback cache index.
+static const uint CALLBACK_CACHE_MAX_FAILURES = 4; ///< Number of consecutive misses after which an entry is bypassed for a while.
+static const uint8 CALLBACK_CACHE_SKIP = 255;      ///< Number of lookups an entry is bypassed for.
+
+static std::vector<CallbackCacheEntry> _callback_cache;           ///< The callback result cache, allocated when first used.
+static CallbackCacheRecording _callback_cache_recording_data;     ///< Storage for the recording of a callback resolution.
+static CallbackCacheRecording *_callback_cache_recording = nullptr; ///< Recording of the callback resolution in progress, if any.
+static bool _callback_cache_busy = false;                         ///< Whether the cache is being recorded into or validated.
+CallbackCacheStats _callback_cache_stats;                         ///< Statistics of the callback result cache.
+
+/**
+ * Mark the callback resolution being recorded as not cacheable, if any.
+ */
+static inline void SetCallbackUncacheable()
+{
+	if (_callback_cache_recording != nullptr) _callback_cache_recording->cacheable = false;
+}
+
+/**
+ * Clear the callback result cache. Must be called when the sprite groups are freed.
+ */
+void ClearCallbackCache()
+{
+	_callback_cache.clear();
+	_callback_cache.shrink_to_fit();
+}
+
 
 /**
  * ResolverObject (re)entry point.
@@ -40,6 +141,9 @@ TemporaryStorageArray<int32, 0x110> _temp_store;
 	const GRFFile *grf = object.grffile;
 	auto profiler = std::find_if(_newgrf_profilers.begin(), _newgrf_profilers.end(), [&](const NewGRFProfiler &pr) { return pr.grffile == grf; });
 
+	/* A nested resolution clears the temporary storage half-way through the one being recorded. */
+	if (top_level) SetCallbackUncacheable();
+
 	if (profiler == _newgrf_profilers.end() || !profiler->active) {
 		if (top_level) _temp_store.ClearChanges();
 		return group->Resolve(object);
@@ -186,9 +290,12 @@ static U EvalAdjustT(const DeterministicSpriteGroupAdjust *adjust, ScopeResolver
 		case DSGA_OP_AND:  return last_value & value;
 		case DSGA_OP_OR:   return last_value | value;
 		case DSGA_OP_XOR:  return last_value ^ value;
-		case DSGA_OP_STO:  _temp_store.StoreValue((U)value, (S)last_value); return last_value;
+		case DSGA_OP_STO:
+			_temp_store.StoreValue((U)value, (S)last_value);
+			if (_callback_cache_recording != nullptr) _callback_cache_recording->stores.push_back({ (U)value, (S)last_value });
+			return last_value;
 		case DSGA_OP_RST:  return value;
-		case DSGA_OP_STOP: scope->StorePSA((U)value, (S)last_value); return last_value;
+		case DSGA_OP_STOP: SetCallbackUncacheable(); scope->StorePSA((U)value, (S)last_value); return last_value;
 		case DSGA_OP_ROR:  return ROR<uint32>((U)last_value, (U)value & 0x1F); // mask 'value' to 5 bits, which should behave the same on all architectures.
 		case DSGA_OP_SCMP: return ((S)last_value == (S)value) ? 1 : ((S)last_value < (S)value ? 0 : 2);
 		case DSGA_OP_UCMP: return ((U)last_value == (U)value) ? 1 : ((U)last_value < (U)value ? 0 : 2);
@@ -207,20 +314,37 @@ static bool RangeHighComparator(const DeterministicSpriteGroupRange& range, uint
 	return range.high < value;
 }
 
-const SpriteGroup *DeterministicSpriteGroup::Resolve(ResolverObject &object) const
+/**
+ * Evaluate the adjusts of this group and select the group to continue with.
+ * @param object Information needed to resolve the group.
+ * @param use_compiled Whether to use the compiled form of this group, if available.
+ * @param[out] is_result Set to true when the returned group is the final result and must not be resolved further.
+ * @return The group to resolve next, or the final result when \a is_result is set.
+ */
+const SpriteGroup *DeterministicSpriteGroup::Evaluate(ResolverObject &object, bool use_compiled, bool *is_result) const
 {
 	uint32 last_value = 0;
 	uint32 value = 0;
-	uint i;
+	uint i = 0;
+
+	*is_result = false;
+	use_compiled &= this->compiled;
+	if (use_compiled && this->folded_adjusts > 0) {
+		last_value = value = this->folded_value;
+		i = this->folded_adjusts;
+	}
 
 	ScopeResolver *scope = object.GetScope(this->var_scope);
 
-	for (i = 0; i < this->num_adjusts; i++) {
+	for (; i < this->num_adjusts; i++) {
 		DeterministicSpriteGroupAdjust *adjust = &this->adjusts[i];
 
 		/* Try to get the variable. We shall assume it is available, unless told otherwise. */
 		bool available = true;
-		if (adjust->variable == 0x7E) {
+		if (adjust->variable == 0x1A) {
+			/* Constant, and the most common variable by far. */
+			value = UINT_MAX;
+		} else if (adjust->variable == 0x7E) {
 			_sprite_group_resolve_check_veh_check = false;
 			const SpriteGroup *subgroup = SpriteGroup::Resolve(adjust->subroutine, object, false);
 			if (subgroup == nullptr) {
@@ -233,6 +357,7 @@ const SpriteGroup *DeterministicSpriteGroup::Resolve(ResolverObject &object) con
 		} else if (adjust->variable == 0x7B) {
 			_sprite_group_resolve_check_veh_check = false;
 			value = GetVariable(object, scope, adjust->parameter, last_value, &available);
+			if (_callback_cache_recording != nullptr) _callback_cache_recording->AddRead(this->var_scope, adjust->parameter, last_value, value, available);
 		} else {
 			if (_sprite_group_resolve_check_veh_check) {
 				switch (adjust->variable) {
@@ -282,12 +407,13 @@ const SpriteGroup *DeterministicSpriteGroup::Resolve(ResolverObject &object) con
 				}
 			}
 			value = GetVariable(object, scope, adjust->variable, adjust->parameter, &available);
+			if (_callback_cache_recording != nullptr) _callback_cache_recording->AddRead(this->var_scope, adjust->variable, adjust->parameter, value, available);
 		}
 
 		if (!available) {
 			/* Unsupported variable: skip further processing and return either
 			 * the group from the first range or the default group. */
-			return SpriteGroup::Resolve(this->error_group, object, false);
+			return this->error_group;
 		}
 
 		switch (this->size) {
@@ -306,29 +432,227 @@ const SpriteGroup *DeterministicSpriteGroup::Resolve(ResolverObject &object) con
 		if (value != CALLBACK_FAILED) value = GB(value, 0, 15);
 		static CallbackResultSpriteGroup nvarzero(0, true);
 		nvarzero.result = value;
+		*is_result = true;
 		return &nvarzero;
 	}
 
+	if (use_compiled && !this->jump_table.empty()) {
+		uint32 offset = value - this->jump_table_base;
+		return offset < this->jump_table.size() ? this->jump_table[offset] : this->default_group;
+	}
+
 	if (this->num_ranges > 4) {
 		DeterministicSpriteGroupRange *lower = std::lower_bound(this->ranges + 0, this->ranges + this->num_ranges, value, RangeHighComparator);
 		if (lower != this->ranges + this->num_ranges && lower->low <= value) {
 			assert(lower->low <= value && value <= lower->high);
-			return SpriteGroup::Resolve(lower->group, object, false);
+			return lower->group;
 		}
 	} else {
 		for (i = 0; i < this->num_ranges; i++) {
 			if (this->ranges[i].low <= value && value <= this->ranges[i].high) {
-				return SpriteGroup::Resolve(this->ranges[i].group, object, false);
+				return this->ranges[i].group;
+			}
+		}
+	}
+
+	return this->default_group;
+}
+
+const SpriteGroup *DeterministicSpriteGroup::Resolve(ResolverObject &object) const
+{
+	if (HasChickenBit(DCBF_NO_COMPILED_SPRITE_GROUPS)) {
+		bool is_result;
+		const SpriteGroup *target = this->Evaluate(object, false, &is_result);
+		return is_result ? target : SpriteGroup::Resolve(target, object, false);
+	}
+
+	/* Follow chains of deterministic groups in a loop instead of recursing through
+	 * SpriteGroup::Resolve for each of them; the result is the same, as only the
+	 * profiler does anything on a nested resolve. */
+	const GRFFile *grf = object.grffile;
+	auto profiler = std::find_if(_newgrf_profilers.begin(), _newgrf_profilers.end(), [&](const NewGRFProfiler &pr) { return pr.grffile == grf && pr.active; });
+
+	const DeterministicSpriteGroup *group = this;
+	for (;;) {
+		bool is_result;
+		const SpriteGroup *target = group->Evaluate(object, true, &is_result);
+		if (is_result || target == nullptr) return target;
+		if (target->type != SGT_DETERMINISTIC) return SpriteGroup::Resolve(target, object, false);
+
+		if (profiler != _newgrf_profilers.end()) profiler->RecursiveResolve();
+		group = static_cast<const DeterministicSpriteGroup *>(target);
+	}
+}
+
+/**
+ * Prepare the compiled form of this group: fold the leading adjusts that do not
+ * depend on anything into a single value and turn dense range tables into a jump
+ * table. The interpreted form is kept, so this can be undone by a chicken bit.
+ */
+void DeterministicSpriteGroup::Compile()
+{
+	this->folded_adjusts = 0;
+	this->folded_value = 0;
+	this->jump_table.clear();
+
+	uint32 last_value = 0;
+	for (uint i = 0; i < this->num_adjusts; i++) {
+		const DeterministicSpriteGroupAdjust *adjust = &this->adjusts[i];
+		if (adjust->variable != 0x1A || adjust->type != DSGA_TYPE_NONE) break;
+		if (adjust->operation == DSGA_OP_STO || adjust->operation == DSGA_OP_STOP) break;
+		if (adjust->operation == DSGA_OP_SDIV || adjust->operation == DSGA_OP_SMOD) break;
+
+		switch (this->size) {
+			case DSG_SIZE_BYTE:  last_value = EvalAdjustT<uint8,  int8> (adjust, nullptr, last_value, UINT_MAX); break;
+			case DSG_SIZE_WORD:  last_value = EvalAdjustT<uint16, int16>(adjust, nullptr, last_value, UINT_MAX); break;
+			case DSG_SIZE_DWORD: last_value = EvalAdjustT<uint32, int32>(adjust, nullptr, last_value, UINT_MAX); break;
+			default: NOT_REACHED();
+		}
+		this->folded_adjusts = i + 1;
+		this->folded_value = last_value;
+	}
+
+	/* Ranges are sorted and do not overlap; see the loader of action 2. */
+	if (!this->calculated_result && this->num_ranges >= MIN_JUMP_TABLE_RANGES) {
+		uint32 base = this->ranges[0].low;
+		uint32 span = this->ranges[this->num_ranges - 1].high - base;
+		if (span < MAX_JUMP_TABLE_SIZE) {
+			this->jump_table_base = base;
+			this->jump_table.assign(span + 1, this->default_group);
+			for (uint i = 0; i < this->num_ranges; i++) {
+				std::fill(this->jump_table.begin() + (this->ranges[i].low - base), this->jump_table.begin() + (this->ranges[i].high - base + 1), this->ranges[i].group);
 			}
 		}
 	}
 
-	return SpriteGroup::Resolve(this->default_group, object, false);
+	this->compiled = true;
+}
+
+/** Compile all deterministic sprite groups after loading the NewGRFs. */
+void CompileSpriteGroups()
+{
+	uint groups = 0;
+	uint folded = 0;
+	uint tables = 0;
+	for (SpriteGroup *group : SpriteGroup::Iterate()) {
+		if (group->type != SGT_DETERMINISTIC) continue;
+
+		DeterministicSpriteGroup *dsg = static_cast<DeterministicSpriteGroup *>(group);
+		dsg->Compile();
+		groups++;
+		folded += dsg->folded_adjusts;
+		if (!dsg->jump_table.empty()) tables++;
+	}
+	DEBUG(grf, 2, "Compiled %u deterministic sprite groups: %u adjusts folded, %u jump tables", groups, folded, tables);
+}
+
+/** Result of resolving a sprite group, for comparing the interpreted and compiled forms. */
+struct SpriteGroupBenchmarkResult {
+	const SpriteGroup *group;
+	uint16 callback_result;
+	int32 registers[0x110];
+};
+
+/**
+ * Resolve the sprite group of a resolver, as it is done for drawing or a callback.
+ * @param object The resolver.
+ * @param[out] result The resolved group, its callback result and the temporary storage.
+ */
+static void ResolveForBenchmark(ResolverObject &object, SpriteGroupBenchmarkResult *result)
+{
+	object.ResetState();
+	result->group = object.Resolve();
+	result->callback_result = result->group != nullptr ? result->group->GetCallbackResult() : CALLBACK_FAILED;
+	for (uint i = 0; i < lengthof(result->registers); i++) result->registers[i] = _temp_store.GetValue(i);
+}
+
+/**
+ * Check that the compiled sprite groups resolve the same as the interpreted ones, and time both.
+ * The sprite groups resolved are the graphics and some callbacks of all NewGRF houses and vehicles on the map.
+ * Houses are resolved as not yet constructed, so that nothing is written to the persistent storage of the town.
+ * @param b buffer to write the results to
+ * @param last last valid position of the buffer
+ * @param iterations number of times to resolve each sprite group
+ */
+void BenchmarkSpriteGroups(char *b, const char *last, uint iterations)
+{
+	static const CallbackID house_callbacks[] = {
+		CBID_NO_CALLBACK, CBID_HOUSE_COLOUR, CBID_HOUSE_CARGO_ACCEPTANCE, CBID_HOUSE_ACCEPT_CARGO,
+		CBID_HOUSE_ANIMATION_SPEED, CBID_HOUSE_DRAW_FOUNDATIONS, CBID_HOUSE_AUTOSLOPE,
+	};
+	static const CallbackID vehicle_callbacks[] = {
+		CBID_NO_CALLBACK, CBID_VEHICLE_VISUAL_EFFECT, CBID_VEHICLE_LENGTH, CBID_VEHICLE_LOAD_AMOUNT,
+		CBID_VEHICLE_COLOUR_MAPPING, CBID_VEHICLE_32DAY_CALLBACK,
+	};
+
+	std::vector<std::unique_ptr<ResolverObject>> jobs;
+	uint houses = 0;
+	uint vehicles = 0;
+	for (TileIndex tile = 0; tile < MapSize(); tile++) {
+		if (!IsTileType(tile, MP_HOUSE)) continue;
+		HouseID house = GetHouseType(tile);
+		if (HouseSpec::Get(house)->grf_prop.spritegroup[0] == nullptr) continue;
+		houses++;
+		for (CallbackID callback : house_callbacks) {
+			jobs.emplace_back(new HouseResolverObject(house, tile, Town::GetByTile(tile), callback, 0, 0, true, GetHouseRandomBits(tile)));
+		}
+	}
+	for (const Vehicle *v : Vehicle::Iterate()) {
+		if (!v->IsPrimaryVehicle() && !v->IsGroundVehicle()) continue;
+		if (Engine::Get(v->engine_type)->GetGRF() == nullptr) continue;
+		vehicles++;
+		for (CallbackID callback : vehicle_callbacks) {
+			jobs.emplace_back(new VehicleResolverObject(v->engine_type, v, VehicleResolverObject::WO_CACHED, false, callback));
+		}
+	}
+	jobs.erase(std::remove_if(jobs.begin(), jobs.end(), [](const std::unique_ptr<ResolverObject> &job) { return job->root_spritegroup == nullptr; }), jobs.end());
+
+	b += seprintf(b, last, "Sprite groups: %u NewGRF houses, %u NewGRF vehicles, %u resolutions, %u iterations\n",
+			houses, vehicles, (uint)jobs.size(), iterations);
+
+	const uint32 chicken_bits = _settings_game.debug.chicken_bits;
+
+	uint mismatches = 0;
+	for (const auto &job : jobs) {
+		SpriteGroupBenchmarkResult interpreted, compiled;
+		SetBit(_settings_game.debug.chicken_bits, DCBF_NO_COMPILED_SPRITE_GROUPS);
+		ResolveForBenchmark(*job, &interpreted);
+		ClrBit(_settings_game.debug.chicken_bits, DCBF_NO_COMPILED_SPRITE_GROUPS);
+		ResolveForBenchmark(*job, &compiled);
+		if (interpreted.group != compiled.group || interpreted.callback_result != compiled.callback_result ||
+				memcmp(interpreted.registers, compiled.registers, sizeof(interpreted.registers)) != 0) {
+			if (mismatches++ < 10) {
+				b += seprintf(b, last, "  Mismatch: GRF %08X, feature %02X, id %u, callback %X\n",
+						job->grffile != nullptr ? BSWAP32(job->grffile->grfid) : 0, job->GetFeature(), job->GetDebugID(), job->callback);
+			}
+		}
+	}
+	b += seprintf(b, last, "  %u mismatches between the interpreted and compiled sprite groups\n", mismatches);
+
+	for (bool use_compiled : { false, true }) {
+		SB(_settings_game.debug.chicken_bits, DCBF_NO_COMPILED_SPRITE_GROUPS, 1, use_compiled ? 0 : 1);
+
+		uint32 results = 0;
+		auto start = std::chrono::steady_clock::now();
+		for (uint i = 0; i < iterations; i++) {
+			for (const auto &job : jobs) {
+				job->ResetState();
+				if (job->Resolve() != nullptr) results++;
+			}
+		}
+		uint ms = (uint)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+		b += seprintf(b, last, "  %s: %u groups resolved, %u ms\n", use_compiled ? "compiled   " : "interpreted", results, ms);
+	}
+
+	_settings_game.debug.chicken_bits = chicken_bits;
 }
 
 
 const SpriteGroup *RandomizedSpriteGroup::Resolve(ResolverObject &object) const
 {
+	SetCallbackUncacheable();
+
 	ScopeResolver *scope = object.GetScope(this->var_scope, this->count);
 	if (object.callback == CBID_RANDOM_TRIGGER) {
 		/* Handle triggers */
@@ -350,9 +674,119 @@ const SpriteGroup *RandomizedSpriteGroup::Resolve(ResolverObject &object) const
 
 const SpriteGroup *RealSpriteGroup::Resolve(ResolverObject &object) const
 {
+	/* The result depends on the state of the object, rather than on variables. */
+	SetCallbackUncacheable();
+
 	return object.ResolveReal(this);
 }
 
+/**
+ * Check whether the variables a cached callback result depends on still have the same values.
+ * @param entry The cache entry.
+ * @param object The resolver of the callback.
+ * @return True if the cached result is valid for the resolver.
+ */
+static bool ValidateCallbackCacheEntry(const CallbackCacheEntry &entry, ResolverObject &object)
+{
+	for (const CallbackCacheRead &read : entry.reads) {
+		bool available = true;
+		uint32 value = GetVariable(object, object.GetScope(read.scope), read.variable, read.parameter, &available);
+		if (value != read.value || available != read.available) return false;
+	}
+	return true;
+}
+
+/**
+ * Resolve callback.
+ * Results are cached by root sprite group, callback and parameters, together with the variables the
+ * resolution read and the temporary storage it wrote. A cached result is used when all those variables
+ * still have the same values, so it is always identical to the result of a full resolution.
+ * @return Callback result.
+ */
+uint16 ResolverObject::ResolveCallback()
+{
+	if (this->root_spritegroup == nullptr) return CALLBACK_FAILED;
+
+	const GRFFile *grf = this->grffile;
+	if (_callback_cache_busy || this->waiting_triggers != 0 || _sprite_group_resolve_check_veh_check ||
+			std::any_of(_newgrf_profilers.begin(), _newgrf_profilers.end(), [&](const NewGRFProfiler &pr) { return pr.grffile == grf && pr.active; })) {
+		const SpriteGroup *result = Resolve();
+		return result != nullptr ? result->GetCallbackResult() : CALLBACK_FAILED;
+	}
+
+	if (_callback_cache.empty()) _callback_cache.resize(1 << CALLBACK_CACHE_BITS);
+
+	uint32 hash = this->root_spritegroup->index * 0x9E3779B1;
+	hash ^= this->callback * 0x85EBCA6B;
+	hash ^= this->callback_param1 * 0xC2B2AE35;
+	hash ^= this->callback_param2 * 0x27D4EB2F;
+	CallbackCacheEntry &entry = _callback_cache[hash >> (32 - CALLBACK_CACHE_BITS)];
+
+	_callback_cache_stats.lookups++;
+	_callback_cache_busy = true;
+
+	if (entry.root == this->root_spritegroup && entry.callback == this->callback && entry.param1 == this->callback_param1 &&
+			entry.param2 == this->callback_param2 && entry.initial_last_value == this->last_value) {
+		if (entry.skip > 0) {
+			entry.skip--;
+			_callback_cache_stats.bypassed++;
+			_callback_cache_busy = false;
+			const SpriteGroup *result = Resolve();
+			return result != nullptr ? result->GetCallbackResult() : CALLBACK_FAILED;
+		}
+
+		if (entry.valid && ValidateCallbackCacheEntry(entry, *this)) {
+			_temp_store.ClearChanges();
+			for (const CallbackCacheStore &store : entry.stores) _temp_store.StoreValue(store.reg, store.value);
+			this->last_value = entry.last_value;
+			entry.failures = 0;
+			_callback_cache_stats.hits++;
+			_callback_cache_busy = false;
+			return entry.result;
+		}
+
+		if (++entry.failures >= CALLBACK_CACHE_MAX_FAILURES) {
+			entry.failures = 0;
+			entry.skip = CALLBACK_CACHE_SKIP;
+		}
+	} else {
+		entry.root = this->root_spritegroup;
+		entry.callback = this->callback;
+		entry.param1 = this->callback_param1;
+		entry.param2 = this->callback_param2;
+		entry.initial_last_value = this->last_value;
+		entry.failures = 0;
+		entry.skip = 0;
+	}
+	_callback_cache_stats.misses++;
+
+	CallbackCacheRecording &recording = _callback_cache_recording_data;
+	recording.cacheable = true;
+	recording.reads.clear();
+	recording.stores.clear();
+	_callback_cache_recording = &recording;
+
+	_temp_store.ClearChanges();
+	const SpriteGroup *group = SpriteGroup::Resolve(this->root_spritegroup, *this, false);
+	uint16 result = group != nullptr ? group->GetCallbackResult() : CALLBACK_FAILED;
+
+	_callback_cache_recording = nullptr;
+	_callback_cache_busy = false;
+
+	entry.valid = recording.cacheable;
+	if (recording.cacheable) {
+		entry.result = result;
+		entry.last_value = this->last_value;
+		entry.reads = recording.reads;
+		entry.stores = recording.stores;
+	} else {
+		entry.skip = CALLBACK_CACHE_SKIP;
+		_callback_cache_stats.uncacheable++;
+	}
+
+	return result;
+}
+
 /**
  * Process registers and the construction stage into the sprite layout.
  * The passed construction stage might get reset to zero, if it gets incorporated into the layout
@@ -168,7 +168,7 @@ struct DeterministicSpriteGroupRange {
 
 
 struct DeterministicSpriteGroup : SpriteGroup {
-	DeterministicSpriteGroup() : SpriteGroup(SGT_DETERMINISTIC) {}
+	DeterministicSpriteGroup() : SpriteGroup(SGT_DETERMINISTIC), compiled(false) {}
 	~DeterministicSpriteGroup();
 
 	VarSpriteGroupScope var_scope;
@@ -184,7 +184,20 @@ struct DeterministicSpriteGroup : SpriteGroup {
 
 	const SpriteGroup *error_group; // was first range, before sorting ranges
 
+	/* Compiled form, see DeterministicSpriteGroup::Compile() */
+	bool compiled;                             ///< Whether the compiled form is valid.
+	uint folded_adjusts;                       ///< Number of leading adjusts that evaluate to a constant.
+	uint32 folded_value;                       ///< Value after the leading constant adjusts.
+	uint32 jump_table_base;                    ///< Value of the first entry of the jump table.
+	std::vector<const SpriteGroup *> jump_table; ///< Target for each value from jump_table_base on, for dense ranges; empty if not used.
+
+	void Compile();
+
 protected:
+	static const uint MIN_JUMP_TABLE_RANGES = 3;  ///< Minimum number of ranges to use a jump table for.
+	static const uint32 MAX_JUMP_TABLE_SIZE = 256; ///< Maximum span of the values covered by a jump table.
+
+	const SpriteGroup *Evaluate(ResolverObject &object, bool use_compiled, bool *is_result) const;
 	const SpriteGroup *Resolve(ResolverObject &object) const;
 };
 
@@ -352,15 +365,7 @@ struct ResolverObject {
 		return SpriteGroup::Resolve(this->root_spritegroup, *this);
 	}
 
-	/**
-	 * Resolve callback.
-	 * @return Callback result.
-	 */
-	uint16 ResolveCallback()
-	{
-		const SpriteGroup *result = Resolve();
-		return result != nullptr ? result->GetCallbackResult() : CALLBACK_FAILED;
-	}
+	uint16 ResolveCallback();
 
 	virtual const SpriteGroup *ResolveReal(const RealSpriteGroup *group) const;
 
@@ -413,4 +418,18 @@ struct ResolverObject {
 	virtual uint32 GetDebugID() const { return 0; }
 };
 
+/** Statistics of the NewGRF callback result cache. */
+struct CallbackCacheStats {
+	uint64 lookups;     ///< Number of callbacks resolved through the cache.
+	uint64 hits;        ///< Number of callbacks answered from the cache.
+	uint64 misses;      ///< Number of callbacks not in the cache, or whose inputs changed.
+	uint64 uncacheable; ///< Number of callbacks whose resolution could not be cached.
+	uint64 bypassed;    ///< Number of callbacks not looked up, as their cache entry kept missing.
+};
+
+extern CallbackCacheStats _callback_cache_stats;
+
+void ClearCallbackCache();
+void CompileSpriteGroups();
+
 #endif /* NEWGRF_SPRITEGROUP_H */
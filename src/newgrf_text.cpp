@@ -648,6 +648,80 @@ GRFText *DuplicateGRFText(GRFText *orig)
 	return newtext;
 }
 
+/**
+ * Append a GRFText list to a string, in a form that only consists of hexadecimal digits, ':' and ','.
+ * Every text is written as its language ID, a ':' and its bytes, the texts are separated by a ','.
+ * An empty list is written as "-".
+ * @param list The GRFText list to serialise.
+ * @param[out] buffer The string to append to.
+ * @see DeserialiseGRFTextList
+ */
+void SerialiseGRFTextList(const GRFText *list, std::string &buffer)
+{
+	static const char HEX[] = "0123456789ABCDEF";
+
+	if (list == nullptr) {
+		buffer += '-';
+		return;
+	}
+	for (const GRFText *text = list; text != nullptr; text = text->next) {
+		if (text != list) buffer += ',';
+		buffer += HEX[text->langid >> 4];
+		buffer += HEX[text->langid & 0xF];
+		buffer += ':';
+		for (size_t i = 0; i < text->len; i++) {
+			buffer += HEX[(byte)text->text[i] >> 4];
+			buffer += HEX[(byte)text->text[i] & 0xF];
+		}
+	}
+}
+
+/**
+ * Get the value of a hexadecimal digit.
+ * @param c The digit.
+ * @return The value of the digit, or -1 if it is not a hexadecimal digit.
+ */
+static int GetHexDigitValue(char c)
+{
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	return -1;
+}
+
+/**
+ * Read a GRFText list written by #SerialiseGRFTextList.
+ * @param[out] list The GRFText list to add the texts to.
+ * @param str The serialised list.
+ * @return True if \a str was a valid serialised list; if not, \a list may hold some of the texts.
+ */
+bool DeserialiseGRFTextList(GRFText **list, const char *str)
+{
+	if (strcmp(str, "-") == 0) return true;
+
+	std::vector<char> text;
+	for (;;) {
+		int hi = GetHexDigitValue(str[0]);
+		int lo = hi < 0 ? -1 : GetHexDigitValue(str[1]);
+		if (lo < 0 || str[2] != ':') return false;
+		const byte langid = (byte)(hi << 4 | lo);
+		str += 3;
+
+		text.clear();
+		while ((hi = GetHexDigitValue(str[0])) >= 0) {
+			lo = GetHexDigitValue(str[1]);
+			if (lo < 0) return false;
+			text.push_back((char)(hi << 4 | lo));
+			str += 2;
+		}
+		if (text.empty()) return false;
+		AddGRFTextToList(list, GRFText::New(langid, text.data(), text.size()));
+
+		if (*str == '\0') return true;
+		if (*str++ != ',') return false;
+	}
+}
+
 /**
  * Add the new read string into our structure.
  */
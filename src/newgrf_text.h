@@ -15,6 +15,8 @@
 #include "core/smallvec_type.hpp"
 #include "table/control_codes.h"
 
+#include <string>
+
 /** This character, the thorn ('þ'), indicates a unicode string to NFO. */
 static const WChar NFO_UTF8_IDENTIFIER = 0x00DE;
 
@@ -30,6 +32,8 @@ void AddGRFTextToList(struct GRFText **list, struct GRFText *text_to_add);
 void AddGRFTextToList(struct GRFText **list, byte langid, uint32 grfid, bool allow_newlines, const char *text_to_add);
 void AddGRFTextToList(struct GRFText **list, const char *text_to_add);
 void CleanUpGRFText(struct GRFText *grftext);
+void SerialiseGRFTextList(const struct GRFText *list, std::string &buffer);
+bool DeserialiseGRFTextList(struct GRFText **list, const char *str);
 
 bool CheckGrfLangID(byte lang_id, byte grf_version);
 
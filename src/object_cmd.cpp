@@ -32,6 +32,7 @@
 #include "date_func.h"
 #include "newgrf_debug.h"
 #include "vehicle_func.h"
+#include "pathfinder/water_regions.h"
 
 #include "table/strings.h"
 #include "table/object_land.h"
@@ -121,6 +122,8 @@ void BuildObject(ObjectType type, TileIndex tile, CompanyID owner, Town *town, u
 			Company::Get(owner)->infrastructure.water++;
 			DirtyCompanyInfrastructureWindows(owner);
 		}
+		/* The tile is no longer passable for ships. */
+		if (wc != WATER_CLASS_INVALID) InvalidateWaterRegion(t);
 		MakeObject(t, owner, o->index, wc, Random());
 		MarkTileDirtyByTile(t, ZOOM_LVL_DRAW_MAP);
 	}
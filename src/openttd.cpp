@@ -79,7 +79,12 @@
 #include "core/checksum_func.hpp"
 
 #include "linkgraph/linkgraphschedule.h"
+#include "linkgraph/refresh.h"
 #include "tracerestrict.h"
+#include "pathfinder/road_regions.h"
+#include "pathfinder/water_regions.h"
+#include "tracing.h"
+#include "command_log_replay.h"
 
 #include <stdarg.h>
 #include <system_error>
@@ -229,6 +234,8 @@ static void ShowHelp()
 		"  -c config_file      = Use 'config_file' instead of 'openttd.cfg'\n"
 		"  -x                  = Do not automatically save to config file on exit\n"
 		"  -q savegame         = Write some information about the savegame and exit\n"
+		"  -R commands.log     = Replay a command log of '-d desync=1' against the savegame\n"
+		"                        of -g without video, sound and music, then report and exit\n"
 		"  -Z                  = Write detailed version information and exit\n"
 		"\n",
 		lastof(buf)
@@ -407,6 +414,7 @@ static void ShutdownGame()
 
 	FreeSignalPrograms();
 	FreeSignalDependencies();
+	ClearSignalBlockCache();
 
 	ClearZoningCaches();
 	ClearOrderDestinationRefcountMap();
@@ -648,6 +656,7 @@ static const OptionData _options[] = {
 	 GETOPT_SHORT_VALUE('K'),
 	 GETOPT_SHORT_NOVAL('h'),
 	 GETOPT_SHORT_VALUE('J'),
+	 GETOPT_SHORT_VALUE('R'),
 	 GETOPT_SHORT_NOVAL('Z'),
 	GETOPT_END()
 };
@@ -674,6 +683,7 @@ int openttd_main(int argc, char *argv[])
 	AfterNewGRFScan *scanner = new AfterNewGRFScan(&save_config);
 	bool dedicated = false;
 	char *debuglog_conn = nullptr;
+	char *replay_log = nullptr;
 
 	extern bool _dedicated_forks;
 	_dedicated_forks = false;
@@ -804,6 +814,7 @@ int openttd_main(int argc, char *argv[])
 		case 'c': free(_config_file); _config_file = stredup(mgo.opt); break;
 		case 'x': scanner->save_config = false; break;
 		case 'J': _quit_after_days = Clamp(atoi(mgo.opt), 0, INT_MAX); break;
+		case 'R': free(replay_log); replay_log = stredup(mgo.opt); break;
 		case 'Z': {
 			CrashLog::VersionInfoLog();
 			goto exit_noshutdown;
@@ -834,6 +845,18 @@ int openttd_main(int argc, char *argv[])
 	DeterminePaths(argv[0]);
 	TarScanner::DoScan(TarScanner::BASESET);
 
+	if (replay_log != nullptr) {
+		if (dedicated || _switch_mode != SM_LOAD_GAME) usererror("Replaying a command log requires a savegame (-g) and cannot be done by a dedicated server");
+		if (!LoadCommandLogReplay(replay_log)) usererror("Failed to load command log '%s'", replay_log);
+		free(replay_log);
+		replay_log = nullptr;
+
+		/* Replay headless, unless asked otherwise. */
+		if (videodriver == nullptr) videodriver = stredup("null:until_exit");
+		if (sounddriver == nullptr) sounddriver = stredup("null");
+		if (musicdriver == nullptr) musicdriver = stredup("null");
+	}
+
 	if (dedicated) DEBUG(net, 0, "Starting dedicated version %s", _openttd_revision);
 	if (_dedicated_forks && !dedicated) _dedicated_forks = false;
 
@@ -1016,10 +1039,11 @@ int openttd_main(int argc, char *argv[])
 	goto exit_normal;
 
 exit_noshutdown:
-	/* These three are normally freed before bootstrap. */
+	/* These four are normally freed before bootstrap. */
 	free(graphics_set);
 	free(videodriver);
 	free(blitter);
+	free(replay_log);
 
 exit_bootstrap:
 	/* These are normally freed before exit, but after bootstrap. */
@@ -1268,8 +1292,8 @@ void SwitchToMode(SwitchMode new_mode)
 					EngineOverrideManager::ResetToCurrentNewGRFConfig();
 				}
 				/* Update the local company for a loaded game. It is either always
-				 * company #1 (eg 0) or in the case of a dedicated server a spectator */
-				SetLocalCompany(_network_dedicated ? COMPANY_SPECTATOR : COMPANY_FIRST);
+				 * company #1 (eg 0) or in the case of a dedicated server (or a replay) a spectator */
+				SetLocalCompany(_network_dedicated || IsReplayingCommandLog() ? COMPANY_SPECTATOR : COMPANY_FIRST);
 				if (_ctrl_pressed && !_network_dedicated) {
 					DoCommandP(0, PM_PAUSED_NORMAL, 1, CMD_PAUSE);
 				}
@@ -1365,6 +1389,8 @@ void CheckCaches(bool force_check, std::function<void(const char *)> log)
 		if (_debug_desync_level == 1 && _scaled_date_ticks % 500 != 0) return;
 	}
 
+	TRACE_ZONE("Check caches");
+
 	char cclog_buffer[1024];
 #define CCLOG(...) { \
 	seprintf(cclog_buffer, lastof(cclog_buffer), __VA_ARGS__); \
@@ -1420,6 +1446,7 @@ void CheckCaches(bool force_check, std::function<void(const char *)> log)
 		old_station_industries_nears.push_back(st->industries_near);
 		old_station_catchment_tiles.push_back(st->catchment_tiles);
 	}
+	const StationCatchmentIndex old_station_catchment_index = _station_catchment_index;
 
 	std::vector<StationList> old_industry_stations_nears;
 	for (Industry *ind : Industry::Iterate()) {
@@ -1448,6 +1475,9 @@ void CheckCaches(bool force_check, std::function<void(const char *)> log)
 		if (old_town_stations_nears[i] != t->stations_near) {
 			CCLOG("town stations_near mismatch: town %i, (old size: %u, new size: %u)", (int)t->index, (uint)old_town_stations_nears[i].size(), (uint)t->stations_near.size());
 		}
+		if (!IsTownGrowthScheduleValid(t)) {
+			CCLOG("town growth schedule mismatch: town %i", (int)t->index);
+		}
 		i++;
 	}
 	if (old_town_cargoes_accepted != _town_cargoes_accepted) {
@@ -1463,23 +1493,14 @@ void CheckCaches(bool force_check, std::function<void(const char *)> log)
 		}
 		i++;
 	}
+	if (old_station_catchment_index != _station_catchment_index) {
+		CCLOG("station catchment index mismatch: (old size: %u, new size: %u)", (uint)old_station_catchment_index.Size(), (uint)_station_catchment_index.Size());
+	}
 	i = 0;
 	for (Industry *ind : Industry::Iterate()) {
 		if (old_industry_stations_nears[i] != ind->stations_near) {
 			CCLOG("industry stations_near mismatch: ind %i, (old size: %u, new size: %u)", (int)ind->index, (uint)old_industry_stations_nears[i].size(), (uint)ind->stations_near.size());
 		}
-		StationList stlist;
-		if (ind->neutral_station != nullptr && !_settings_game.station.serve_neutral_industries) {
-			stlist.insert(ind->neutral_station);
-			if (ind->stations_near != stlist) {
-				CCLOG("industry neutral station stations_near mismatch: ind %i, (recalc size: %u, neutral size: %u)", (int)ind->index, (uint)ind->stations_near.size(), (uint)stlist.size());
-			}
-		} else {
-			FindStationsAroundTiles(ind->location, &stlist, false, ind->index);
-			if (ind->stations_near != stlist) {
-				CCLOG("industry FindStationsAroundTiles mismatch: ind %i, (recalc size: %u, find size: %u)", (int)ind->index, (uint)ind->stations_near.size(), (uint)stlist.size());
-			}
-		}
 		i++;
 	}
 
@@ -1509,21 +1530,7 @@ void CheckCaches(bool force_check, std::function<void(const char *)> log)
 		i++;
 	}
 
-	/* Strict checking of the road stop cache entries */
-	for (const RoadStop *rs : RoadStop::Iterate()) {
-		if (IsStandardRoadStopTile(rs->xy)) continue;
-
-		assert(rs->GetEntry(DIAGDIR_NE) != rs->GetEntry(DIAGDIR_NW));
-		rs->GetEntry(DIAGDIR_NE)->CheckIntegrity(rs);
-		rs->GetEntry(DIAGDIR_NW)->CheckIntegrity(rs);
-	}
-
 	for (Vehicle *v : Vehicle::Iterate()) {
-		extern bool ValidateVehicleTileHash(const Vehicle *v);
-		if (!ValidateVehicleTileHash(v)) {
-			CCLOG("vehicle tile hash mismatch: type %i, vehicle %i, company %i, unit number %i", (int)v->type, v->index, (int)v->owner, v->unitnumber);
-		}
-
 		extern void FillNewGRFVehicleCache(const Vehicle *v);
 		if (v != v->First() || v->vehstatus & VS_CRASHED || !v->IsPrimaryVehicle()) continue;
 
@@ -1670,44 +1677,12 @@ void CheckCaches(bool force_check, std::function<void(const char *)> log)
 		free(veh_old);
 	}
 
-	/* Check whether the caches are still valid */
-	for (Vehicle *v : Vehicle::Iterate()) {
-		byte buff[sizeof(VehicleCargoList)];
-		memcpy(buff, &v->cargo, sizeof(VehicleCargoList));
-		v->cargo.InvalidateCache();
-		assert(memcmp(&v->cargo, buff, sizeof(VehicleCargoList)) == 0);
-	}
-
-	for (Station *st : Station::Iterate()) {
-		for (CargoID c = 0; c < NUM_CARGO; c++) {
-			byte buff[sizeof(StationCargoList)];
-			memcpy(buff, &st->goods[c].cargo, sizeof(StationCargoList));
-			st->goods[c].cargo.InvalidateCache();
-			assert(memcmp(&st->goods[c].cargo, buff, sizeof(StationCargoList)) == 0);
-		}
-	}
-
-	for (OrderList *order_list : OrderList::Iterate()) {
-		order_list->DebugCheckSanity();
-	}
-
 	extern void ValidateVehicleTickCaches();
 	ValidateVehicleTickCaches();
 
-	for (Vehicle *v : Vehicle::Iterate()) {
-		if (v->Previous()) assert_msg(v->Previous()->Next() == v, "%u", v->index);
-		if (v->Next()) assert_msg(v->Next()->Previous() == v, "%u", v->index);
-	}
-	for (const TemplateVehicle *tv : TemplateVehicle::Iterate()) {
-		if (tv->Prev()) assert_msg(tv->Prev()->Next() == tv, "%u", tv->index);
-		if (tv->Next()) assert_msg(tv->Next()->Prev() == tv, "%u", tv->index);
-	}
-
 	if (!TraceRestrictSlot::ValidateVehicleIndex()) CCLOG("Trace restrict slot vehicle index validation failed");
 	TraceRestrictSlot::ValidateSlotOccupants(log);
 
-	if (!CargoPacket::ValidateDeferredCargoPayments()) CCLOG("Cargo packets deferred payments validation failed");
-
 	if (_order_destination_refcount_map_valid) {
 		btree::btree_map<uint32, uint32> saved_order_destination_refcount_map = std::move(_order_destination_refcount_map);
 		for (auto iter = saved_order_destination_refcount_map.begin(); iter != saved_order_destination_refcount_map.end();) {
@@ -1717,12 +1692,132 @@ void CheckCaches(bool force_check, std::function<void(const char *)> log)
 				++iter;
 			}
 		}
+		btree::btree_map<uint32, uint32> saved_order_station_list_refcount_map = std::move(_order_station_list_refcount_map);
 		IntialiseOrderDestinationRefcountMap();
 		if (saved_order_destination_refcount_map != _order_destination_refcount_map) CCLOG("Order destination refcount map mismatch");
+		if (saved_order_station_list_refcount_map != _order_station_list_refcount_map) CCLOG("Order station list refcount map mismatch");
 	} else {
 		CCLOG("Order destination refcount map not valid");
 	}
 
+	/* Rebuilding the cargo list caches writes to the lists, and brings pending aging of the packets up to date. */
+	for (Vehicle *v : Vehicle::Iterate()) {
+		/* Bring the packets up to date first, that is not part of the cached state. */
+		v->cargo.ApplyPendingAging();
+		byte buff[sizeof(VehicleCargoList)];
+		memcpy(buff, &v->cargo, sizeof(VehicleCargoList));
+		v->cargo.InvalidateCache();
+		assert(memcmp(&v->cargo, buff, sizeof(VehicleCargoList)) == 0);
+	}
+
+	for (Station *st : Station::Iterate()) {
+		for (CargoID c = 0; c < NUM_CARGO; c++) {
+			byte buff[sizeof(StationCargoList)];
+			memcpy(buff, &st->goods[c].cargo, sizeof(StationCargoList));
+			st->goods[c].cargo.InvalidateCache();
+			assert(memcmp(&st->goods[c].cargo, buff, sizeof(StationCargoList)) == 0);
+		}
+	}
+
+	/* The remaining checks only read the game state, so they are run in parallel. Each check collects its
+	 * own messages, which are logged afterwards in the order of the checks, so the log does not depend on
+	 * the number of threads. */
+#define CCLOGT(...) messages.push_back(stdstr_fmt(__VA_ARGS__))
+	static const std::function<void(std::vector<std::string> &)> checks[] = {
+		[](std::vector<std::string> &) {
+			/* Strict checking of the road stop cache entries */
+			for (const RoadStop *rs : RoadStop::Iterate()) {
+				if (IsStandardRoadStopTile(rs->xy)) continue;
+
+				assert(rs->GetEntry(DIAGDIR_NE) != rs->GetEntry(DIAGDIR_NW));
+				rs->GetEntry(DIAGDIR_NE)->CheckIntegrity(rs);
+				rs->GetEntry(DIAGDIR_NW)->CheckIntegrity(rs);
+			}
+		},
+		[](std::vector<std::string> &messages) {
+			for (const Industry *ind : Industry::Iterate()) {
+				StationList stlist;
+				if (ind->neutral_station != nullptr && !_settings_game.station.serve_neutral_industries) {
+					stlist.insert(ind->neutral_station);
+					if (ind->stations_near != stlist) {
+						CCLOGT("industry neutral station stations_near mismatch: ind %i, (recalc size: %u, neutral size: %u)", (int)ind->index, (uint)ind->stations_near.size(), (uint)stlist.size());
+					}
+				} else {
+					FindStationsAroundTiles(ind->location, &stlist, false, ind->index);
+					if (ind->stations_near != stlist) {
+						CCLOGT("industry FindStationsAroundTiles mismatch: ind %i, (recalc size: %u, find size: %u)", (int)ind->index, (uint)ind->stations_near.size(), (uint)stlist.size());
+					}
+				}
+			}
+		},
+		[](std::vector<std::string> &messages) {
+			extern bool ValidateVehicleTileHash(const Vehicle *v);
+			for (const Vehicle *v : Vehicle::Iterate()) {
+				if (!ValidateVehicleTileHash(v)) {
+					CCLOGT("vehicle tile hash mismatch: type %i, vehicle %i, company %i, unit number %i", (int)v->type, v->index, (int)v->owner, v->unitnumber);
+				}
+			}
+		},
+		[](std::vector<std::string> &) {
+			for (const OrderList *order_list : OrderList::Iterate()) {
+				order_list->DebugCheckSanity();
+			}
+		},
+		[](std::vector<std::string> &) {
+			for (const Vehicle *v : Vehicle::Iterate()) {
+				if (v->Previous()) assert_msg(v->Previous()->Next() == v, "%u", v->index);
+				if (v->Next()) assert_msg(v->Next()->Previous() == v, "%u", v->index);
+			}
+			for (const TemplateVehicle *tv : TemplateVehicle::Iterate()) {
+				if (tv->Prev()) assert_msg(tv->Prev()->Next() == tv, "%u", tv->index);
+				if (tv->Next()) assert_msg(tv->Next()->Prev() == tv, "%u", tv->index);
+			}
+		},
+		[](std::vector<std::string> &messages) {
+			if (!CargoPacket::ValidateDeferredCargoPayments()) CCLOGT("Cargo packets deferred payments validation failed");
+		},
+		[](std::vector<std::string> &messages) {
+			for (uint region_index : GetStaleRoadRegions(RTT_ROAD)) {
+				CCLOGT("road region cache mismatch: rtt %u, region %u", (uint)RTT_ROAD, region_index);
+			}
+		},
+		[](std::vector<std::string> &messages) {
+			for (uint region_index : GetStaleRoadRegions(RTT_TRAM)) {
+				CCLOGT("road region cache mismatch: rtt %u, region %u", (uint)RTT_TRAM, region_index);
+			}
+		},
+		[](std::vector<std::string> &messages) {
+			for (uint region_index : GetStaleWaterRegions()) {
+				CCLOGT("water region cache mismatch: region %u", region_index);
+			}
+		},
+		[](std::vector<std::string> &messages) {
+			for (OrderListID list : LinkRefresher::GetStaleCachedRefreshes()) {
+				CCLOGT("link refresher cache mismatch: order list %u", (uint)list);
+			}
+		},
+		[](std::vector<std::string> &messages) {
+			/* Exploring signal blocks uses the global tile sets of the signal code, so this must be the only check doing so. */
+			for (TileIndex tile : GetStaleSignalBlocks()) {
+				CCLOGT("signal block cache mismatch: tile %u (%u x %u)", tile, TileX(tile), TileY(tile));
+			}
+		},
+	};
+#undef CCLOGT
+
+	/* The worker threads are started for each call. Even at desync debug level 2, which checks every tick,
+	 * starting a thread takes some tens of microseconds, against about a millisecond for the checks. */
+	std::vector<std::string> check_messages[lengthof(checks)];
+	ParallelForRange("ottd:caches", 0, (uint)lengthof(checks), 1, [&](uint begin, uint end) {
+		for (uint i = begin; i < end; i++) {
+			TRACE_ZONE_ID("Cache check", i);
+			checks[i](check_messages[i]);
+		}
+	});
+	for (const std::vector<std::string> &messages : check_messages) {
+		for (const std::string &message : messages) CCLOG("%s", message.c_str());
+	}
+
 #undef CCLOGV
 #undef CCLOG
 }
@@ -1752,7 +1847,7 @@ CommandCost CmdDesyncCheck(TileIndex tile, DoCommandFlag flags, uint32 p1, uint3
  */
 void StateGameLoop()
 {
-	if (!_networking || _network_server) {
+	if ((!_networking && !IsReplayingCommandLog()) || _network_server) {
 		extern void StateGameLoop_LinkGraphPauseControl();
 		StateGameLoop_LinkGraphPauseControl();
 	}
@@ -1769,7 +1864,7 @@ void StateGameLoop()
 
 		UpdateLandscapingLimits();
 #ifndef DEBUG_DUMP_COMMANDS
-		Game::GameLoop();
+		if (!IsReplayingCommandLog()) Game::GameLoop();
 #endif
 		return;
 	}
@@ -1778,6 +1873,9 @@ void StateGameLoop()
 	PerformanceAccumulator::Reset(PFE_GL_LANDSCAPE);
 	if (HasModalProgress()) return;
 
+	TRACE_GAME_TICK();
+	TRACE_ZONE("StateGameLoop");
+
 	Layouter::ReduceLineCache();
 
 	if (_game_mode == GM_EDITOR) {
@@ -1822,7 +1920,7 @@ void StateGameLoop()
 		BasePersistentStorageArray::SwitchMode(PSM_LEAVE_GAMELOOP);
 
 #ifndef DEBUG_DUMP_COMMANDS
-		{
+		if (!IsReplayingCommandLog()) {
 			PerformanceMeasurer framerate(PFE_ALLSCRIPTS);
 			AI::GameLoop();
 			Game::GameLoop();
@@ -1908,7 +2006,11 @@ void GameLoop()
 			NetworkClientConnectGame(NetworkAddress(_settings_client.network.last_host, _settings_client.network.last_port), COMPANY_SPECTATOR);
 		}
 		/* Singleplayer */
-		StateGameLoop();
+		if (IsReplayingCommandLog()) {
+			CommandLogReplayGameLoop();
+		} else {
+			StateGameLoop();
+		}
 	}
 
 	if (!_pause_mode && HasBit(_display_opt, DO_FULL_ANIMATION)) DoPaletteAnimations();
@@ -54,11 +54,12 @@ OrderBackup::OrderBackup(const Vehicle *v, uint32 user)
 	} else {
 		/* Else copy the orders */
 		Order **tail = &this->orders;
+		Order *copy = nullptr;
 
 		/* Count the number of orders */
 		const Order *order;
 		FOR_VEHICLE_ORDERS(v, order) {
-			Order *copy = new Order();
+			copy = NewOrderNear(copy);
 			copy->AssignOrder(*order);
 			*tail = copy;
 			tail = &copy->next;
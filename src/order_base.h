@@ -24,7 +24,7 @@
 #include <vector>
 #include "3rdparty/cpp-btree/btree_map.h"
 
-typedef Pool<Order, OrderID, 256, 0xFF0000> OrderPool;
+typedef Pool<Order, OrderID, 256, 0xFF0000, PT_NORMAL, false, true, true> OrderPool;
 typedef Pool<OrderList, OrderListID, 128, 64000> OrderListPool;
 extern OrderPool _order_pool;
 extern OrderListPool _orderlist_pool;
@@ -46,6 +46,42 @@ template <typename F> void IterateOrderRefcountMapForDestinationID(DestinationID
 	}
 }
 
+extern btree::btree_map<uint32, uint32> _order_station_list_refcount_map;
+
+inline uint32 OrderStationListRefcountMapKey(StationID station, OrderListID list)
+{
+	assert_compile(sizeof(station) == 2);
+	assert_compile(sizeof(list) == 2);
+	return (((uint32) station) << 16) | ((uint32) list);
+}
+
+/**
+ * Call a handler for each order list which has goto station or implicit orders for both of two stations.
+ * The order lists are handled in order of their index.
+ * @param st1 First station.
+ * @param st2 Second station.
+ * @param handler Functor with signature: void (OrderListID)
+ */
+template <typename F> void IterateOrderListsForStationPair(StationID st1, StationID st2, F handler)
+{
+	auto it1 = _order_station_list_refcount_map.lower_bound(OrderStationListRefcountMapKey(st1, 0));
+	auto it2 = _order_station_list_refcount_map.lower_bound(OrderStationListRefcountMapKey(st2, 0));
+	const auto end = _order_station_list_refcount_map.end();
+	while (it1 != end && it2 != end && GB(it1->first, 16, 16) == st1 && GB(it2->first, 16, 16) == st2) {
+		const OrderListID list1 = GB(it1->first, 0, 16);
+		const OrderListID list2 = GB(it2->first, 0, 16);
+		if (list1 < list2) {
+			++it1;
+		} else if (list2 < list1) {
+			++it2;
+		} else {
+			if (it1->second != 0 && it2->second != 0) handler(list1);
+			++it1;
+			++it2;
+		}
+	}
+}
+
 void IntialiseOrderDestinationRefcountMap();
 void ClearOrderDestinationRefcountMap();
 
@@ -505,8 +541,23 @@ public:
 	void ConvertFromOldSavegame();
 };
 
+/**
+ * Allocate a new order close in memory to an existing order.
+ * Keeping the orders of a list close together keeps walking the list cache friendly.
+ * @param neighbour Order the new order will be linked to, or nullptr to allocate it anywhere.
+ * @return The new order.
+ * @pre Order::CanAllocateItem()
+ */
+inline Order *NewOrderNear(const Order *neighbour)
+{
+	if (neighbour == nullptr) return new Order();
+	return new (PoolNeighbour{ neighbour->index }) Order();
+}
+
+Order *NewOrderToInsert(const Vehicle *v, VehicleOrderID sel_ord);
 void InsertOrder(Vehicle *v, Order *new_o, VehicleOrderID sel_ord);
 void DeleteOrder(Vehicle *v, VehicleOrderID sel_ord);
+void CompactOrderListStorage();
 
 struct CargoMaskedStationIDStack {
 	CargoTypes cargo_mask;
@@ -569,6 +620,7 @@ private:
 	friend void AfterLoadVehicles(bool part_of_load); ///< For instantiating the shared vehicle chain
 	friend const struct SaveLoad *GetOrderListDescription(); ///< Saving and loading of order lists.
 	friend void Ptrs_ORDL(); ///< Saving and loading of order lists.
+	friend void CompactOrderListStorage(); ///< Moving the orders of the lists.
 
 	StationID GetBestLoadableNext(const Vehicle *v, const Order *o1, const Order *o2) const;
 	void ReindexOrderList();
@@ -606,8 +658,7 @@ public:
 	 */
 	OrderList(Order *chain, Vehicle *v) { this->Initialize(chain, v); }
 
-	/** Destructor. Invalidates OrderList for re-usage by the pool. */
-	~OrderList() {}
+	~OrderList();
 
 	void Initialize(Order *chain, Vehicle *v);
 
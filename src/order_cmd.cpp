@@ -37,6 +37,7 @@
 #include "order_cmd.h"
 #include "vehiclelist.h"
 #include "tracerestrict.h"
+#include "linkgraph/refresh.h"
 
 #include "table/strings.h"
 
@@ -55,6 +56,7 @@ INSTANTIATE_POOL_METHODS(OrderList)
 
 btree::btree_map<uint32, uint32> _order_destination_refcount_map;
 bool _order_destination_refcount_map_valid = false;
+btree::btree_map<uint32, uint32> _order_station_list_refcount_map; ///< Number of goto station and implicit orders by station and order list, valid together with #_order_destination_refcount_map.
 
 CommandCost CmdInsertOrderIntl(DoCommandFlag flags, Vehicle *v, VehicleOrderID sel_ord, const Order &new_order, bool allow_load_by_cargo_type);
 
@@ -68,6 +70,9 @@ void IntialiseOrderDestinationRefcountMap()
 			if (order->IsType(OT_GOTO_STATION) || order->IsType(OT_GOTO_WAYPOINT) || order->IsType(OT_IMPLICIT)) {
 				_order_destination_refcount_map[OrderDestinationRefcountMapKey(order->GetDestination(), v->owner, order->GetType(), v->type)]++;
 			}
+			if (order->IsType(OT_GOTO_STATION) || order->IsType(OT_IMPLICIT)) {
+				_order_station_list_refcount_map[OrderStationListRefcountMapKey(order->GetDestination(), v->orders.list->index)]++;
+			}
 		}
 	}
 	_order_destination_refcount_map_valid = true;
@@ -76,14 +81,23 @@ void IntialiseOrderDestinationRefcountMap()
 void ClearOrderDestinationRefcountMap()
 {
 	_order_destination_refcount_map.clear();
+	_order_station_list_refcount_map.clear();
 	_order_destination_refcount_map_valid = false;
 }
 
-void UpdateOrderDestinationRefcount(const Order *order, VehicleType type, Owner owner, int delta)
+void UpdateOrderDestinationRefcount(const Order *order, OrderListID list, VehicleType type, Owner owner, int delta)
 {
 	if (order->IsType(OT_GOTO_STATION) || order->IsType(OT_GOTO_WAYPOINT) || order->IsType(OT_IMPLICIT)) {
 		_order_destination_refcount_map[OrderDestinationRefcountMapKey(order->GetDestination(), owner, order->GetType(), type)] += delta;
 	}
+	if (order->IsType(OT_GOTO_STATION) || order->IsType(OT_IMPLICIT)) {
+		const uint32 key = OrderStationListRefcountMapKey(order->GetDestination(), list);
+		if (delta < 0 && _order_station_list_refcount_map[key] == (uint32)-delta) {
+			_order_station_list_refcount_map.erase(key);
+		} else {
+			_order_station_list_refcount_map[key] += delta;
+		}
+	}
 }
 
 /** Clean everything up. */
@@ -396,6 +410,7 @@ void CargoStationIDStackSet::FillNextStoppingStation(const Vehicle *v, const Ord
 
 void OrderList::ReindexOrderList()
 {
+	LinkRefresher::InvalidateOrderList(this->index);
 	this->order_index.clear();
 	for (Order *o = this->first; o != nullptr; o = o->next) {
 		this->order_index.push_back(o);
@@ -412,6 +427,52 @@ bool OrderList::CheckOrderListIndexing() const
 	return idx == this->order_index.size();
 }
 
+/**
+ * Move the orders of each order list to consecutive indexes of the order pool, in list order.
+ * The order pool allocates its items from slabs, so the orders of a list then are next to
+ * each other in memory and walking a list walks memory linearly. Orders are only referred
+ * to by their index in savegames, so the indexes may change.
+ * @note Only call this when no pointers to the orders of order lists are kept elsewhere.
+ */
+void CompactOrderListStorage()
+{
+	std::vector<Order> orders;
+	std::vector<VehicleOrderID> counts;
+	for (OrderList *list : OrderList::Iterate()) {
+		VehicleOrderID count = 0;
+		for (Order *o = list->first; o != nullptr; count++) {
+			Order *next = o->next;
+			orders.emplace_back(std::move(*o));
+			delete o;
+			o = next;
+		}
+		counts.push_back(count);
+	}
+
+	/* All orders of lists are free now; allocating them in list order fills the pool from the lowest free index. */
+	assert(Order::CanAllocateItem(orders.size()));
+	auto order = orders.begin();
+	auto count = counts.begin();
+	for (OrderList *list : OrderList::Iterate()) {
+		Order **link = &list->first;
+		for (VehicleOrderID i = 0; i < *count; i++, ++order) {
+			Order *o = new Order();
+			o->AssignOrder(*order);
+			o->SetOccupancy(order->GetOccupancy());
+			*link = o;
+			link = &o->next;
+		}
+		++count;
+		list->ReindexOrderList();
+	}
+}
+
+/** Destructor. Invalidates OrderList for re-usage by the pool. */
+OrderList::~OrderList()
+{
+	LinkRefresher::InvalidateOrderList(this->index);
+}
+
 /**
  * Recomputes everything.
  * @param chain first order in the chain
@@ -419,6 +480,7 @@ bool OrderList::CheckOrderListIndexing() const
  */
 void OrderList::Initialize(Order *chain, Vehicle *v)
 {
+	LinkRefresher::InvalidateOrderList(this->index);
 	this->first = chain;
 	this->first_shared = v;
 
@@ -438,7 +500,7 @@ void OrderList::Initialize(Order *chain, Vehicle *v)
 			this->total_duration += o->GetWaitTime() + o->GetTravelTime();
 		}
 		this->order_index.push_back(o);
-		RegisterOrderDestination(o, type, owner);
+		RegisterOrderDestination(o, this->index, type, owner);
 	}
 
 	for (Vehicle *u = this->first_shared->PreviousShared(); u != nullptr; u = u->PreviousShared()) {
@@ -470,11 +532,12 @@ void OrderList::RecalculateTimetableDuration()
  */
 void OrderList::FreeChain(bool keep_orderlist)
 {
+	LinkRefresher::InvalidateOrderList(this->index);
 	Order *next;
 	VehicleType type = this->GetFirstSharedVehicle()->type;
 	Owner owner = this->GetFirstSharedVehicle()->owner;
 	for (Order *o = this->first; o != nullptr; o = next) {
-		UnregisterOrderDestination(o, type, owner);
+		UnregisterOrderDestination(o, this->index, type, owner);
 		next = o->next;
 		delete o;
 	}
@@ -679,7 +742,7 @@ void OrderList::InsertOrderAt(Order *new_order, int index)
 		this->timetable_duration += new_order->GetTimetabledWait() + new_order->GetTimetabledTravel();
 		this->total_duration += new_order->GetWaitTime() + new_order->GetTravelTime();
 	}
-	RegisterOrderDestination(new_order, this->GetFirstSharedVehicle()->type, this->GetFirstSharedVehicle()->owner);
+	RegisterOrderDestination(new_order, this->index, this->GetFirstSharedVehicle()->type, this->GetFirstSharedVehicle()->owner);
 	this->ReindexOrderList();
 
 	/* We can visit oil rigs and buoys that are not our own. They will be shown in
@@ -715,7 +778,7 @@ void OrderList::DeleteOrderAt(int index)
 		this->timetable_duration -= (to_remove->GetTimetabledWait() + to_remove->GetTimetabledTravel());
 		this->total_duration -= (to_remove->GetWaitTime() + to_remove->GetTravelTime());
 	}
-	UnregisterOrderDestination(to_remove, this->GetFirstSharedVehicle()->type, this->GetFirstSharedVehicle()->owner);
+	UnregisterOrderDestination(to_remove, this->index, this->GetFirstSharedVehicle()->type, this->GetFirstSharedVehicle()->owner);
 	delete to_remove;
 	this->ReindexOrderList();
 }
@@ -1169,7 +1232,7 @@ CommandCost CmdInsertOrderIntl(DoCommandFlag flags, Vehicle *v, VehicleOrderID s
 	if (v->orders.list == nullptr && !OrderList::CanAllocateItem()) return_cmd_error(STR_ERROR_NO_MORE_SPACE_FOR_ORDERS);
 
 	if (flags & DC_EXEC) {
-		Order *new_o = new Order();
+		Order *new_o = NewOrderToInsert(v, sel_ord);
 		new_o->AssignOrder(new_order);
 		InsertOrder(v, new_o, sel_ord);
 		CheckMarkDirtyFocusedRoutePaths(v);
@@ -1178,6 +1241,20 @@ CommandCost CmdInsertOrderIntl(DoCommandFlag flags, Vehicle *v, VehicleOrderID s
 	return CommandCost();
 }
 
+/**
+ * Allocate a new order to insert into the order list of a vehicle.
+ * The new order is allocated close in memory to the order it will follow.
+ * @param v       The vehicle the order will be inserted to.
+ * @param sel_ord The position the order will be inserted at.
+ * @return The new order.
+ * @pre Order::CanAllocateItem()
+ */
+Order *NewOrderToInsert(const Vehicle *v, VehicleOrderID sel_ord)
+{
+	/* An order inserted at the front of the list is allocated close to the order it precedes. */
+	return NewOrderNear(v->GetOrder(sel_ord == 0 ? 0 : min<int>(sel_ord, v->GetNumOrders()) - 1));
+}
+
 /**
  * Insert a new order but skip the validation.
  * @param v       The vehicle to insert the order to.
@@ -1741,6 +1818,7 @@ CommandCost CmdModifyOrder(TileIndex tile, DoCommandFlag flags, uint32 p1, uint3
 	}
 
 	if (flags & DC_EXEC) {
+		LinkRefresher::InvalidateOrderList(v->orders.list->index);
 		switch (mof) {
 			case MOF_NON_STOP:
 				order->SetNonStopType((OrderNonStopFlags)data);
@@ -2165,10 +2243,11 @@ CommandCost CmdCloneOrder(TileIndex tile, DoCommandFlag flags, uint32 p1, uint32
 				DeleteVehicleOrders(dst, true, ShouldResetOrderIndicesOnOrderCopy(src, dst));
 
 				order_dst = &first;
+				Order *last = nullptr;
 				FOR_VEHICLE_ORDERS(src, order) {
-					*order_dst = new Order();
-					(*order_dst)->AssignOrder(*order);
-					order_dst = &(*order_dst)->next;
+					last = *order_dst = NewOrderNear(last);
+					last->AssignOrder(*order);
+					order_dst = &last->next;
 				}
 				if (dst->orders.list == nullptr) {
 					dst->orders.list = new OrderList(first, dst);
@@ -2264,6 +2343,7 @@ CommandCost CmdOrderRefit(TileIndex tile, DoCommandFlag flags, uint32 p1, uint32
 	if (order->GetLoadType() & OLFB_NO_LOAD) return CMD_ERROR;
 
 	if (flags & DC_EXEC) {
+		LinkRefresher::InvalidateOrderList(v->orders.list->index);
 		order->SetRefit(cargo);
 
 		/* Make the depot order an 'always go' order. */
@@ -13,17 +13,18 @@
 #include "order_base.h"
 #include "order_func.h"
 #include "vehicle_base.h"
+#include "linkgraph/refresh.h"
 
-void UpdateOrderDestinationRefcount(const Order *order, VehicleType type, Owner owner, int delta);
+void UpdateOrderDestinationRefcount(const Order *order, OrderListID list, VehicleType type, Owner owner, int delta);
 
-inline void RegisterOrderDestination(const Order *order, VehicleType type, Owner owner)
+inline void RegisterOrderDestination(const Order *order, OrderListID list, VehicleType type, Owner owner)
 {
-	if (_order_destination_refcount_map_valid) UpdateOrderDestinationRefcount(order, type, owner, 1);
+	if (_order_destination_refcount_map_valid) UpdateOrderDestinationRefcount(order, list, type, owner, 1);
 }
 
-inline void UnregisterOrderDestination(const Order *order, VehicleType type, Owner owner)
+inline void UnregisterOrderDestination(const Order *order, OrderListID list, VehicleType type, Owner owner)
 {
-	if (_order_destination_refcount_map_valid) UpdateOrderDestinationRefcount(order, type, owner, -1);
+	if (_order_destination_refcount_map_valid) UpdateOrderDestinationRefcount(order, list, type, owner, -1);
 }
 
 /**
@@ -51,7 +52,7 @@ restart:
 				break;
 			}
 
-			UnregisterOrderDestination(order, v->type, v->owner);
+			UnregisterOrderDestination(order, v->orders.list->index, v->type, v->owner);
 
 			/* Clear wait time */
 			if (!order->IsType(OT_CONDITIONAL)) v->orders.list->UpdateTotalDuration(-order->GetWaitTime());
@@ -63,6 +64,7 @@ restart:
 
 			/* Clear order, preserving travel time */
 			bool travel_timetabled = order->IsTravelTimetabled();
+			LinkRefresher::InvalidateOrderList(v->orders.list->index);
 			order->MakeDummy();
 			order->SetTravelTimetabled(travel_timetabled);
 
@@ -0,0 +1,576 @@
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file road_regions.cpp Region graph of the road network, used to estimate road vehicle path costs. */
+
+#include "../stdafx.h"
+#include "road_regions.h"
+#include "pathfinder_type.h"
+#include "../map_func.h"
+#include "../road_map.h"
+#include "../tunnelbridge_map.h"
+#include "../tunnelbridge.h"
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <queue>
+
+#include "../safeguards.h"
+
+static const uint ROAD_REGION_TILES = ROAD_REGION_SIZE * ROAD_REGION_SIZE; ///< Number of tiles in a road region.
+static const uint8 ROAD_REGION_TILE_HAS_ROAD = 1 << DIAGDIR_END;         ///< Flag of RoadRegion::tiles for a tile with road.
+static const uint16 ROAD_REGION_UNREACHED = UINT16_MAX;                  ///< Number of steps of a tile which was not reached.
+static const int ROAD_REGION_STEP_COST = YAPF_TILE_CORNER_LENGTH;        ///< Lower bound of the path cost of entering a tile.
+static const uint MAX_ROAD_REGION_DISTANCE_FIELDS = 16;                  ///< Number of destinations to keep portal distances of.
+
+/** Road tile of a region which connects to a road tile in another region, or to the other end of a tunnel or bridge. */
+struct RoadRegionPortal {
+	uint8 tile;                                     ///< Index of the tile within the region.
+	std::vector<std::pair<uint8, uint16>> intra;    ///< Other portals of the region reachable within the region: tile index, number of steps.
+	std::vector<std::pair<TileIndex, uint16>> links; ///< Road tiles outside of the region the portal connects to, or tunnel/bridge ends: tile, number of steps.
+
+	bool operator==(const RoadRegionPortal &other) const
+	{
+		return this->tile == other.tile && this->intra == other.intra && this->links == other.links;
+	}
+};
+
+/** Cached connectivity of the road tiles of one road/tram type in a region. */
+struct RoadRegion {
+	bool valid = false;                    ///< Whether the cached data is up to date.
+	std::vector<uint8> tiles;              ///< Per tile: bits of the directions of connected tiles within the region, and #ROAD_REGION_TILE_HAS_ROAD. Empty when the region has no road.
+	std::vector<RoadRegionPortal> portals; ///< Portals of the region, sorted by tile index.
+
+	/**
+	 * Get the portal at a tile of the region.
+	 * @param tile Index of the tile within the region.
+	 * @return The portal, or nullptr if the tile is not a portal.
+	 */
+	const RoadRegionPortal *GetPortal(uint8 tile) const
+	{
+		auto iter = std::lower_bound(this->portals.begin(), this->portals.end(), tile, [](const RoadRegionPortal &portal, uint8 tile) {
+			return portal.tile < tile;
+		});
+		return (iter != this->portals.end() && iter->tile == tile) ? &(*iter) : nullptr;
+	}
+
+	/**
+	 * Check whether a tile of the region has road.
+	 * @param tile Index of the tile within the region.
+	 * @return True if the tile has road.
+	 */
+	inline bool HasRoad(uint tile) const
+	{
+		return !this->tiles.empty() && (this->tiles[tile] & ROAD_REGION_TILE_HAS_ROAD) != 0;
+	}
+};
+
+/** Distances from portals to a destination, found by Dijkstra, which can be continued later. */
+struct RoadRegionDistanceField {
+	typedef std::pair<int, uint32> OpenItem; ///< Distance and portal ID.
+
+	RoadTramType rtt;                        ///< Road/tram type of the road network.
+	std::vector<TileIndex> dest_tiles;       ///< Destination tiles, sorted.
+	btree::btree_map<uint32, int> settled;   ///< Exact distances of the settled portals, by portal ID.
+	btree::btree_map<uint32, int> tentative; ///< Best distances found so far of the other portals, by portal ID.
+	std::priority_queue<OpenItem, std::vector<OpenItem>, std::greater<OpenItem>> open; ///< Portals to settle.
+
+	void Seed();
+	void Push(uint32 id, int distance);
+	bool SettleNext(uint32 &id, int &distance);
+	void SettleUntil(int limit);
+
+	/**
+	 * Get the lower bound of the distances of the portals which have not been settled.
+	 * @return The distance.
+	 */
+	inline int GetFrontier() const
+	{
+		return this->open.empty() ? INT_MAX : this->open.top().first;
+	}
+};
+
+static std::vector<RoadRegion> _road_regions[2];  ///< Cached road regions, per road/tram type.
+static uint _road_regions_x = 0;                 ///< Number of road regions along the x axis.
+static uint _road_regions_y = 0;                 ///< Number of road regions along the y axis.
+static std::vector<std::unique_ptr<RoadRegionDistanceField>> _road_region_distance_fields; ///< Distance fields, least recently used first.
+
+/**
+ * Get the index of the road region of a tile.
+ * @param tile The tile.
+ * @return The region index.
+ */
+static inline uint GetRoadRegionIndex(TileIndex tile)
+{
+	return (TileY(tile) >> ROAD_REGION_SIZE_LOG) * _road_regions_x + (TileX(tile) >> ROAD_REGION_SIZE_LOG);
+}
+
+/**
+ * Get the index of a tile within its road region.
+ * @param tile The tile.
+ * @return The index of the tile within the region.
+ */
+static inline uint GetRoadRegionTileIndex(TileIndex tile)
+{
+	return ((TileY(tile) & (ROAD_REGION_SIZE - 1)) << ROAD_REGION_SIZE_LOG) | (TileX(tile) & (ROAD_REGION_SIZE - 1));
+}
+
+/**
+ * Get the ID of a portal, which is unique over all regions.
+ * @param tile The tile of the portal.
+ * @return The portal ID.
+ */
+static inline uint32 GetRoadRegionPortalID(TileIndex tile)
+{
+	return (GetRoadRegionIndex(tile) << (2 * ROAD_REGION_SIZE_LOG)) | GetRoadRegionTileIndex(tile);
+}
+
+/**
+ * Get the tile of the top corner of a road region.
+ * @param region_index The region index.
+ * @return The tile.
+ */
+static inline TileIndex GetRoadRegionBaseTile(uint region_index)
+{
+	return TileXY((region_index % _road_regions_x) << ROAD_REGION_SIZE_LOG, (region_index / _road_regions_x) << ROAD_REGION_SIZE_LOG);
+}
+
+/**
+ * Allocate the road regions for the current map size, if not done yet.
+ */
+static void AllocateRoadRegions()
+{
+	uint size_x = MapSizeX() >> ROAD_REGION_SIZE_LOG;
+	uint size_y = MapSizeY() >> ROAD_REGION_SIZE_LOG;
+	if (size_x == _road_regions_x && size_y == _road_regions_y) return;
+
+	ClearRoadRegions();
+	_road_regions_x = size_x;
+	_road_regions_y = size_y;
+	FOR_ALL_ROADTRAMTYPES(rtt) _road_regions[rtt].resize(size_x * size_y);
+}
+
+/**
+ * Count the steps from a set of tiles to all tiles of a region, without leaving the region.
+ * @param region The region.
+ * @param sources Indices of the tiles to start from.
+ * @param[out] steps Per tile index, the number of steps or #ROAD_REGION_UNREACHED.
+ */
+static void CountRoadRegionSteps(const RoadRegion &region, const std::vector<uint8> &sources, uint16 steps[ROAD_REGION_TILES])
+{
+	std::fill(steps, steps + ROAD_REGION_TILES, ROAD_REGION_UNREACHED);
+
+	uint8 queue[ROAD_REGION_TILES];
+	uint head = 0;
+	uint tail = 0;
+	for (uint8 source : sources) {
+		if (steps[source] == ROAD_REGION_UNREACHED) {
+			steps[source] = 0;
+			queue[tail++] = source;
+		}
+	}
+
+	while (head != tail) {
+		uint8 tile = queue[head++];
+		for (DiagDirection dir = DIAGDIR_BEGIN; dir < DIAGDIR_END; dir++) {
+			if (!HasBit(region.tiles[tile], dir)) continue;
+			TileIndexDiffC diff = TileIndexDiffCByDiagDir(dir);
+			uint8 next = tile + diff.y * ROAD_REGION_SIZE + diff.x;
+			if (steps[next] != ROAD_REGION_UNREACHED) continue;
+			steps[next] = steps[tile] + 1;
+			queue[tail++] = next;
+		}
+	}
+}
+
+/**
+ * Find the connections of the road tiles of a region.
+ * Tiles are connected when both have road bits towards each other, whatever their road types, one-way state or owners,
+ * so every move a road vehicle can make is a connection.
+ * @param rtt The road/tram type.
+ * @param region_index The region index.
+ * @param region[out] The region to fill.
+ */
+static void UpdateRoadRegion(RoadTramType rtt, uint region_index, RoadRegion &region)
+{
+	region.valid = true;
+	region.tiles.clear();
+	region.portals.clear();
+
+	const TileIndex base = GetRoadRegionBaseTile(region_index);
+	RoadBits bits[ROAD_REGION_TILES];
+	bool has_road = false;
+	for (uint i = 0; i < ROAD_REGION_TILES; i++) {
+		bits[i] = GetAnyRoadBits(base + TileXY(i % ROAD_REGION_SIZE, i / ROAD_REGION_SIZE), rtt, false);
+		if (bits[i] != ROAD_NONE) has_road = true;
+	}
+	if (!has_road) return;
+
+	region.tiles.resize(ROAD_REGION_TILES, 0);
+	for (uint i = 0; i < ROAD_REGION_TILES; i++) {
+		if (bits[i] == ROAD_NONE) continue;
+		region.tiles[i] = ROAD_REGION_TILE_HAS_ROAD;
+
+		const TileIndex tile = base + TileXY(i % ROAD_REGION_SIZE, i / ROAD_REGION_SIZE);
+		std::vector<std::pair<TileIndex, uint16>> links;
+		for (DiagDirection dir = DIAGDIR_BEGIN; dir < DIAGDIR_END; dir++) {
+			if (!(bits[i] & DiagDirToRoadBits(dir))) continue;
+
+			TileIndexDiffC diff = TileIndexDiffCByDiagDir(dir);
+			const RoadBits back = DiagDirToRoadBits(ReverseDiagDir(dir));
+			int x = (i % ROAD_REGION_SIZE) + diff.x;
+			int y = (i / ROAD_REGION_SIZE) + diff.y;
+			if (IsInsideMM(x, 0, ROAD_REGION_SIZE) && IsInsideMM(y, 0, ROAD_REGION_SIZE)) {
+				if (bits[(y << ROAD_REGION_SIZE_LOG) | x] & back) SetBit(region.tiles[i], dir);
+				continue;
+			}
+
+			int map_x = TileX(tile) + diff.x;
+			int map_y = TileY(tile) + diff.y;
+			if (!IsInsideMM(map_x, 0, MapSizeX()) || !IsInsideMM(map_y, 0, MapSizeY())) continue;
+			const TileIndex other = TileXY(map_x, map_y);
+			if (GetAnyRoadBits(other, rtt, false) & back) links.emplace_back(other, 1);
+		}
+		if (IsTileType(tile, MP_TUNNELBRIDGE)) {
+			const TileIndex other = GetOtherTunnelBridgeEnd(tile);
+			links.emplace_back(other, GetTunnelBridgeLength(tile, other) + 1);
+		}
+		if (links.empty()) continue;
+
+		region.portals.emplace_back();
+		region.portals.back().tile = i;
+		region.portals.back().links = std::move(links);
+	}
+
+	uint16 steps[ROAD_REGION_TILES];
+	for (RoadRegionPortal &portal : region.portals) {
+		CountRoadRegionSteps(region, { portal.tile }, steps);
+		for (const RoadRegionPortal &other : region.portals) {
+			if (&other != &portal && steps[other.tile] != ROAD_REGION_UNREACHED) portal.intra.emplace_back(other.tile, steps[other.tile]);
+		}
+	}
+}
+
+/**
+ * Get a road region, updating it when needed.
+ * @param rtt The road/tram type.
+ * @param region_index The region index.
+ * @return The region.
+ */
+static const RoadRegion &GetRoadRegion(RoadTramType rtt, uint region_index)
+{
+	RoadRegion &region = _road_regions[rtt][region_index];
+	if (!region.valid) UpdateRoadRegion(rtt, region_index, region);
+	return region;
+}
+
+/**
+ * Get the indices within a region of those destination tiles which are in the region.
+ * @param dest_tiles The destination tiles.
+ * @param region_index The region index.
+ * @return The tile indices.
+ */
+static std::vector<uint8> GetRoadRegionDestinations(const std::vector<TileIndex> &dest_tiles, uint region_index)
+{
+	std::vector<uint8> result;
+	for (TileIndex tile : dest_tiles) {
+		if (GetRoadRegionIndex(tile) == region_index) result.push_back(GetRoadRegionTileIndex(tile));
+	}
+	return result;
+}
+
+/**
+ * Start the search with the portals which are reachable from the destination tiles within their region.
+ */
+void RoadRegionDistanceField::Seed()
+{
+	std::vector<uint> regions;
+	for (TileIndex tile : this->dest_tiles) regions.push_back(GetRoadRegionIndex(tile));
+	std::sort(regions.begin(), regions.end());
+	regions.erase(std::unique(regions.begin(), regions.end()), regions.end());
+
+	uint16 steps[ROAD_REGION_TILES];
+	for (uint region_index : regions) {
+		const RoadRegion &region = GetRoadRegion(this->rtt, region_index);
+		std::vector<uint8> sources;
+		for (uint8 tile : GetRoadRegionDestinations(this->dest_tiles, region_index)) {
+			if (region.HasRoad(tile)) sources.push_back(tile);
+		}
+		if (sources.empty()) continue;
+
+		CountRoadRegionSteps(region, sources, steps);
+		for (const RoadRegionPortal &portal : region.portals) {
+			if (steps[portal.tile] == ROAD_REGION_UNREACHED) continue;
+			this->Push((region_index << (2 * ROAD_REGION_SIZE_LOG)) | portal.tile, steps[portal.tile] * ROAD_REGION_STEP_COST);
+		}
+	}
+}
+
+/**
+ * Offer a distance for a portal.
+ * @param id The portal ID.
+ * @param distance The distance.
+ */
+void RoadRegionDistanceField::Push(uint32 id, int distance)
+{
+	if (this->settled.find(id) != this->settled.end()) return;
+
+	auto iter = this->tentative.find(id);
+	if (iter != this->tentative.end()) {
+		if (iter->second <= distance) return;
+		iter->second = distance;
+	} else {
+		this->tentative.insert({ id, distance });
+	}
+	this->open.push({ distance, id });
+}
+
+/**
+ * Settle the nearest portal which has not been settled yet.
+ * @param[out] id The ID of the settled portal.
+ * @param[out] distance The distance of the settled portal.
+ * @return False if there are no portals left to settle.
+ */
+bool RoadRegionDistanceField::SettleNext(uint32 &id, int &distance)
+{
+	while (!this->open.empty()) {
+		const OpenItem item = this->open.top();
+		this->open.pop();
+
+		auto iter = this->tentative.find(item.second);
+		if (iter == this->tentative.end() || iter->second != item.first) continue;
+		this->tentative.erase(iter);
+		this->settled.insert({ item.second, item.first });
+
+		const uint region_index = item.second >> (2 * ROAD_REGION_SIZE_LOG);
+		const RoadRegion &region = GetRoadRegion(this->rtt, region_index);
+		const RoadRegionPortal *portal = region.GetPortal(GB(item.second, 0, 2 * ROAD_REGION_SIZE_LOG));
+		if (portal != nullptr) {
+			for (const auto &intra : portal->intra) {
+				this->Push((region_index << (2 * ROAD_REGION_SIZE_LOG)) | intra.first, item.first + intra.second * ROAD_REGION_STEP_COST);
+			}
+			for (const auto &link : portal->links) {
+				this->Push(GetRoadRegionPortalID(link.first), item.first + link.second * ROAD_REGION_STEP_COST);
+			}
+		}
+
+		id = item.second;
+		distance = item.first;
+		return true;
+	}
+	return false;
+}
+
+/**
+ * Settle all portals nearer than a distance.
+ * @param limit The distance.
+ */
+void RoadRegionDistanceField::SettleUntil(int limit)
+{
+	uint32 id;
+	int distance;
+	while (this->GetFrontier() < limit && this->SettleNext(id, distance)) {}
+}
+
+/**
+ * Get the distance field of a destination, creating it if needed.
+ * @param rtt The road/tram type.
+ * @param dest_tiles The destination tiles, sorted.
+ * @return The distance field.
+ */
+static RoadRegionDistanceField *GetRoadRegionDistanceField(RoadTramType rtt, const std::vector<TileIndex> &dest_tiles)
+{
+	auto &fields = _road_region_distance_fields;
+	for (auto iter = fields.begin(); iter != fields.end(); ++iter) {
+		if ((*iter)->rtt != rtt || (*iter)->dest_tiles != dest_tiles) continue;
+
+		/* Move to the back, as most recently used. */
+		std::rotate(iter, iter + 1, fields.end());
+		return fields.back().get();
+	}
+
+	if (fields.size() >= MAX_ROAD_REGION_DISTANCE_FIELDS) fields.erase(fields.begin());
+
+	RoadRegionDistanceField *field = new RoadRegionDistanceField();
+	field->rtt = rtt;
+	field->dest_tiles = dest_tiles;
+	field->Seed();
+	fields.emplace_back(field);
+	return field;
+}
+
+/**
+ * Prepare the estimates for a search.
+ * @param rtt The road/tram type of the vehicle.
+ * @param origin The tile the search starts at.
+ * @param dest_tiles The tiles any of which is the destination.
+ * @return True if the estimates are available, false if the destination is not reachable from the origin.
+ */
+bool RoadRegionEstimator::Setup(RoadTramType rtt, TileIndex origin, std::vector<TileIndex> dest_tiles)
+{
+	this->field = nullptr;
+	this->estimates.clear();
+
+	AllocateRoadRegions();
+
+	dest_tiles.erase(std::remove_if(dest_tiles.begin(), dest_tiles.end(), [](TileIndex tile) { return tile >= MapSize(); }), dest_tiles.end());
+	std::sort(dest_tiles.begin(), dest_tiles.end());
+	dest_tiles.erase(std::unique(dest_tiles.begin(), dest_tiles.end()), dest_tiles.end());
+	if (dest_tiles.empty() || origin >= MapSize()) return false;
+
+	const uint origin_region_index = GetRoadRegionIndex(origin);
+	const RoadRegion &origin_region = GetRoadRegion(rtt, origin_region_index);
+	if (!origin_region.HasRoad(GetRoadRegionTileIndex(origin))) return false;
+
+	RoadRegionDistanceField *field = GetRoadRegionDistanceField(rtt, dest_tiles);
+
+	/* Find the exact distance of the origin: settle portals until no unsettled portal can give a shorter distance. */
+	uint16 steps[ROAD_REGION_TILES];
+	CountRoadRegionSteps(origin_region, { (uint8)GetRoadRegionTileIndex(origin) }, steps);
+
+	int origin_distance = INT_MAX;
+	for (uint8 tile : GetRoadRegionDestinations(dest_tiles, origin_region_index)) {
+		if (steps[tile] != ROAD_REGION_UNREACHED) origin_distance = min(origin_distance, steps[tile] * ROAD_REGION_STEP_COST);
+	}
+	for (const RoadRegionPortal &portal : origin_region.portals) {
+		if (steps[portal.tile] == ROAD_REGION_UNREACHED) continue;
+		auto iter = field->settled.find((origin_region_index << (2 * ROAD_REGION_SIZE_LOG)) | portal.tile);
+		if (iter != field->settled.end()) origin_distance = min(origin_distance, steps[portal.tile] * ROAD_REGION_STEP_COST + iter->second);
+	}
+
+	uint32 id;
+	int distance;
+	while (field->GetFrontier() < origin_distance && field->SettleNext(id, distance)) {
+		if ((id >> (2 * ROAD_REGION_SIZE_LOG)) != origin_region_index) continue;
+		uint8 tile = GB(id, 0, 2 * ROAD_REGION_SIZE_LOG);
+		if (steps[tile] != ROAD_REGION_UNREACHED) origin_distance = min(origin_distance, steps[tile] * ROAD_REGION_STEP_COST + distance);
+	}
+	if (origin_distance == INT_MAX) return false;
+
+	/* Leave room for detours, and for the search to look around the origin. */
+	this->bound = origin_distance + origin_distance / 2 + 2 * ROAD_REGION_SIZE * ROAD_REGION_STEP_COST;
+	field->SettleUntil(this->bound);
+	this->field = field;
+	return true;
+}
+
+/**
+ * Get the estimates of all tiles of a region, computing them when needed.
+ * @param region_index The region index.
+ * @return The estimates, by tile index within the region.
+ */
+const std::vector<int> &RoadRegionEstimator::GetRegionEstimates(uint region_index)
+{
+	auto iter = this->estimates.find(region_index);
+	if (iter != this->estimates.end()) return iter->second;
+
+	std::vector<int> &result = this->estimates[region_index];
+	result.assign(ROAD_REGION_TILES, this->bound);
+
+	typedef std::pair<int, uint8> OpenItem;
+	std::priority_queue<OpenItem, std::vector<OpenItem>, std::greater<OpenItem>> open;
+	auto push = [&](uint8 tile, int distance) {
+		if (distance >= result[tile]) return;
+		result[tile] = distance;
+		open.push({ distance, tile });
+	};
+
+	const RoadRegion &region = GetRoadRegion(this->field->rtt, region_index);
+	for (uint8 tile : GetRoadRegionDestinations(this->field->dest_tiles, region_index)) {
+		if (region.HasRoad(tile)) push(tile, 0);
+	}
+	for (const RoadRegionPortal &portal : region.portals) {
+		auto settled = this->field->settled.find((region_index << (2 * ROAD_REGION_SIZE_LOG)) | portal.tile);
+		if (settled != this->field->settled.end()) push(portal.tile, settled->second);
+	}
+
+	while (!open.empty()) {
+		const OpenItem item = open.top();
+		open.pop();
+		if (item.first != result[item.second]) continue;
+
+		for (DiagDirection dir = DIAGDIR_BEGIN; dir < DIAGDIR_END; dir++) {
+			if (!HasBit(region.tiles[item.second], dir)) continue;
+			TileIndexDiffC diff = TileIndexDiffCByDiagDir(dir);
+			push(item.second + diff.y * ROAD_REGION_SIZE + diff.x, item.first + ROAD_REGION_STEP_COST);
+		}
+	}
+	return result;
+}
+
+/**
+ * Get the estimate of the remaining path cost from a tile.
+ * This is the shortest distance to the destination in the road region graph, capped at the bound of the search.
+ * @param tile The tile.
+ * @return The estimate.
+ */
+int RoadRegionEstimator::GetEstimate(TileIndex tile)
+{
+	assert(this->IsActive());
+	return this->GetRegionEstimates(GetRoadRegionIndex(tile))[GetRoadRegionTileIndex(tile)];
+}
+
+/**
+ * Mark the road regions which depend on the road of a tile as out of date.
+ * This has to be called whenever road is added to or removed from a tile, including road stops, depots, tunnels and bridges.
+ * @param tile The tile.
+ */
+void InvalidateRoadRegion(TileIndex tile)
+{
+	if (_road_regions_x != MapSizeX() >> ROAD_REGION_SIZE_LOG || _road_regions_y != MapSizeY() >> ROAD_REGION_SIZE_LOG) return;
+
+	auto invalidate = [](uint region_index) {
+		FOR_ALL_ROADTRAMTYPES(rtt) _road_regions[rtt][region_index].valid = false;
+	};
+	invalidate(GetRoadRegionIndex(tile));
+
+	/* Regions next to the tile have portals which depend on the road of the tile. */
+	for (DiagDirection dir = DIAGDIR_BEGIN; dir < DIAGDIR_END; dir++) {
+		TileIndexDiffC diff = TileIndexDiffCByDiagDir(dir);
+		int x = TileX(tile) + diff.x;
+		int y = TileY(tile) + diff.y;
+		if (IsInsideMM(x, 0, MapSizeX()) && IsInsideMM(y, 0, MapSizeY())) invalidate(GetRoadRegionIndex(TileXY(x, y)));
+	}
+
+	_road_region_distance_fields.clear();
+}
+
+/**
+ * Free all cached road regions.
+ */
+void ClearRoadRegions()
+{
+	FOR_ALL_ROADTRAMTYPES(rtt) {
+		_road_regions[rtt].clear();
+		_road_regions[rtt].shrink_to_fit();
+	}
+	_road_regions_x = 0;
+	_road_regions_y = 0;
+	_road_region_distance_fields.clear();
+}
+
+/**
+ * Find the cached road regions which are not marked as out of date but differ from the map.
+ * @param rtt The road/tram type.
+ * @return The indices of the regions.
+ */
+std::vector<uint> GetStaleRoadRegions(RoadTramType rtt)
+{
+	std::vector<uint> result;
+	if (_road_regions_x != MapSizeX() >> ROAD_REGION_SIZE_LOG || _road_regions_y != MapSizeY() >> ROAD_REGION_SIZE_LOG) return result;
+
+	for (uint i = 0; i < _road_regions[rtt].size(); i++) {
+		const RoadRegion &region = _road_regions[rtt][i];
+		if (!region.valid) continue;
+
+		RoadRegion current;
+		UpdateRoadRegion(rtt, i, current);
+		if (current.tiles != region.tiles || current.portals != region.portals) result.push_back(i);
+	}
+	return result;
+}
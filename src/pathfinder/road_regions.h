@@ -0,0 +1,62 @@
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file road_regions.h Region graph of the road network, used to estimate road vehicle path costs. */
+
+#ifndef ROAD_REGIONS_H
+#define ROAD_REGIONS_H
+
+#include "../tile_type.h"
+#include "../road.h"
+#include "../3rdparty/cpp-btree/btree_map.h"
+
+#include <vector>
+
+struct RoadRegionDistanceField;
+
+/**
+ * Lower bound of the cost of the remaining path of a road vehicle to its destination.
+ *
+ * The map is split into regions of #ROAD_REGION_SIZE by #ROAD_REGION_SIZE tiles.
+ * Each region caches which of its road tiles connect to each other, and its portals:
+ * the road tiles which connect to road tiles in other regions, or to the other end of a tunnel or bridge.
+ * Shortest distances from the portals to the destination are found with Dijkstra on the graph of portals,
+ * which is kept between searches for the same destination.
+ *
+ * The estimate is the shortest distance to the destination over any road, ignoring road types,
+ * one-way roads and penalties, so it is a consistent heuristic for YAPF.
+ * Estimates are capped at a bound derived from the distance of the origin,
+ * so only the part of the portal graph around the route has to be searched.
+ * The estimates only depend on the map, not on which searches were done before.
+ */
+class RoadRegionEstimator {
+	RoadRegionDistanceField *field = nullptr;           ///< Portal distances to the destination, or nullptr if not active.
+	int bound = 0;                                      ///< Cap of the estimates; all portals nearer than this have their exact distance.
+	btree::btree_map<uint, std::vector<int>> estimates; ///< Estimates of the tiles of each region looked at, by region index.
+
+	const std::vector<int> &GetRegionEstimates(uint region_index);
+
+public:
+	bool Setup(RoadTramType rtt, TileIndex origin, std::vector<TileIndex> dest_tiles);
+
+	/**
+	 * Whether region estimates are available for the current search.
+	 * @return True if #GetEstimate can be used.
+	 */
+	inline bool IsActive() const { return this->field != nullptr; }
+
+	int GetEstimate(TileIndex tile);
+};
+
+static const uint ROAD_REGION_SIZE_LOG = 4;                       ///< Log2 of the width and height of a road region.
+static const uint ROAD_REGION_SIZE     = 1 << ROAD_REGION_SIZE_LOG; ///< Width and height of a road region in tiles.
+
+void InvalidateRoadRegion(TileIndex tile);
+void ClearRoadRegions();
+std::vector<uint> GetStaleRoadRegions(RoadTramType rtt);
+
+#endif /* ROAD_REGIONS_H */
@@ -0,0 +1,716 @@
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file water_regions.cpp Region graph of the waterways, used to prune and estimate ship path searches. */
+
+#include "../stdafx.h"
+#include "water_regions.h"
+#include "pathfinder_type.h"
+#include "../map_func.h"
+#include "../landscape.h"
+#include "../track_func.h"
+#include "../tunnelbridge_map.h"
+#include "../tunnelbridge.h"
+
+#include <algorithm>
+#include <memory>
+#include <numeric>
+#include <queue>
+
+#include "../safeguards.h"
+
+static const uint WATER_REGION_TILES = WATER_REGION_SIZE * WATER_REGION_SIZE; ///< Number of tiles in a water region.
+static const uint8 WATER_REGION_TILE_HAS_WATER = 1 << DIAGDIR_END;          ///< Flag of WaterRegion::tiles for a tile with water tracks.
+static const uint16 WATER_REGION_UNREACHED = UINT16_MAX;                    ///< Number of steps of a tile which was not reached.
+static const int WATER_REGION_STEP_COST = YAPF_TILE_CORNER_LENGTH;          ///< Lower bound of the path cost of entering a tile.
+static const uint MAX_WATER_REGION_DISTANCE_FIELDS = 16;                    ///< Number of destinations to keep portal distances of.
+
+/** Water tile of a region which connects to a water tile in another region, or to the other end of an aqueduct. */
+struct WaterRegionPortal {
+	uint8 tile;                                     ///< Index of the tile within the region.
+	std::vector<std::pair<uint8, uint16>> intra;    ///< Other portals of the region reachable within the region: tile index, number of steps.
+	std::vector<std::pair<TileIndex, uint16>> links; ///< Water tiles outside of the region the portal connects to, or aqueduct ends: tile, number of steps.
+
+	bool operator==(const WaterRegionPortal &other) const
+	{
+		return this->tile == other.tile && this->intra == other.intra && this->links == other.links;
+	}
+};
+
+/** Cached connectivity of the water tiles in a region. */
+struct WaterRegion {
+	bool valid = false;                     ///< Whether the cached data is up to date.
+	std::vector<uint8> tiles;               ///< Per tile: bits of the directions of connected tiles within the region, and #WATER_REGION_TILE_HAS_WATER. Empty when the region has no water.
+	std::vector<uint8> patches;             ///< Per tile: 1-based index of the set of connected tiles within the region it belongs to, or 0. Empty when the region has no water.
+	uint8 patch_count = 0;                  ///< Number of sets of connected tiles within the region.
+	uint32 first_patch = 0;                 ///< Index of the first patch of the region in #_water_components.
+	std::vector<WaterRegionPortal> portals; ///< Portals of the region, sorted by tile index.
+
+	/**
+	 * Get the portal at a tile of the region.
+	 * @param tile Index of the tile within the region.
+	 * @return The portal, or nullptr if the tile is not a portal.
+	 */
+	const WaterRegionPortal *GetPortal(uint8 tile) const
+	{
+		auto iter = std::lower_bound(this->portals.begin(), this->portals.end(), tile, [](const WaterRegionPortal &portal, uint8 tile) {
+			return portal.tile < tile;
+		});
+		return (iter != this->portals.end() && iter->tile == tile) ? &(*iter) : nullptr;
+	}
+
+	/**
+	 * Check whether a tile of the region has water tracks.
+	 * @param tile Index of the tile within the region.
+	 * @return True if the tile has water tracks.
+	 */
+	inline bool HasWater(uint tile) const
+	{
+		return !this->tiles.empty() && (this->tiles[tile] & WATER_REGION_TILE_HAS_WATER) != 0;
+	}
+};
+
+/** Distances from portals to a destination, found by Dijkstra, which can be continued later. */
+struct WaterRegionDistanceField {
+	typedef std::pair<int, uint32> OpenItem; ///< Distance and portal ID.
+
+	std::vector<TileIndex> dest_tiles;       ///< Destination tiles, sorted.
+	btree::btree_map<uint32, int> settled;   ///< Exact distances of the settled portals, by portal ID.
+	btree::btree_map<uint32, int> tentative; ///< Best distances found so far of the other portals, by portal ID.
+	std::priority_queue<OpenItem, std::vector<OpenItem>, std::greater<OpenItem>> open; ///< Portals to settle.
+
+	void Seed();
+	void Push(uint32 id, int distance);
+	bool SettleNext(uint32 &id, int &distance);
+	void SettleUntil(int limit);
+
+	/**
+	 * Get the lower bound of the distances of the portals which have not been settled.
+	 * @return The distance.
+	 */
+	inline int GetFrontier() const
+	{
+		return this->open.empty() ? INT_MAX : this->open.top().first;
+	}
+};
+
+static std::vector<WaterRegion> _water_regions;     ///< Cached water regions.
+static uint _water_regions_x = 0;                   ///< Number of water regions along the x axis.
+static uint _water_regions_y = 0;                   ///< Number of water regions along the y axis.
+static std::vector<WaterComponentID> _water_components; ///< Component of each patch of all regions, indexed by WaterRegion::first_patch.
+static bool _water_components_valid = false;        ///< Whether #_water_components is up to date.
+static std::vector<std::unique_ptr<WaterRegionDistanceField>> _water_region_distance_fields; ///< Distance fields, least recently used first.
+
+/**
+ * Get the index of the water region of a tile.
+ * @param tile The tile.
+ * @return The region index.
+ */
+static inline uint GetWaterRegionIndex(TileIndex tile)
+{
+	return (TileY(tile) >> WATER_REGION_SIZE_LOG) * _water_regions_x + (TileX(tile) >> WATER_REGION_SIZE_LOG);
+}
+
+/**
+ * Get the index of a tile within its water region.
+ * @param tile The tile.
+ * @return The index of the tile within the region.
+ */
+static inline uint GetWaterRegionTileIndex(TileIndex tile)
+{
+	return ((TileY(tile) & (WATER_REGION_SIZE - 1)) << WATER_REGION_SIZE_LOG) | (TileX(tile) & (WATER_REGION_SIZE - 1));
+}
+
+/**
+ * Get the ID of a portal, which is unique over all regions.
+ * @param tile The tile of the portal.
+ * @return The portal ID.
+ */
+static inline uint32 GetWaterRegionPortalID(TileIndex tile)
+{
+	return (GetWaterRegionIndex(tile) << (2 * WATER_REGION_SIZE_LOG)) | GetWaterRegionTileIndex(tile);
+}
+
+/**
+ * Get the tile of the top corner of a water region.
+ * @param region_index The region index.
+ * @return The tile.
+ */
+static inline TileIndex GetWaterRegionBaseTile(uint region_index)
+{
+	return TileXY((region_index % _water_regions_x) << WATER_REGION_SIZE_LOG, (region_index / _water_regions_x) << WATER_REGION_SIZE_LOG);
+}
+
+/**
+ * Check whether the water regions are allocated for the current map size.
+ * @return True if they are.
+ */
+static inline bool AreWaterRegionsAllocated()
+{
+	return _water_regions_x == MapSizeX() >> WATER_REGION_SIZE_LOG && _water_regions_y == MapSizeY() >> WATER_REGION_SIZE_LOG;
+}
+
+/**
+ * Allocate the water regions for the current map size, if not done yet.
+ */
+static void AllocateWaterRegions()
+{
+	if (AreWaterRegionsAllocated()) return;
+
+	ClearWaterRegions();
+	_water_regions_x = MapSizeX() >> WATER_REGION_SIZE_LOG;
+	_water_regions_y = MapSizeY() >> WATER_REGION_SIZE_LOG;
+	_water_regions.resize(_water_regions_x * _water_regions_y);
+}
+
+/**
+ * Get the directions in which a ship can leave and enter a tile.
+ * Aqueduct ramps can not be left or entered towards the bridge; the other end of the aqueduct is a portal link instead.
+ * @param tile The tile.
+ * @param[out] exits Bits of the directions in which ships can leave the tile.
+ * @param[out] entries Bits of the directions in which ships can move into the tile.
+ */
+static void GetWaterTileDirections(TileIndex tile, uint8 &exits, uint8 &entries)
+{
+	exits = 0;
+	entries = 0;
+
+	const TrackdirBits trackdirs = TrackStatusToTrackdirBits(GetTileTrackStatus(tile, TRANSPORT_WATER, 0));
+	if (trackdirs == TRACKDIR_BIT_NONE) return;
+
+	for (DiagDirection dir = DIAGDIR_BEGIN; dir < DIAGDIR_END; dir++) {
+		if (trackdirs & DiagdirReachesTrackdirs(dir)) SetBit(entries, dir);
+	}
+	for (TrackdirBits remaining = trackdirs; remaining != TRACKDIR_BIT_NONE;) {
+		SetBit(exits, TrackdirToExitdir(RemoveFirstTrackdir(&remaining)));
+	}
+
+	if (IsTileType(tile, MP_TUNNELBRIDGE) && GetTunnelBridgeTransportType(tile) == TRANSPORT_WATER) {
+		const DiagDirection dir = GetTunnelBridgeDirection(tile);
+		ClrBit(exits, dir);
+		ClrBit(entries, ReverseDiagDir(dir));
+	}
+}
+
+/**
+ * Check whether a ship can move between two neighbouring tiles, in any direction.
+ * @param exits_a Exit directions of the first tile.
+ * @param entries_a Entry directions of the first tile.
+ * @param exits_b Exit directions of the second tile.
+ * @param entries_b Entry directions of the second tile.
+ * @param dir The direction from the first tile to the second tile.
+ * @return True if the tiles are connected.
+ */
+static inline bool AreWaterTilesConnected(uint8 exits_a, uint8 entries_a, uint8 exits_b, uint8 entries_b, DiagDirection dir)
+{
+	const DiagDirection back = ReverseDiagDir(dir);
+	return (HasBit(exits_a, dir) && HasBit(entries_b, dir)) || (HasBit(exits_b, back) && HasBit(entries_a, back));
+}
+
+/**
+ * Count the steps from a set of tiles to all tiles of a region, without leaving the region.
+ * @param region The region.
+ * @param sources Indices of the tiles to start from.
+ * @param[out] steps Per tile index, the number of steps or #WATER_REGION_UNREACHED.
+ */
+static void CountWaterRegionSteps(const WaterRegion &region, const std::vector<uint8> &sources, uint16 steps[WATER_REGION_TILES])
+{
+	std::fill(steps, steps + WATER_REGION_TILES, WATER_REGION_UNREACHED);
+
+	uint8 queue[WATER_REGION_TILES];
+	uint head = 0;
+	uint tail = 0;
+	for (uint8 source : sources) {
+		if (steps[source] == WATER_REGION_UNREACHED) {
+			steps[source] = 0;
+			queue[tail++] = source;
+		}
+	}
+
+	while (head != tail) {
+		uint8 tile = queue[head++];
+		for (DiagDirection dir = DIAGDIR_BEGIN; dir < DIAGDIR_END; dir++) {
+			if (!HasBit(region.tiles[tile], dir)) continue;
+			TileIndexDiffC diff = TileIndexDiffCByDiagDir(dir);
+			uint8 next = tile + diff.y * WATER_REGION_SIZE + diff.x;
+			if (steps[next] != WATER_REGION_UNREACHED) continue;
+			steps[next] = steps[tile] + 1;
+			queue[tail++] = next;
+		}
+	}
+}
+
+/**
+ * Find the connections of the water tiles of a region.
+ * Tiles are connected when a ship can move from one to the other in either direction,
+ * ignoring which tracks of a tile connect to each other, so every move a ship can make is a connection.
+ * @param region_index The region index.
+ * @param region[out] The region to fill.
+ */
+static void UpdateWaterRegion(uint region_index, WaterRegion &region)
+{
+	region.valid = true;
+	region.tiles.clear();
+	region.patches.clear();
+	region.patch_count = 0;
+	region.portals.clear();
+
+	const TileIndex base = GetWaterRegionBaseTile(region_index);
+	uint8 exits[WATER_REGION_TILES];
+	uint8 entries[WATER_REGION_TILES];
+	bool has_water = false;
+	for (uint i = 0; i < WATER_REGION_TILES; i++) {
+		GetWaterTileDirections(base + TileXY(i % WATER_REGION_SIZE, i / WATER_REGION_SIZE), exits[i], entries[i]);
+		if ((exits[i] | entries[i]) != 0) has_water = true;
+	}
+	if (!has_water) return;
+
+	region.tiles.resize(WATER_REGION_TILES, 0);
+	for (uint i = 0; i < WATER_REGION_TILES; i++) {
+		if ((exits[i] | entries[i]) == 0) continue;
+		region.tiles[i] = WATER_REGION_TILE_HAS_WATER;
+
+		const TileIndex tile = base + TileXY(i % WATER_REGION_SIZE, i / WATER_REGION_SIZE);
+		std::vector<std::pair<TileIndex, uint16>> links;
+		for (DiagDirection dir = DIAGDIR_BEGIN; dir < DIAGDIR_END; dir++) {
+			TileIndexDiffC diff = TileIndexDiffCByDiagDir(dir);
+			int x = (i % WATER_REGION_SIZE) + diff.x;
+			int y = (i / WATER_REGION_SIZE) + diff.y;
+			if (IsInsideMM(x, 0, WATER_REGION_SIZE) && IsInsideMM(y, 0, WATER_REGION_SIZE)) {
+				const uint j = (y << WATER_REGION_SIZE_LOG) | x;
+				if (AreWaterTilesConnected(exits[i], entries[i], exits[j], entries[j], dir)) SetBit(region.tiles[i], dir);
+				continue;
+			}
+
+			int map_x = TileX(tile) + diff.x;
+			int map_y = TileY(tile) + diff.y;
+			if (!IsInsideMM(map_x, 0, MapSizeX()) || !IsInsideMM(map_y, 0, MapSizeY())) continue;
+			const TileIndex other = TileXY(map_x, map_y);
+			uint8 other_exits, other_entries;
+			GetWaterTileDirections(other, other_exits, other_entries);
+			if (AreWaterTilesConnected(exits[i], entries[i], other_exits, other_entries, dir)) links.emplace_back(other, 1);
+		}
+		if (IsTileType(tile, MP_TUNNELBRIDGE) && GetTunnelBridgeTransportType(tile) == TRANSPORT_WATER) {
+			const TileIndex other = GetOtherTunnelBridgeEnd(tile);
+			links.emplace_back(other, GetTunnelBridgeLength(tile, other) + 1);
+		}
+		if (links.empty()) continue;
+
+		region.portals.emplace_back();
+		region.portals.back().tile = i;
+		region.portals.back().links = std::move(links);
+	}
+
+	uint16 steps[WATER_REGION_TILES];
+	region.patches.resize(WATER_REGION_TILES, 0);
+	for (uint i = 0; i < WATER_REGION_TILES; i++) {
+		if (!region.HasWater(i) || region.patches[i] != 0) continue;
+		region.patch_count++;
+		CountWaterRegionSteps(region, { (uint8)i }, steps);
+		for (uint j = i; j < WATER_REGION_TILES; j++) {
+			if (steps[j] != WATER_REGION_UNREACHED) region.patches[j] = region.patch_count;
+		}
+	}
+
+	for (WaterRegionPortal &portal : region.portals) {
+		CountWaterRegionSteps(region, { portal.tile }, steps);
+		for (const WaterRegionPortal &other : region.portals) {
+			if (&other != &portal && steps[other.tile] != WATER_REGION_UNREACHED) portal.intra.emplace_back(other.tile, steps[other.tile]);
+		}
+	}
+}
+
+/**
+ * Get a water region, updating it when needed.
+ * @param region_index The region index.
+ * @return The region.
+ */
+static const WaterRegion &GetWaterRegion(uint region_index)
+{
+	WaterRegion &region = _water_regions[region_index];
+	if (!region.valid) UpdateWaterRegion(region_index, region);
+	return region;
+}
+
+/**
+ * Find the connected components of all water tiles, by joining the patches of the regions along the portal links.
+ * Only regions which are out of date are scanned again.
+ */
+static void UpdateWaterComponents()
+{
+	uint32 patch_count = 0;
+	for (uint i = 0; i < _water_regions.size(); i++) {
+		GetWaterRegion(i);
+		_water_regions[i].first_patch = patch_count;
+		patch_count += _water_regions[i].patch_count;
+	}
+
+	std::vector<uint32> parent(patch_count);
+	std::iota(parent.begin(), parent.end(), 0);
+	auto find = [&](uint32 patch) -> uint32 {
+		while (parent[patch] != patch) {
+			parent[patch] = parent[parent[patch]];
+			patch = parent[patch];
+		}
+		return patch;
+	};
+
+	for (const WaterRegion &region : _water_regions) {
+		for (const WaterRegionPortal &portal : region.portals) {
+			for (const auto &link : portal.links) {
+				const WaterRegion &other = _water_regions[GetWaterRegionIndex(link.first)];
+				const uint8 other_patch = other.patches.empty() ? 0 : other.patches[GetWaterRegionTileIndex(link.first)];
+				if (other_patch == 0) continue;
+
+				/* Keep the lowest patch as root, so a component is identified by its first patch. */
+				const uint32 a = find(region.first_patch + region.patches[portal.tile] - 1);
+				const uint32 b = find(other.first_patch + other_patch - 1);
+				if (a != b) parent[max(a, b)] = min(a, b);
+			}
+		}
+	}
+
+	_water_components.resize(patch_count);
+	for (uint32 i = 0; i < patch_count; i++) _water_components[i] = find(i);
+	_water_components_valid = true;
+}
+
+/**
+ * Get the connected component of the water tracks of a tile.
+ * Ships can only travel between tiles with the same component.
+ * @param tile The tile.
+ * @return The component, or #INVALID_WATER_COMPONENT if the tile has no water tracks.
+ */
+WaterComponentID GetWaterComponentID(TileIndex tile)
+{
+	AllocateWaterRegions();
+	if (!_water_components_valid) UpdateWaterComponents();
+
+	const WaterRegion &region = _water_regions[GetWaterRegionIndex(tile)];
+	if (!region.HasWater(GetWaterRegionTileIndex(tile))) return INVALID_WATER_COMPONENT;
+	return _water_components[region.first_patch + region.patches[GetWaterRegionTileIndex(tile)] - 1];
+}
+
+/**
+ * Check whether a ship at a tile may be able to reach any of a set of tiles.
+ * @param origin The tile of the ship.
+ * @param dest_tiles The destination tiles.
+ * @return False if none of the destination tiles is connected to the origin, true if one is or if the origin has no water tracks.
+ */
+bool IsAnyWaterTileReachable(TileIndex origin, const std::vector<TileIndex> &dest_tiles)
+{
+	const WaterComponentID component = GetWaterComponentID(origin);
+	if (component == INVALID_WATER_COMPONENT) return true;
+
+	for (TileIndex tile : dest_tiles) {
+		if (tile < MapSize() && GetWaterComponentID(tile) == component) return true;
+	}
+	return false;
+}
+
+/**
+ * Get the indices within a region of those destination tiles which are in the region.
+ * @param dest_tiles The destination tiles.
+ * @param region_index The region index.
+ * @return The tile indices.
+ */
+static std::vector<uint8> GetWaterRegionDestinations(const std::vector<TileIndex> &dest_tiles, uint region_index)
+{
+	std::vector<uint8> result;
+	for (TileIndex tile : dest_tiles) {
+		if (GetWaterRegionIndex(tile) == region_index) result.push_back(GetWaterRegionTileIndex(tile));
+	}
+	return result;
+}
+
+/**
+ * Start the search with the portals which are reachable from the destination tiles within their region.
+ */
+void WaterRegionDistanceField::Seed()
+{
+	std::vector<uint> regions;
+	for (TileIndex tile : this->dest_tiles) regions.push_back(GetWaterRegionIndex(tile));
+	std::sort(regions.begin(), regions.end());
+	regions.erase(std::unique(regions.begin(), regions.end()), regions.end());
+
+	uint16 steps[WATER_REGION_TILES];
+	for (uint region_index : regions) {
+		const WaterRegion &region = GetWaterRegion(region_index);
+		std::vector<uint8> sources;
+		for (uint8 tile : GetWaterRegionDestinations(this->dest_tiles, region_index)) {
+			if (region.HasWater(tile)) sources.push_back(tile);
+		}
+		if (sources.empty()) continue;
+
+		CountWaterRegionSteps(region, sources, steps);
+		for (const WaterRegionPortal &portal : region.portals) {
+			if (steps[portal.tile] == WATER_REGION_UNREACHED) continue;
+			this->Push((region_index << (2 * WATER_REGION_SIZE_LOG)) | portal.tile, steps[portal.tile] * WATER_REGION_STEP_COST);
+		}
+	}
+}
+
+/**
+ * Offer a distance for a portal.
+ * @param id The portal ID.
+ * @param distance The distance.
+ */
+void WaterRegionDistanceField::Push(uint32 id, int distance)
+{
+	if (this->settled.find(id) != this->settled.end()) return;
+
+	auto iter = this->tentative.find(id);
+	if (iter != this->tentative.end()) {
+		if (iter->second <= distance) return;
+		iter->second = distance;
+	} else {
+		this->tentative.insert({ id, distance });
+	}
+	this->open.push({ distance, id });
+}
+
+/**
+ * Settle the nearest portal which has not been settled yet.
+ * @param[out] id The ID of the settled portal.
+ * @param[out] distance The distance of the settled portal.
+ * @return False if there are no portals left to settle.
+ */
+bool WaterRegionDistanceField::SettleNext(uint32 &id, int &distance)
+{
+	while (!this->open.empty()) {
+		const OpenItem item = this->open.top();
+		this->open.pop();
+
+		auto iter = this->tentative.find(item.second);
+		if (iter == this->tentative.end() || iter->second != item.first) continue;
+		this->tentative.erase(iter);
+		this->settled.insert({ item.second, item.first });
+
+		const uint region_index = item.second >> (2 * WATER_REGION_SIZE_LOG);
+		const WaterRegion &region = GetWaterRegion(region_index);
+		const WaterRegionPortal *portal = region.GetPortal(GB(item.second, 0, 2 * WATER_REGION_SIZE_LOG));
+		if (portal != nullptr) {
+			for (const auto &intra : portal->intra) {
+				this->Push((region_index << (2 * WATER_REGION_SIZE_LOG)) | intra.first, item.first + intra.second * WATER_REGION_STEP_COST);
+			}
+			for (const auto &link : portal->links) {
+				this->Push(GetWaterRegionPortalID(link.first), item.first + link.second * WATER_REGION_STEP_COST);
+			}
+		}
+
+		id = item.second;
+		distance = item.first;
+		return true;
+	}
+	return false;
+}
+
+/**
+ * Settle all portals nearer than a distance.
+ * @param limit The distance.
+ */
+void WaterRegionDistanceField::SettleUntil(int limit)
+{
+	uint32 id;
+	int distance;
+	while (this->GetFrontier() < limit && this->SettleNext(id, distance)) {}
+}
+
+/**
+ * Get the distance field of a destination, creating it if needed.
+ * @param dest_tiles The destination tiles, sorted.
+ * @return The distance field.
+ */
+static WaterRegionDistanceField *GetWaterRegionDistanceField(const std::vector<TileIndex> &dest_tiles)
+{
+	auto &fields = _water_region_distance_fields;
+	for (auto iter = fields.begin(); iter != fields.end(); ++iter) {
+		if ((*iter)->dest_tiles != dest_tiles) continue;
+
+		/* Move to the back, as most recently used. */
+		std::rotate(iter, iter + 1, fields.end());
+		return fields.back().get();
+	}
+
+	if (fields.size() >= MAX_WATER_REGION_DISTANCE_FIELDS) fields.erase(fields.begin());
+
+	WaterRegionDistanceField *field = new WaterRegionDistanceField();
+	field->dest_tiles = dest_tiles;
+	field->Seed();
+	fields.emplace_back(field);
+	return field;
+}
+
+/**
+ * Prepare the estimates for a search.
+ * @param origin The tile the search starts at.
+ * @param dest_tiles The tiles any of which is the destination.
+ * @return True if the estimates are available, false if the destination is not reachable from the origin.
+ */
+bool WaterRegionEstimator::Setup(TileIndex origin, std::vector<TileIndex> dest_tiles)
+{
+	this->field = nullptr;
+	this->estimates.clear();
+
+	AllocateWaterRegions();
+
+	dest_tiles.erase(std::remove_if(dest_tiles.begin(), dest_tiles.end(), [](TileIndex tile) { return tile >= MapSize(); }), dest_tiles.end());
+	std::sort(dest_tiles.begin(), dest_tiles.end());
+	dest_tiles.erase(std::unique(dest_tiles.begin(), dest_tiles.end()), dest_tiles.end());
+	if (dest_tiles.empty() || origin >= MapSize()) return false;
+
+	const uint origin_region_index = GetWaterRegionIndex(origin);
+	const WaterRegion &origin_region = GetWaterRegion(origin_region_index);
+	if (!origin_region.HasWater(GetWaterRegionTileIndex(origin))) return false;
+	if (!IsAnyWaterTileReachable(origin, dest_tiles)) return false;
+
+	WaterRegionDistanceField *field = GetWaterRegionDistanceField(dest_tiles);
+
+	/* Find the exact distance of the origin: settle portals until no unsettled portal can give a shorter distance. */
+	uint16 steps[WATER_REGION_TILES];
+	CountWaterRegionSteps(origin_region, { (uint8)GetWaterRegionTileIndex(origin) }, steps);
+
+	int origin_distance = INT_MAX;
+	for (uint8 tile : GetWaterRegionDestinations(dest_tiles, origin_region_index)) {
+		if (steps[tile] != WATER_REGION_UNREACHED) origin_distance = min(origin_distance, steps[tile] * WATER_REGION_STEP_COST);
+	}
+	for (const WaterRegionPortal &portal : origin_region.portals) {
+		if (steps[portal.tile] == WATER_REGION_UNREACHED) continue;
+		auto iter = field->settled.find((origin_region_index << (2 * WATER_REGION_SIZE_LOG)) | portal.tile);
+		if (iter != field->settled.end()) origin_distance = min(origin_distance, steps[portal.tile] * WATER_REGION_STEP_COST + iter->second);
+	}
+
+	uint32 id;
+	int distance;
+	while (field->GetFrontier() < origin_distance && field->SettleNext(id, distance)) {
+		if ((id >> (2 * WATER_REGION_SIZE_LOG)) != origin_region_index) continue;
+		uint8 tile = GB(id, 0, 2 * WATER_REGION_SIZE_LOG);
+		if (steps[tile] != WATER_REGION_UNREACHED) origin_distance = min(origin_distance, steps[tile] * WATER_REGION_STEP_COST + distance);
+	}
+	if (origin_distance == INT_MAX) return false;
+
+	/* Leave room for detours, and for the search to look around the origin. */
+	this->bound = origin_distance + origin_distance / 2 + 2 * WATER_REGION_SIZE * WATER_REGION_STEP_COST;
+	field->SettleUntil(this->bound);
+	this->field = field;
+	return true;
+}
+
+/**
+ * Get the estimates of all tiles of a region, computing them when needed.
+ * @param region_index The region index.
+ * @return The estimates, by tile index within the region.
+ */
+const std::vector<int> &WaterRegionEstimator::GetRegionEstimates(uint region_index)
+{
+	auto iter = this->estimates.find(region_index);
+	if (iter != this->estimates.end()) return iter->second;
+
+	std::vector<int> &result = this->estimates[region_index];
+	result.assign(WATER_REGION_TILES, this->bound);
+
+	typedef std::pair<int, uint8> OpenItem;
+	std::priority_queue<OpenItem, std::vector<OpenItem>, std::greater<OpenItem>> open;
+	auto push = [&](uint8 tile, int distance) {
+		if (distance >= result[tile]) return;
+		result[tile] = distance;
+		open.push({ distance, tile });
+	};
+
+	const WaterRegion &region = GetWaterRegion(region_index);
+	for (uint8 tile : GetWaterRegionDestinations(this->field->dest_tiles, region_index)) {
+		if (region.HasWater(tile)) push(tile, 0);
+	}
+	for (const WaterRegionPortal &portal : region.portals) {
+		auto settled = this->field->settled.find((region_index << (2 * WATER_REGION_SIZE_LOG)) | portal.tile);
+		if (settled != this->field->settled.end()) push(portal.tile, settled->second);
+	}
+
+	while (!open.empty()) {
+		const OpenItem item = open.top();
+		open.pop();
+		if (item.first != result[item.second]) continue;
+
+		for (DiagDirection dir = DIAGDIR_BEGIN; dir < DIAGDIR_END; dir++) {
+			if (!HasBit(region.tiles[item.second], dir)) continue;
+			TileIndexDiffC diff = TileIndexDiffCByDiagDir(dir);
+			push(item.second + diff.y * WATER_REGION_SIZE + diff.x, item.first + WATER_REGION_STEP_COST);
+		}
+	}
+	return result;
+}
+
+/**
+ * Get the estimate of the remaining path cost from a tile.
+ * This is the shortest distance to the destination in the water region graph, capped at the bound of the search.
+ * @param tile The tile.
+ * @return The estimate.
+ */
+int WaterRegionEstimator::GetEstimate(TileIndex tile)
+{
+	assert(this->IsActive());
+	return this->GetRegionEstimates(GetWaterRegionIndex(tile))[GetWaterRegionTileIndex(tile)];
+}
+
+/**
+ * Mark the water regions which depend on the water tracks of a tile as out of date.
+ * This has to be called whenever water tracks appear on or disappear from a tile,
+ * including flooding, canals, rivers, locks, depots, docks, buoys and aqueducts.
+ * @param tile The tile.
+ */
+void InvalidateWaterRegion(TileIndex tile)
+{
+	if (!AreWaterRegionsAllocated()) return;
+
+	_water_regions[GetWaterRegionIndex(tile)].valid = false;
+
+	/* Regions next to the tile have portals which depend on the water of the tile. */
+	for (DiagDirection dir = DIAGDIR_BEGIN; dir < DIAGDIR_END; dir++) {
+		TileIndexDiffC diff = TileIndexDiffCByDiagDir(dir);
+		int x = TileX(tile) + diff.x;
+		int y = TileY(tile) + diff.y;
+		if (IsInsideMM(x, 0, MapSizeX()) && IsInsideMM(y, 0, MapSizeY())) _water_regions[GetWaterRegionIndex(TileXY(x, y))].valid = false;
+	}
+
+	_water_components_valid = false;
+	_water_region_distance_fields.clear();
+}
+
+/**
+ * Free all cached water regions.
+ */
+void ClearWaterRegions()
+{
+	_water_regions.clear();
+	_water_regions.shrink_to_fit();
+	_water_regions_x = 0;
+	_water_regions_y = 0;
+	_water_components.clear();
+	_water_components.shrink_to_fit();
+	_water_components_valid = false;
+	_water_region_distance_fields.clear();
+}
+
+/**
+ * Find the cached water regions which are not marked as out of date but differ from the map.
+ * @return The indices of the regions.
+ */
+std::vector<uint> GetStaleWaterRegions()
+{
+	std::vector<uint> result;
+	if (!AreWaterRegionsAllocated()) return result;
+
+	for (uint i = 0; i < _water_regions.size(); i++) {
+		const WaterRegion &region = _water_regions[i];
+		if (!region.valid) continue;
+
+		WaterRegion current;
+		UpdateWaterRegion(i, current);
+		if (current.tiles != region.tiles || current.patches != region.patches || current.portals != region.portals) result.push_back(i);
+	}
+	return result;
+}
@@ -10,60 +10,300 @@
 #ifndef NODELIST_HPP
 #define NODELIST_HPP
 
-#include "../../misc/array.hpp"
-#include "../../misc/hashtable.hpp"
+#include "../../misc/str.hpp"
 #include "../../misc/binaryheap.hpp"
+#include "../../core/alloc_func.hpp"
+
+#include <memory>
+#include <vector>
+
+/**
+ * Storage of the nodes, hash slots and priority queue of a node list, kept between searches.
+ *  Node lists take an arena from a per-thread pool when they are constructed and
+ *  give it back when they are destroyed, so the next search reuses the memory
+ *  instead of allocating and clearing it again.
+ *  The memory kept by an arena, and the number of arenas kept by a pool, are bounded.
+ */
+template <class Titem_>
+struct CNodeListArenaT {
+	/** Hash slot of a node in the open or closed list. */
+	struct Slot {
+		Titem_ *item;      ///< The node in this slot.
+		uint32 generation; ///< Generation of the search which filled this slot; the slot is empty in any other generation.
+		bool closed;       ///< Whether the node is in the closed list, instead of the open list.
+	};
+
+	static const uint CHUNK_BITS        = 10;              ///< Log2 of the number of nodes in a chunk.
+	static const uint CHUNK_SIZE        = 1 << CHUNK_BITS; ///< Number of nodes in a chunk.
+	static const uint MAX_KEPT_CHUNKS   = 16;              ///< Number of chunks of nodes kept for the next search.
+	static const uint MAX_KEPT_SLOTS    = 1 << 15;         ///< Number of hash slots kept for the next search.
+	static const uint MAX_KEPT_QUEUE    = MAX_KEPT_CHUNKS * CHUNK_SIZE; ///< Capacity of the priority queue kept for the next search.
+	static const uint MAX_POOLED_ARENAS = 4;               ///< Number of unused arenas kept by the pool of each thread.
+
+	std::vector<Titem_ *> chunks;     ///< Chunks of #CHUNK_SIZE nodes; the nodes are constructed when used.
+	std::vector<Slot> slots;          ///< Open addressing hash table of the open and closed nodes.
+	std::vector<Slot> scratch;        ///< Slots being moved while the hash table grows.
+	uint32 generation;                ///< Generation of the current search.
+	CBinaryHeapT<Titem_> queue;       ///< Priority queue of the open nodes.
+
+	CNodeListArenaT() : generation(0), queue(2048) {}
+
+	~CNodeListArenaT()
+	{
+		for (Titem_ *chunk : this->chunks) free(chunk);
+	}
+
+	/**
+	 * Empty all hash slots by starting a new generation.
+	 * Only when the generation counter wraps, the slots are actually cleared.
+	 */
+	inline void NextGeneration()
+	{
+		if (++this->generation == 0) {
+			for (Slot &slot : this->slots) slot.generation = 0;
+			this->generation = 1;
+		}
+	}
+
+	/**
+	 * Get a node of the arena.
+	 * @param index Index of the node.
+	 * @return The (possibly not yet constructed) node.
+	 */
+	inline Titem_ *GetItem(uint index)
+	{
+		if ((index >> CHUNK_BITS) == this->chunks.size()) this->chunks.push_back(MallocT<Titem_>(CHUNK_SIZE));
+		return this->chunks[index >> CHUNK_BITS] + (index & (CHUNK_SIZE - 1));
+	}
+
+	/**
+	 * Destroy the nodes of the last search, and free the memory above the bounds.
+	 * @param num_items Number of nodes constructed by the last search.
+	 */
+	void Reset(uint num_items)
+	{
+		for (uint i = 0; i < num_items; i++) this->GetItem(i)->~Titem_();
+		while (this->chunks.size() > MAX_KEPT_CHUNKS) {
+			free(this->chunks.back());
+			this->chunks.pop_back();
+		}
+		if (this->slots.size() > MAX_KEPT_SLOTS) {
+			this->slots.resize(MAX_KEPT_SLOTS);
+			this->slots.shrink_to_fit();
+		}
+		this->queue.Clear();
+		this->queue.Shrink(MAX_KEPT_QUEUE);
+	}
+
+	/**
+	 * Get the unused arenas of the current thread.
+	 * @return The pool.
+	 */
+	static std::vector<std::unique_ptr<CNodeListArenaT>> &GetPool()
+	{
+		static thread_local std::vector<std::unique_ptr<CNodeListArenaT>> pool;
+		return pool;
+	}
+
+	/**
+	 * Take an arena from the pool of the current thread, or allocate a new one if the pool is empty.
+	 * @return The arena.
+	 */
+	static CNodeListArenaT *Acquire()
+	{
+		std::vector<std::unique_ptr<CNodeListArenaT>> &pool = GetPool();
+		if (pool.empty()) return new CNodeListArenaT();
+		CNodeListArenaT *arena = pool.back().release();
+		pool.pop_back();
+		return arena;
+	}
+
+	/**
+	 * Give an arena back to the pool of the current thread.
+	 * @param arena The arena.
+	 * @param num_items Number of nodes constructed by the last search.
+	 */
+	static void Release(CNodeListArenaT *arena, uint num_items)
+	{
+		arena->Reset(num_items);
+		std::vector<std::unique_ptr<CNodeListArenaT>> &pool = GetPool();
+		if (pool.size() < MAX_POOLED_ARENAS) {
+			pool.emplace_back(arena);
+		} else {
+			delete arena;
+		}
+	}
+};
 
 /**
  * Hash table based node list multi-container class.
  *  Implements open list, closed list and priority queue for A-star
  *  path finder.
+ *
+ *  The open and closed nodes share one open addressing hash table with linear probing.
+ *  A slot is only valid in the generation of the search which filled it,
+ *  so a new search gets an empty table without clearing it.
+ *  The hash table starts with 2^Thash_bits_open_ slots, which keeps short searches in a few cache lines,
+ *  and doubles whenever it gets three quarters full.
  */
 template <class Titem_, int Thash_bits_open_, int Thash_bits_closed_>
 class CNodeList_HashTableT {
 public:
-	typedef Titem_ Titem;                                        ///< Make #Titem_ visible from outside of class.
-	typedef typename Titem_::Key Key;                            ///< Make Titem_::Key a property of this class.
-	typedef SmallArray<Titem_, 65536, 256> CItemArray;           ///< Type that we will use as item container.
-	typedef CHashTableT<Titem_, Thash_bits_open_  > COpenList;   ///< How pointers to open nodes will be stored.
-	typedef CHashTableT<Titem_, Thash_bits_closed_> CClosedList; ///< How pointers to closed nodes will be stored.
-	typedef CBinaryHeapT<Titem_> CPriorityQueue;                 ///< How the priority queue will be managed.
+	typedef Titem_ Titem;                         ///< Make #Titem_ visible from outside of class.
+	typedef typename Titem_::Key Key;             ///< Make Titem_::Key a property of this class.
+	typedef CNodeListArenaT<Titem_> CArena;       ///< Storage of nodes, hash slots and priority queue.
+	typedef typename CArena::Slot Slot;           ///< Hash slot of a node.
+	typedef CBinaryHeapT<Titem_> CPriorityQueue;  ///< How the priority queue will be managed.
 
 protected:
-	CItemArray      m_arr;        ///< Here we store full item data (Titem_).
-	COpenList       m_open;       ///< Hash table of pointers to open item data.
-	CClosedList     m_closed;     ///< Hash table of pointers to closed item data.
-	CPriorityQueue  m_open_queue; ///< Priority queue of pointers to open item data.
-	Titem          *m_new_node;   ///< New open node under construction.
+	CArena         *m_arena;       ///< Storage of this node list, taken from the pool.
+	CPriorityQueue &m_open_queue;  ///< Priority queue of pointers to open item data.
+	Titem          *m_new_node;    ///< New open node under construction.
+	uint            m_num_items;   ///< Number of nodes constructed.
+	int             m_open_count;  ///< Number of open nodes.
+	int             m_closed_count;///< Number of closed nodes.
+	uint            m_hash_bits;   ///< Log2 of the number of hash slots used by this search.
+	uint            m_stats_slot_probes; ///< stats - how many hash slots were looked at
+
+	/** return the first hash slot to probe for a key */
+	inline uint SlotIndex(const Key &key) const
+	{
+		return ((uint32)key.CalcHash() * 0x9E3779B1U) >> (32 - m_hash_bits);
+	}
+
+	/** return the hash slot of a key or nullptr if not found */
+	inline Slot *FindSlot(const Key &key)
+	{
+		const uint mask = (1 << m_hash_bits) - 1;
+		for (uint i = SlotIndex(key);; i = (i + 1) & mask) {
+			Slot &slot = m_arena->slots[i];
+			m_stats_slot_probes++;
+			if (slot.generation != m_arena->generation) return nullptr;
+			if (slot.item->GetKey() == key) return &slot;
+		}
+	}
+
+	/** put an item into the first free hash slot for its key */
+	inline void PlaceSlot(Titem_ &item, bool closed)
+	{
+		const uint mask = (1 << m_hash_bits) - 1;
+		for (uint i = SlotIndex(item.GetKey());; i = (i + 1) & mask) {
+			Slot &slot = m_arena->slots[i];
+			m_stats_slot_probes++;
+			if (slot.generation != m_arena->generation) {
+				slot.item = &item;
+				slot.generation = m_arena->generation;
+				slot.closed = closed;
+				return;
+			}
+			assert(!(slot.item->GetKey() == item.GetKey()));
+		}
+	}
+
+	/** use 2^bits hash slots, moving the slots of the current search */
+	void ResizeSlots(uint bits)
+	{
+		std::vector<Slot> &scratch = m_arena->scratch;
+		scratch.clear();
+		if (m_open_count + m_closed_count > 0) {
+			for (uint i = 0; i < (1U << m_hash_bits); i++) {
+				if (m_arena->slots[i].generation == m_arena->generation) scratch.push_back(m_arena->slots[i]);
+			}
+		}
+		m_arena->NextGeneration();
+		m_hash_bits = bits;
+		if (m_arena->slots.size() < (1U << bits)) m_arena->slots.resize(1 << bits, { nullptr, 0, false });
+		for (const Slot &slot : scratch) PlaceSlot(*slot.item, slot.closed);
+	}
+
+	/** insert an item into the hash table */
+	inline void InsertSlot(Titem_ &item, bool closed)
+	{
+		if ((m_open_count + m_closed_count + 1) * 4 > (3 << m_hash_bits)) ResizeSlots(m_hash_bits + 1);
+		PlaceSlot(item, closed);
+		if (closed) {
+			m_closed_count++;
+		} else {
+			m_open_count++;
+		}
+	}
+
+	/** remove the item of a hash slot, moving back the following slots so no probe sequence gets broken */
+	inline void RemoveSlot(Slot *removed)
+	{
+		if (removed->closed) {
+			m_closed_count--;
+		} else {
+			m_open_count--;
+		}
+
+		const uint mask = (1 << m_hash_bits) - 1;
+		uint gap = removed - m_arena->slots.data();
+		for (uint i = (gap + 1) & mask;; i = (i + 1) & mask) {
+			Slot &slot = m_arena->slots[i];
+			if (slot.generation != m_arena->generation) break;
+			/* the slot can fill the gap if its first probe is not cyclically in (gap, i] */
+			uint first = SlotIndex(slot.item->GetKey());
+			if (((i - first) & mask) >= ((i - gap) & mask)) {
+				m_arena->slots[gap] = slot;
+				gap = i;
+			}
+		}
+		m_arena->slots[gap].generation = m_arena->generation - 1;
+	}
 
 public:
 	/** default constructor */
-	CNodeList_HashTableT() : m_open_queue(2048)
+	CNodeList_HashTableT()
+		: m_arena(CArena::Acquire())
+		, m_open_queue(m_arena->queue)
+		, m_new_node(nullptr)
+		, m_num_items(0)
+		, m_open_count(0)
+		, m_closed_count(0)
+		, m_hash_bits(0)
+		, m_stats_slot_probes(0)
 	{
-		m_new_node = nullptr;
+		ResizeSlots(Thash_bits_open_);
 	}
 
+	CNodeList_HashTableT(const CNodeList_HashTableT &) = delete;
+	CNodeList_HashTableT &operator=(const CNodeList_HashTableT &) = delete;
+
 	/** destructor */
 	~CNodeList_HashTableT()
 	{
+		CArena::Release(m_arena, m_num_items);
 	}
 
 	/** return number of open nodes */
 	inline int OpenCount()
 	{
-		return m_open.Count();
+		return m_open_count;
 	}
 
 	/** return number of closed nodes */
 	inline int ClosedCount()
 	{
-		return m_closed.Count();
+		return m_closed_count;
+	}
+
+	/**
+	 * Return an estimate of the memory used by the search so far:
+	 * the nodes constructed and the hash slots looked at.
+	 */
+	inline size_t BytesTouched() const
+	{
+		return m_num_items * sizeof(Titem_) + m_stats_slot_probes * sizeof(Slot);
 	}
 
-	/** allocate new data item from m_arr */
+	/** allocate new data item from the arena */
 	inline Titem_ *CreateNewNode()
 	{
-		if (m_new_node == nullptr) m_new_node = m_arr.AppendC();
+		if (m_new_node == nullptr) {
+			m_new_node = m_arena->GetItem(m_num_items++);
+			new (m_new_node) Titem_;
+		}
 		return m_new_node;
 	}
 
@@ -77,11 +317,11 @@ public:
 		/* TODO: do we need to store best nodes found in some extra list/array? Probably not now. */
 	}
 
-	/** insert given item as open node (into m_open and m_open_queue) */
+	/** insert given item as open node (into the hash table and m_open_queue) */
 	inline void InsertOpenNode(Titem_ &item)
 	{
-		assert(m_closed.Find(item.GetKey()) == nullptr);
-		m_open.Push(item);
+		assert(FindClosedNode(item.GetKey()) == nullptr);
+		InsertSlot(item, false);
 		m_open_queue.Include(&item);
 		if (&item == m_new_node) {
 			m_new_node = nullptr;
@@ -102,7 +342,7 @@ public:
 	{
 		if (!m_open_queue.IsEmpty()) {
 			Titem_ *item = m_open_queue.Shift();
-			m_open.Pop(*item);
+			PopAlreadyDequeuedOpenNode(item->GetKey());
 			return item;
 		}
 		return nullptr;
@@ -121,20 +361,34 @@ public:
 
 	inline Titem_& PopAlreadyDequeuedOpenNode(const Key &key)
 	{
-		return m_open.Pop(key);
+		Slot *slot = FindSlot(key);
+		assert(slot != nullptr && !slot->closed);
+		Titem_ &item = *slot->item;
+		RemoveSlot(slot);
+		return item;
+	}
+
+	/** move an open node which was already dequeued to the closed list, without looking up its key twice */
+	inline void CloseAlreadyDequeuedOpenNode(Titem_ &item)
+	{
+		Slot *slot = FindSlot(item.GetKey());
+		assert(slot != nullptr && slot->item == &item && !slot->closed);
+		slot->closed = true;
+		m_open_count--;
+		m_closed_count++;
 	}
 
 	/** return the open node specified by a key or nullptr if not found */
 	inline Titem_ *FindOpenNode(const Key &key)
 	{
-		Titem_ *item = m_open.Find(key);
-		return item;
+		Slot *slot = FindSlot(key);
+		return (slot != nullptr && !slot->closed) ? slot->item : nullptr;
 	}
 
 	/** remove and return the open node specified by a key */
 	inline Titem_& PopOpenNode(const Key &key)
 	{
-		Titem_ &item = m_open.Pop(key);
+		Titem_ &item = PopAlreadyDequeuedOpenNode(key);
 		uint idxPop = m_open_queue.FindIndex(item);
 		m_open_queue.Remove(idxPop);
 		return item;
@@ -143,33 +397,38 @@ public:
 	/** close node */
 	inline void InsertClosedNode(Titem_ &item)
 	{
-		assert(m_open.Find(item.GetKey()) == nullptr);
-		m_closed.Push(item);
+		assert(FindOpenNode(item.GetKey()) == nullptr);
+		InsertSlot(item, true);
 	}
 
 	/** return the closed node specified by a key or nullptr if not found */
 	inline Titem_ *FindClosedNode(const Key &key)
 	{
-		Titem_ *item = m_closed.Find(key);
-		return item;
+		Slot *slot = FindSlot(key);
+		return (slot != nullptr && slot->closed) ? slot->item : nullptr;
 	}
 
 	/** The number of items. */
 	inline int TotalCount()
 	{
-		return m_arr.Length();
+		return m_num_items;
 	}
 
 	/** Get a particular item. */
 	inline Titem_& ItemAt(int idx)
 	{
-		return m_arr[idx];
+		return *m_arena->GetItem(idx);
 	}
 
 	/** Helper for creating output of this array. */
 	template <class D> void Dump(D &dmp) const
 	{
-		dmp.WriteStructT("m_arr", &m_arr);
+		dmp.WriteLine("num_items = %d", m_num_items);
+		CStrA name;
+		for (uint i = 0; i < m_num_items; i++) {
+			name.Format("item[%d]", i);
+			dmp.WriteStructT(name.Data(), m_arena->GetItem(i));
+		}
 	}
 };
 
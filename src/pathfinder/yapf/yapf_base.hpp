@@ -12,8 +12,11 @@
 
 #include "../../debug.h"
 #include "../../settings_type.h"
+#include "../../tracing.h"
 
 extern int _total_pf_time_us;
+extern int _total_pf_nodes_expanded;
+extern uint64 _total_pf_bytes_touched;
 
 /**
  * CYapfBaseT - A-star type path finder base class.
@@ -65,6 +68,7 @@ protected:
 
 	int                  m_stats_cost_calcs;   ///< stats - how many node's costs were calculated
 	int                  m_stats_cache_hits;   ///< stats - how many node's costs were reused from cache
+	int                  m_stats_nodes_expanded; ///< stats - how many nodes were followed
 
 public:
 	CPerformanceTimer    m_perf_cost;          ///< stats - total CPU time of this run
@@ -84,6 +88,7 @@ public:
 		, m_veh(nullptr)
 		, m_stats_cost_calcs(0)
 		, m_stats_cache_hits(0)
+		, m_stats_nodes_expanded(0)
 		, m_num_steps(0)
 	{
 	}
@@ -116,6 +121,8 @@ public:
 	 */
 	inline bool FindPath(const VehicleType *v)
 	{
+		TRACE_ZONE_ID("YAPF search", v->index);
+
 		m_veh = v;
 
 		CPerformanceTimer perf;
@@ -137,10 +144,10 @@ public:
 			}
 
 			m_nodes.DequeueBestOpenNode();
+			m_stats_nodes_expanded++;
 			Yapf().PfFollowNode(*n);
 			if (m_max_search_nodes == 0 || m_nodes.ClosedCount() < m_max_search_nodes) {
-				m_nodes.PopAlreadyDequeuedOpenNode(n->GetKey());
-				m_nodes.InsertClosedNode(*n);
+				m_nodes.CloseAlreadyDequeuedOpenNode(*n);
 			} else {
 				m_nodes.ReenqueueOpenNode(*n);
 				bDestFound = false;
@@ -154,6 +161,8 @@ public:
 		if (_debug_yapf_level >= 2) {
 			int t = perf.Get(1000000);
 			_total_pf_time_us += t;
+			_total_pf_nodes_expanded += m_stats_nodes_expanded;
+			_total_pf_bytes_touched += m_nodes.BytesTouched();
 
 			if (_debug_yapf_level >= 3) {
 				UnitID veh_idx = (m_veh != nullptr) ? m_veh->unitnumber : 0;
@@ -162,8 +171,9 @@ public:
 				int cost = bDestFound ? m_pBestDestNode->m_cost : -1;
 				int dist = bDestFound ? m_pBestDestNode->m_estimate - m_pBestDestNode->m_cost : -1;
 
-				DEBUG(yapf, 3, "[YAPF%c]%c%4d- %d us - %d rounds - %d open - %d closed - CHR %4.1f%% - C %d D %d - c%d(sc%d, ts%d, o%d) -- ",
+				DEBUG(yapf, 3, "[YAPF%c]%c%4d- %d us - %d rounds - %d open - %d closed - %d expanded - %u bytes - CHR %4.1f%% - C %d D %d - c%d(sc%d, ts%d, o%d) -- ",
 					ttc, bDestFound ? '-' : '!', veh_idx, t, m_num_steps, m_nodes.OpenCount(), m_nodes.ClosedCount(),
+					m_stats_nodes_expanded, (uint)m_nodes.BytesTouched(),
 					cache_hit_ratio, cost, dist, m_perf_cost.Get(1000000), m_perf_slope_cost.Get(1000000),
 					m_perf_ts_cost.Get(1000000), m_perf_other_cost.Get(1000000)
 				);
@@ -188,8 +188,10 @@ protected:
 		/* some statistics */
 		if (last_date != _date) {
 			last_date = _date;
-			DEBUG(yapf, 2, "Pf time today: %5d ms", _total_pf_time_us / 1000);
+			DEBUG(yapf, 2, "Pf time today: %5d ms, %d nodes expanded, " OTTD_PRINTF64U " KiB touched", _total_pf_time_us / 1000, _total_pf_nodes_expanded, _total_pf_bytes_touched / 1024);
 			_total_pf_time_us = 0;
+			_total_pf_nodes_expanded = 0;
+			_total_pf_bytes_touched = 0;
 		}
 
 		/* delete the cache sometimes... */
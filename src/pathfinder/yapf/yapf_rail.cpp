@@ -17,6 +17,7 @@
 #include "../../viewport_func.h"
 #include "../../newgrf_station.h"
 #include "../../tracerestrict.h"
+#include "../../signal_func.h"
 #include "../../debug.h"
 
 #include "../../safeguards.h"
@@ -67,6 +68,8 @@ template <typename Tpf> void DumpState(Tpf &pf1, Tpf &pf2)
 }
 
 int _total_pf_time_us = 0;
+int _total_pf_nodes_expanded = 0;
+uint64 _total_pf_bytes_touched = 0;
 
 template <class Types>
 class CYapfReserveTrack
@@ -762,6 +765,7 @@ int CSegmentCostCacheBase::s_rail_change_counter = 0;
 void YapfNotifyTrackLayoutChange(TileIndex tile, Track track)
 {
 	CSegmentCostCacheBase::NotifyTrackLayoutChange(tile, track);
+	ClearSignalBlockCache();
 }
 
 void YapfCheckRailSignalPenalties()
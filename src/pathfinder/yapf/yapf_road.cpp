@@ -10,8 +10,11 @@
 #include "../../stdafx.h"
 #include "yapf.hpp"
 #include "yapf_node_road.hpp"
+#include "../road_regions.h"
 #include "../../roadstop_base.h"
 
+#include <chrono>
+
 #include "../../safeguards.h"
 
 /**
@@ -248,6 +251,7 @@ protected:
 	StationID    m_dest_station;
 	bool         m_bus;
 	bool         m_non_artic;
+	RoadRegionEstimator m_region_estimator;
 
 public:
 	void SetDestination(const RoadVehicle *v)
@@ -270,6 +274,26 @@ public:
 		return m_dest_station != INVALID_STATION ? Station::GetIfValid(m_dest_station) : nullptr;
 	}
 
+	/**
+	 * Use the road region graph to improve the cost estimates of the search.
+	 * Must be called after SetDestination.
+	 * @param v the vehicle
+	 * @param origin the tile the search starts at
+	 */
+	void SetupRegionEstimate(const RoadVehicle *v, TileIndex origin)
+	{
+		std::vector<TileIndex> dest_tiles;
+		const Station *st = GetDestinationStation();
+		if (st != nullptr) {
+			for (const RoadStop *rs = st->GetPrimaryRoadStop(m_bus ? ROADSTOP_BUS : ROADSTOP_TRUCK); rs != nullptr; rs = rs->next) {
+				dest_tiles.push_back(rs->xy);
+			}
+		} else {
+			dest_tiles.push_back(m_destTile);
+		}
+		m_region_estimator.Setup(GetRoadTramType(v->roadtype), origin, std::move(dest_tiles));
+	}
+
 protected:
 	/** to access inherited path finder */
 	Tpf& Yapf()
@@ -320,6 +344,7 @@ public:
 		int dmin = min(dx, dy);
 		int dxy = abs(dx - dy);
 		int d = dmin * YAPF_TILE_CORNER_LENGTH + (dxy - 1) * (YAPF_TILE_LENGTH / 2);
+		if (m_region_estimator.IsActive()) d = max(d, m_region_estimator.GetEstimate(tile));
 		n.m_estimate = n.m_cost + d;
 		assert(n.m_estimate >= n.m_parent->m_estimate);
 		return true;
@@ -391,6 +416,7 @@ public:
 		/* set origin and destination nodes */
 		Yapf().SetOrigin(src_tile, src_trackdirs);
 		Yapf().SetDestination(v);
+		if (_settings_game.pf.yapf.road_hierarchical_search) Yapf().SetupRegionEstimate(v, src_tile);
 
 		/* find the best path */
 		path_found = Yapf().FindPath(v);
@@ -477,13 +503,37 @@ public:
 		return dist;
 	}
 
+	static bool stBenchmarkPath(const RoadVehicle *v, bool use_regions, uint64 &nodes)
+	{
+		Tpf pf;
+		return pf.BenchmarkPath(v, use_regions, nodes);
+	}
+
+	/**
+	 * Search a path from the current position of a vehicle to its destination, without using the result.
+	 * @param v the vehicle
+	 * @param use_regions whether to use the road region graph for cost estimates
+	 * @param[in,out] nodes incremented by the number of nodes of the search
+	 * @return true if the path was found
+	 */
+	inline bool BenchmarkPath(const RoadVehicle *v, bool use_regions, uint64 &nodes)
+	{
+		if (!SetOriginFromVehiclePos(v)) return false;
+		Yapf().SetDestination(v);
+		if (use_regions) Yapf().SetupRegionEstimate(v, v->tile);
+
+		bool path_found = Yapf().FindPath(v);
+		nodes += Yapf().m_nodes.OpenCount() + Yapf().m_nodes.ClosedCount();
+		return path_found;
+	}
+
 	/** Return true if the valid origin (tile/trackdir) was set from the current vehicle position. */
 	inline bool SetOriginFromVehiclePos(const RoadVehicle *v)
 	{
 		/* set origin (tile, trackdir) */
 		TileIndex src_tile = v->tile;
 		Trackdir src_td = v->GetVehicleTrackdir();
-		if (!HasTrackdir(TrackStatusToTrackdirBits(GetTileTrackStatus(src_tile, TRANSPORT_ROAD, this->IsTram() ? RTT_TRAM : RTT_ROAD)), src_td)) {
+		if (!HasTrackdir(TrackStatusToTrackdirBits(GetTileTrackStatus(src_tile, TRANSPORT_ROAD, GetRoadTramType(v->roadtype))), src_td)) {
 			/* sometimes the roadveh is not on the road (it resides on non-existing track)
 			 * how should we handle that situation? */
 			return false;
@@ -578,3 +628,43 @@ FindDepotData YapfRoadVehicleFindNearestDepot(const RoadVehicle *v, int max_dist
 
 	return pfnFindNearestDepot(v, tile, trackdir, max_distance);
 }
+
+/**
+ * Time road vehicle path searches, with and without the road region graph.
+ * The origin/destination pairs are the current positions and destinations of all road vehicles.
+ * @param b buffer to write the results to
+ * @param last last valid position of the buffer
+ * @param iterations number of times to search each path
+ */
+void BenchmarkRoadVehiclePathfinder(char *b, const char *last, uint iterations)
+{
+	std::vector<const RoadVehicle *> vehicles;
+	for (const RoadVehicle *v : RoadVehicle::Iterate()) {
+		if (!v->IsFrontEngine() || v->IsInDepot() || v->dest_tile == INVALID_TILE) continue;
+		if (!v->current_order.IsType(OT_GOTO_STATION) && !v->current_order.IsType(OT_GOTO_DEPOT)) continue;
+		vehicles.push_back(v);
+	}
+
+	b += seprintf(b, last, "Road vehicle pathfinder: %u origin/destination pairs, %u iterations\n", (uint)vehicles.size(), iterations);
+
+	for (bool use_regions : { false, true }) {
+		/* Start from an empty region cache, so that building it is included in the time. */
+		ClearRoadRegions();
+
+		uint found = 0;
+		uint64 nodes = 0;
+		auto start = std::chrono::steady_clock::now();
+		for (uint i = 0; i < iterations; i++) {
+			for (const RoadVehicle *v : vehicles) {
+				bool path_found = _settings_game.pf.yapf.disable_node_optimization ?
+						CYapfRoad1::stBenchmarkPath(v, use_regions, nodes) :
+						CYapfRoad2::stBenchmarkPath(v, use_regions, nodes);
+				if (path_found) found++;
+			}
+		}
+		uint ms = (uint)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+		b += seprintf(b, last, "  %s: %u paths found, " OTTD_PRINTF64U " nodes, %u ms\n",
+				use_regions ? "region graph" : "tile search ", found, nodes, ms);
+	}
+}
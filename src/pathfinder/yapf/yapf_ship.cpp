@@ -14,6 +14,7 @@
 
 #include "yapf.hpp"
 #include "yapf_node_ship.hpp"
+#include "../water_regions.h"
 
 #include "../../safeguards.h"
 
@@ -30,6 +31,7 @@ protected:
 	TileIndex    m_destTile;
 	TrackdirBits m_destTrackdirs;
 	StationID    m_destStation;
+	WaterRegionEstimator m_region_estimator;
 
 public:
 	void SetDestination(const Ship *v)
@@ -45,6 +47,45 @@ public:
 		}
 	}
 
+	/**
+	 * Get the tiles which can be the end of the path.
+	 * @return The docking tiles of the destination station, or the destination tile.
+	 */
+	std::vector<TileIndex> GetDestinationTiles() const
+	{
+		std::vector<TileIndex> dest_tiles;
+		if (m_destStation != INVALID_STATION) {
+			const Station *st = Station::GetIfValid(m_destStation);
+			if (st != nullptr) {
+				TILE_AREA_LOOP(tile, st->docking_station) {
+					if (IsDockingTile(tile) && IsShipDestinationTile(tile, m_destStation)) dest_tiles.push_back(tile);
+				}
+			}
+		} else {
+			dest_tiles.push_back(m_destTile);
+		}
+		return dest_tiles;
+	}
+
+	/**
+	 * Check the water region graph for whether the destination can be reached at all.
+	 * @param origin The tile the search starts at.
+	 * @return False if no destination tile is connected to the origin.
+	 */
+	bool IsDestinationReachable(TileIndex origin) const
+	{
+		return IsAnyWaterTileReachable(origin, GetDestinationTiles());
+	}
+
+	/**
+	 * Use the water region graph to estimate the remaining path costs of this search.
+	 * @param origin The tile the search starts at.
+	 */
+	void SetupRegionEstimate(TileIndex origin)
+	{
+		m_region_estimator.Setup(origin, GetDestinationTiles());
+	}
+
 protected:
 	/** to access inherited path finder */
 	inline Tpf& Yapf()
@@ -92,6 +133,7 @@ public:
 		int dmin = min(dx, dy);
 		int dxy = abs(dx - dy);
 		int d = dmin * YAPF_TILE_CORNER_LENGTH + (dxy - 1) * (YAPF_TILE_LENGTH / 2);
+		if (m_region_estimator.IsActive()) d = max(d, m_region_estimator.GetEstimate(tile));
 		n.m_estimate = n.m_cost + d;
 		assert(n.m_estimate >= n.m_parent->m_estimate);
 		return true;
@@ -163,6 +205,15 @@ public:
 		/* set origin and destination nodes */
 		pf.SetOrigin(src_tile, trackdirs);
 		pf.SetDestination(v);
+		if (_settings_game.pf.yapf.ship_hierarchical_search) {
+			if (!pf.IsDestinationReachable(src_tile)) {
+				/* No water connects to the destination, so keep going and let the ship get lost. */
+				path_found = false;
+				TrackdirBits next_trackdirs = TrackBitsToTrackdirBits(tracks) & DiagdirReachesTrackdirs(enterdir);
+				return HasTrackdir(next_trackdirs, trackdir) ? trackdir : (Trackdir)FindFirstBit2x64(next_trackdirs);
+			}
+			pf.SetupRegionEstimate(src_tile);
+		}
 		/* find best path */
 		path_found = pf.FindPath(v);
 
@@ -213,6 +264,10 @@ public:
 		/* set origin and destination nodes */
 		pf.SetOrigin(tile, TrackdirToTrackdirBits(td1) | TrackdirToTrackdirBits(td2));
 		pf.SetDestination(v);
+		if (_settings_game.pf.yapf.ship_hierarchical_search) {
+			if (!pf.IsDestinationReachable(tile)) return false;
+			pf.SetupRegionEstimate(tile);
+		}
 		/* find best path */
 		if (!pf.FindPath(v)) return false;
 
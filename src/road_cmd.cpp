@@ -37,6 +37,7 @@
 #include "genworld.h"
 #include "company_gui.h"
 #include "road_func.h"
+#include "pathfinder/road_regions.h"
 
 #include "table/strings.h"
 #include "table/roadtypes.h"
@@ -255,6 +256,8 @@ static Foundation GetRoadFoundation(Slope tileh, RoadBits bits);
 
 void NotifyRoadLayoutChangedIfTileNonLeaf(TileIndex tile, RoadTramType rtt, RoadBits present_bits)
 {
+	InvalidateRoadRegion(tile);
+
 	uint connections = 0;
 	if ((present_bits & ROAD_NE) && (GetAnyRoadBits(TILE_ADDXY(tile, -1,  0), rtt) & ROAD_SW)) connections++;
 	if ((present_bits & ROAD_SE) && (GetAnyRoadBits(TILE_ADDXY(tile,  0,  1), rtt) & ROAD_NW)) connections++;
@@ -267,6 +270,9 @@ void NotifyRoadLayoutChangedIfTileNonLeaf(TileIndex tile, RoadTramType rtt, Road
 
 void NotifyRoadLayoutChangedIfSimpleTunnelBridgeNonLeaf(TileIndex start, TileIndex end, DiagDirection start_dir, RoadTramType rtt)
 {
+	InvalidateRoadRegion(start);
+	InvalidateRoadRegion(end);
+
 	if (!(GetAnyRoadBits(TileAddByDiagDir(start, ReverseDiagDir(start_dir)), rtt) & DiagDirToRoadBits(start_dir))) return;
 	if (!(GetAnyRoadBits(TileAddByDiagDir(end, start_dir), rtt) & DiagDirToRoadBits(ReverseDiagDir(start_dir)))) return;
 
@@ -468,6 +474,8 @@ static CommandCost RemoveRoad(TileIndex tile, DoCommandFlag flags, RoadBits piec
 
 				/* Todo: Change this to be more fine-grained if necessary */
 				NotifyRoadLayoutChanged();
+				InvalidateRoadRegion(tile);
+				InvalidateRoadRegion(other_end);
 			}
 		} else {
 			assert_tile(IsDriveThroughStopTile(tile), tile);
@@ -478,6 +486,7 @@ static CommandCost RemoveRoad(TileIndex tile, DoCommandFlag flags, RoadBits piec
 				SetRoadType(tile, rtt, INVALID_ROADTYPE);
 				MarkTileDirtyByTile(tile);
 				NotifyRoadLayoutChanged();
+				InvalidateRoadRegion(tile);
 			}
 		}
 		return cost;
@@ -992,6 +1001,8 @@ CommandCost CmdBuildRoad(TileIndex tile, DoCommandFlag flags, uint32 p1, uint32
 
 					AddRoadTunnelBridgeInfrastructure(tile, other_end);
 					NotifyRoadLayoutChanged();
+					InvalidateRoadRegion(tile);
+					InvalidateRoadRegion(other_end);
 					DirtyAllCompanyInfrastructureWindows();
 				}
 
@@ -1109,6 +1120,8 @@ do_clear:;
 					MarkTileDirtyByTile(tile);
 				}
 				NotifyRoadLayoutChanged();
+				InvalidateRoadRegion(tile);
+				InvalidateRoadRegion(other_end);
 				break;
 			}
 
@@ -1117,6 +1130,7 @@ do_clear:;
 				SetRoadType(tile, rtt, rt);
 				SetRoadOwner(tile, rtt, company);
 				NotifyRoadLayoutChanged();
+				InvalidateRoadRegion(tile);
 				break;
 			}
 
@@ -1388,6 +1402,7 @@ CommandCost CmdBuildRoadDepot(TileIndex tile, DoCommandFlag flags, uint32 p1, ui
 		MakeDefaultName(dep);
 
 		NotifyRoadLayoutChanged();
+		InvalidateRoadRegion(tile);
 	}
 	cost.AddCost(_price[PR_BUILD_DEPOT_ROAD]);
 	return cost;
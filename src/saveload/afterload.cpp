@@ -60,7 +60,9 @@
 #include "../tracerestrict.h"
 #include "../tunnel_map.h"
 #include "../bridge_signal_map.h"
+#include "../signal_func.h"
 #include "../water.h"
+#include "../command_log_replay.h"
 
 
 #include "saveload_internal.h"
@@ -965,8 +967,9 @@ bool AfterLoadGame()
 	/* If Load Scenario / New (Scenario) Game is used,
 	 *  a company does not exist yet. So create one here.
 	 * 1 exception: network-games. Those can have 0 companies
-	 *   But this exception is not true for non-dedicated network servers! */
-	if (!Company::IsValidID(COMPANY_FIRST) && (!_networking || (_networking && _network_server && !_network_dedicated))) {
+	 *   But this exception is not true for non-dedicated network servers!
+	 * Replays of command logs load the game like a dedicated server does. */
+	if (!Company::IsValidID(COMPANY_FIRST) && ((!_networking && !IsReplayingCommandLog()) || (_networking && _network_server && !_network_dedicated))) {
 		DoStartupNewCompany(false);
 		Company *c = Company::Get(COMPANY_FIRST);
 		c->settings = _settings_client.company;
@@ -3397,7 +3400,7 @@ bool AfterLoadGame()
 	 * saved-by-server savegame. There are no clients with a backup, so clear it.
 	 * Furthermore before savegame version SLV_192 the actual content was always corrupt.
 	 */
-	if (!_networking || _network_server || IsSavegameVersionBefore(SLV_192)) {
+	if ((!_networking && !IsReplayingCommandLog()) || _network_server || IsSavegameVersionBefore(SLV_192)) {
 #ifndef DEBUG_DUMP_COMMANDS
 		/* Note: We cannot use CleanPool since that skips part of the destructor
 		 * and then leaks un-reachable Orders in the order pool. */
@@ -3776,6 +3779,9 @@ bool AfterLoadGame()
 	RebuildViewportKdtree();
 	ViewportMapBuildTunnelCache();
 
+	/* Keep the orders of each order list next to each other in memory. */
+	CompactOrderListStorage();
+
 	/* Road stops is 'only' updating some caches */
 	AfterLoadRoadStops();
 	AfterLoadLabelMaps();
@@ -3798,6 +3804,8 @@ bool AfterLoadGame()
 
 	UpdateAllVehiclesIsDrawn();
 
+	RebuildTownGrowthSchedule();
+
 	extern void YapfCheckRailSignalPenalties();
 	YapfCheckRailSignalPenalties();
 
@@ -3849,6 +3857,8 @@ void ReloadNewGRFData()
 	GroupStatistics::UpdateAfterLoad();
 	/* update station graphics */
 	AfterLoadStations();
+	/* station specs may block other tracks now */
+	ClearSignalBlockCache();
 
 	RailType rail_type_translate_map[RAILTYPE_END];
 	for (RailType old_type = RAILTYPE_BEGIN; old_type != RAILTYPE_END; old_type++) {
@@ -15,7 +15,6 @@
 
 #include "../ai/ai.hpp"
 #include "../ai/ai_config.hpp"
-#include "../network/network.h"
 #include "../ai/ai_instance.hpp"
 
 #include "../safeguards.h"
@@ -71,7 +70,7 @@ static void Load_AIPL()
 		_ai_saveload_version = -1;
 		SlObject(nullptr, _ai_company);
 
-		if (_networking && !_network_server) {
+		if (!AI::IsRunningInstances()) {
 			if (Company::IsValidAiID(index)) AIInstance::LoadEmpty();
 			continue;
 		}
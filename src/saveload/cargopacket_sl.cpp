@@ -133,6 +133,9 @@ const SaveLoad *GetCargoPacketDesc()
  */
 static void Save_CAPA()
 {
+	/* The days in transit of cargo in vehicles may not be stored in the packets yet. */
+	for (Vehicle *v : Vehicle::Iterate()) v->cargo.ApplyPendingAging();
+
 	std::vector<SaveLoad> filtered_packet_desc = SlFilterObject(GetCargoPacketDesc());
 	for (CargoPacket *cp : CargoPacket::Iterate()) {
 		SlSetArrayIndex(cp->index);
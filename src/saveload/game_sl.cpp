@@ -14,7 +14,6 @@
 
 #include "../game/game.hpp"
 #include "../game/game_config.hpp"
-#include "../network/network.h"
 #include "../game/game_instance.hpp"
 #include "../game/game_text.hpp"
 
@@ -64,7 +63,7 @@ static void Load_GSDT()
 	_game_saveload_version = -1;
 	SlObject(nullptr, _game_script);
 
-	if (_networking && !_network_server) {
+	if (!Game::IsRunningInstance()) {
 		GameInstance::LoadEmpty();
 		if ((CompanyID)SlIterateArray() != (CompanyID)-1) SlErrorCorrupt("Too many GameScript configs");
 		return;
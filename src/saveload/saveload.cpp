@@ -43,6 +43,7 @@
 #include "../string_func_extra.h"
 #include "../fios.h"
 #include "../error.h"
+#include "../tracing.h"
 #include <atomic>
 
 #include "../tbtr_template_vehicle.h"
@@ -2933,6 +2934,8 @@ static void SaveFileError()
  */
 static SaveOrLoadResult SaveFileToDisk(bool threaded)
 {
+	TRACE_ZONE("Write savegame");
+
 	try {
 		byte compression;
 		const SaveLoadFormat *fmt = GetSavegameFormat(_savegame_format, &compression);
@@ -2993,6 +2996,8 @@ static SaveOrLoadResult DoSave(SaveFilter *writer, bool threaded)
 {
 	assert(!_sl.saveinprogress);
 
+	TRACE_ZONE("Save game");
+
 	_sl.dumper = new MemoryDumper();
 	_sl.sf = writer;
 
@@ -3147,6 +3152,8 @@ struct ThreadedLoadFilter : LoadFilter {
  */
 static SaveOrLoadResult DoLoad(LoadFilter *reader, bool load_check)
 {
+	TRACE_ZONE("Load game");
+
 	_sl.lf = reader;
 
 	if (load_check) {
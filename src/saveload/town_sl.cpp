@@ -307,6 +307,7 @@ static void Save_TOWN()
 {
 	SetupDescs_TOWN();
 	for (Town *t : Town::Iterate()) {
+		t->grow_counter = t->GetGrowCounter();
 		SlSetArrayIndex(t->index);
 		SlAutolength((AutolengthProc*)RealSave_Town, t);
 	}
@@ -70,6 +70,7 @@
 #include "void_map.h"
 #include "station_base.h"
 #include "infrastructure_func.h"
+#include "pathfinder/water_regions.h"
 
 #if defined(WITH_FREETYPE) || defined(_WIN32)
 #define HAS_TRUETYPE_FONT
@@ -1364,6 +1365,7 @@ static bool CheckFreeformEdges(int32 p1)
 			MakeSea(TileXY(0, i));
 		}
 	}
+	ClearWaterRegions();
 	MarkWholeScreenDirty();
 	return true;
 }
@@ -20,6 +20,8 @@
 #include "programmable_signals.h"
 #include "error.h"
 #include "infrastructure_func.h"
+#include "command_func.h"
+#include "3rdparty/cpp-btree/btree_map.h"
 
 #include "safeguards.h"
 
@@ -221,6 +223,58 @@ static Vehicle *TrainInWormholeTileEnum(Vehicle *v, void *data)
 	return v;
 }
 
+/** Kind of a step of a signal block, see #SignalBlock. */
+enum SignalBlockStepType : byte {
+	SBS_GLOBAL_REMOVE,       ///< Remove (tile, data) from _globset, as the block is explored from there too.
+	SBS_TRAIN_ON_TILE,       ///< Look for a train on the tile, not in a depot.
+	SBS_TRAIN_ON_TRACK_BITS, ///< Look for a train on the track bits (data) of the tile.
+	SBS_TRAIN_IN_WORMHOLE,   ///< Look for a train at the tunnel/bridge end (data_tile), on the ramp or in the wormhole of the tile.
+	SBS_PBS,                 ///< The block has a PBS signal.
+	SBS_UPDATE_SIGNAL,       ///< Add the signal on (tile, data) to _tbuset.
+	SBS_PRESIGNAL_EXIT,      ///< Count the presignal exit on (tile, data).
+	SBS_FULL,                ///< Some buffer was full.
+};
+
+/** Step of a signal block, see #SignalBlock. */
+struct SignalBlockStep {
+	SignalBlockStepType type; ///< What to do.
+	uint16 data;              ///< Direction, trackdir or track bits, depending on the type.
+	TileIndex tile;           ///< Tile of the step.
+	TileIndex data_tile;      ///< Tile which the train check is done on, for #SBS_TRAIN_IN_WORMHOLE.
+};
+
+/**
+ * Everything ExploreSegment found out about a signal block which does not depend on trains or signal states,
+ * as the steps which together with the current trains and signal states give the SigInfo of the block.
+ * The steps are in the order of the exploration, so replaying them leaves the sets in the same state as exploring again.
+ */
+struct SignalBlock {
+	std::vector<SignalBlockStep> steps; ///< Steps, in order of the exploration.
+
+	inline void Add(SignalBlockStepType type, TileIndex tile, uint16 data = 0, TileIndex data_tile = INVALID_TILE)
+	{
+		this->steps.push_back({ type, data, tile, data_tile });
+	}
+
+	inline bool operator==(const SignalBlock &other) const
+	{
+		if (this->steps.size() != other.steps.size()) return false;
+		for (size_t i = 0; i < this->steps.size(); i++) {
+			const SignalBlockStep &a = this->steps[i];
+			const SignalBlockStep &b = other.steps[i];
+			if (a.type != b.type || a.data != b.data || a.tile != b.tile || a.data_tile != b.data_tile) return false;
+		}
+		return true;
+	}
+};
+
+/**
+ * Signal blocks explored before, by the place and owner their update started from.
+ * The blocks only depend on the track layout, so they are dropped whenever the track layout changes.
+ */
+static btree::btree_map<uint64, SignalBlock> _signal_block_cache;
+static const size_t SIGNAL_BLOCK_CACHE_MAX_SIZE = 4096; ///< Number of signal blocks at which the cache is emptied.
+
 /**
  * Perform some operations before adding data into Todo set
  * The new and reverse direction is removed from _globset, because we are sure
@@ -228,16 +282,17 @@ static Vehicle *TrainInWormholeTileEnum(Vehicle *v, void *data)
  * Also, remove reverse direction from _tbdset
  * This is the 'core' part so the graph searching won't enter any tile twice
  *
+ * @param block signal block being explored
  * @param t1 tile we are entering
  * @param d1 direction (tile side) we are entering
  * @param t2 tile we are leaving
  * @param d2 direction (tile side) we are leaving
  * @return false iff reverse direction was in Todo set
  */
-static inline bool CheckAddToTodoSet(TileIndex t1, DiagDirection d1, TileIndex t2, DiagDirection d2)
+static inline bool CheckAddToTodoSet(SignalBlock &block, TileIndex t1, DiagDirection d1, TileIndex t2, DiagDirection d2)
 {
-	_globset.Remove(t1, d1); // it can be in Global but not in Todo
-	_globset.Remove(t2, d2); // remove in all cases
+	block.Add(SBS_GLOBAL_REMOVE, t1, d1); // it can be in Global but not in Todo
+	block.Add(SBS_GLOBAL_REMOVE, t2, d2); // remove in all cases
 
 	assert(!_tbdset.IsIn(t1, d1)); // it really shouldn't be there already
 
@@ -254,15 +309,16 @@ static inline bool CheckAddToTodoSet(TileIndex t1, DiagDirection d1, TileIndex t
  * Also, remove reverse direction from Todo set
  * This is the 'core' part so the graph searching won't enter any tile twice
  *
+ * @param block signal block being explored
  * @param t1 tile we are entering
  * @param d1 direction (tile side) we are entering
  * @param t2 tile we are leaving
  * @param d2 direction (tile side) we are leaving
  * @return false iff the Todo buffer would be overrun
  */
-static inline bool MaybeAddToTodoSet(TileIndex t1, DiagDirection d1, TileIndex t2, DiagDirection d2)
+static inline bool MaybeAddToTodoSet(SignalBlock &block, TileIndex t1, DiagDirection d1, TileIndex t2, DiagDirection d2)
 {
-	if (!CheckAddToTodoSet(t1, d1, t2, d2)) return true;
+	if (!CheckAddToTodoSet(block, t1, d1, t2, d2)) return true;
 
 	return _tbdset.Add(t1, d1);
 }
@@ -291,15 +347,13 @@ struct SigInfo {
 };
 
 /**
- * Search signal block
+ * Search signal block, starting from the nodes in _tbdset
  *
  * @param owner owner whose signals we are updating
- * @return SigFlags
+ * @param block signal block the steps are added to
  */
-static SigInfo ExploreSegment(Owner owner)
+static void ExploreSegment(Owner owner, SignalBlock &block)
 {
-	SigInfo info;
-
 	TileIndex tile;
 	DiagDirection enterdir;
 
@@ -313,13 +367,13 @@ static SigInfo ExploreSegment(Owner owner)
 
 				if (IsRailDepot(tile)) {
 					if (enterdir == INVALID_DIAGDIR) { // from 'inside' - train just entered or left the depot
-						if (!(info.flags & SF_TRAIN) && HasVehicleOnPos(tile, VEH_TRAIN, nullptr, &TrainOnTileEnum)) info.flags |= SF_TRAIN;
+						block.Add(SBS_TRAIN_ON_TILE, tile);
 						exitdir = GetRailDepotDirection(tile);
 						tile += TileOffsByDiagDir(exitdir);
 						enterdir = ReverseDiagDir(exitdir);
 						break;
 					} else if (enterdir == GetRailDepotDirection(tile)) { // entered a depot
-						if (!(info.flags & SF_TRAIN) && HasVehicleOnPos(tile, VEH_TRAIN, nullptr, &TrainOnTileEnum)) info.flags |= SF_TRAIN;
+						block.Add(SBS_TRAIN_ON_TILE, tile);
 						continue;
 					} else {
 						continue;
@@ -332,11 +386,11 @@ static SigInfo ExploreSegment(Owner owner)
 
 				if (tracks == TRACK_BIT_HORZ || tracks == TRACK_BIT_VERT) { // there is exactly one incidating track, no need to check
 					tracks = tracks_masked;
-					/* If no train detected yet, and there is not no train -> there is a train -> set the flag */
-					if (!(info.flags & SF_TRAIN) && EnsureNoTrainOnTrackBits(tile, tracks).Failed()) info.flags |= SF_TRAIN;
+					/* If there is a train on the track -> set the flag */
+					block.Add(SBS_TRAIN_ON_TRACK_BITS, tile, tracks);
 				} else {
 					if (tracks_masked == TRACK_BIT_NONE) continue; // no incidating track
-					if (!(info.flags & SF_TRAIN) && HasVehicleOnPos(tile, VEH_TRAIN, nullptr, &TrainOnTileEnum)) info.flags |= SF_TRAIN;
+					block.Add(SBS_TRAIN_ON_TILE, tile);
 				}
 
 				if (HasSignals(tile)) { // there is exactly one track - not zero, because there is exit from this tile
@@ -350,20 +404,16 @@ static SigInfo ExploreSegment(Owner owner)
 						 * (if it is a presignal EXIT and it changes, it will be added to 'to-be-done' set later) */
 						if (HasSignalOnTrackdir(tile, reversedir)) {
 							if (IsPbsSignal(sig)) {
-								info.flags |= SF_PBS;
-							} else if (!_tbuset.Add(tile, reversedir)) {
-								info.flags |= SF_FULL;
-								return info;
+								block.Add(SBS_PBS, tile);
+							} else {
+								block.Add(SBS_UPDATE_SIGNAL, tile, reversedir);
 							}
 						}
-						if (HasSignalOnTrackdir(tile, trackdir) && !IsOnewaySignal(tile, track)) info.flags |= SF_PBS;
+						if (HasSignalOnTrackdir(tile, trackdir) && !IsOnewaySignal(tile, track)) block.Add(SBS_PBS, tile);
 
 						/* if it is a presignal EXIT in OUR direction, count it */
 						if (IsPresignalExit(tile, track) && HasSignalOnTrackdir(tile, trackdir)) { // found presignal exit
-							info.num_exits++;
-							if (GetSignalStateByTrackdir(tile, trackdir) == SIGNAL_STATE_GREEN) { // found green presignal exit
-								info.num_green++;
-							}
+							block.Add(SBS_PRESIGNAL_EXIT, tile, trackdir);
 						}
 
 						continue;
@@ -374,9 +424,9 @@ static SigInfo ExploreSegment(Owner owner)
 					if (dir != enterdir && (tracks & _enterdir_to_trackbits[dir])) { // any track incidating?
 						TileIndex newtile = tile + TileOffsByDiagDir(dir);  // new tile to check
 						DiagDirection newdir = ReverseDiagDir(dir); // direction we are entering from
-						if (!MaybeAddToTodoSet(newtile, newdir, tile, dir)) {
-							info.flags |= SF_FULL;
-							return info;
+						if (!MaybeAddToTodoSet(block, newtile, newdir, tile, dir)) {
+							block.Add(SBS_FULL, tile);
+							return;
 						}
 					}
 				}
@@ -390,7 +440,7 @@ static SigInfo ExploreSegment(Owner owner)
 				if (DiagDirToAxis(enterdir) != GetRailStationAxis(tile)) continue; // different axis
 				if (IsStationTileBlocked(tile)) continue; // 'eye-candy' station tile
 
-				if (!(info.flags & SF_TRAIN) && HasVehicleOnPos(tile, VEH_TRAIN, nullptr, &TrainOnTileEnum)) info.flags |= SF_TRAIN;
+				block.Add(SBS_TRAIN_ON_TILE, tile);
 				tile += TileOffsByDiagDir(exitdir);
 				break;
 
@@ -399,8 +449,8 @@ static SigInfo ExploreSegment(Owner owner)
 				if (!IsOneSignalBlock(owner, GetTileOwner(tile))) continue;
 				if (DiagDirToAxis(enterdir) == GetCrossingRoadAxis(tile)) continue; // different axis
 
-				if (!(info.flags & SF_TRAIN) && HasVehicleOnPos(tile, VEH_TRAIN, nullptr, &TrainOnTileEnum)) info.flags |= SF_TRAIN;
-				if (_settings_game.vehicle.safer_crossings) info.flags |= SF_PBS;
+				block.Add(SBS_TRAIN_ON_TILE, tile);
+				if (_settings_game.vehicle.safer_crossings) block.Add(SBS_PBS, tile);
 				tile += TileOffsByDiagDir(exitdir);
 				break;
 
@@ -414,15 +464,15 @@ static SigInfo ExploreSegment(Owner owner)
 				TrackBits tracks = GetTunnelBridgeTrackBits(tile);
 				TrackBits across_tracks = GetAcrossTunnelBridgeTrackBits(tile);
 
-				auto check_train_present = [tile, tracks, across_tracks](DiagDirection enterdir) -> bool {
+				auto add_train_present = [&block, tile, tracks, across_tracks](DiagDirection enterdir) {
 					if (tracks == TRACK_BIT_HORZ || tracks == TRACK_BIT_VERT) {
 						if (_enterdir_to_trackbits[enterdir] & across_tracks) {
-							return EnsureNoTrainOnTrackBits(tile, TRACK_BIT_WORMHOLE | across_tracks).Failed();
+							block.Add(SBS_TRAIN_ON_TRACK_BITS, tile, TRACK_BIT_WORMHOLE | across_tracks);
 						} else {
-							return EnsureNoTrainOnTrackBits(tile, tracks & (~across_tracks)).Failed();
+							block.Add(SBS_TRAIN_ON_TRACK_BITS, tile, tracks & (~across_tracks));
 						}
 					} else {
-						return HasVehicleOnPos(tile, VEH_TRAIN, nullptr, &TrainOnTileEnum);
+						block.Add(SBS_TRAIN_ON_TILE, tile);
 					}
 				};
 
@@ -432,13 +482,10 @@ static SigInfo ExploreSegment(Owner owner)
 				if (IsTunnelBridgeWithSignalSimulation(tile)) {
 					if (enterdir == INVALID_DIAGDIR) {
 						// incoming from the wormhole, onto signal
-						if (!(info.flags & SF_TRAIN) && IsTunnelBridgeSignalSimulationExit(tile)) { // tunnel entrance is ignored
-							if (HasVehicleOnPos(GetOtherTunnelBridgeEnd(tile), VEH_TRAIN, reinterpret_cast<void *>(tile), &TrainInWormholeTileEnum)) info.flags |= SF_TRAIN;
-							if (!(info.flags & SF_TRAIN) && HasVehicleOnPos(tile, VEH_TRAIN, reinterpret_cast<void *>(tile), &TrainInWormholeTileEnum)) info.flags |= SF_TRAIN;
-						}
-						if (IsTunnelBridgeSignalSimulationExit(tile) && !_tbuset.Add(tile, INVALID_TRACKDIR)) {
-							info.flags |= SF_FULL;
-							return info;
+						if (IsTunnelBridgeSignalSimulationExit(tile)) { // tunnel entrance is ignored
+							block.Add(SBS_TRAIN_IN_WORMHOLE, tile, 0, GetOtherTunnelBridgeEnd(tile));
+							block.Add(SBS_TRAIN_IN_WORMHOLE, tile, 0, tile);
+							block.Add(SBS_UPDATE_SIGNAL, tile, INVALID_TRACKDIR);
 						}
 						Trackdir exit_track = TrackEnterdirToTrackdir(FindFirstTrack(GetAcrossTunnelBridgeTrackBits(tile)), ReverseDiagDir(tunnel_bridge_dir));
 						exitdir = TrackdirToExitdir(exit_track);
@@ -449,41 +496,38 @@ static SigInfo ExploreSegment(Owner owner)
 						// NOT incoming from the wormhole!
 						if (IsTunnelBridgeSignalSimulationExit(tile)) {
 							if (IsTunnelBridgePBS(tile)) {
-								info.flags |= SF_PBS;
-							} else if (!_tbuset.Add(tile, INVALID_TRACKDIR)) {
-								info.flags |= SF_FULL;
-								return info;
+								block.Add(SBS_PBS, tile);
+							} else {
+								block.Add(SBS_UPDATE_SIGNAL, tile, INVALID_TRACKDIR);
 							}
 						}
-						if (!(info.flags & SF_TRAIN)) {
-							if (HasVehicleOnPos(tile, VEH_TRAIN, reinterpret_cast<void *>(tile), &TrainInWormholeTileEnum)) info.flags |= SF_TRAIN;
-							if (!(info.flags & SF_TRAIN) && IsTunnelBridgeSignalSimulationExit(tile)) {
-								if (HasVehicleOnPos(GetOtherTunnelBridgeEnd(tile), VEH_TRAIN, reinterpret_cast<void *>(tile), &TrainInWormholeTileEnum)) info.flags |= SF_TRAIN;
-							}
+						block.Add(SBS_TRAIN_IN_WORMHOLE, tile, 0, tile);
+						if (IsTunnelBridgeSignalSimulationExit(tile)) {
+							block.Add(SBS_TRAIN_IN_WORMHOLE, tile, 0, GetOtherTunnelBridgeEnd(tile));
 						}
 						continue;
 					}
 				}
 				if (enterdir == INVALID_DIAGDIR) { // incoming from the wormhole
-					if (!(info.flags & SF_TRAIN) && check_train_present(tunnel_bridge_dir)) info.flags |= SF_TRAIN;
+					add_train_present(tunnel_bridge_dir);
 					enterdir = tunnel_bridge_dir;
 				} else if (enterdir != tunnel_bridge_dir) { // NOT incoming from the wormhole!
 					if (tracks_masked == TRACK_BIT_NONE) continue; // no incidating track
-					if (!(info.flags & SF_TRAIN) && check_train_present(enterdir)) info.flags |= SF_TRAIN;
+					add_train_present(enterdir);
 				}
 				for (DiagDirection dir = DIAGDIR_BEGIN; dir < DIAGDIR_END; dir++) { // test all possible exit directions
 					if (dir != enterdir && (tracks & _enterdir_to_trackbits[dir])) { // any track incidating?
 						if (dir == tunnel_bridge_dir) {
-							if (!MaybeAddToTodoSet(GetOtherTunnelBridgeEnd(tile), INVALID_DIAGDIR, tile, INVALID_DIAGDIR)) {
-								info.flags |= SF_FULL;
-								return info;
+							if (!MaybeAddToTodoSet(block, GetOtherTunnelBridgeEnd(tile), INVALID_DIAGDIR, tile, INVALID_DIAGDIR)) {
+								block.Add(SBS_FULL, tile);
+								return;
 							}
 						} else {
 							TileIndex newtile = tile + TileOffsByDiagDir(dir);  // new tile to check
 							DiagDirection newdir = ReverseDiagDir(dir); // direction we are entering from
-							if (!MaybeAddToTodoSet(newtile, newdir, tile, dir)) {
-								info.flags |= SF_FULL;
-								return info;
+							if (!MaybeAddToTodoSet(block, newtile, newdir, tile, dir)) {
+								block.Add(SBS_FULL, tile);
+								return;
 							}
 						}
 					}
@@ -495,8 +539,63 @@ static SigInfo ExploreSegment(Owner owner)
 				continue; // continue the while() loop
 		}
 
-		if (!MaybeAddToTodoSet(tile, enterdir, oldtile, exitdir)) {
-			info.flags |= SF_FULL;
+		if (!MaybeAddToTodoSet(block, tile, enterdir, oldtile, exitdir)) {
+			block.Add(SBS_FULL, tile);
+		}
+	}
+}
+
+/**
+ * Replay the steps of a signal block with the current trains and signal states.
+ * Fills _tbuset with the signals to update, and removes the places the block is explored from from _globset.
+ *
+ * @param block signal block
+ * @return info about the block
+ */
+static SigInfo EvaluateSignalBlock(const SignalBlock &block)
+{
+	SigInfo info;
+	const bool update_globset = !_globset.IsEmpty();
+
+	for (const SignalBlockStep &step : block.steps) {
+		switch (step.type) {
+			case SBS_GLOBAL_REMOVE:
+				if (update_globset) _globset.Remove(step.tile, (DiagDirection)step.data);
+				break;
+
+			case SBS_TRAIN_ON_TILE:
+				if (!(info.flags & SF_TRAIN) && HasVehicleOnPos(step.tile, VEH_TRAIN, nullptr, &TrainOnTileEnum)) info.flags |= SF_TRAIN;
+				break;
+
+			case SBS_TRAIN_ON_TRACK_BITS:
+				if (!(info.flags & SF_TRAIN) && EnsureNoTrainOnTrackBits(step.tile, (TrackBits)step.data).Failed()) info.flags |= SF_TRAIN;
+				break;
+
+			case SBS_TRAIN_IN_WORMHOLE:
+				if (!(info.flags & SF_TRAIN) && HasVehicleOnPos(step.data_tile, VEH_TRAIN, reinterpret_cast<void *>(step.tile), &TrainInWormholeTileEnum)) info.flags |= SF_TRAIN;
+				break;
+
+			case SBS_PBS:
+				info.flags |= SF_PBS;
+				break;
+
+			case SBS_UPDATE_SIGNAL:
+				if (!_tbuset.Add(step.tile, (Trackdir)step.data)) {
+					info.flags |= SF_FULL;
+					return info;
+				}
+				break;
+
+			case SBS_PRESIGNAL_EXIT:
+				info.num_exits++;
+				if (GetSignalStateByTrackdir(step.tile, (Trackdir)step.data) == SIGNAL_STATE_GREEN) { // found green presignal exit
+					info.num_green++;
+				}
+				break;
+
+			case SBS_FULL:
+				info.flags |= SF_FULL;
+				break;
 		}
 	}
 
@@ -599,6 +698,96 @@ static inline void ResetSets()
 }
 
 
+/**
+ * Explore the signal block an update from a place in _globset starts in.
+ *
+ * @param owner owner whose signals we are updating
+ * @param tile tile of the place
+ * @param dir side of the tile, or INVALID_DIAGDIR for the inside of a depot or wormhole
+ * @param block signal block the steps are added to
+ * @return false iff there is no track at the place, so there is nothing to update
+ */
+static bool ExploreSignalBlock(Owner owner, TileIndex tile, DiagDirection dir, SignalBlock &block)
+{
+	assert(_tbdset.IsEmpty());
+
+	/* After updating signal, data stored are always MP_RAILWAY with signals.
+	 * Other situations happen when data are from outside functions -
+	 * modification of railbits (including both rail building and removal),
+	 * train entering/leaving block, train leaving depot...
+	 */
+	switch (GetTileType(tile)) {
+		case MP_TUNNELBRIDGE: {
+			/* 'optimization assert' - do not try to update signals when it is not needed */
+			assert_tile(GetTunnelBridgeTransportType(tile) == TRANSPORT_RAIL, tile);
+			if (IsTunnel(tile)) assert(dir == INVALID_DIAGDIR || dir == ReverseDiagDir(GetTunnelBridgeDirection(tile)));
+			TrackBits across = GetAcrossTunnelBridgeTrackBits(tile);
+			if (dir == INVALID_DIAGDIR || _enterdir_to_trackbits[dir] & across) {
+				_tbdset.Add(tile, INVALID_DIAGDIR);  // we can safely start from wormhole centre
+				if (!IsTunnelBridgeWithSignalSimulation(tile)) {  // Don't worry with other side of tunnel.
+					_tbdset.Add(GetOtherTunnelBridgeEnd(tile), INVALID_DIAGDIR);
+				}
+				break;
+			}
+		}
+			FALLTHROUGH;
+
+		case MP_RAILWAY:
+			if (IsRailDepotTile(tile)) {
+				/* 'optimization assert' do not try to update signals in other cases */
+				assert(dir == INVALID_DIAGDIR || dir == GetRailDepotDirection(tile));
+				_tbdset.Add(tile, INVALID_DIAGDIR); // start from depot inside
+				break;
+			}
+			FALLTHROUGH;
+
+		case MP_STATION:
+		case MP_ROAD:
+			if ((TrackStatusToTrackBits(GetTileTrackStatus(tile, TRANSPORT_RAIL, 0)) & _enterdir_to_trackbits[dir]) != TRACK_BIT_NONE) {
+				/* only add to set when there is some 'interesting' track */
+				_tbdset.Add(tile, dir);
+				_tbdset.Add(tile + TileOffsByDiagDir(dir), ReverseDiagDir(dir));
+				break;
+			}
+			FALLTHROUGH;
+
+		default:
+			/* jump to next tile */
+			tile = tile + TileOffsByDiagDir(dir);
+			dir = ReverseDiagDir(dir);
+			if ((TrackStatusToTrackBits(GetTileTrackStatus(tile, TRANSPORT_RAIL, 0)) & _enterdir_to_trackbits[dir]) != TRACK_BIT_NONE) {
+				_tbdset.Add(tile, dir);
+				break;
+			}
+			/* happens when removing a rail that wasn't connected at one or both sides */
+			return false;
+	}
+
+	assert(!_tbdset.Overflowed()); // it really shouldn't overflow by these one or two items
+	assert(!_tbdset.IsEmpty()); // it wouldn't hurt anyone, but shouldn't happen too
+
+	ExploreSegment(owner, block);
+
+	/* The exploration stops early when a buffer is full. */
+	_tbdset.Reset();
+	return true;
+}
+
+/**
+ * Key of a signal block in the cache.
+ * The settings which change what is one signal block are part of the key.
+ *
+ * @param owner owner whose signals we are updating
+ * @param tile tile the update starts from
+ * @param dir side of the tile the update starts from
+ * @return the key
+ */
+static inline uint64 SignalBlockCacheKey(Owner owner, TileIndex tile, DiagDirection dir)
+{
+	return ((uint64)tile << 32) | ((uint64)dir << 16) | ((uint64)owner << 8) |
+			(_settings_game.economy.infrastructure_sharing[VEH_TRAIN] ? 2 : 0) | (_settings_game.vehicle.safer_crossings ? 1 : 0);
+}
+
 /**
  * Updates blocks in _globset buffer
  *
@@ -617,66 +806,33 @@ static SigSegState UpdateSignalsInBuffer(Owner owner)
 	TileIndex tile;
 	DiagDirection dir;
 
+	/* Commands update signals while they are still changing the track layout,
+	 * and only notify the change when they are done, so do not use the cache in commands. */
+	const bool use_cache = !IsCommandRunning();
+	SignalBlock uncached_block;
+
 	while (_globset.Get(&tile, &dir)) {
 		assert(_tbuset.IsEmpty());
 		assert(_tbdset.IsEmpty());
 
-		/* After updating signal, data stored are always MP_RAILWAY with signals.
-		 * Other situations happen when data are from outside functions -
-		 * modification of railbits (including both rail building and removal),
-		 * train entering/leaving block, train leaving depot...
-		 */
-		switch (GetTileType(tile)) {
-			case MP_TUNNELBRIDGE: {
-				/* 'optimization assert' - do not try to update signals when it is not needed */
-				assert_tile(GetTunnelBridgeTransportType(tile) == TRANSPORT_RAIL, tile);
-				if (IsTunnel(tile)) assert(dir == INVALID_DIAGDIR || dir == ReverseDiagDir(GetTunnelBridgeDirection(tile)));
-				TrackBits across = GetAcrossTunnelBridgeTrackBits(tile);
-				if (dir == INVALID_DIAGDIR || _enterdir_to_trackbits[dir] & across) {
-					_tbdset.Add(tile, INVALID_DIAGDIR);  // we can safely start from wormhole centre
-					if (!IsTunnelBridgeWithSignalSimulation(tile)) {  // Don't worry with other side of tunnel.
-						_tbdset.Add(GetOtherTunnelBridgeEnd(tile), INVALID_DIAGDIR);
-					}
-					break;
-				}
+		const SignalBlock *block;
+		if (use_cache) {
+			const uint64 key = SignalBlockCacheKey(owner, tile, dir);
+			auto iter = _signal_block_cache.find(key);
+			if (iter == _signal_block_cache.end()) {
+				SignalBlock new_block;
+				if (!ExploreSignalBlock(owner, tile, dir, new_block)) continue;
+				if (_signal_block_cache.size() >= SIGNAL_BLOCK_CACHE_MAX_SIZE) _signal_block_cache.clear();
+				iter = _signal_block_cache.insert(std::make_pair(key, std::move(new_block))).first;
 			}
-				FALLTHROUGH;
-
-			case MP_RAILWAY:
-				if (IsRailDepotTile(tile)) {
-					/* 'optimization assert' do not try to update signals in other cases */
-					assert(dir == INVALID_DIAGDIR || dir == GetRailDepotDirection(tile));
-					_tbdset.Add(tile, INVALID_DIAGDIR); // start from depot inside
-					break;
-				}
-				FALLTHROUGH;
-
-			case MP_STATION:
-			case MP_ROAD:
-				if ((TrackStatusToTrackBits(GetTileTrackStatus(tile, TRANSPORT_RAIL, 0)) & _enterdir_to_trackbits[dir]) != TRACK_BIT_NONE) {
-					/* only add to set when there is some 'interesting' track */
-					_tbdset.Add(tile, dir);
-					_tbdset.Add(tile + TileOffsByDiagDir(dir), ReverseDiagDir(dir));
-					break;
-				}
-				FALLTHROUGH;
-
-			default:
-				/* jump to next tile */
-				tile = tile + TileOffsByDiagDir(dir);
-				dir = ReverseDiagDir(dir);
-				if ((TrackStatusToTrackBits(GetTileTrackStatus(tile, TRANSPORT_RAIL, 0)) & _enterdir_to_trackbits[dir]) != TRACK_BIT_NONE) {
-					_tbdset.Add(tile, dir);
-					break;
-				}
-				/* happens when removing a rail that wasn't connected at one or both sides */
-				continue; // continue the while() loop
+			block = &iter->second;
+		} else {
+			uncached_block.steps.clear();
+			if (!ExploreSignalBlock(owner, tile, dir, uncached_block)) continue;
+			block = &uncached_block;
 		}
 
-		assert(!_tbdset.Overflowed()); // it really shouldn't overflow by these one or two items
-		assert(!_tbdset.IsEmpty()); // it wouldn't hurt anyone, but shouldn't happen too
-
-		SigInfo info = ExploreSegment(owner);
+		SigInfo info = EvaluateSignalBlock(*block);
 
 		if (first) {
 			first = false;
@@ -845,6 +1001,34 @@ void FreeSignalDependencies()
 	_signal_dependencies.clear();
 }
 
+/**
+ * Forget all explored signal blocks.
+ * Call whenever the track layout, signals or the owners of track may have changed.
+ */
+void ClearSignalBlockCache()
+{
+	_signal_block_cache.clear();
+}
+
+/**
+ * Explore all cached signal blocks again, and compare them to the cache.
+ * @return the start tiles of the cached signal blocks which do not match the map any more
+ */
+std::vector<TileIndex> GetStaleSignalBlocks()
+{
+	std::vector<TileIndex> stale;
+	for (const auto &it : _signal_block_cache) {
+		const TileIndex tile = (TileIndex)(it.first >> 32);
+		const DiagDirection dir = (DiagDirection)GB(it.first, 16, 8);
+		const Owner owner = (Owner)GB(it.first, 8, 8);
+		if (SignalBlockCacheKey(owner, tile, dir) != it.first) continue; // cached with other settings
+
+		SignalBlock block;
+		if (!ExploreSignalBlock(owner, tile, dir, block) || !(block == it.second)) stale.push_back(tile);
+	}
+	return stale;
+}
+
 static void MarkDependencidesForUpdate(SignalReference on)
 {
 	SignalDependencyMap::iterator f = _signal_dependencies.find(on);
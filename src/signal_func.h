@@ -17,6 +17,8 @@
 #include "company_type.h"
 #include "debug.h"
 
+#include <vector>
+
 /**
  * Maps a trackdir to the bit that stores its status in the map arrays, in the
  * direction along with the trackdir.
@@ -133,6 +135,9 @@ void RemoveSignalDependency(SignalReference on, SignalReference dep);
 /// Frees signal dependencies (for newgame/load)
 void FreeSignalDependencies();
 
+void ClearSignalBlockCache();
+std::vector<TileIndex> GetStaleSignalBlocks();
+
 SigSegState UpdateSignalsOnSegment(TileIndex tile, DiagDirection side, Owner owner);
 void SetSignalsOnBothDir(TileIndex tile, Track track, Owner owner);
 void AddTrackToSignalBuffer(TileIndex tile, Track track, Owner owner);
@@ -666,11 +666,25 @@ void DupSprite(SpriteID old_spr, SpriteID new_spr)
 	scnew->container_ver = scold->container_ver;
 }
 
-static size_t GetSpriteCacheUsage()
+/**
+ * Get the number of bytes used by the sprites in the sprite cache.
+ * @return Bytes in use.
+ */
+size_t GetSpriteCacheUsage()
 {
 	return _spritecache_bytes_used;
 }
 
+/**
+ * Get the number of bytes the sprite cache is trimmed to when it uses more.
+ * @return Size limit of the sprite cache in bytes, depending on the screen depth of the blitter.
+ */
+size_t GetSpriteCacheLimit()
+{
+	int bpp = BlitterFactory::GetCurrentBlitter()->GetScreenDepth();
+	return (size_t)(bpp > 0 ? _sprite_cache_size * bpp / 8 : 1) * 1024 * 1024;
+}
+
 /**
  * Delete a single entry from the sprite cache.
  * @param item Entry to delete.
@@ -737,8 +751,7 @@ static void DeleteEntriesFromSpriteCache(size_t target)
 
 void IncreaseSpriteLRU()
 {
-	int bpp = BlitterFactory::GetCurrentBlitter()->GetScreenDepth();
-	uint target_size = (bpp > 0 ? _sprite_cache_size * bpp / 8 : 1) * 1024 * 1024;
+	size_t target_size = GetSpriteCacheLimit();
 	if (_spritecache_bytes_used > target_size) {
 		DeleteEntriesFromSpriteCache(_spritecache_bytes_used - target_size + 512 * 1024);
 	}
@@ -50,6 +50,8 @@ static inline const byte *GetNonSprite(SpriteID sprite, SpriteType type)
 void GfxInitSpriteMem();
 void GfxClearSpriteCache();
 void IncreaseSpriteLRU();
+size_t GetSpriteCacheUsage();
+size_t GetSpriteCacheLimit();
 
 void ReadGRFSpriteOffsets(byte container_version);
 size_t GetGRFSpriteOffset(uint32 id);
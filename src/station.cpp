@@ -38,6 +38,8 @@
 StationPool _station_pool("Station");
 INSTANTIATE_POOL_METHODS(Station)
 
+StationCatchmentIndex _station_catchment_index; ///< NOSAVE: Stations covering each tile, rebuilt by Station::RecomputeCatchment
+
 
 StationKdtree _station_kdtree(Kdtree_StationXYFunc);
 
@@ -138,6 +140,7 @@ Station::~Station()
 
 	/* Remove station from industries and towns that reference it. */
 	this->RemoveFromAllNearbyLists();
+	this->RemoveFromCatchmentIndex();
 
 	/* Clear the persistent storage. */
 	delete this->airport.psa;
@@ -181,6 +184,14 @@ void BaseStation::PostDestructor(size_t index)
 	InvalidateWindowData(WC_SELECT_STATION, 0, 0);
 }
 
+/**
+ * Station pool is about to be cleaned
+ */
+void BaseStation::PreCleanPool()
+{
+	_station_catchment_index.Clear();
+}
+
 /**
  * Get the primary road stop (the first road stop) that the given vehicle can load/unload.
  * @param v the vehicle to get the first road stop for
@@ -404,6 +415,93 @@ void Station::RemoveFromAllNearbyLists()
 	for (Industry *i : Industry::Iterate()) { i->stations_near.erase(this); }
 }
 
+/**
+ * Add a station covering a tile.
+ * @param tile The tile.
+ * @param station The station covering the tile.
+ */
+void StationCatchmentIndex::Add(TileIndex tile, StationID station)
+{
+	if (this->first.empty()) this->first.assign(MapSize(), INVALID_STATION);
+
+	StationID &first = this->first[tile];
+	if (first == INVALID_STATION) {
+		first = station;
+	} else if (station < first) {
+		this->others.insert(std::make_pair(tile, first));
+		first = station;
+	} else {
+		this->others.insert(std::make_pair(tile, station));
+	}
+}
+
+/**
+ * Remove a station covering a tile.
+ * @param tile The tile.
+ * @param station The station no longer covering the tile.
+ */
+void StationCatchmentIndex::Remove(TileIndex tile, StationID station)
+{
+	/* The index is cleared before the stations are, when the station pool is cleaned. */
+	if (this->first.empty()) return;
+
+	StationID &first = this->first[tile];
+	if (first != station) {
+		this->others.erase(std::make_pair(tile, station));
+		return;
+	}
+
+	/* Move the station with the next lowest ID to the tile. */
+	auto it = this->others.lower_bound(std::make_pair(tile, (StationID)0));
+	if (it != this->others.end() && it->first == tile) {
+		first = it->second;
+		this->others.erase(it);
+	} else {
+		first = INVALID_STATION;
+	}
+}
+
+/**
+ * Add all tiles of our catchment area to the catchment index.
+ */
+void Station::AddToCatchmentIndex() const
+{
+	if (this->catchment_tiles.tile == INVALID_TILE) return;
+
+	BitmapTileIterator it(this->catchment_tiles);
+	for (TileIndex tile = it; tile != INVALID_TILE; tile = ++it) {
+		_station_catchment_index.Add(tile, this->index);
+	}
+}
+
+/**
+ * Remove all tiles of our catchment area from the catchment index.
+ */
+void Station::RemoveFromCatchmentIndex() const
+{
+	if (this->catchment_tiles.tile == INVALID_TILE) return;
+
+	BitmapTileIterator it(this->catchment_tiles);
+	for (TileIndex tile = it; tile != INVALID_TILE; tile = ++it) {
+		_station_catchment_index.Remove(tile, this->index);
+	}
+}
+
+/**
+ * Add all stations whose catchment area covers the given tile to a station list.
+ * Stations associated with a neutral industry are skipped unless they can serve other industries.
+ * @param tile Tile to look up.
+ * @param[out] stations The list to add the stations to.
+ */
+/* static */ void Station::AddStationsCoveringTile(TileIndex tile, StationList *stations)
+{
+	_station_catchment_index.ForEach(tile, [&](StationID id) {
+		Station *st = Station::Get(id);
+		if (!_settings_game.station.serve_neutral_industries && st->industry != nullptr) return;
+		stations->insert(st);
+	});
+}
+
 /**
  * Test if the given town ID is covered by our catchment area.
  * This is used when removing a house tile to determine if it was the last house tile
@@ -428,6 +526,7 @@ void Station::RecomputeCatchment(bool no_clear_nearby_lists)
 {
 	this->industries_near.clear();
 	if (!no_clear_nearby_lists) this->RemoveFromAllNearbyLists();
+	this->RemoveFromCatchmentIndex();
 
 	if (this->rect.IsEmpty()) {
 		this->catchment_tiles.Reset();
@@ -449,6 +548,7 @@ void Station::RecomputeCatchment(bool no_clear_nearby_lists)
 		this->industry->stations_near.clear();
 		this->industry->stations_near.insert(this);
 		this->industries_near.insert(this->industry);
+		this->AddToCatchmentIndex();
 		return;
 	}
 
@@ -466,6 +566,7 @@ void Station::RecomputeCatchment(bool no_clear_nearby_lists)
 		TileArea ta2 = TileArea(tile, 1, 1).Expand(r);
 		TILE_AREA_LOOP(tile2, ta2) this->catchment_tiles.SetTile(tile2);
 	}
+	this->AddToCatchmentIndex();
 
 	/* Search catchment tiles for towns and industries */
 	BitmapTileIterator it(this->catchment_tiles);
@@ -490,13 +591,17 @@ void Station::RecomputeCatchment(bool no_clear_nearby_lists)
 
 /**
  * Recomputes catchment of all stations.
- * This will additionally recompute nearby stations for all towns and industries.
+ * This will additionally recompute nearby stations for all towns and industries, and rebuild the catchment index.
  */
 /* static */ void Station::RecomputeCatchmentForAll()
 {
 	for (Town *t : Town::Iterate()) { t->stations_near.clear(); }
 	for (Industry *i : Industry::Iterate()) { i->stations_near.clear(); }
-	for (Station *st : Station::Iterate()) { st->RecomputeCatchment(true); }
+	_station_catchment_index.Clear();
+	for (Station *st : Station::Iterate()) {
+		st->catchment_tiles.Reset();
+		st->RecomputeCatchment(true);
+	}
 }
 
 /************************************************************************/
@@ -32,6 +32,70 @@ extern StationPool _station_pool;
 
 static const byte INITIAL_STATION_RATING = 175;
 
+/**
+ * Stations whose catchment area covers each tile, @see Station::RecomputeCatchment
+ * Each tile stores the station with the lowest ID covering it, which is all there is for most tiles.
+ * The other stations of tiles covered by more than one station are kept in a set of (tile, station) pairs.
+ */
+class StationCatchmentIndex {
+	std::vector<StationID> first;                               ///< Per tile the lowest ID of the stations covering it, or INVALID_STATION. Empty until the first station is added.
+	btree::btree_set<std::pair<TileIndex, StationID>> others;   ///< The other stations covering a tile.
+
+public:
+	void Add(TileIndex tile, StationID station);
+	void Remove(TileIndex tile, StationID station);
+
+	/**
+	 * Call a function for each station covering a tile.
+	 * @param tile The tile to look up.
+	 * @param proc The function to call with the ID of each station.
+	 */
+	template <typename F>
+	void ForEach(TileIndex tile, F proc) const
+	{
+		if (this->first.empty() || this->first[tile] == INVALID_STATION) return;
+		proc(this->first[tile]);
+		if (this->others.empty()) return;
+		for (auto it = this->others.lower_bound(std::make_pair(tile, (StationID)0)); it != this->others.end() && it->first == tile; ++it) {
+			proc(it->second);
+		}
+	}
+
+	/** Remove all stations from the index, and free its memory. */
+	void Clear()
+	{
+		this->first.clear();
+		this->first.shrink_to_fit();
+		this->others.clear();
+	}
+
+	/**
+	 * Get the number of (tile, station) pairs in the index.
+	 * @return The number of pairs.
+	 */
+	size_t Size() const
+	{
+		return std::count_if(this->first.begin(), this->first.end(), [](StationID st) { return st != INVALID_STATION; }) + this->others.size();
+	}
+
+	bool operator==(const StationCatchmentIndex &other) const
+	{
+		if (this->others != other.others) return false;
+		if (this->first.empty() != other.first.empty()) {
+			/* An index whose stations have all been removed keeps its tiles, but has the same pairs as an empty one. */
+			const std::vector<StationID> &tiles = this->first.empty() ? other.first : this->first;
+			return std::all_of(tiles.begin(), tiles.end(), [](StationID st) { return st == INVALID_STATION; });
+		}
+		return this->first == other.first;
+	}
+
+	bool operator!=(const StationCatchmentIndex &other) const
+	{
+		return !(*this == other);
+	}
+};
+extern StationCatchmentIndex _station_catchment_index;
+
 class FlowStatMap;
 
 /**
@@ -834,6 +898,7 @@ public:
 
 	bool CatchmentCoversTown(TownID t) const;
 	void RemoveFromAllNearbyLists();
+	static void AddStationsCoveringTile(TileIndex tile, StationList *stations);
 
 	inline bool TileIsInCatchment(TileIndex tile) const
 	{
@@ -855,6 +920,10 @@ public:
 	uint32 GetNewGRFVariable(const ResolverObject &object, byte variable, byte parameter, bool *available) const override;
 
 	void GetTileArea(TileArea *ta, StationType type) const override;
+
+private:
+	void AddToCatchmentIndex() const;
+	void RemoveFromCatchmentIndex() const;
 };
 
 /** Iterator to iterate over all tiles belonging to an airport. */
@@ -526,6 +526,10 @@ static inline void free(const void *ptr)
 #define USE_SCOPE_INFO
 #endif
 
+#if !defined(DISABLE_TRACE_ZONES)
+#define USE_TRACE_ZONES
+#endif
+
 #define SINGLE_ARG(...) __VA_ARGS__
 
 #endif /* STDAFX_H */
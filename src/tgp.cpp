@@ -14,6 +14,7 @@
 #include "genworld.h"
 #include "core/random_func.hpp"
 #include "landscape_type.h"
+#include "thread.h"
 
 #include "safeguards.h"
 
@@ -338,6 +339,74 @@ static inline height_t RandomHeight(amplitude_t rMax)
 	return A2H(RandomRange(2 * rMax + 1) - rMax);
 }
 
+/**
+ * Generates new random height in given amplitude, using the given random number generator.
+ * @param random Random number generator to use
+ * @param rMax Limit of result
+ * @return generated height
+ */
+static inline height_t RandomHeight(Randomizer &random, amplitude_t rMax)
+{
+	/* Spread height into range -rMax..+rMax */
+	return A2H(random.Next(2 * rMax + 1) - rMax);
+}
+
+/**
+ * Process independent rows or columns of the height map on multiple threads.
+ * @param lines Number of rows or columns to process
+ * @param line_size Number of heights processed in each line, to avoid starting threads for trivial amounts of work
+ * @param func Function called as func(first_line, end_line)
+ */
+template <typename F>
+static void HeightMapParallelLines(uint lines, uint line_size, F func)
+{
+	ParallelForRange("ottd:tgp", 0, lines, max<uint>(1, (1 << 16) / max<uint>(line_size, 1)), func);
+}
+
+/**
+ * Set or add noise to the heights at every step'th column of every step'th row.
+ *
+ * Normally a single random sequence is used for the whole map. With the parallel
+ * generator each row gets its own sequence derived from \a seed, the frequency and
+ * the row, so the rows can be generated independently of each other and the
+ * result does not depend on the number of threads.
+ * @param frequency Noise frequency being generated
+ * @param amplitude Amplitude of the noise
+ * @param step Distance between the heights to apply noise to
+ * @param first Whether to set the base heights instead of adding to them
+ * @param seed Base seed of the per-row sequences
+ */
+static void HeightMapApplyNoise(int frequency, amplitude_t amplitude, int step, bool first, uint32 seed)
+{
+	if (!_settings_game.game_creation.tgen_parallel) {
+		for (int y = 0; y <= _height_map.size_y; y += step) {
+			for (int x = 0; x <= _height_map.size_x; x += step) {
+				if (first) {
+					_height_map.height(x, y) = (amplitude > 0) ? RandomHeight(amplitude) : 0;
+				} else {
+					_height_map.height(x, y) += RandomHeight(amplitude);
+				}
+			}
+		}
+		return;
+	}
+
+	HeightMapParallelLines(_height_map.size_y / step + 1, _height_map.size_x / step + 1, [&](uint row_begin, uint row_end) {
+		for (uint row = row_begin; row < row_end; row++) {
+			const int y = row * step;
+			Randomizer random;
+			random.SetSeed(DeriveRandomSeed(seed, frequency, y));
+			for (int x = 0; x <= _height_map.size_x; x += step) {
+				if (first) {
+					_height_map.height(x, y) = (amplitude > 0) ? RandomHeight(random, amplitude) : 0;
+				} else {
+					_height_map.height(x, y) += RandomHeight(random, amplitude);
+				}
+			}
+		}
+	});
+}
+
 /**
  * Base Perlin noise generator - fills height map with raw Perlin noise.
  *
@@ -353,6 +422,9 @@ static void HeightMapGenerate()
 	int start = max(MAX_TGP_FREQUENCIES - (int)min(MapLogX(), MapLogY()), 0);
 	bool first = true;
 
+	/* The parallel generator derives all its noise from a single number of the game's random sequence. */
+	const uint32 seed = _settings_game.game_creation.tgen_parallel ? Random() : 0;
+
 	for (int frequency = start; frequency < MAX_TGP_FREQUENCIES; frequency++) {
 		const amplitude_t amplitude = GetAmplitude(frequency);
 
@@ -364,43 +436,39 @@ static void HeightMapGenerate()
 
 		if (first) {
 			/* This is first round, we need to establish base heights with step = size_min */
-			for (int y = 0; y <= _height_map.size_y; y += step) {
-				for (int x = 0; x <= _height_map.size_x; x += step) {
-					height_t height = (amplitude > 0) ? RandomHeight(amplitude) : 0;
-					_height_map.height(x, y) = height;
-				}
-			}
+			HeightMapApplyNoise(frequency, amplitude, step, true, seed);
 			first = false;
 			continue;
 		}
 
 		/* It is regular iteration round.
 		 * Interpolate height values at odd x, even y tiles */
-		for (int y = 0; y <= _height_map.size_y; y += 2 * step) {
-			for (int x = 0; x <= _height_map.size_x - 2 * step; x += 2 * step) {
-				height_t h00 = _height_map.height(x + 0 * step, y);
-				height_t h02 = _height_map.height(x + 2 * step, y);
-				height_t h01 = (h00 + h02) / 2;
-				_height_map.height(x + 1 * step, y) = h01;
+		HeightMapParallelLines(_height_map.size_y / (2 * step) + 1, _height_map.size_x / (2 * step), [&](uint row_begin, uint row_end) {
+			for (int y = row_begin * 2 * step; y < (int)row_end * 2 * step; y += 2 * step) {
+				for (int x = 0; x <= _height_map.size_x - 2 * step; x += 2 * step) {
+					height_t h00 = _height_map.height(x + 0 * step, y);
+					height_t h02 = _height_map.height(x + 2 * step, y);
+					height_t h01 = (h00 + h02) / 2;
+					_height_map.height(x + 1 * step, y) = h01;
+				}
 			}
-		}
+		});
 
 		/* Interpolate height values at odd y tiles */
-		for (int y = 0; y <= _height_map.size_y - 2 * step; y += 2 * step) {
-			for (int x = 0; x <= _height_map.size_x; x += step) {
-				height_t h00 = _height_map.height(x, y + 0 * step);
-				height_t h20 = _height_map.height(x, y + 2 * step);
-				height_t h10 = (h00 + h20) / 2;
-				_height_map.height(x, y + 1 * step) = h10;
+		const uint odd_rows = _height_map.size_y >= 2 * step ? (_height_map.size_y - 2 * step) / (2 * step) + 1 : 0;
+		HeightMapParallelLines(odd_rows, _height_map.size_x / step + 1, [&](uint row_begin, uint row_end) {
+			for (int y = row_begin * 2 * step; y < (int)row_end * 2 * step; y += 2 * step) {
+				for (int x = 0; x <= _height_map.size_x; x += step) {
+					height_t h00 = _height_map.height(x, y + 0 * step);
+					height_t h20 = _height_map.height(x, y + 2 * step);
+					height_t h10 = (h00 + h20) / 2;
+					_height_map.height(x, y + 1 * step) = h10;
+				}
 			}
-		}
+		});
 
 		/* Add noise for next higher frequency (smaller steps) */
-		for (int y = 0; y <= _height_map.size_y; y += step) {
-			for (int x = 0; x <= _height_map.size_x; x += step) {
-				_height_map.height(x, y) += RandomHeight(amplitude);
-			}
-		}
+		HeightMapApplyNoise(frequency, amplitude, step, false, seed);
 	}
 }
 
@@ -445,78 +513,78 @@ static int *HeightMapMakeHistogram(height_t h_min, height_t h_max, int *hist_buf
 /** Applies sine wave redistribution onto height map */
 static void HeightMapSineTransform(height_t h_min, height_t h_max)
 {
-	height_t *h;
-
-	FOR_ALL_TILES_IN_HEIGHT(h) {
-		double fheight;
-
-		if (*h < h_min) continue;
-
-		/* Transform height into 0..1 space */
-		fheight = (double)(*h - h_min) / (double)(h_max - h_min);
-		/* Apply sine transform depending on landscape type */
-		switch (_settings_game.game_creation.landscape) {
-			case LT_TOYLAND:
-			case LT_TEMPERATE:
-				/* Move and scale 0..1 into -1..+1 */
-				fheight = 2 * fheight - 1;
-				/* Sine transform */
-				fheight = sin(fheight * M_PI_2);
-				/* Transform it back from -1..1 into 0..1 space */
-				fheight = 0.5 * (fheight + 1);
-				break;
-
-			case LT_ARCTIC:
-				{
-					/* Arctic terrain needs special height distribution.
-					 * Redistribute heights to have more tiles at highest (75%..100%) range */
-					double sine_upper_limit = 0.75;
-					double linear_compression = 2;
-					if (fheight >= sine_upper_limit) {
-						/* Over the limit we do linear compression up */
-						fheight = 1.0 - (1.0 - fheight) / linear_compression;
-					} else {
-						double m = 1.0 - (1.0 - sine_upper_limit) / linear_compression;
-						/* Get 0..sine_upper_limit into -1..1 */
-						fheight = 2.0 * fheight / sine_upper_limit - 1.0;
-						/* Sine wave transform */
-						fheight = sin(fheight * M_PI_2);
-						/* Get -1..1 back to 0..(1 - (1 - sine_upper_limit) / linear_compression) == 0.0..m */
-						fheight = 0.5 * (fheight + 1.0) * m;
+	HeightMapParallelLines(_height_map.size_y + 1, _height_map.dim_x, [&](uint row_begin, uint row_end) {
+		for (height_t *h = &_height_map.h[row_begin * _height_map.dim_x]; h < &_height_map.h[row_end * _height_map.dim_x]; h++) {
+			double fheight;
+
+			if (*h < h_min) continue;
+
+			/* Transform height into 0..1 space */
+			fheight = (double)(*h - h_min) / (double)(h_max - h_min);
+			/* Apply sine transform depending on landscape type */
+			switch (_settings_game.game_creation.landscape) {
+				case LT_TOYLAND:
+				case LT_TEMPERATE:
+					/* Move and scale 0..1 into -1..+1 */
+					fheight = 2 * fheight - 1;
+					/* Sine transform */
+					fheight = sin(fheight * M_PI_2);
+					/* Transform it back from -1..1 into 0..1 space */
+					fheight = 0.5 * (fheight + 1);
+					break;
+
+				case LT_ARCTIC:
+					{
+						/* Arctic terrain needs special height distribution.
+						 * Redistribute heights to have more tiles at highest (75%..100%) range */
+						double sine_upper_limit = 0.75;
+						double linear_compression = 2;
+						if (fheight >= sine_upper_limit) {
+							/* Over the limit we do linear compression up */
+							fheight = 1.0 - (1.0 - fheight) / linear_compression;
+						} else {
+							double m = 1.0 - (1.0 - sine_upper_limit) / linear_compression;
+							/* Get 0..sine_upper_limit into -1..1 */
+							fheight = 2.0 * fheight / sine_upper_limit - 1.0;
+							/* Sine wave transform */
+							fheight = sin(fheight * M_PI_2);
+							/* Get -1..1 back to 0..(1 - (1 - sine_upper_limit) / linear_compression) == 0.0..m */
+							fheight = 0.5 * (fheight + 1.0) * m;
+						}
 					}
-				}
-				break;
-
-			case LT_TROPIC:
-				{
-					/* Desert terrain needs special height distribution.
-					 * Half of tiles should be at lowest (0..25%) heights */
-					double sine_lower_limit = 0.5;
-					double linear_compression = 2;
-					if (fheight <= sine_lower_limit) {
-						/* Under the limit we do linear compression down */
-						fheight = fheight / linear_compression;
-					} else {
-						double m = sine_lower_limit / linear_compression;
-						/* Get sine_lower_limit..1 into -1..1 */
-						fheight = 2.0 * ((fheight - sine_lower_limit) / (1.0 - sine_lower_limit)) - 1.0;
-						/* Sine wave transform */
-						fheight = sin(fheight * M_PI_2);
-						/* Get -1..1 back to (sine_lower_limit / linear_compression)..1.0 */
-						fheight = 0.5 * ((1.0 - m) * fheight + (1.0 + m));
+					break;
+
+				case LT_TROPIC:
+					{
+						/* Desert terrain needs special height distribution.
+						 * Half of tiles should be at lowest (0..25%) heights */
+						double sine_lower_limit = 0.5;
+						double linear_compression = 2;
+						if (fheight <= sine_lower_limit) {
+							/* Under the limit we do linear compression down */
+							fheight = fheight / linear_compression;
+						} else {
+							double m = sine_lower_limit / linear_compression;
+							/* Get sine_lower_limit..1 into -1..1 */
+							fheight = 2.0 * ((fheight - sine_lower_limit) / (1.0 - sine_lower_limit)) - 1.0;
+							/* Sine wave transform */
+							fheight = sin(fheight * M_PI_2);
+							/* Get -1..1 back to (sine_lower_limit / linear_compression)..1.0 */
+							fheight = 0.5 * ((1.0 - m) * fheight + (1.0 + m));
+						}
 					}
-				}
-				break;
+					break;
 
-			default:
-				NOT_REACHED();
-				break;
+				default:
+					NOT_REACHED();
+					break;
+			}
+			/* Transform it back into h_min..h_max space */
+			*h = (height_t)(fheight * (h_max - h_min) + h_min);
+			if (*h < 0) *h = I2H(0);
+			if (*h >= h_max) *h = h_max - 1;
 		}
-		/* Transform it back into h_min..h_max space */
-		*h = (height_t)(fheight * (h_max - h_min) + h_min);
-		if (*h < 0) *h = I2H(0);
-		if (*h >= h_max) *h = h_max - 1;
-	}
+	});
 }
 
 /**
@@ -564,9 +632,6 @@ static void HeightMapCurves(uint level)
 		{ lengthof(curve_map_4), curve_map_4 },
 	};
 
-	height_t ht[lengthof(curve_maps)];
-	MemSetT(ht, 0, lengthof(ht));
-
 	/* Set up a grid to choose curve maps based on location; attempt to get a somewhat square grid */
 	float factor = sqrt((float)_height_map.size_x / (float)_height_map.size_y);
 	uint sx = Clamp((int)(((1 << level) * factor) + 0.5), 1, 128);
@@ -577,88 +642,93 @@ static void HeightMapCurves(uint level)
 		c[i] = Random() % lengthof(curve_maps);
 	}
 
-	/* Apply curves */
-	for (int x = 0; x < _height_map.size_x; x++) {
-
-		/* Get our X grid positions and bi-linear ratio */
-		float fx = (float)(sx * x) / _height_map.size_x + 1.0f;
-		uint x1 = (uint)fx;
-		uint x2 = x1;
-		float xr = 2.0f * (fx - x1) - 1.0f;
-		xr = sin(xr * M_PI_2);
-		xr = sin(xr * M_PI_2);
-		xr = 0.5f * (xr + 1.0f);
-		float xri = 1.0f - xr;
-
-		if (x1 > 0) {
-			x1--;
-			if (x2 >= sx) x2--;
-		}
-
-		for (int y = 0; y < _height_map.size_y; y++) {
-
-			/* Get our Y grid position and bi-linear ratio */
-			float fy = (float)(sy * y) / _height_map.size_y + 1.0f;
-			uint y1 = (uint)fy;
-			uint y2 = y1;
-			float yr = 2.0f * (fy - y1) - 1.0f;
-			yr = sin(yr * M_PI_2);
-			yr = sin(yr * M_PI_2);
-			yr = 0.5f * (yr + 1.0f);
-			float yri = 1.0f - yr;
-
-			if (y1 > 0) {
-				y1--;
-				if (y2 >= sy) y2--;
+	/* Apply curves; each height only depends on its own position, so the columns are independent */
+	HeightMapParallelLines(_height_map.size_x, _height_map.size_y, [&](uint x_begin, uint x_end) {
+		height_t ht[lengthof(curve_maps)];
+		MemSetT(ht, 0, lengthof(ht));
+
+		for (int x = x_begin; x < (int)x_end; x++) {
+
+			/* Get our X grid positions and bi-linear ratio */
+			float fx = (float)(sx * x) / _height_map.size_x + 1.0f;
+			uint x1 = (uint)fx;
+			uint x2 = x1;
+			float xr = 2.0f * (fx - x1) - 1.0f;
+			xr = sin(xr * M_PI_2);
+			xr = sin(xr * M_PI_2);
+			xr = 0.5f * (xr + 1.0f);
+			float xri = 1.0f - xr;
+
+			if (x1 > 0) {
+				x1--;
+				if (x2 >= sx) x2--;
 			}
 
-			uint corner_a = c[x1 + sx * y1];
-			uint corner_b = c[x1 + sx * y2];
-			uint corner_c = c[x2 + sx * y1];
-			uint corner_d = c[x2 + sx * y2];
-
-			/* Bitmask of which curve maps are chosen, so that we do not bother
-			 * calculating a curve which won't be used. */
-			uint corner_bits = 0;
-			corner_bits |= 1 << corner_a;
-			corner_bits |= 1 << corner_b;
-			corner_bits |= 1 << corner_c;
-			corner_bits |= 1 << corner_d;
-
-			height_t *h = &_height_map.height(x, y);
-
-			/* Do not touch sea level */
-			if (*h < I2H(1)) continue;
-
-			/* Only scale above sea level */
-			*h -= I2H(1);
-
-			/* Apply all curve maps that are used on this tile. */
-			for (uint t = 0; t < lengthof(curve_maps); t++) {
-				if (!HasBit(corner_bits, t)) continue;
-
-				bool found = false;
-				const control_point_t *cm = curve_maps[t].list;
-				for (uint i = 0; i < curve_maps[t].length - 1; i++) {
-					const control_point_t &p1 = cm[i];
-					const control_point_t &p2 = cm[i + 1];
-
-					if (*h >= p1.x && *h < p2.x) {
-						ht[t] = p1.y + (*h - p1.x) * (p2.y - p1.y) / (p2.x - p1.x);
-						found = true;
-						break;
+			for (int y = 0; y < _height_map.size_y; y++) {
+
+				/* Get our Y grid position and bi-linear ratio */
+				float fy = (float)(sy * y) / _height_map.size_y + 1.0f;
+				uint y1 = (uint)fy;
+				uint y2 = y1;
+				float yr = 2.0f * (fy - y1) - 1.0f;
+				yr = sin(yr * M_PI_2);
+				yr = sin(yr * M_PI_2);
+				yr = 0.5f * (yr + 1.0f);
+				float yri = 1.0f - yr;
+
+				if (y1 > 0) {
+					y1--;
+					if (y2 >= sy) y2--;
+				}
+
+				uint corner_a = c[x1 + sx * y1];
+				uint corner_b = c[x1 + sx * y2];
+				uint corner_c = c[x2 + sx * y1];
+				uint corner_d = c[x2 + sx * y2];
+
+				/* Bitmask of which curve maps are chosen, so that we do not bother
+				 * calculating a curve which won't be used. */
+				uint corner_bits = 0;
+				corner_bits |= 1 << corner_a;
+				corner_bits |= 1 << corner_b;
+				corner_bits |= 1 << corner_c;
+				corner_bits |= 1 << corner_d;
+
+				height_t *h = &_height_map.height(x, y);
+
+				/* Do not touch sea level */
+				if (*h < I2H(1)) continue;
+
+				/* Only scale above sea level */
+				*h -= I2H(1);
+
+				/* Apply all curve maps that are used on this tile. */
+				for (uint t = 0; t < lengthof(curve_maps); t++) {
+					if (!HasBit(corner_bits, t)) continue;
+
+					bool found = false;
+					const control_point_t *cm = curve_maps[t].list;
+					for (uint i = 0; i < curve_maps[t].length - 1; i++) {
+						const control_point_t &p1 = cm[i];
+						const control_point_t &p2 = cm[i + 1];
+
+						if (*h >= p1.x && *h < p2.x) {
+							ht[t] = p1.y + (*h - p1.x) * (p2.y - p1.y) / (p2.x - p1.x);
+							found = true;
+							break;
+						}
 					}
+					assert(found);
 				}
-				assert(found);
-			}
 
-			/* Apply interpolation of curve map results. */
-			*h = (height_t)((ht[corner_a] * yri + ht[corner_b] * yr) * xri + (ht[corner_c] * yri + ht[corner_d] * yr) * xr);
+				/* Apply interpolation of curve map results. */
+				*h = (height_t)((ht[corner_a] * yri + ht[corner_b] * yr) * xri + (ht[corner_c] * yri + ht[corner_d] * yr) * xr);
 
-			/* Readd sea level */
-			*h += I2H(1);
+				/* Readd sea level */
+				*h += I2H(1);
+			}
 		}
-	}
+	});
 }
 
 /** Adjusts heights in height map to contain required amount of water tiles */
@@ -841,18 +911,47 @@ static void HeightMapSmoothCoasts(uint8 water_borders)
  */
 static void HeightMapSmoothSlopes(height_t dh_max)
 {
-	for (int y = 0; y <= (int)_height_map.size_y; y++) {
-		for (int x = 0; x <= (int)_height_map.size_x; x++) {
-			height_t h_max = min(_height_map.height(x > 0 ? x - 1 : x, y), _height_map.height(x, y > 0 ? y - 1 : y)) + dh_max;
-			if (_height_map.height(x, y) > h_max) _height_map.height(x, y) = h_max;
+	/* Limiting each height to dh_max above its lower x neighbour and then to dh_max above its
+	 * lower y neighbour gives exactly the same result as limiting it against both neighbours
+	 * in a single sweep, as the limit from any height propagates along every monotone path.
+	 * This way all rows, and then all columns, can be processed independently. */
+	const int size_x = _height_map.size_x;
+	const int size_y = _height_map.size_y;
+
+	HeightMapParallelLines(size_y + 1, size_x + 1, [&](uint y_begin, uint y_end) {
+		for (int y = y_begin; y < (int)y_end; y++) {
+			for (int x = 1; x <= size_x; x++) {
+				height_t h_max = _height_map.height(x - 1, y) + dh_max;
+				if (_height_map.height(x, y) > h_max) _height_map.height(x, y) = h_max;
+			}
 		}
-	}
-	for (int y = _height_map.size_y; y >= 0; y--) {
-		for (int x = _height_map.size_x; x >= 0; x--) {
-			height_t h_max = min(_height_map.height(x < _height_map.size_x ? x + 1 : x, y), _height_map.height(x, y < _height_map.size_y ? y + 1 : y)) + dh_max;
-			if (_height_map.height(x, y) > h_max) _height_map.height(x, y) = h_max;
+	});
+	HeightMapParallelLines(size_x + 1, size_y + 1, [&](uint x_begin, uint x_end) {
+		for (int y = 1; y <= size_y; y++) {
+			for (int x = x_begin; x < (int)x_end; x++) {
+				height_t h_max = _height_map.height(x, y - 1) + dh_max;
+				if (_height_map.height(x, y) > h_max) _height_map.height(x, y) = h_max;
+			}
 		}
-	}
+	});
+
+	/* The same in the opposite direction. */
+	HeightMapParallelLines(size_y + 1, size_x + 1, [&](uint y_begin, uint y_end) {
+		for (int y = y_begin; y < (int)y_end; y++) {
+			for (int x = size_x - 1; x >= 0; x--) {
+				height_t h_max = _height_map.height(x + 1, y) + dh_max;
+				if (_height_map.height(x, y) > h_max) _height_map.height(x, y) = h_max;
+			}
+		}
+	});
+	HeightMapParallelLines(size_x + 1, size_y + 1, [&](uint x_begin, uint x_end) {
+		for (int y = size_y - 1; y >= 0; y--) {
+			for (int x = x_begin; x < (int)x_end; x++) {
+				height_t h_max = _height_map.height(x, y + 1) + dh_max;
+				if (_height_map.height(x, y) > h_max) _height_map.height(x, y) = h_max;
+			}
+		}
+	});
 }
 
 /**
@@ -11,8 +11,10 @@
 #define THREAD_H
 
 #include "debug.h"
+#include "core/math_func.hpp"
 #include <system_error>
 #include <thread>
+#include <vector>
 #if defined(__MINGW32__)
 #include "3rdparty/mingw-std-threads/mingw.thread.h"
 #endif
@@ -102,4 +104,55 @@ inline bool StartNewThread(std::thread *thr, const char *name, TFn&& _Fx, TArgs&
 	return false;
 }
 
+/**
+ * Get the number of threads to split a parallelisable workload over.
+ * @return The number of hardware threads, at least 1.
+ */
+inline uint GetWorkerThreadCount()
+{
+#ifndef NO_THREADS
+	return max<uint>(1, std::thread::hardware_concurrency());
+#else
+	return 1;
+#endif
+}
+
+/**
+ * Call a function for contiguous chunks of the range [begin, end), using up to GetWorkerThreadCount() threads.
+ * The calling thread processes the first chunk itself and returns once all chunks are done.
+ * The result must not depend on how the range is split, or it would depend on the number of threads.
+ * @param name Name of the worker threads.
+ * @param begin First index of the range.
+ * @param end One past the last index of the range.
+ * @param min_chunk Minimum number of indices worth handing to a thread.
+ * @param func Function called as func(chunk_begin, chunk_end).
+ */
+template <typename TFn>
+void ParallelForRange(const char *name, uint begin, uint end, uint min_chunk, TFn func)
+{
+	if (begin >= end) return;
+
+	const uint count = end - begin;
+	const uint threads = min<uint>(GetWorkerThreadCount(), CeilDiv(count, max<uint>(min_chunk, 1)));
+	if (threads <= 1) {
+		func(begin, end);
+		return;
+	}
+
+	const uint chunk = CeilDiv(count, threads);
+	std::vector<std::thread> workers(threads - 1);
+	for (uint i = 1; i < threads; i++) {
+		const uint chunk_begin = begin + i * chunk;
+		const uint chunk_end = min<uint>(end, chunk_begin + chunk);
+		if (chunk_begin >= chunk_end) break;
+		/* If no thread can be started, do the work on this one instead. */
+		if (!StartNewThread(&workers[i - 1], name, TFn(func), chunk_begin, chunk_end)) func(chunk_begin, chunk_end);
+	}
+	func(begin, begin + chunk);
+
+	for (std::thread &t : workers) {
+		if (t.joinable()) t.join();
+	}
+}
+
 #endif /* THREAD_H */
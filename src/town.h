@@ -96,8 +96,9 @@ struct Town : TownPool::PoolItem<&_town_pool> {
 
 	uint16 time_until_rebuild;       ///< time until we rebuild a house
 
-	uint16 grow_counter;             ///< counter to count when to grow, value is smaller than or equal to growth_rate
+	uint16 grow_counter;             ///< counter to count when to grow, value is smaller than or equal to growth_rate; only up to date when the town is not scheduled to grow, see #GetGrowCounter
 	uint16 growth_rate;              ///< town growth rate
+	uint64 grow_due;                 ///< NOSAVE: town tick the town grows in, or 0 if it is not scheduled to grow
 
 	byte fund_buildings_months;      ///< fund buildings program in action?
 	byte road_build_months;          ///< fund road reconstruction in action?
@@ -120,6 +121,8 @@ struct Town : TownPool::PoolItem<&_town_pool> {
 
 	void InitializeLayout(TownLayout layout);
 
+	uint16 GetGrowCounter() const;
+
 	void UpdateLabel();
 
 	/**
@@ -235,6 +238,8 @@ void UpdateTownRadius(Town *t);
 void UpdateTownCargoes(Town *t);
 void UpdateTownCargoTotal(Town *t);
 void UpdateTownCargoBitmap();
+void RebuildTownGrowthSchedule();
+bool IsTownGrowthScheduleValid(const Town *t);
 CommandCost CheckIfAuthorityAllowsNewStation(TileIndex tile, DoCommandFlag flags);
 Town *ClosestTownFromTile(TileIndex tile, uint threshold);
 void ChangeTownRating(Town *t, int add, int max, DoCommandFlag flags);
@@ -53,6 +53,8 @@
 #include "zoom_func.h"
 #include "zoning.h"
 #include "scope.h"
+#include "tracing.h"
+#include "3rdparty/cpp-btree/btree_set.h"
 
 #include "table/strings.h"
 #include "table/town_land.h"
@@ -70,6 +72,17 @@ static bool CanFollowRoad(TileIndex tile, DiagDirection dir);
 
 TownKdtree _town_kdtree(&Kdtree_TownXYFunc);
 
+/*
+ * Instead of counting down the grow counter of every growing town in every tick,
+ * growing towns are scheduled for the town tick their counter runs out in.
+ * The grow counter of a scheduled town is derived from that tick when needed.
+ * Towns which are due in the same tick are handled in order of their index,
+ * just like when all towns were visited.
+ */
+static uint64 _town_ticks = 0;                                             ///< Number of town ticks done so far.
+static TownID _town_ticking = INVALID_TOWN;                                ///< Town being handled by the current town tick, or #INVALID_TOWN.
+static btree::btree_set<std::pair<uint64, TownID>> _town_growth_schedule; ///< Growing towns, by their due town tick and index.
+
 void RebuildTownKdtree()
 {
 	std::vector<TownID> townids;
@@ -110,6 +123,8 @@ Town::~Town()
 	free(this->name);
 	free(this->text);
 
+	if (this->grow_due != 0) _town_growth_schedule.erase(std::make_pair(this->grow_due, this->index));
+
 	if (CleaningPool()) return;
 
 	/* Delete town authority window
@@ -1025,19 +1040,84 @@ void UpdateTownCargoBitmap()
 
 static bool GrowTown(Town *t);
 
+/**
+ * Get the number of town ticks which have counted down the grow counter of a town.
+ * @param t The town.
+ * @return The number of town ticks.
+ */
+static inline uint64 GetTownTicksDone(const Town *t)
+{
+	/* Towns after the town being handled have not been ticked in the current town tick yet. */
+	return (_town_ticking != INVALID_TOWN && t->index > _town_ticking) ? _town_ticks - 1 : _town_ticks;
+}
+
+/**
+ * Get the counter to count when the town grows.
+ * @return The grow counter.
+ */
+uint16 Town::GetGrowCounter() const
+{
+	if (this->grow_due == 0) return this->grow_counter;
+	return (uint16)(this->grow_due - GetTownTicksDone(this) - 1);
+}
+
+/**
+ * Take a town off the growth schedule, and bring its grow counter up to date.
+ * Must be called before reading or changing Town::grow_counter.
+ * @param t The town.
+ */
+static void UnscheduleTownGrowth(Town *t)
+{
+	if (t->grow_due == 0) return;
+	t->grow_counter = t->GetGrowCounter();
+	_town_growth_schedule.erase(std::make_pair(t->grow_due, t->index));
+	t->grow_due = 0;
+}
+
+/**
+ * Put a town on the growth schedule according to its grow counter, if it is growing.
+ * Must be called after changing Town::grow_counter or whether the town is growing.
+ * @param t The town.
+ */
+static void ScheduleTownGrowth(Town *t)
+{
+	UnscheduleTownGrowth(t);
+	if (!HasBit(t->flags, TOWN_IS_GROWING) || t->index == _town_ticking) return;
+
+	t->grow_due = GetTownTicksDone(t) + t->grow_counter + 1;
+	_town_growth_schedule.insert(std::make_pair(t->grow_due, t->index));
+}
+
+/** Rebuild the growth schedule of all towns, e.g. after loading a game. */
+void RebuildTownGrowthSchedule()
+{
+	_town_growth_schedule.clear();
+	for (Town *t : Town::Iterate()) {
+		t->grow_due = 0;
+		ScheduleTownGrowth(t);
+	}
+}
+
+/**
+ * Check whether a town is on the growth schedule exactly when it is growing.
+ * @param t The town.
+ * @return True if the schedule of the town is valid.
+ */
+bool IsTownGrowthScheduleValid(const Town *t)
+{
+	if (!HasBit(t->flags, TOWN_IS_GROWING)) return t->grow_due == 0;
+	return t->grow_due > _town_ticks && _town_growth_schedule.count(std::make_pair(t->grow_due, t->index)) == 1;
+}
+
 static void TownTickHandler(Town *t)
 {
-	if (HasBit(t->flags, TOWN_IS_GROWING)) {
-		int i = (int)t->grow_counter - 1;
-		if (i < 0) {
-			if (GrowTown(t)) {
-				i = t->growth_rate;
-			} else {
-				/* If growth failed wait a bit before retrying */
-				i = min(t->growth_rate, TOWN_GROWTH_TICKS - 1);
-			}
-		}
-		t->grow_counter = i;
+	/* The grow counter of the town has just run out. */
+	t->grow_counter = 0;
+	if (GrowTown(t)) {
+		t->grow_counter = t->growth_rate;
+	} else {
+		/* If growth failed wait a bit before retrying */
+		t->grow_counter = min(t->growth_rate, TOWN_GROWTH_TICKS - 1);
 	}
 }
 
@@ -1045,9 +1125,21 @@ void OnTick_Town()
 {
 	if (_game_mode == GM_EDITOR) return;
 
-	for (Town *t : Town::Iterate()) {
+	_town_ticks++;
+	while (!_town_growth_schedule.empty() && _town_growth_schedule.begin()->first == _town_ticks) {
+		Town *t = Town::Get(_town_growth_schedule.begin()->second);
+		TRACE_ZONE_ID("Town tick", t->index);
+		assert(HasBit(t->flags, TOWN_IS_GROWING));
+		_town_growth_schedule.erase(_town_growth_schedule.begin());
+		t->grow_due = 0;
+
+		_town_ticking = t->index;
 		TownTickHandler(t);
+		_town_ticking = INVALID_TOWN;
+
+		ScheduleTownGrowth(t);
 	}
+	assert(_town_growth_schedule.empty() || _town_growth_schedule.begin()->first > _town_ticks);
 }
 
 /**
@@ -3087,6 +3179,7 @@ CommandCost CmdTownGrowthRate(TileIndex tile, DoCommandFlag flags, uint32 p1, ui
 	if (t == nullptr) return CMD_ERROR;
 
 	if (flags & DC_EXEC) {
+		UnscheduleTownGrowth(t);
 		if (p2 == 0) {
 			/* Just clear the flag, UpdateTownGrowth will determine a proper growth rate */
 			ClrBit(t->flags, TOWN_CUSTOM_GROWTH);
@@ -3437,7 +3530,9 @@ static CommandCost TownActionFundBuildings(Town *t, DoCommandFlag flags)
 		 * tick-perfect and gives player some time window where he can
 		 * spam funding with the exact same efficiency.
 		 */
+		UnscheduleTownGrowth(t);
 		t->grow_counter = min(t->grow_counter, 2 * TOWN_GROWTH_TICKS - (t->growth_rate - t->grow_counter) % TOWN_GROWTH_TICKS);
+		ScheduleTownGrowth(t);
 
 		SetWindowDirty(WC_TOWN_VIEW, t->index);
 	}
@@ -3739,9 +3834,11 @@ static uint GetNormalGrowthRate(Town *t)
 static void UpdateTownGrowthRate(Town *t)
 {
 	if (HasBit(t->flags, TOWN_CUSTOM_GROWTH)) return;
+	UnscheduleTownGrowth(t);
 	uint old_rate = t->growth_rate;
 	t->growth_rate = GetNormalGrowthRate(t);
 	UpdateTownGrowCounter(t, old_rate);
+	ScheduleTownGrowth(t);
 	SetWindowDirty(WC_TOWN_VIEW, t->index);
 }
 
@@ -3752,9 +3849,11 @@ static void UpdateTownGrowthRate(Town *t)
 static void UpdateTownGrowth(Town *t)
 {
 	auto guard = scope_guard([t]() {
+		ScheduleTownGrowth(t);
 		SetWindowDirty(WC_TOWN_VIEW, t->index);
 	});
 
+	UnscheduleTownGrowth(t);
 	SetBit(t->flags, TOWN_IS_GROWING);
 	UpdateTownGrowthRate(t);
 	if (!HasBit(t->flags, TOWN_IS_GROWING)) return;
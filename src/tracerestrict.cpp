@@ -173,9 +173,9 @@ static bool TestCondition(int value, TraceRestrictCondOp condop, int condvalue)
 /**
  * Binary condition testing helper function
  */
-static bool TestBinaryConditionCommon(TraceRestrictItem item, bool input)
+static bool TestBinaryConditionCommon(const TraceRestrictInstruction &op, bool input)
 {
-	switch (GetTraceRestrictCondOp(item)) {
+	switch (op.condop) {
 		case TRCO_IS:
 			return input;
 
@@ -192,13 +192,13 @@ static bool TestBinaryConditionCommon(TraceRestrictItem item, bool input)
  * Test order condition
  * @p order may be nullptr
  */
-static bool TestOrderCondition(const Order *order, TraceRestrictItem item)
+static bool TestOrderCondition(const Order *order, const TraceRestrictInstruction &op)
 {
 	bool result = false;
 
 	if (order) {
-		DestinationID condvalue = GetTraceRestrictValue(item);
-		switch (static_cast<TraceRestrictOrderCondAuxField>(GetTraceRestrictAuxField(item))) {
+		DestinationID condvalue = op.value;
+		switch (static_cast<TraceRestrictOrderCondAuxField>(op.aux_field)) {
 			case TROCAF_STATION:
 				result = (order->IsType(OT_GOTO_STATION) || order->IsType(OT_LOADING_ADVANCE))
 						&& order->GetDestination() == condvalue;
@@ -216,16 +216,16 @@ static bool TestOrderCondition(const Order *order, TraceRestrictItem item)
 				NOT_REACHED();
 		}
 	}
-	return TestBinaryConditionCommon(item, result);
+	return TestBinaryConditionCommon(op, result);
 }
 
 /**
  * Test station condition
  */
-static bool TestStationCondition(StationID station, TraceRestrictItem item)
+static bool TestStationCondition(StationID station, const TraceRestrictInstruction &op)
 {
-	bool result = (GetTraceRestrictAuxField(item) == TROCAF_STATION) && (station == GetTraceRestrictValue(item));
-	return TestBinaryConditionCommon(item, result);
+	bool result = (op.aux_field == TROCAF_STATION) && (station == op.value);
+	return TestBinaryConditionCommon(op, result);
 
 }
 
@@ -236,35 +236,40 @@ static bool TestStationCondition(StationID station, TraceRestrictItem item)
  */
 void TraceRestrictProgram::Execute(const Train* v, const TraceRestrictProgramInput &input, TraceRestrictProgramResult& out) const
 {
-	// static to avoid needing to re-alloc/resize on each execution
-	static std::vector<TraceRestrictCondStackFlags> condstack;
-	condstack.clear();
-
 	bool have_previous_signal = false;
 	TileIndex previous_signal_tile = INVALID_TILE;
 
-	size_t size = this->items.size();
-	for (size_t i = 0; i < size; i++) {
-		TraceRestrictItem item = this->items[i];
-		TraceRestrictItemType type = GetTraceRestrictType(item);
+	/* Whether the current instruction was reached from a false condition at the same level,
+	 * rather than by reaching the end of a branch which was taken */
+	bool jumped = false;
 
-		if (IsTraceRestrictConditional(item)) {
-			TraceRestrictCondFlags condflags = GetTraceRestrictCondFlags(item);
-			TraceRestrictCondOp condop = GetTraceRestrictCondOp(item);
+	const size_t size = this->instructions.size();
+	for (size_t i = 0; i < size;) {
+		const TraceRestrictInstruction &op = this->instructions[i];
+		const TraceRestrictItemType type = op.type;
+
+		if (IsTraceRestrictTypeConditional(type)) {
+			const TraceRestrictCondFlags condflags = op.condflags;
+			const TraceRestrictCondOp condop = op.condop;
+			const bool after_false_condition = jumped;
+			jumped = false;
 
 			if (type == TRIT_COND_ENDIF) {
-				assert(!condstack.empty());
-				if (condflags & TRCF_ELSE) {
-					// else
-					assert(!(condstack.back() & TRCSF_SEEN_ELSE));
-					HandleCondition(condstack, condflags, true);
-					condstack.back() |= TRCSF_SEEN_ELSE;
+				if ((condflags & TRCF_ELSE) && !after_false_condition) {
+					// else, after a branch which was taken
+					i = op.end;
 				} else {
-					// end if
-					condstack.pop_back();
+					// end if, or else after no branch was taken
+					i++;
 				}
+			} else if ((condflags & TRCF_OR) && !after_false_condition) {
+				// orif, the preceding condition is true
+				i++;
+			} else if ((condflags & TRCF_ELSE) && !after_false_condition) {
+				// elif, after a branch which was taken
+				i = op.end;
 			} else {
-				uint16 condvalue = GetTraceRestrictValue(item);
+				uint16 condvalue = op.value;
 				bool result = false;
 				switch(type) {
 					case TRIT_COND_UNDEFINED:
@@ -280,7 +285,7 @@ void TraceRestrictProgram::Execute(const Train* v, const TraceRestrictProgramInp
 						break;
 
 					case TRIT_COND_CURRENT_ORDER:
-						result = TestOrderCondition(&(v->current_order), item);
+						result = TestOrderCondition(&(v->current_order), op);
 						break;
 
 					case TRIT_COND_NEXT_ORDER: {
@@ -290,7 +295,7 @@ void TraceRestrictProgram::Execute(const Train* v, const TraceRestrictProgramInp
 						const Order *current_order = v->GetOrder(v->cur_real_order_index);
 						for (const Order *order = v->orders.list->GetNext(current_order); order != current_order; order = v->orders.list->GetNext(order)) {
 							if (order->IsGotoOrder()) {
-								result = TestOrderCondition(order, item);
+								result = TestOrderCondition(order, op);
 								break;
 							}
 						}
@@ -298,29 +303,29 @@ void TraceRestrictProgram::Execute(const Train* v, const TraceRestrictProgramInp
 					}
 
 					case TRIT_COND_LAST_STATION:
-						result = TestStationCondition(v->last_station_visited, item);
+						result = TestStationCondition(v->last_station_visited, op);
 						break;
 
 					case TRIT_COND_CARGO: {
 						bool have_cargo = false;
 						for (const Vehicle *v_iter = v; v_iter != nullptr; v_iter = v_iter->Next()) {
-							if (v_iter->cargo_type == GetTraceRestrictValue(item) && v_iter->cargo_cap > 0) {
+							if (v_iter->cargo_type == op.value && v_iter->cargo_cap > 0) {
 								have_cargo = true;
 								break;
 							}
 						}
-						result = TestBinaryConditionCommon(item, have_cargo);
+						result = TestBinaryConditionCommon(op, have_cargo);
 						break;
 					}
 
 					case TRIT_COND_ENTRY_DIRECTION: {
 						bool direction_match;
-						switch (GetTraceRestrictValue(item)) {
+						switch (op.value) {
 							case TRNTSV_NE:
 							case TRNTSV_SE:
 							case TRNTSV_SW:
 							case TRNTSV_NW:
-								direction_match = (static_cast<DiagDirection>(GetTraceRestrictValue(item)) == TrackdirToExitdir(ReverseTrackdir(input.trackdir)));
+								direction_match = (static_cast<DiagDirection>(op.value) == TrackdirToExitdir(ReverseTrackdir(input.trackdir)));
 								break;
 
 							case TRDTSV_FRONT:
@@ -335,14 +340,13 @@ void TraceRestrictProgram::Execute(const Train* v, const TraceRestrictProgramInp
 								NOT_REACHED();
 								break;
 						}
-						result = TestBinaryConditionCommon(item, direction_match);
+						result = TestBinaryConditionCommon(op, direction_match);
 						break;
 					}
 
 					case TRIT_COND_PBS_ENTRY_SIGNAL: {
 						// TRVT_TILE_INDEX value type uses the next slot
-						i++;
-						uint32_t signal_tile = this->items[i];
+						uint32_t signal_tile = op.secondary;
 						if (!have_previous_signal) {
 							if (input.previous_signal_callback) {
 								previous_signal_tile = input.previous_signal_callback(v, input.previous_signal_ptr);
@@ -351,27 +355,26 @@ void TraceRestrictProgram::Execute(const Train* v, const TraceRestrictProgramInp
 						}
 						bool match = (signal_tile != INVALID_TILE)
 								&& (previous_signal_tile == signal_tile);
-						result = TestBinaryConditionCommon(item, match);
+						result = TestBinaryConditionCommon(op, match);
 						break;
 					}
 
 					case TRIT_COND_TRAIN_GROUP: {
-						result = TestBinaryConditionCommon(item, GroupIsInGroup(v->group_id, GetTraceRestrictValue(item)));
+						result = TestBinaryConditionCommon(op, GroupIsInGroup(v->group_id, op.value));
 						break;
 					}
 
 					case TRIT_COND_TRAIN_IN_SLOT: {
-						const TraceRestrictSlot *slot = TraceRestrictSlot::GetIfValid(GetTraceRestrictValue(item));
-						result = TestBinaryConditionCommon(item, slot != nullptr && slot->IsOccupant(v->index));
+						const TraceRestrictSlot *slot = TraceRestrictSlot::GetIfValid(op.value);
+						result = TestBinaryConditionCommon(op, slot != nullptr && slot->IsOccupant(v->index));
 						break;
 					}
 
 					case TRIT_COND_SLOT_OCCUPANCY: {
 						// TRIT_COND_SLOT_OCCUPANCY value type uses the next slot
-						i++;
-						uint32_t value = this->items[i];
-						const TraceRestrictSlot *slot = TraceRestrictSlot::GetIfValid(GetTraceRestrictValue(item));
-						switch (static_cast<TraceRestrictSlotOccupancyCondAuxField>(GetTraceRestrictAuxField(item))) {
+						uint32_t value = op.secondary;
+						const TraceRestrictSlot *slot = TraceRestrictSlot::GetIfValid(op.value);
+						switch (static_cast<TraceRestrictSlotOccupancyCondAuxField>(op.aux_field)) {
 							case TRSOCAF_OCCUPANTS:
 								result = TestCondition(slot != nullptr ? slot->occupants.size() : 0, condop, value);
 								break;
@@ -388,7 +391,7 @@ void TraceRestrictProgram::Execute(const Train* v, const TraceRestrictProgramInp
 					}
 
 					case TRIT_COND_PHYS_PROP: {
-						switch (static_cast<TraceRestrictPhysPropCondAuxField>(GetTraceRestrictAuxField(item))) {
+						switch (static_cast<TraceRestrictPhysPropCondAuxField>(op.aux_field)) {
 							case TRPPCAF_WEIGHT:
 								result = TestCondition(v->gcache.cached_weight, condop, condvalue);
 								break;
@@ -409,7 +412,7 @@ void TraceRestrictProgram::Execute(const Train* v, const TraceRestrictProgramInp
 					}
 
 					case TRIT_COND_PHYS_RATIO: {
-						switch (static_cast<TraceRestrictPhysPropRatioCondAuxField>(GetTraceRestrictAuxField(item))) {
+						switch (static_cast<TraceRestrictPhysPropRatioCondAuxField>(op.aux_field)) {
 							case TRPPRCAF_POWER_WEIGHT:
 								result = TestCondition(min<uint>(UINT16_MAX, (100 * v->gcache.cached_power) / max<uint>(1, v->gcache.cached_weight)), condop, condvalue);
 								break;
@@ -426,14 +429,14 @@ void TraceRestrictProgram::Execute(const Train* v, const TraceRestrictProgramInp
 					}
 
 					case TRIT_COND_TRAIN_OWNER: {
-						result = TestBinaryConditionCommon(item, v->owner == condvalue);
+						result = TestBinaryConditionCommon(op, v->owner == condvalue);
 						break;
 					}
 
 
 					case TRIT_COND_TRAIN_STATUS: {
 						bool has_status = false;
-						switch (static_cast<TraceRestrictTrainStatusValueField>(GetTraceRestrictValue(item))) {
+						switch (static_cast<TraceRestrictTrainStatusValueField>(op.value)) {
 							case TRTSVF_EMPTY:
 								has_status = true;
 								for (const Vehicle *v_iter = v; v_iter != nullptr; v_iter = v_iter->Next()) {
@@ -490,7 +493,7 @@ void TraceRestrictProgram::Execute(const Train* v, const TraceRestrictProgramInp
 								has_status = v->NeedsServicing();
 								break;
 						}
-						result = TestBinaryConditionCommon(item, has_status);
+						result = TestBinaryConditionCommon(op, has_status);
 						break;
 					}
 
@@ -502,152 +505,156 @@ void TraceRestrictProgram::Execute(const Train* v, const TraceRestrictProgramInp
 					default:
 						NOT_REACHED();
 				}
-				HandleCondition(condstack, condflags, result);
+				if (result) {
+					i++;
+				} else {
+					// skip to the next elif/orif/else/endif at this level
+					i = op.next;
+					jumped = true;
+				}
 			}
 		} else {
-			if (condstack.empty() || condstack.back() & TRCSF_ACTIVE) {
-				switch(type) {
-					case TRIT_PF_DENY:
-						if (GetTraceRestrictValue(item)) {
-							out.flags &= ~TRPRF_DENY;
-						} else {
-							out.flags |= TRPRF_DENY;
-						}
-						break;
-
-					case TRIT_PF_PENALTY:
-						switch (static_cast<TraceRestrictPathfinderPenaltyAuxField>(GetTraceRestrictAuxField(item))) {
-							case TRPPAF_VALUE:
-								out.penalty += GetTraceRestrictValue(item);
-								break;
+			switch(type) {
+				case TRIT_PF_DENY:
+					if (op.value) {
+						out.flags &= ~TRPRF_DENY;
+					} else {
+						out.flags |= TRPRF_DENY;
+					}
+					break;
 
-							case TRPPAF_PRESET: {
-								uint16 index = GetTraceRestrictValue(item);
-								assert(index < TRPPPI_END);
-								out.penalty += _tracerestrict_pathfinder_penalty_preset_values[index];
-								break;
-							}
+				case TRIT_PF_PENALTY:
+					switch (static_cast<TraceRestrictPathfinderPenaltyAuxField>(op.aux_field)) {
+						case TRPPAF_VALUE:
+							out.penalty += op.value;
+							break;
 
-							default:
-								NOT_REACHED();
+						case TRPPAF_PRESET: {
+							uint16 index = op.value;
+							assert(index < TRPPPI_END);
+							out.penalty += _tracerestrict_pathfinder_penalty_preset_values[index];
+							break;
 						}
-						break;
 
-					case TRIT_RESERVE_THROUGH:
-						if (GetTraceRestrictValue(item)) {
-							out.flags &= ~TRPRF_RESERVE_THROUGH;
-						} else {
-							out.flags |= TRPRF_RESERVE_THROUGH;
-						}
-						break;
+						default:
+							NOT_REACHED();
+					}
+					break;
 
-					case TRIT_LONG_RESERVE:
-						if (GetTraceRestrictValue(item)) {
-							out.flags &= ~TRPRF_LONG_RESERVE;
-						} else {
-							out.flags |= TRPRF_LONG_RESERVE;
-						}
-						break;
+				case TRIT_RESERVE_THROUGH:
+					if (op.value) {
+						out.flags &= ~TRPRF_RESERVE_THROUGH;
+					} else {
+						out.flags |= TRPRF_RESERVE_THROUGH;
+					}
+					break;
 
-					case TRIT_WAIT_AT_PBS:
-						switch (static_cast<TraceRestrictWaitAtPbsValueField>(GetTraceRestrictValue(item))) {
-							case TRWAPVF_WAIT_AT_PBS:
-								out.flags |= TRPRF_WAIT_AT_PBS;
-								break;
+				case TRIT_LONG_RESERVE:
+					if (op.value) {
+						out.flags &= ~TRPRF_LONG_RESERVE;
+					} else {
+						out.flags |= TRPRF_LONG_RESERVE;
+					}
+					break;
 
-							case TRWAPVF_CANCEL_WAIT_AT_PBS:
-								out.flags &= ~TRPRF_WAIT_AT_PBS;
-								break;
+				case TRIT_WAIT_AT_PBS:
+					switch (static_cast<TraceRestrictWaitAtPbsValueField>(op.value)) {
+						case TRWAPVF_WAIT_AT_PBS:
+							out.flags |= TRPRF_WAIT_AT_PBS;
+							break;
 
-							case TRWAPVF_PBS_RES_END_WAIT:
-								out.flags |= TRPRF_PBS_RES_END_WAIT;
-								break;
+						case TRWAPVF_CANCEL_WAIT_AT_PBS:
+							out.flags &= ~TRPRF_WAIT_AT_PBS;
+							break;
 
-							case TRWAPVF_CANCEL_PBS_RES_END_WAIT:
-								out.flags &= ~TRPRF_PBS_RES_END_WAIT;
-								break;
+						case TRWAPVF_PBS_RES_END_WAIT:
+							out.flags |= TRPRF_PBS_RES_END_WAIT;
+							break;
 
-							default:
-								NOT_REACHED();
-								break;
-						}
-						break;
+						case TRWAPVF_CANCEL_PBS_RES_END_WAIT:
+							out.flags &= ~TRPRF_PBS_RES_END_WAIT;
+							break;
 
-					case TRIT_SLOT: {
-						if (!input.permitted_slot_operations) break;
-						TraceRestrictSlot *slot = TraceRestrictSlot::GetIfValid(GetTraceRestrictValue(item));
-						if (slot == nullptr) break;
-						switch (static_cast<TraceRestrictSlotCondOpField>(GetTraceRestrictCondOp(item))) {
-							case TRSCOF_ACQUIRE_WAIT:
-								if (input.permitted_slot_operations & TRPISP_ACQUIRE) {
-									if (!slot->Occupy(v->index)) out.flags |= TRPRF_WAIT_AT_PBS;
-								}
-								break;
+						default:
+							NOT_REACHED();
+							break;
+					}
+					break;
 
-							case TRSCOF_ACQUIRE_TRY:
-								if (input.permitted_slot_operations & TRPISP_ACQUIRE) slot->Occupy(v->index);
-								break;
+				case TRIT_SLOT: {
+					if (!input.permitted_slot_operations) break;
+					TraceRestrictSlot *slot = TraceRestrictSlot::GetIfValid(op.value);
+					if (slot == nullptr) break;
+					switch (static_cast<TraceRestrictSlotCondOpField>(op.condop)) {
+						case TRSCOF_ACQUIRE_WAIT:
+							if (input.permitted_slot_operations & TRPISP_ACQUIRE) {
+								if (!slot->Occupy(v->index)) out.flags |= TRPRF_WAIT_AT_PBS;
+							}
+							break;
 
-							case TRSCOF_RELEASE_BACK:
-								if (input.permitted_slot_operations & TRPISP_RELEASE_BACK) slot->Vacate(v->index);
-								break;
+						case TRSCOF_ACQUIRE_TRY:
+							if (input.permitted_slot_operations & TRPISP_ACQUIRE) slot->Occupy(v->index);
+							break;
 
-							case TRSCOF_RELEASE_FRONT:
-								if (input.permitted_slot_operations & TRPISP_RELEASE_FRONT) slot->Vacate(v->index);
-								break;
+						case TRSCOF_RELEASE_BACK:
+							if (input.permitted_slot_operations & TRPISP_RELEASE_BACK) slot->Vacate(v->index);
+							break;
 
-							case TRSCOF_PBS_RES_END_ACQ_WAIT:
-								if (input.permitted_slot_operations & TRPISP_PBS_RES_END_ACQUIRE) {
-									if (!slot->Occupy(v->index)) out.flags |= TRPRF_PBS_RES_END_WAIT;
-								} else if (input.permitted_slot_operations & TRPISP_PBS_RES_END_ACQ_DRY) {
-									if (!slot->OccupyDryRun(v->index)) out.flags |= TRPRF_PBS_RES_END_WAIT;
-								}
-								break;
+						case TRSCOF_RELEASE_FRONT:
+							if (input.permitted_slot_operations & TRPISP_RELEASE_FRONT) slot->Vacate(v->index);
+							break;
 
-							case TRSCOF_PBS_RES_END_ACQ_TRY:
-								if (input.permitted_slot_operations & TRPISP_PBS_RES_END_ACQUIRE) slot->Occupy(v->index);
-								break;
+						case TRSCOF_PBS_RES_END_ACQ_WAIT:
+							if (input.permitted_slot_operations & TRPISP_PBS_RES_END_ACQUIRE) {
+								if (!slot->Occupy(v->index)) out.flags |= TRPRF_PBS_RES_END_WAIT;
+							} else if (input.permitted_slot_operations & TRPISP_PBS_RES_END_ACQ_DRY) {
+								if (!slot->OccupyDryRun(v->index)) out.flags |= TRPRF_PBS_RES_END_WAIT;
+							}
+							break;
 
-							case TRSCOF_PBS_RES_END_RELEASE:
-								if (input.permitted_slot_operations & TRPISP_PBS_RES_END_RELEASE) slot->Vacate(v->index);
-								break;
+						case TRSCOF_PBS_RES_END_ACQ_TRY:
+							if (input.permitted_slot_operations & TRPISP_PBS_RES_END_ACQUIRE) slot->Occupy(v->index);
+							break;
 
-							default:
-								NOT_REACHED();
-								break;
-						}
-						break;
-					}
+						case TRSCOF_PBS_RES_END_RELEASE:
+							if (input.permitted_slot_operations & TRPISP_PBS_RES_END_RELEASE) slot->Vacate(v->index);
+							break;
 
-					case TRIT_REVERSE:
-						switch (static_cast<TraceRestrictReverseValueField>(GetTraceRestrictValue(item))) {
-							case TRRVF_REVERSE:
-								out.flags |= TRPRF_REVERSE;
-								break;
+						default:
+							NOT_REACHED();
+							break;
+					}
+					break;
+				}
 
-							case TRRVF_CANCEL_REVERSE:
-								out.flags &= ~TRPRF_REVERSE;
-								break;
+				case TRIT_REVERSE:
+					switch (static_cast<TraceRestrictReverseValueField>(op.value)) {
+						case TRRVF_REVERSE:
+							out.flags |= TRPRF_REVERSE;
+							break;
 
-							default:
-								NOT_REACHED();
-								break;
-						}
-						break;
+						case TRRVF_CANCEL_REVERSE:
+							out.flags &= ~TRPRF_REVERSE;
+							break;
 
-					case TRIT_SPEED_RESTRICTION: {
-						out.speed_restriction = GetTraceRestrictValue(item);
-						out.flags |= TRPRF_SPEED_RETRICTION_SET;
-						break;
+						default:
+							NOT_REACHED();
+							break;
 					}
+					break;
 
-					default:
-						NOT_REACHED();
+				case TRIT_SPEED_RESTRICTION: {
+					out.speed_restriction = op.value;
+					out.flags |= TRPRF_SPEED_RETRICTION_SET;
+					break;
 				}
+
+				default:
+					NOT_REACHED();
 			}
+			i++;
 		}
 	}
-	assert(condstack.empty());
 }
 
 /**
@@ -661,6 +668,59 @@ void TraceRestrictProgram::DecrementRefCount() {
 	}
 }
 
+/**
+ * Compile the instruction list into the pre-decoded form used by Execute
+ * The jump targets of the conditionals are resolved here, such that execution does not need a condition stack
+ * The instruction list must be valid, see Validate
+ */
+void TraceRestrictProgram::Compile()
+{
+	struct CondLevel {
+		uint32 first_branch; ///< Instruction index of the if
+		uint32 last_branch;  ///< Instruction index of the latest if/elif/orif/else
+	};
+	std::vector<CondLevel> levels;
+
+	this->instructions.clear();
+	this->instructions.reserve(this->items.size());
+
+	for (size_t i = 0; i < this->items.size(); i++) {
+		TraceRestrictItem item = this->items[i];
+
+		TraceRestrictInstruction op;
+		op.type = GetTraceRestrictType(item);
+		op.condflags = GetTraceRestrictCondFlags(item);
+		op.condop = GetTraceRestrictCondOp(item);
+		op.aux_field = GetTraceRestrictAuxField(item);
+		op.value = GetTraceRestrictValue(item);
+		op.secondary = IsTraceRestrictDoubleItem(item) ? this->items[++i] : 0;
+		op.next = 0;
+		op.end = 0;
+
+		const uint32 index = (uint32)this->instructions.size();
+		if (IsTraceRestrictTypeConditional(op.type)) {
+			if (op.type == TRIT_COND_ENDIF || (op.condflags & (TRCF_ELSE | TRCF_OR))) {
+				// elif/orif/else/endif: link from the previous branch at this level
+				assert(!levels.empty());
+				this->instructions[levels.back().last_branch].next = index;
+				levels.back().last_branch = index;
+			}
+			if (op.type == TRIT_COND_ENDIF && !(op.condflags & TRCF_ELSE)) {
+				// end if: all branches at this level end here
+				for (uint32 j = levels.back().first_branch; j != index; j = this->instructions[j].next) {
+					this->instructions[j].end = index + 1;
+				}
+				levels.pop_back();
+			} else if (op.type != TRIT_COND_ENDIF && !(op.condflags & (TRCF_ELSE | TRCF_OR))) {
+				// if
+				levels.push_back({ index, index });
+			}
+		}
+		this->instructions.push_back(op);
+	}
+	assert(levels.empty());
+}
+
 /**
  * Validate a instruction list
  * Returns successful result if program seems OK
@@ -1386,6 +1446,7 @@ CommandCost CmdProgramSignalTraceRestrict(TileIndex tile, DoCommandFlag flags, u
 		// move in modified program
 		prog->items.swap(items);
 		prog->actions_used_flags = actions_used_flags;
+		prog->Compile();
 
 		if (prog->items.size() == 0 && prog->refcount == 1) {
 			// program is empty, and this tile is the only reference to it
@@ -1560,6 +1621,7 @@ void TraceRestrictRemoveDestinationID(TraceRestrictOrderCondAuxField type, uint1
 			}
 			if (IsTraceRestrictDoubleItem(item)) i++;
 		}
+		prog->Compile();
 	}
 
 	// update windows
@@ -1580,6 +1642,7 @@ void TraceRestrictRemoveGroupID(GroupID index)
 			}
 			if (IsTraceRestrictDoubleItem(item)) i++;
 		}
+		prog->Compile();
 	}
 
 	// update windows
@@ -1603,6 +1666,7 @@ void TraceRestrictUpdateCompanyID(CompanyID old_company, CompanyID new_company)
 			}
 			if (IsTraceRestrictDoubleItem(item)) i++;
 		}
+		prog->Compile();
 	}
 
 	for (TraceRestrictSlot *slot : TraceRestrictSlot::Iterate()) {
@@ -1806,6 +1870,7 @@ void TraceRestrictRemoveSlotID(TraceRestrictSlotID index)
 			}
 			if (IsTraceRestrictDoubleItem(item)) i++;
 		}
+		prog->Compile();
 	}
 
 	bool changed_order = false;
@@ -370,12 +370,27 @@ struct TraceRestrictProgramResult {
 			: penalty(0), flags(static_cast<TraceRestrictProgramResultFlags>(0)) { }
 };
 
+/**
+ * Pre-decoded instruction of a compiled TraceRestrictProgram, see TraceRestrictProgram::Compile
+ */
+struct TraceRestrictInstruction {
+	TraceRestrictItemType type;              ///< Type field
+	TraceRestrictCondFlags condflags;        ///< Condition flags field, only for conditionals
+	TraceRestrictCondOp condop;              ///< Condition operator field
+	uint8 aux_field;                         ///< Auxiliary field
+	uint16 value;                            ///< Value field
+	uint32 secondary;                        ///< Second item of double-item instructions
+	uint32 next;                             ///< Conditionals: instruction to continue at when the condition is false, this is the next elif/orif/else/endif at the same level
+	uint32 end;                              ///< Elif/else: instruction to continue at when a previous branch at the same level was taken, this is one past the endif
+};
+
 /**
  * Program type, this stores the instruction list
  * This is refcounted, see info at top of tracerestrict.cpp
  */
 struct TraceRestrictProgram : TraceRestrictProgramPool::PoolItem<&_tracerestrictprogram_pool> {
 	std::vector<TraceRestrictItem> items;
+	std::vector<TraceRestrictInstruction> instructions; ///< Compiled form of items, used for execution
 	uint32 refcount;
 	TraceRestrictProgramActionsUsedFlags actions_used_flags;
 
@@ -391,6 +406,8 @@ struct TraceRestrictProgram : TraceRestrictProgramPool::PoolItem<&_tracerestrict
 
 	void DecrementRefCount();
 
+	void Compile();
+
 	static CommandCost Validate(const std::vector<TraceRestrictItem> &items, TraceRestrictProgramActionsUsedFlags &actions_used_flags);
 
 	static size_t InstructionOffsetToArrayOffset(const std::vector<TraceRestrictItem> &items, size_t offset);
@@ -433,10 +450,12 @@ struct TraceRestrictProgram : TraceRestrictProgramPool::PoolItem<&_tracerestrict
 		return items.begin() + TraceRestrictProgram::InstructionOffsetToArrayOffset(items, instruction_offset);
 	}
 
-	/** Call validation function on current program instruction list and set actions_used_flags */
+	/** Call validation function on current program instruction list and set actions_used_flags, compile the program if it is valid */
 	CommandCost Validate()
 	{
-		return TraceRestrictProgram::Validate(items, actions_used_flags);
+		CommandCost result = TraceRestrictProgram::Validate(items, actions_used_flags);
+		if (result.Succeeded()) this->Compile();
+		return result;
 	}
 };
 
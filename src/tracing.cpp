@@ -0,0 +1,262 @@
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file tracing.cpp Recording of the trace zones and their export to Chrome trace files. */
+
+#include "stdafx.h"
+#include "tracing.h"
+#include "thread.h"
+#include "fileio_func.h"
+#include "string_func.h"
+#include "console_func.h"
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <time.h>
+
+#include "safeguards.h"
+
+#ifdef USE_TRACE_ZONES
+
+/** Whether zones are recorded, see #TRACE_ZONE. */
+std::atomic<bool> _trace_zones_active(false);
+
+/** A zone that has been left. */
+struct TraceEvent {
+	const char *name; ///< Name of the zone.
+	uint64 start;     ///< Time the zone was entered, in nanoseconds.
+	uint64 duration;  ///< Time spent in the zone, in nanoseconds.
+	uint32 id;        ///< Index of the item handled in the zone, or \c UINT32_MAX.
+};
+
+/** Number of events kept for each thread. */
+static const uint TRACE_BUFFER_EVENTS = 1 << 16;
+
+/**
+ * Ring buffer with the most recent events of a thread.
+ * Only the thread owning the buffer writes to it, without locking. Readers use the
+ * number of written events to determine which of the events they copied may have
+ * been overwritten while copying.
+ */
+struct TraceBuffer {
+	TraceEvent events[TRACE_BUFFER_EVENTS]; ///< The events, the oldest is overwritten first.
+	std::atomic<uint64> written;             ///< Number of events ever written to this buffer.
+	std::atomic<bool> in_use;                ///< Whether a running thread owns this buffer.
+	bool main_thread;                        ///< Whether the (last) owner is the main thread.
+};
+
+/** Releases the trace buffer of a thread when the thread exits, so a later thread can reuse it. */
+struct TraceBufferOwner {
+	TraceBuffer *buffer = nullptr; ///< The trace buffer of this thread, if it has any yet.
+
+	~TraceBufferOwner()
+	{
+		if (this->buffer != nullptr) this->buffer->in_use.store(false);
+	}
+};
+
+static std::mutex _trace_buffers_mutex;                        ///< Protects #_trace_buffers.
+static std::vector<std::unique_ptr<TraceBuffer>> _trace_buffers; ///< Trace buffers of all threads that recorded zones.
+static thread_local TraceBufferOwner _trace_buffer_owner;      ///< Trace buffer of the current thread.
+
+/** Number of game ticks of which the start is kept. */
+static const uint TRACE_GAME_TICKS = 4096;
+static uint64 _trace_game_ticks[TRACE_GAME_TICKS]; ///< Start times of the most recent game ticks; only used by the main thread.
+static uint64 _trace_game_ticks_written;           ///< Number of game ticks recorded since tracing was started.
+static uint64 _trace_start;                        ///< Time tracing was started; events of earlier starts are not dumped.
+
+/**
+ * Get the current time for trace events.
+ * @return Time in nanoseconds of a steady clock.
+ */
+uint64 GetTraceTimestamp()
+{
+	using namespace std::chrono;
+	return (uint64)duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * Get the trace buffer of the current thread, claiming one the first time.
+ * @return The trace buffer.
+ */
+static TraceBuffer *GetTraceBuffer()
+{
+	TraceBuffer *buffer = _trace_buffer_owner.buffer;
+	if (buffer != nullptr) return buffer;
+
+	std::lock_guard<std::mutex> lock(_trace_buffers_mutex);
+	for (auto &b : _trace_buffers) {
+		if (!b->in_use.load()) {
+			buffer = b.get();
+			break;
+		}
+	}
+	if (buffer == nullptr) {
+		_trace_buffers.emplace_back(new TraceBuffer());
+		buffer = _trace_buffers.back().get();
+		buffer->written.store(0);
+	}
+	buffer->in_use.store(true);
+	buffer->main_thread = !IsNonMainThread();
+	_trace_buffer_owner.buffer = buffer;
+	return buffer;
+}
+
+/**
+ * Record that the current thread left a zone.
+ * @param name Name of the zone.
+ * @param id Index of the item handled in the zone, or \c UINT32_MAX.
+ * @param start Time the zone was entered.
+ */
+void AddTraceEvent(const char *name, uint32 id, uint64 start)
+{
+	const uint64 end = GetTraceTimestamp();
+	TraceBuffer *buffer = GetTraceBuffer();
+
+	const uint64 written = buffer->written.load(std::memory_order_relaxed);
+	TraceEvent &event = buffer->events[written % TRACE_BUFFER_EVENTS];
+	event.name = name;
+	event.start = start;
+	event.duration = end - start;
+	event.id = id;
+	buffer->written.store(written + 1, std::memory_order_release);
+}
+
+/** Record the start of a game tick. */
+void AddTraceGameTick()
+{
+	_trace_game_ticks[_trace_game_ticks_written % TRACE_GAME_TICKS] = GetTraceTimestamp();
+	_trace_game_ticks_written++;
+}
+
+/** Start recording the zones of all threads. */
+void StartTracing()
+{
+	if (IsTracing()) return;
+
+	_trace_start = GetTraceTimestamp();
+	_trace_game_ticks_written = 0;
+	_trace_zones_active.store(true);
+}
+
+/** Stop recording zones; the zones recorded so far can still be dumped. */
+void StopTracing()
+{
+	_trace_zones_active.store(false);
+}
+
+/**
+ * Whether zones are being recorded.
+ * @return True when tracing is active.
+ */
+bool IsTracing()
+{
+	return _trace_zones_active.load();
+}
+
+/** Print whether tracing is active and how much it recorded to the console. */
+void PrintTraceStatus()
+{
+	std::lock_guard<std::mutex> lock(_trace_buffers_mutex);
+	uint64 events = 0;
+	for (auto &b : _trace_buffers) events += min<uint64>(b->written.load(), TRACE_BUFFER_EVENTS);
+	IConsolePrintF(CC_INFO, "Tracing is %s, " OTTD_PRINTF64U " game ticks recorded, " OTTD_PRINTF64U " zones buffered for %u threads",
+			IsTracing() ? "active" : "inactive", _trace_game_ticks_written, events, (uint)_trace_buffers.size());
+}
+
+/**
+ * Copy the events of a trace buffer that started at or after a time.
+ * @param buffer The buffer to copy from.
+ * @param since Minimum start time of the events to copy.
+ * @param[out] events The vector to add the events to.
+ */
+static void CopyTraceEvents(const TraceBuffer *buffer, uint64 since, std::vector<TraceEvent> &events)
+{
+	const uint64 written = buffer->written.load(std::memory_order_acquire);
+	const uint64 first = written > TRACE_BUFFER_EVENTS ? written - TRACE_BUFFER_EVENTS : 0;
+
+	const size_t begin = events.size();
+	for (uint64 i = first; i < written; i++) {
+		events.push_back(buffer->events[i % TRACE_BUFFER_EVENTS]);
+	}
+
+	/* The owner may have overwritten the oldest events while copying; the event being written now is not valid either. */
+	const uint64 rewritten = buffer->written.load(std::memory_order_acquire) + 1;
+	const uint64 valid_first = rewritten > TRACE_BUFFER_EVENTS ? rewritten - TRACE_BUFFER_EVENTS : 0;
+
+	size_t out = begin;
+	for (uint64 i = first; i < written; i++) {
+		const TraceEvent &event = events[begin + (size_t)(i - first)];
+		if (i < valid_first || event.start < since) continue;
+		events[out++] = event;
+	}
+	events.resize(out);
+}
+
+/**
+ * Write the zones recorded during the most recent game ticks to a file in the Chrome trace event format,
+ * which can be viewed with e.g. chrome://tracing or https://ui.perfetto.dev.
+ * @param ticks Number of game ticks to write the zones of.
+ * @return True if the file was written.
+ */
+bool DumpTrace(uint ticks)
+{
+	if (_trace_game_ticks_written == 0) {
+		IConsolePrint(CC_WARNING, "No game ticks traced, nothing to dump.");
+		return false;
+	}
+
+	/* Find the start of the window of ticks to write. */
+	const uint64 kept_ticks = min<uint64>(_trace_game_ticks_written, TRACE_GAME_TICKS);
+	ticks = (uint)min<uint64>(max(ticks, 1U), kept_ticks);
+	const uint64 since = max(_trace_game_ticks[(_trace_game_ticks_written - ticks) % TRACE_GAME_TICKS], _trace_start);
+
+	time_t write_time = time(nullptr);
+	char timestamp[16] = {};
+	strftime(timestamp, lengthof(timestamp), "%Y%m%d-%H%M%S", localtime(&write_time));
+	char filename[MAX_PATH];
+	seprintf(filename, lastof(filename), "%strace-%s.json", FiosGetScreenshotDir(), timestamp);
+
+	FILE *f = FioFOpenFile(filename, "wt", Subdirectory::NO_DIRECTORY);
+	if (f == nullptr) {
+		IConsolePrintF(CC_ERROR, "Could not open '%s' for writing.", filename);
+		return false;
+	}
+	FileCloser fcloser(f);
+
+	std::lock_guard<std::mutex> lock(_trace_buffers_mutex);
+
+	size_t total = 0;
+	std::vector<TraceEvent> events;
+	fputs("{\"traceEvents\":[\n", f);
+	for (size_t tid = 0; tid < _trace_buffers.size(); tid++) {
+		const TraceBuffer *buffer = _trace_buffers[tid].get();
+		if (tid != 0) fputs(",\n", f);
+		if (buffer->main_thread) {
+			fprintf(f, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" PRINTF_SIZE ",\"args\":{\"name\":\"Main thread\"}}", tid);
+		} else {
+			fprintf(f, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" PRINTF_SIZE ",\"args\":{\"name\":\"Thread " PRINTF_SIZE "\"}}", tid, tid);
+		}
+
+		events.clear();
+		CopyTraceEvents(buffer, since, events);
+		for (const TraceEvent &event : events) {
+			fprintf(f, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":" PRINTF_SIZE ",\"ts\":%.3f,\"dur\":%.3f", event.name, tid, (event.start - since) / 1000.0, event.duration / 1000.0);
+			if (event.id != UINT32_MAX) fprintf(f, ",\"args\":{\"id\":%u}", event.id);
+			fputs("}", f);
+		}
+		total += events.size();
+	}
+	fputs("\n]}\n", f);
+
+	IConsolePrintF(CC_INFO, "Wrote " PRINTF_SIZE " zones of the last %u game ticks to %s", total, ticks, filename);
+	return true;
+}
+
+#endif /* USE_TRACE_ZONES */
@@ -0,0 +1,76 @@
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file tracing.h Tracing of the time spent in scoped zones, to find which items make a tick slow. */
+
+#ifndef TRACING_H
+#define TRACING_H
+
+#include <atomic>
+
+#ifdef USE_TRACE_ZONES
+
+extern std::atomic<bool> _trace_zones_active;
+
+uint64 GetTraceTimestamp();
+void AddTraceEvent(const char *name, uint32 id, uint64 start);
+void AddTraceGameTick();
+
+void StartTracing();
+void StopTracing();
+bool IsTracing();
+void PrintTraceStatus();
+bool DumpTrace(uint ticks);
+
+/**
+ * Records the time spent in its scope to the trace buffer of the current thread,
+ * if tracing was active when the scope was entered.
+ * Use #TRACE_ZONE or #TRACE_ZONE_ID instead of using this directly.
+ */
+struct TraceZone {
+	const char *name; ///< Name of the zone; must be a string literal.
+	uint32 id;        ///< Index of the item handled in the zone, or \c UINT32_MAX.
+	uint64 start;     ///< Time the zone was entered, or 0 if tracing was not active then.
+
+	inline TraceZone(const char *name, uint32 id) : name(name), id(id), start(_trace_zones_active.load(std::memory_order_relaxed) ? GetTraceTimestamp() : 0) {}
+
+	TraceZone(const TraceZone &copysrc) = delete;
+
+	inline ~TraceZone()
+	{
+		if (this->start != 0) AddTraceEvent(this->name, this->id, this->start);
+	}
+};
+
+#define TRACE_ZONE_PASTE(a, b) a ## b
+#define TRACE_ZONE_NAME(line) TRACE_ZONE_PASTE(_trace_zone_, line)
+
+/**
+ * Trace the time spent in the rest of the current scope.
+ * @param name Name of the zone, a string literal.
+ */
+#define TRACE_ZONE(name) TraceZone TRACE_ZONE_NAME(__LINE__)(name, UINT32_MAX);
+
+/**
+ * Trace the time spent in the rest of the current scope for a single item.
+ * @param name Name of the zone, a string literal.
+ * @param id Index of the vehicle, station, town, ... handled in the zone.
+ */
+#define TRACE_ZONE_ID(name, id) TraceZone TRACE_ZONE_NAME(__LINE__)(name, id);
+
+/** Mark the start of a game tick, which bounds the windows of ticks that can be dumped. */
+#define TRACE_GAME_TICK() { if (_trace_zones_active.load(std::memory_order_relaxed)) AddTraceGameTick(); }
+
+#else /* USE_TRACE_ZONES */
+
+#define TRACE_ZONE(name)
+#define TRACE_ZONE_ID(name, id)
+#define TRACE_GAME_TICK()
+
+#endif /* USE_TRACE_ZONES */
+
+#endif /* TRACING_H */
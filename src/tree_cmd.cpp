@@ -19,9 +19,12 @@
 #include "company_func.h"
 #include "sound_func.h"
 #include "water.h"
+#include "pathfinder/water_regions.h"
+#include "string_func.h"
 #include "company_base.h"
 #include "core/random_func.hpp"
 #include "newgrf_generic.h"
+#include "thread.h"
 
 #include "table/strings.h"
 #include "table/tree_land.h"
@@ -53,6 +56,7 @@ byte _trees_tick_ctr;
 static const uint16 DEFAULT_TREE_STEPS = 1000;             ///< Default number of attempts for placing trees.
 static const uint16 DEFAULT_RAINFOREST_TREE_STEPS = 15000; ///< Default number of attempts for placing extra trees at rainforest in tropic.
 static const uint16 EDITOR_TREE_DIV = 5;                   ///< Game editor tree generation divisor factor.
+static const uint TREE_REGION_ROWS = 128;                   ///< Number of map rows in each region when placing trees in regions.
 
 /**
  * Tests if a tile can be converted to MP_TREES
@@ -98,6 +102,8 @@ static void PlantTreesOnTile(TileIndex tile, TreeType treetype, uint count, uint
 	switch (GetTileType(tile)) {
 		case MP_WATER:
 			ground = TREE_GROUND_SHORE;
+			/* The water tracks of the coast disappear. */
+			InvalidateWaterRegion(tile);
 			break;
 
 		case MP_CLEAR:
@@ -354,6 +360,217 @@ void PlaceTreesRandomly()
 	}
 }
 
+/**
+ * Tree placement for a new game within a band of map rows, using its own random sequence.
+ *
+ * Trees are only placed directly on tiles within the region, so all regions can be
+ * processed in parallel. Trees which would be placed outside the region are deferred
+ * instead, and placed afterwards by ApplyDeferred in a fixed region order.
+ */
+struct TreePlacerRegion {
+	/** Tree to place outside the region. */
+	struct DeferredTree {
+		TileIndex tile; ///< Tile to place the tree on.
+		uint32 r;       ///< Randomness value for PlaceTree.
+		int height;     ///< Height the tile must be near, or -1 for any height.
+	};
+
+	uint y_begin;                       ///< First row of the region.
+	uint y_end;                         ///< One past the last row of the region.
+	Randomizer random;                  ///< Random sequence of the region.
+	std::vector<DeferredTree> deferred; ///< Trees to place outside the region.
+
+	/**
+	 * Check whether a tile is within the region.
+	 * @param tile Tile to check.
+	 * @return True if the tile is in one of the region's rows.
+	 */
+	inline bool Contains(TileIndex tile) const
+	{
+		return TileY(tile) >= this->y_begin && TileY(tile) < this->y_end;
+	}
+
+	/**
+	 * Get a random tile within the region, like #RandomTileSeed.
+	 * @param r Randomness value.
+	 * @return The tile.
+	 */
+	inline TileIndex RandomTileSeed(uint32 r) const
+	{
+		return TileXY(r & MapMaxX(), this->y_begin + (r >> MapLogX()) % (this->y_end - this->y_begin));
+	}
+
+	void PlaceTreeGroups(uint num_groups);
+	void PlaceTreeAtSameHeight(TileIndex tile, int height);
+	void PlaceTreesRandomly(uint steps, uint rainforest_steps);
+	void ApplyDeferred() const;
+};
+
+/**
+ * Creates a number of tree groups centred within the region, like ::PlaceTreeGroups.
+ * @param num_groups Number of tree groups to place.
+ */
+void TreePlacerRegion::PlaceTreeGroups(uint num_groups)
+{
+	for (; num_groups != 0; num_groups--) {
+		TileIndex center_tile = this->RandomTileSeed(this->random.Next());
+
+		for (uint i = 0; i < DEFAULT_TREE_STEPS; i++) {
+			uint32 r = this->random.Next();
+			int x = GB(r, 0, 5) - 16;
+			int y = GB(r, 8, 5) - 16;
+			uint dist = abs(x) + abs(y);
+			TileIndex cur_tile = TileAddWrap(center_tile, x, y);
+			if (cur_tile == INVALID_TILE || dist > 13) continue;
+
+			if (!this->Contains(cur_tile)) {
+				this->deferred.push_back({ cur_tile, r, -1 });
+			} else if (CanPlantTreesOnTile(cur_tile, true)) {
+				PlaceTree(cur_tile, r);
+			}
+		}
+	}
+}
+
+/**
+ * Place a tree at the same height as an existing tree, like ::PlaceTreeAtSameHeight.
+ * Whether a tile outside the region is suitable is only decided when the deferred trees are placed.
+ * @param tile The base tile to add a new tree somewhere around
+ * @param height The height (like the one from the tile)
+ */
+void TreePlacerRegion::PlaceTreeAtSameHeight(TileIndex tile, int height)
+{
+	for (uint i = 0; i < DEFAULT_TREE_STEPS; i++) {
+		uint32 r = this->random.Next();
+		int x = GB(r, 0, 5) - 16;
+		int y = GB(r, 8, 5) - 16;
+		TileIndex cur_tile = TileAddWrap(tile, x, y);
+		if (cur_tile == INVALID_TILE) continue;
+
+		/* Keep in range of the existing tree */
+		if (abs(x) + abs(y) > 16) continue;
+
+		if (!this->Contains(cur_tile)) {
+			this->deferred.push_back({ cur_tile, r, height });
+			break;
+		}
+
+		/* Clear tile, no farm-tiles or rocks */
+		if (!CanPlantTreesOnTile(cur_tile, true)) continue;
+
+		/* Not too much height difference */
+		if (Delta(GetTileZ(cur_tile), height) > 2) continue;
+
+		/* Place one tree and quit */
+		PlaceTree(cur_tile, r);
+		break;
+	}
+}
+
+/**
+ * Place some trees randomly within the region, like ::PlaceTreesRandomly.
+ * @param steps Number of attempts to place trees.
+ * @param rainforest_steps Number of attempts to place extra trees at rainforest area.
+ */
+void TreePlacerRegion::PlaceTreesRandomly(uint steps, uint rainforest_steps)
+{
+	for (; steps != 0; steps--) {
+		uint32 r = this->random.Next();
+		TileIndex tile = this->RandomTileSeed(r);
+
+		if (!CanPlantTreesOnTile(tile, true)) continue;
+
+		PlaceTree(tile, r);
+		if (_settings_game.game_creation.tree_placer != TP_IMPROVED) continue;
+
+		int ht = GetTileZ(tile);
+		/* The higher we get, the more trees we plant */
+		int j = ht * 2;
+		/* Above snowline more trees! */
+		if (_settings_game.game_creation.landscape == LT_ARCTIC && ht > GetSnowLine()) j *= 3;
+		while (j--) {
+			this->PlaceTreeAtSameHeight(tile, ht);
+		}
+	}
+
+	for (; rainforest_steps != 0; rainforest_steps--) {
+		uint32 r = this->random.Next();
+		TileIndex tile = this->RandomTileSeed(r);
+
+		if (GetTropicZone(tile) == TROPICZONE_RAINFOREST && CanPlantTreesOnTile(tile, false)) {
+			PlaceTree(tile, r);
+		}
+	}
+}
+
+/**
+ * Place the trees which fell outside the region, if their tiles are still suitable.
+ */
+void TreePlacerRegion::ApplyDeferred() const
+{
+	for (const DeferredTree &tree : this->deferred) {
+		if (!CanPlantTreesOnTile(tree.tile, true)) continue;
+		if (tree.height >= 0 && Delta(GetTileZ(tree.tile), tree.height) > 2) continue;
+		PlaceTree(tree.tile, tree.r);
+	}
+}
+
+/**
+ * Get the share of a total amount of work of one of a number of regions.
+ * @param total Total amount of work.
+ * @param region Index of the region.
+ * @param num_regions Number of regions.
+ * @return Amount of work of the region.
+ */
+static inline uint GetRegionShare(uint total, uint region, uint num_regions)
+{
+	return total / num_regions + (region < total % num_regions ? 1 : 0);
+}
+
+/**
+ * Place trees for a new game in regions of the map, which are processed in parallel.
+ * Each region has its own random sequence, so the result does not depend on the number of threads.
+ * @param num_groups Number of tree groups to place.
+ * @param rounds Number of times to place trees randomly.
+ */
+static void PlaceTreesInRegions(uint num_groups, uint rounds)
+{
+	/* Make sure GetRandomTreeType won't need to update the occurrence array from the worker threads. */
+	if (_settings_game.construction.trees_around_snow_line_range != _previous_trees_around_snow_line_range) RecalculateArcticTreeOccuranceArray();
+
+	uint steps = ScaleByMapSize(DEFAULT_TREE_STEPS);
+	uint rainforest_steps = (_settings_game.game_creation.landscape == LT_TROPIC) ? ScaleByMapSize(DEFAULT_RAINFOREST_TREE_STEPS) : 0;
+	if (_game_mode == GM_EDITOR) {
+		steps /= EDITOR_TREE_DIV;
+		rainforest_steps /= EDITOR_TREE_DIV;
+	}
+
+	const uint32 seed = Random();
+	const uint rows = min<uint>(TREE_REGION_ROWS, MapSizeY());
+	const uint num_regions = MapSizeY() / rows;
+	std::vector<TreePlacerRegion> regions(num_regions);
+	for (uint i = 0; i < num_regions; i++) {
+		regions[i].y_begin = i * rows;
+		regions[i].y_end = (i + 1) * rows;
+		regions[i].random.SetSeed(DeriveRandomSeed(seed, i, rows));
+	}
+
+	ParallelForRange("ottd:trees", 0, num_regions, 1, [&](uint begin, uint end) {
+		for (uint i = begin; i < end; i++) {
+			TreePlacerRegion &region = regions[i];
+			uint groups = GetRegionShare(num_groups, i, num_regions);
+			if (groups != 0) region.PlaceTreeGroups(groups);
+			for (uint round = 0; round < rounds; round++) {
+				region.PlaceTreesRandomly(GetRegionShare(steps, i, num_regions), GetRegionShare(rainforest_steps, i, num_regions));
+			}
+		}
+	});
+
+	for (const TreePlacerRegion &region : regions) {
+		region.ApplyDeferred();
+	}
+}
+
 /**
  * Remove all trees
  *
@@ -399,6 +616,12 @@ void GenerateTrees()
 	total += num_groups * DEFAULT_TREE_STEPS;
 	SetGeneratingWorldProgress(GWP_TREE, total);
 
+	if (_settings_game.game_creation.tree_placer_regions) {
+		PlaceTreesInRegions(num_groups, i);
+		IncreaseGeneratingWorldProgress(GWP_TREE, total);
+		return;
+	}
+
 	if (num_groups != 0) PlaceTreeGroups(num_groups);
 
 	for (; i != 0; i--) {
@@ -729,6 +952,38 @@ static void TileLoopTreesAlps(TileIndex tile)
 	MarkTileDirtyByTile(tile, ZOOM_LVL_DRAW_MAP);
 }
 
+/**
+ * Turn a tile with a single dying tree back into the ground below the tree.
+ * @param tile The tile.
+ */
+static void RemoveLastTree(TileIndex tile)
+{
+	switch (GetTreeGround(tile)) {
+		case TREE_GROUND_SHORE:
+			MakeShore(tile);
+			/* A flooded tree on a coast with one corner raised leaves a coast with water tracks. */
+			InvalidateWaterRegion(tile);
+			break;
+		case TREE_GROUND_GRASS: MakeClear(tile, CLEAR_GRASS, GetTreeDensity(tile)); break;
+		case TREE_GROUND_ROUGH: MakeClear(tile, CLEAR_ROUGH, 3); break;
+		case TREE_GROUND_ROUGH_SNOW: {
+			uint density = GetTreeDensity(tile);
+			MakeClear(tile, CLEAR_ROUGH, 3);
+			MakeSnow(tile, density);
+			break;
+		}
+		default: // snow or desert
+			if (_settings_game.game_creation.landscape == LT_TROPIC) {
+				MakeClear(tile, CLEAR_DESERT, GetTreeDensity(tile));
+			} else {
+				uint density = GetTreeDensity(tile);
+				MakeClear(tile, CLEAR_GRASS, 3);
+				MakeSnow(tile, density);
+			}
+			break;
+	}
+}
+
 static void TileLoop_Trees(TileIndex tile)
 {
 	if (GetTreeGround(tile) == TREE_GROUND_SHORE) {
@@ -823,26 +1078,7 @@ static void TileLoop_Trees(TileIndex tile)
 				SetTreeGrowth(tile, 3);
 			} else {
 				/* just one tree, change type into MP_CLEAR */
-				switch (GetTreeGround(tile)) {
-					case TREE_GROUND_SHORE: MakeShore(tile); break;
-					case TREE_GROUND_GRASS: MakeClear(tile, CLEAR_GRASS, GetTreeDensity(tile)); break;
-					case TREE_GROUND_ROUGH: MakeClear(tile, CLEAR_ROUGH, 3); break;
-					case TREE_GROUND_ROUGH_SNOW: {
-						uint density = GetTreeDensity(tile);
-						MakeClear(tile, CLEAR_ROUGH, 3);
-						MakeSnow(tile, density);
-						break;
-					}
-					default: // snow or desert
-						if (_settings_game.game_creation.landscape == LT_TROPIC) {
-							MakeClear(tile, CLEAR_DESERT, GetTreeDensity(tile));
-						} else {
-							uint density = GetTreeDensity(tile);
-							MakeClear(tile, CLEAR_GRASS, 3);
-							MakeSnow(tile, density);
-						}
-						break;
-				}
+				RemoveLastTree(tile);
 			}
 			break;
 
@@ -903,6 +1139,57 @@ static CommandCost TerraformTile_Trees(TileIndex tile, DoCommandFlag flags, int
 }
 
 
+/**
+ * Check that the cached water regions stay up to date when a tree grows on, or dies on, a coast tile.
+ * A tree is planted on and removed from the first coast tile that allows it. Then the tree of a
+ * flooded coast tile with water tracks dies. After each step the cache is compared with the map.
+ * The map is the same as before afterwards.
+ * @param b buffer to write the results to
+ * @param last last valid position of the buffer
+ */
+void CheckShoreTreeWaterRegions(char *b, const char *last)
+{
+	const TreeType type = (TreeType)_tree_base_by_landscape[_settings_game.game_creation.landscape];
+
+	auto report = [&](const char *step, TileIndex tile) {
+		std::vector<uint> stale = GetStaleWaterRegions();
+		b += seprintf(b, last, "  %s at %u x %u: %u stale water regions\n", step, TileX(tile), TileY(tile), (uint)stale.size());
+	};
+
+	TileIndex plant_tile = INVALID_TILE;
+	TileIndex flood_tile = INVALID_TILE;
+	for (TileIndex tile = 0; tile < MapSize(); tile++) {
+		if (!IsTileType(tile, MP_WATER) || !IsCoast(tile) || IsBridgeAbove(tile)) continue;
+		if (plant_tile == INVALID_TILE && CanPlantTreesOnTile(tile, true)) plant_tile = tile;
+		if (flood_tile == INVALID_TILE && IsSlopeWithOneCornerRaised(GetTileSlope(tile))) flood_tile = tile;
+	}
+
+	b += seprintf(b, last, "Shore trees and water regions:\n");
+	if (plant_tile != INVALID_TILE) {
+		GetWaterComponentID(plant_tile);
+		PlantTreesOnTile(plant_tile, type, 0, 3);
+		report("planted tree", plant_tile);
+		GetWaterComponentID(plant_tile);
+		RemoveLastTree(plant_tile);
+		report("removed tree", plant_tile);
+		MarkTileDirtyByTile(plant_tile);
+	} else {
+		b += seprintf(b, last, "  no coast tile to plant a tree on\n");
+	}
+
+	if (flood_tile != INVALID_TILE) {
+		/* This is what a tree tile with one corner raised becomes when it is flooded. */
+		MakeTree(flood_tile, type, 0, 3, TREE_GROUND_SHORE, 3);
+		InvalidateWaterRegion(flood_tile);
+		GetWaterComponentID(flood_tile);
+		RemoveLastTree(flood_tile);
+		report("removed flooded tree", flood_tile);
+		MarkTileDirtyByTile(flood_tile);
+	} else {
+		b += seprintf(b, last, "  no coast tile with water tracks\n");
+	}
+}
+
 extern const TileTypeProcs _tile_type_trees_procs = {
 	DrawTile_Trees,           // draw_tile_proc
 	GetSlopePixelZ_Trees,     // get_slope_z_proc
@@ -58,6 +58,7 @@
 #include "string_func.h"
 #include "scope_info.h"
 #include "debug_settings.h"
+#include "tracing.h"
 #include "3rdparty/cpp-btree/btree_set.h"
 
 #include "table/strings.h"
@@ -457,25 +458,72 @@ byte VehicleRandomBits()
 	return GB(Random(), 0, 8);
 }
 
-/* Size of the hash, 6 = 64 x 64, 7 = 128 x 128. Larger sizes will (in theory) reduce hash
- * lookup times at the expense of memory usage. */
-const int HASH_BITS = 7;
-const int HASH_SIZE = 1 << HASH_BITS;
-const int HASH_MASK = HASH_SIZE - 1;
-const int TOTAL_HASH_SIZE = 1 << (HASH_BITS * 2);
-const int TOTAL_HASH_MASK = TOTAL_HASH_SIZE - 1;
+/* Size of the hash along each axis, 7 = 128, 9 = 512. The hash scales with the map so that about 4 x 4
+ * tiles share a chain on maps of up to 2048 tiles along an axis; on larger maps more tiles share a chain,
+ * e.g. 8 x 8 on a 4096 x 4096 map. The occupancy bitmap keeps lookups on empty tiles from walking those
+ * longer chains. Larger sizes reduce hash lookup times at the expense of memory usage. */
+const int HASH_BITS_MIN = 7;
+const int HASH_BITS_MAX = 9;
 
 /* Resolution of the hash, 0 = 1*1 tile, 1 = 2*2 tiles, 2 = 4*4 tiles, etc.
  * Profiling results show that 0 is fastest. */
 const int HASH_RES = 0;
 
-static Vehicle *_vehicle_tile_hash[TOTAL_HASH_SIZE * 4];
+static uint _vehicle_tile_hash_bits_x;             ///< Number of bits of the hash along the x axis.
+static uint _vehicle_tile_hash_bits_y;             ///< Number of bits of the hash along the y axis.
+static uint _vehicle_tile_hash_type_size;          ///< Number of hash entries for each vehicle type.
+static std::vector<Vehicle *> _vehicle_tile_hash;  ///< Vehicle tile hash, one block of #_vehicle_tile_hash_type_size entries for each vehicle type.
+
+/**
+ * Occupancy bitmap of each vehicle type, one bit per tile.
+ * A bit is set whenever a vehicle of the type is hashed onto the tile, and cleared by
+ * #UpdateVehicleTileHash when the last vehicle hashed onto the tile leaves it.
+ * A cleared bit therefore guarantees there is no vehicle of that type on the tile.
+ */
+static std::vector<uint64> _vehicle_tile_occupancy[VEH_COMPANY_END];
+
+/**
+ * Get the entry of the vehicle tile hash for the given hash coordinates.
+ * @param x X coordinate in the hash.
+ * @param y Y coordinate in the hash.
+ * @param type The vehicle type.
+ * @return The head of the hash chain.
+ */
+static inline Vehicle **GetVehicleTileHashEntry(uint x, uint y, VehicleType type)
+{
+	return &_vehicle_tile_hash[(y << _vehicle_tile_hash_bits_x) + x + (_vehicle_tile_hash_type_size * type)];
+}
+
+/**
+ * Get the entry of the vehicle tile hash a tile belongs to.
+ * @param tile The tile.
+ * @param type The vehicle type.
+ * @return The head of the hash chain.
+ */
+static inline Vehicle **GetVehicleTileHashEntry(TileIndex tile, VehicleType type)
+{
+	return GetVehicleTileHashEntry(GB(TileX(tile), HASH_RES, _vehicle_tile_hash_bits_x), GB(TileY(tile), HASH_RES, _vehicle_tile_hash_bits_y), type);
+}
+
+/**
+ * Check whether a vehicle of the given type may be on a tile, according to the occupancy bitmap.
+ * @param tile The tile.
+ * @param type The vehicle type.
+ * @return False if there is certainly no vehicle of the type on the tile.
+ */
+static inline bool IsVehicleTileOccupancySet(TileIndex tile, VehicleType type)
+{
+	return tile >= MapSize() || HasBit(_vehicle_tile_occupancy[type][tile / 64], tile % 64);
+}
 
 static Vehicle *VehicleFromTileHash(int xl, int yl, int xu, int yu, VehicleType type, void *data, VehicleFromPosProc *proc, bool find_first)
 {
-	for (int y = yl; ; y = (y + (1 << HASH_BITS)) & (HASH_MASK << HASH_BITS)) {
-		for (int x = xl; ; x = (x + 1) & HASH_MASK) {
-			Vehicle *v = _vehicle_tile_hash[((x + y) & TOTAL_HASH_MASK) + (TOTAL_HASH_SIZE * type)];
+	const int x_mask = (1 << _vehicle_tile_hash_bits_x) - 1;
+	const int y_mask = (1 << _vehicle_tile_hash_bits_y) - 1;
+
+	for (int y = yl; ; y = (y + 1) & y_mask) {
+		for (int x = xl; ; x = (x + 1) & x_mask) {
+			Vehicle *v = *GetVehicleTileHashEntry(x, y, type);
 			for (; v != nullptr; v = v->hash_tile_next) {
 				Vehicle *a = proc(v, data);
 				if (find_first && a != nullptr) return a;
@@ -505,10 +553,10 @@ Vehicle *VehicleFromPosXY(int x, int y, VehicleType type, void *data, VehicleFro
 	const int COLL_DIST = 6;
 
 	/* Hash area to scan is from xl,yl to xu,yu */
-	int xl = GB((x - COLL_DIST) / TILE_SIZE, HASH_RES, HASH_BITS);
-	int xu = GB((x + COLL_DIST) / TILE_SIZE, HASH_RES, HASH_BITS);
-	int yl = GB((y - COLL_DIST) / TILE_SIZE, HASH_RES, HASH_BITS) << HASH_BITS;
-	int yu = GB((y + COLL_DIST) / TILE_SIZE, HASH_RES, HASH_BITS) << HASH_BITS;
+	int xl = GB((x - COLL_DIST) / TILE_SIZE, HASH_RES, _vehicle_tile_hash_bits_x);
+	int xu = GB((x + COLL_DIST) / TILE_SIZE, HASH_RES, _vehicle_tile_hash_bits_x);
+	int yl = GB((y - COLL_DIST) / TILE_SIZE, HASH_RES, _vehicle_tile_hash_bits_y);
+	int yu = GB((y + COLL_DIST) / TILE_SIZE, HASH_RES, _vehicle_tile_hash_bits_y);
 
 	return VehicleFromTileHash(xl, yl, xu, yu, type, data, proc, find_first);
 }
@@ -525,10 +573,9 @@ Vehicle *VehicleFromPosXY(int x, int y, VehicleType type, void *data, VehicleFro
  */
 Vehicle *VehicleFromPos(TileIndex tile, VehicleType type, void *data, VehicleFromPosProc *proc, bool find_first)
 {
-	int x = GB(TileX(tile), HASH_RES, HASH_BITS);
-	int y = GB(TileY(tile), HASH_RES, HASH_BITS) << HASH_BITS;
+	if (!IsVehicleTileOccupancySet(tile, type)) return nullptr;
 
-	Vehicle *v = _vehicle_tile_hash[((x + y) & TOTAL_HASH_MASK) + (TOTAL_HASH_SIZE * type)];
+	Vehicle *v = *GetVehicleTileHashEntry(tile, type);
 	for (; v != nullptr; v = v->hash_tile_next) {
 		if (v->tile != tile) continue;
 
@@ -700,20 +747,42 @@ CommandCost EnsureNoTrainOnTrackBits(TileIndex tile, TrackBits track_bits)
 	return CommandCost();
 }
 
+/**
+ * Clear the occupancy bit of a tile a vehicle has left, unless another vehicle of the type is still on it.
+ * @param hash The hash chain of the tile.
+ * @param tile The tile the vehicle has left.
+ * @param type The vehicle type.
+ */
+static void UpdateVehicleTileOccupancy(Vehicle * const *hash, TileIndex tile, VehicleType type)
+{
+	if (tile >= MapSize()) return;
+
+	for (const Vehicle *v = *hash; v != nullptr; v = v->hash_tile_next) {
+		if (v->hash_tile == tile || v->tile == tile) return;
+	}
+	ClrBit(_vehicle_tile_occupancy[type][tile / 64], tile % 64);
+}
+
 void UpdateVehicleTileHash(Vehicle *v, bool remove)
 {
 	Vehicle **old_hash = v->hash_tile_current;
+	const TileIndex old_tile = v->hash_tile;
 	Vehicle **new_hash;
 
 	if (remove || HasBit(v->subtype, GVSF_VIRTUAL)) {
 		new_hash = nullptr;
+		v->hash_tile = INVALID_TILE;
 	} else {
-		int x = GB(TileX(v->tile), HASH_RES, HASH_BITS);
-		int y = GB(TileY(v->tile), HASH_RES, HASH_BITS) << HASH_BITS;
-		new_hash = &_vehicle_tile_hash[((x + y) & TOTAL_HASH_MASK) + (TOTAL_HASH_SIZE * v->type)];
+		new_hash = GetVehicleTileHashEntry(v->tile, v->type);
+		v->hash_tile = v->tile;
+		if (v->tile < MapSize()) SetBit(_vehicle_tile_occupancy[v->type][v->tile / 64], v->tile % 64);
 	}
 
-	if (old_hash == new_hash) return;
+	if (old_hash == new_hash) {
+		/* Moved to another tile of the same chain. */
+		if (old_hash != nullptr && old_tile != v->hash_tile) UpdateVehicleTileOccupancy(old_hash, old_tile, v->type);
+		return;
+	}
 
 	/* Remove from the old position in the hash table */
 	if (old_hash != nullptr) {
@@ -731,15 +800,35 @@ void UpdateVehicleTileHash(Vehicle *v, bool remove)
 
 	/* Remember current hash position */
 	v->hash_tile_current = new_hash;
+
+	if (old_hash != nullptr) UpdateVehicleTileOccupancy(old_hash, old_tile, v->type);
 }
 
 bool ValidateVehicleTileHash(const Vehicle *v)
 {
 	if ((v->type == VEH_TRAIN && Train::From(v)->IsVirtual()) || v->type >= VEH_COMPANY_END) return v->hash_tile_current == nullptr;
 
-	int x = GB(TileX(v->tile), HASH_RES, HASH_BITS);
-	int y = GB(TileY(v->tile), HASH_RES, HASH_BITS) << HASH_BITS;
-	return v->hash_tile_current == &_vehicle_tile_hash[((x + y) & TOTAL_HASH_MASK) + (TOTAL_HASH_SIZE * v->type)];
+	return v->hash_tile_current == GetVehicleTileHashEntry(v->tile, v->type) && IsVehicleTileOccupancySet(v->tile, v->type);
+}
+
+/**
+ * (Re)allocate the vehicle tile hash and occupancy bitmaps for the current map size.
+ * Vehicles are unlinked from the old hash; they have to be re-added, or be removed from the pool.
+ */
+void AllocateVehicleTileHash()
+{
+	for (Vehicle *v : Vehicle::Iterate()) { v->hash_tile_current = nullptr; }
+
+	_vehicle_tile_hash_bits_x = Clamp<int>(MapLogX() - 2, HASH_BITS_MIN, HASH_BITS_MAX);
+	_vehicle_tile_hash_bits_y = Clamp<int>(MapLogY() - 2, HASH_BITS_MIN, HASH_BITS_MAX);
+	_vehicle_tile_hash_type_size = 1 << (_vehicle_tile_hash_bits_x + _vehicle_tile_hash_bits_y);
+
+	_vehicle_tile_hash.assign(_vehicle_tile_hash_type_size * VEH_COMPANY_END, nullptr);
+	_vehicle_tile_hash.shrink_to_fit();
+	for (std::vector<uint64> &occupancy : _vehicle_tile_occupancy) {
+		occupancy.assign(CeilDiv(MapSize(), 64), 0);
+		occupancy.shrink_to_fit();
+	}
 }
 
 static Vehicle *_vehicle_viewport_hash[1 << (GEN_HASHX_BITS + GEN_HASHY_BITS)];
@@ -774,7 +863,10 @@ void ResetVehicleHash()
 {
 	for (Vehicle *v : Vehicle::Iterate()) { v->hash_tile_current = nullptr; }
 	memset(_vehicle_viewport_hash, 0, sizeof(_vehicle_viewport_hash));
-	memset(_vehicle_tile_hash, 0, sizeof(_vehicle_tile_hash));
+	std::fill(_vehicle_tile_hash.begin(), _vehicle_tile_hash.end(), nullptr);
+	for (std::vector<uint64> &occupancy : _vehicle_tile_occupancy) {
+		std::fill(occupancy.begin(), occupancy.end(), 0);
+	}
 }
 
 void ResetVehicleColourMap()
@@ -1246,6 +1338,8 @@ void VehicleTickMotion(Vehicle *v, Vehicle *front)
 
 void CallVehicleTicks()
 {
+	TRACE_ZONE("CallVehicleTicks");
+
 	_vehicles_to_autoreplace.clear();
 	_vehicles_to_templatereplace.clear();
 	_vehicles_to_pay_repair.clear();
@@ -1292,6 +1386,7 @@ void CallVehicleTicks()
 		}
 		_tick_train_too_heavy_cache.clear();
 		for (Train *front : _tick_train_front_cache) {
+			TRACE_ZONE_ID("Train tick", front->index);
 			v = front;
 			if (!front->Train::Tick()) continue;
 			for (Train *u = front; u != nullptr; u = u->Next()) {
@@ -1304,6 +1399,7 @@ void CallVehicleTicks()
 	{
 		PerformanceMeasurer framerate(PFE_GL_ROADVEHS);
 		for (RoadVehicle *front : _tick_road_veh_front_cache) {
+			TRACE_ZONE_ID("Road vehicle tick", front->index);
 			v = front;
 			if (!front->RoadVehicle::Tick()) continue;
 			for (RoadVehicle *u = front; u != nullptr; u = u->Next()) {
@@ -1316,6 +1412,7 @@ void CallVehicleTicks()
 	{
 		PerformanceMeasurer framerate(PFE_GL_AIRCRAFT);
 		for (Aircraft *front : _tick_aircraft_front_cache) {
+			TRACE_ZONE_ID("Aircraft tick", front->index);
 			v = front;
 			if (!front->Aircraft::Tick()) continue;
 			for (Aircraft *u = front; u != nullptr; u = u->Next()) {
@@ -1327,6 +1424,7 @@ void CallVehicleTicks()
 	{
 		PerformanceMeasurer framerate(PFE_GL_SHIPS);
 		for (Ship *s : _tick_ship_cache) {
+			TRACE_ZONE_ID("Ship tick", s->index);
 			v = s;
 			if (!s->Ship::Tick()) continue;
 			VehicleTickCargoAging(s);
@@ -2902,7 +3000,7 @@ void Vehicle::BeginLoading()
 						((this->orders.list == nullptr ? OrderList::CanAllocateItem() : this->orders.list->GetNumOrders() < MAX_VEH_ORDER_ID)) &&
 						Order::CanAllocateItem()) {
 					/* Insert new implicit order */
-					Order *implicit_order = new Order();
+					Order *implicit_order = NewOrderToInsert(this, this->cur_implicit_order_index);
 					implicit_order->MakeImplicit(this->last_station_visited);
 					InsertOrder(this, implicit_order, this->cur_implicit_order_index);
 					if (this->cur_implicit_order_index > 0) --this->cur_implicit_order_index;